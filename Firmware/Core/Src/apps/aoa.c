@@ -0,0 +1,240 @@
+/*
+ * aoa.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timebase.h"
+#include "uart_stdio.h"
+
+#include "application_config.h"
+#include "aoa.h"
+
+#define PI_Q11			(6434)		/* pi in [1:-11] radians */
+#define STATE_BITS		(8)			/* additional fraction bits of the filter state */
+#define PI_STATE		(PI_Q11 << STATE_BITS)
+#define SIN_ONE			(32767)		/* sin(angle) = 1 in Q15 */
+#define ASIN_STEP_BITS	(8)			/* table step 256 / 32768 */
+#define ASIN_DIRECT_MAX	(23170)		/* 1/sqrt(2) in Q15, above: 90 degrees - asin(sqrt(1 - x^2)) */
+
+/* Factor from PDoA to sin(angle) in Q16: wavelength / (2 * pi * antenna distance) */
+#define SIN_FACTOR_Q16(freq_hz) \
+	((int32_t)(299792458.0 / (freq_hz) * 1000.0 / (2.0 * 3.14159265358979 * AOA_ANTENNA_DISTANCE_MM) * 65536.0 + 0.5))
+
+static const int32_t sin_factor_ch5 = SIN_FACTOR_Q16(6489.6e6);
+static const int32_t sin_factor_ch9 = SIN_FACTOR_Q16(7987.2e6);
+
+/* asin(i * 256 / 32768) in millidegrees, i = 0..96 (sin up to 0.75) */
+static const int32_t asin_table[97] = {
+	0, 448, 895, 1343, 1791, 2239, 2687, 3135,
+	3583, 4032, 4481, 4930, 5379, 5829, 6279, 6730,
+	7181, 7632, 8084, 8536, 8989, 9443, 9897, 10352,
+	10807, 11263, 11720, 12177, 12636, 13095, 13555, 14016,
+	14478, 14940, 15404, 15869, 16335, 16802, 17270, 17739,
+	18210, 18682, 19155, 19630, 20106, 20583, 21062, 21542,
+	22024, 22508, 22993, 23481, 23969, 24460, 24953, 25448,
+	25944, 26443, 26944, 27448, 27953, 28461, 28972, 29484,
+	30000, 30518, 31039, 31563, 32090, 32620, 33153, 33689,
+	34229, 34772, 35319, 35869, 36424, 36982, 37544, 38111,
+	38682, 39258, 39838, 40424, 41014, 41610, 42212, 42819,
+	43433, 44052, 44678, 45311, 45951, 46599, 47254, 47918,
+	48590,
+};
+
+typedef struct
+{
+	int32_t measured;
+	int32_t true_angle;
+} cal_point_t;
+
+#define CAL_POINT_ENTRY(measured, true_angle) { measured, true_angle },
+static const cal_point_t cal_points[] = {
+	AOA_CALIBRATION_POINTS(CAL_POINT_ENTRY)
+	{ 0, 0 },  /* end of table */
+};
+#undef CAL_POINT_ENTRY
+
+#define CAL_POINT_COUNT (sizeof(cal_points) / sizeof(cal_points[0]) - 1)
+
+static int16_t pdoa_offset = AOA_PDOA_OFFSET;
+
+/* Filter */
+static int32_t state = 0;		/* filtered PDoA << STATE_BITS, wrapped to +-pi */
+static uint8_t state_valid = 0;
+static uint64_t last_update_us = 0;
+
+/* Result */
+static int16_t last_pdoa = 0;
+static int32_t angle_mdeg = 0;
+static uint8_t flags = 0;
+
+/* Offset calibration ("aoa cal") */
+static uint16_t cal_remaining = 0;
+static int16_t cal_reference = 0;
+static int32_t cal_sum = 0;
+
+static char print_buffer[64];
+
+/* Wrap to -pi..pi (pi given in the same scale as value) */
+static int32_t wrap(int32_t value, int32_t pi)
+{
+	while (value >= pi) {
+		value -= 2 * pi;
+	}
+	while (value < -pi) {
+		value += 2 * pi;
+	}
+	return value;
+}
+
+static uint32_t isqrt(uint32_t value)
+{
+	uint32_t result = 0;
+	uint32_t bit = 1ul << 30;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= result + bit) {
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return result;
+}
+
+/* asin of 0 <= x <= 1 (Q15) in millidegrees */
+static int32_t asin_mdeg(int32_t x)
+{
+	if (x > ASIN_DIRECT_MAX) {
+		/* the table is too coarse where asin gets steep */
+		return 90000 - asin_mdeg((int32_t)isqrt((1ul << 30) - (uint32_t)(x * x)));
+	}
+
+	const int32_t index = x >> ASIN_STEP_BITS;
+	const int32_t fraction = x & ((1 << ASIN_STEP_BITS) - 1);
+	return asin_table[index] + (((asin_table[index + 1] - asin_table[index]) * fraction) >> ASIN_STEP_BITS);
+}
+
+/* Piecewise linear correction, the first and last point are extended as constant offset */
+static int32_t calibrate(int32_t angle)
+{
+	if (CAL_POINT_COUNT == 0) {
+		return angle;
+	}
+	if (angle <= cal_points[0].measured) {
+		return angle + cal_points[0].true_angle - cal_points[0].measured;
+	}
+	for (uint32_t i = 1; i < CAL_POINT_COUNT; i++) {
+		const cal_point_t *a = &cal_points[i - 1];
+		const cal_point_t *b = &cal_points[i];
+		if (angle <= b->measured) {
+			return a->true_angle + (int32_t)((int64_t)(angle - a->measured) * (b->true_angle - a->true_angle)
+					/ (b->measured - a->measured));
+		}
+	}
+	const cal_point_t *last = &cal_points[CAL_POINT_COUNT - 1];
+	return angle + last->true_angle - last->measured;
+}
+
+static void calibration_sample(int16_t pdoa)
+{
+	if (cal_remaining == AOA_CAL_SAMPLES) {
+		cal_reference = pdoa;
+	}
+	/* relative to the first sample to average across the +-pi boundary */
+	cal_sum += wrap(pdoa - cal_reference, PI_Q11);
+	cal_remaining--;
+
+	if (cal_remaining == 0) {
+		pdoa_offset = (int16_t)wrap(cal_reference + cal_sum / AOA_CAL_SAMPLES, PI_Q11);
+		aoa_reset();
+		snprintf(print_buffer, sizeof(print_buffer), "AoA offset: %d\n", pdoa_offset);
+		stdio_write(print_buffer);
+	}
+}
+
+void aoa_reset(void)
+{
+	state_valid = 0;
+}
+
+void aoa_update(int16_t pdoa, uint8_t channel)
+{
+	const uint64_t now_us = timebase_us();
+
+	if (cal_remaining > 0) {
+		calibration_sample(pdoa);
+	}
+	last_pdoa = pdoa;
+
+	const int32_t corrected = wrap((int32_t)pdoa - pdoa_offset, PI_Q11) << STATE_BITS;
+	if (!state_valid || (now_us - last_update_us > AOA_FILTER_TIMEOUT_US)) {
+		state = corrected;
+		state_valid = 1;
+		flags |= AOA_FLAG_FILTER_RESET;
+	} else {
+		/* step to the nearest equivalent of the new PDoA (unwrapping) */
+		const int32_t step = wrap(corrected - state, PI_STATE);
+		state = wrap(state + (step >> AOA_FILTER_SHIFT), PI_STATE);
+	}
+	last_update_us = now_us;
+
+	const int32_t factor = (channel == 9) ? sin_factor_ch9 : sin_factor_ch5;
+	int32_t sin_q15 = ((state >> STATE_BITS) * factor) >> 12;  /* Q11 * Q16 -> Q15 */
+	if (sin_q15 > SIN_ONE || sin_q15 < -SIN_ONE) {
+		sin_q15 = (sin_q15 > 0) ? SIN_ONE : -SIN_ONE;
+		flags |= AOA_FLAG_CLAMPED;
+	}
+
+	const int32_t angle = (sin_q15 < 0) ? -asin_mdeg(-sin_q15) : asin_mdeg(sin_q15);
+	angle_mdeg = calibrate(angle);
+}
+
+int32_t aoa_angle_mdeg(void)
+{
+	return angle_mdeg;
+}
+
+void aoa_export(uint32_t dist_mm, uint16_t twr_count, int16_t rx_power_cdbm, int16_t fp_power_cdbm)
+{
+	meas_aoa_t aoa_blob = {
+			angle_mdeg, (int16_t)(state >> STATE_BITS), last_pdoa, dist_mm, rx_power_cdbm, fp_power_cdbm,
+			twr_count, flags, { 0 }
+	};
+	flags = 0;
+
+	stdio_write(AOA_BLOB_HEADER);
+	stdio_write_binary((const uint8_t*)&aoa_blob, AOA_BLOB_SIZE);
+	stdio_write("\n");
+}
+
+void aoa_command(const char *arguments)
+{
+	if (strcmp(arguments, "cal") == 0) {
+		cal_remaining = AOA_CAL_SAMPLES;
+		cal_sum = 0;
+		stdio_write("AoA calibration started\n");
+		return;
+	}
+
+	if (strncmp(arguments, "offset ", 7) == 0) {
+		pdoa_offset = (int16_t)wrap(atoi(arguments + 7), PI_Q11);
+		aoa_reset();
+	} else if (arguments[0] != '\0') {
+		snprintf(print_buffer, sizeof(print_buffer), "Unknown aoa command: %s\n", arguments);
+		stdio_write(print_buffer);
+		return;
+	}
+
+	snprintf(print_buffer, sizeof(print_buffer), "AoA offset: %d\n", pdoa_offset);
+	stdio_write(print_buffer);
+}
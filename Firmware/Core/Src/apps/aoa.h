@@ -0,0 +1,62 @@
+/*
+ * aoa.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_AOA_H_
+#define SRC_APPS_AOA_H_
+
+#include <stdint.h>
+
+/* Angle of arrival from the PDoA of the double antenna module
+ *
+ * The DW3000 reports the phase difference between its two antennas in [1:-11] radians (2048 = 1 rad).
+ * With the antenna distance d and the wavelength l of the channel the angle is
+ *
+ *   angle = arcsin(pdoa * l / (2 * pi * d))
+ *
+ * Each PDoA is corrected by the board offset (AOA_PDOA_OFFSET, or measured at runtime with "aoa cal"),
+ * unwrapped against the filtered PDoA (so a target at the +-pi boundary does not average to 0) and
+ * low pass filtered (alpha = 2^-AOA_FILTER_SHIFT). The arcsin is an interpolated table in
+ * millidegrees (error < 0.01 degrees up to 60 degrees, the Q15 sine limits it to 0.15 degrees close
+ * to +-90 degrees), the result is finally corrected with AOA_CALIBRATION_POINTS (piecewise linear
+ * between (measured, true) angle pairs from a turntable measurement, identity if empty).
+ *
+ * aoa_export() transmits the result as aoa blob, see Scripts/binary_parser.py.
+ *
+ * Serial commands: "aoa cal" averages the next AOA_CAL_SAMPLES PDoA values as board offset (the
+ * anchor has to be at 0 degrees), "aoa offset <n>" sets it, "aoa" prints it.
+ */
+
+#define AOA_ANTENNA_DISTANCE_MM	(23.1)		/* Distance of the antenna phase centers */
+#define AOA_PDOA_OFFSET			(0)			/* PDoA at 0 degrees of this board in [1:-11] radians */
+#define AOA_FILTER_SHIFT		(2)			/* Filter weight of a new PDoA: 1/4 */
+#define AOA_FILTER_TIMEOUT_US	(2000000)	/* Restart the filter after this time without PDoA */
+#define AOA_CAL_SAMPLES			(64)
+
+/* Correction of the angle: (measured, true) in millidegrees, ascending measured angle */
+#define AOA_CALIBRATION_POINTS(X) \
+	/* X(-60000, -61500) */
+
+/* Result flags */
+#define AOA_FLAG_CLAMPED		(0x01)		/* |sin| > 1 (PDoA larger than possible at the antenna distance) */
+#define AOA_FLAG_FILTER_RESET	(0x02)		/* First PDoA after a reset or timeout of the filter */
+
+/* Restart the filter */
+void aoa_reset(void);
+
+/* Add the PDoA of a received frame (measured on the given channel) */
+void aoa_update(int16_t pdoa, uint8_t channel);
+
+/* Filtered angle of arrival in millidegrees (0: broadside) */
+int32_t aoa_angle_mdeg(void);
+
+/* Transmit the current result as aoa blob (with distance and power levels of the exchange, see
+ * signal_power.h) */
+void aoa_export(uint32_t dist_mm, uint16_t twr_count, int16_t rx_power_cdbm, int16_t fp_power_cdbm);
+
+/* Process the serial command "aoa <arguments>" */
+void aoa_command(const char *arguments);
+
+#endif /* SRC_APPS_AOA_H_ */
@@ -0,0 +1,300 @@
+/*
+ * app_framework.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "deca_regs.h"
+#include "deca_spi.h"
+#include "port.h"
+#include "uart_stdio.h"
+#include "timebase.h"
+#include "profile.h"
+
+#include "applications.h"
+#include "application_config.h"
+#include "app_framework.h"
+#include "radio_config.h"
+#include "spi_link.h"
+#include "aoa.h"
+
+/* All applications that can be selected with the "app" command */
+static const application_t *const applications[] = {
+		&app_tx,
+		&app_rx,
+		&app_cir,
+		&app_pdoa,
+		&app_twr_tag,
+		&app_twr_tag_duty,
+		&app_twr_pdoa_tag,
+		&app_twr_anchor,
+		&app_twr_multi_tag,
+		&app_twr_multi_anchor,
+		&app_tx_test,
+};
+
+#define APPLICATION_COUNT (sizeof(applications) / sizeof(applications[0]))
+
+static const application_t *current_app = NULL;
+
+/* Active radio configuration (kept when switching applications) and configuration waiting to be applied */
+static dwt_config_t device_config;
+static dwt_config_t pending_config;
+static uint8_t config_pending = 0;
+static uint16_t config_count = 0;
+
+/* The SPI rate is selected by the self-test after the first device initialization */
+static uint8_t spi_tuned = 0;
+
+static char command_buffer[64];
+static char print_buffer[64];
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn find_application()
+ *
+ * @brief Look up an application by name
+ *
+ * @param  name  application name
+ *
+ * @return  application or NULL if there is none with this name
+ */
+static const application_t *find_application(const char *name)
+{
+	for (size_t i = 0; i < APPLICATION_COUNT; i++) {
+		if (strcmp(applications[i]->name, name) == 0) {
+			return applications[i];
+		}
+	}
+	return NULL;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn init_device()
+ *
+ * @brief Reset, initialize and configure the DW3000 and set up the interrupts of an application
+ *
+ * @param  app  application to prepare the device for
+ *
+ * @return  DWT_SUCCESS or DWT_ERROR
+ */
+static int init_device(const application_t *app)
+{
+	/* Stop any ongoing transmission or reception and detach the previous application */
+	port_set_dwic_isr(NULL);
+	dwt_forcetrxoff();
+
+	/* Reset DW IC */
+	reset_DWIC(); /* Target specific drive of RSTn line into DW IC low for a period. */
+
+	Sleep(20); // Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC, or could wait for SPIRDY event)
+
+	while (!dwt_checkidlerc()) /* Need to make sure DW IC is in IDLE_RC before proceeding */
+	{ };
+
+	/* Select the SPI rate before any configuration is written at an untested rate */
+	if (!spi_tuned)
+	{
+		spi_link_tune();
+		spi_tuned = 1;
+	}
+
+	if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
+	{
+		stdio_write("INIT FAILED\n");
+		return DWT_ERROR;
+	}
+
+	stdio_write("INITIALIZED\n");
+
+	spi_link_enable_crc();
+
+	/* Enabling LEDs here for debug so that for each RX-enable the D2 LED will flash on DW3000 red eval-shield boards. */
+	dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
+
+	/* Configure DW IC. */
+	if(dwt_configure(&device_config)) /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration has failed the host should reset the device */
+	{
+		stdio_write("CONFIG FAILED\n");
+		return DWT_ERROR;
+	}
+
+	if (spi_link_write_error())
+	{
+		stdio_write("SPI CRC ERROR\n");
+		return DWT_ERROR;
+	}
+
+	stdio_write("CONFIGURED\n");
+
+	radio_config_export(&device_config, config_count);
+
+	if (app->interrupts)
+	{
+		/* Register call-backs. */
+		dwt_setcallbacks(app->tx_done_cb, app->rx_ok_cb, app->rx_to_cb, app->rx_err_cb, NULL, NULL);
+
+		/* Enable the interrupts of the application. */
+		dwt_setinterrupt(app->interrupts, 0, DWT_ENABLE_INT);
+
+		/*Clearing the SPI ready interrupt*/
+		dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+
+		/* Install DW IC IRQ handler. */
+		port_set_dwic_isr(dwt_isr);
+	}
+
+	return DWT_SUCCESS;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn apply_pending_config()
+ *
+ * @brief Reconfigure the radio with the pending configuration, called between exchanges of the application
+ *
+ * @return  none
+ */
+static void apply_pending_config(void)
+{
+	config_pending = 0;
+
+	if (current_app == NULL) {
+		/* Nothing running, the configuration is applied when the next application is started */
+		device_config = pending_config;
+		config_count++;
+		return;
+	}
+
+	dwt_forcetrxoff();
+
+	if (dwt_configure(&pending_config)) /* PLL or RX calibration failed, the device has to be reset */
+	{
+		stdio_write("CONFIG FAILED, restoring previous configuration\n");
+		app_framework_select(current_app->name);
+		return;
+	}
+
+	device_config = pending_config;
+	config_count++;
+	radio_config_export(&device_config, config_count);
+
+	if (current_app->resume != NULL) {
+		current_app->resume();
+	}
+}
+
+const dwt_config_t *app_framework_config(void)
+{
+	return &device_config;
+}
+
+int app_framework_select(const char *name)
+{
+	const application_t *app = find_application(name);
+	if (app == NULL) {
+		snprintf(print_buffer, sizeof(print_buffer), "Unknown application: %s\n", name);
+		stdio_write(print_buffer);
+		return DWT_ERROR;
+	}
+
+	/* The main loop must not call the previous application while the device is reconfigured */
+	current_app = NULL;
+
+	stdio_write(app->banner);
+	stdio_write("\n");
+
+	int result = init_device(app);
+	for (int attempt = 1; (result != DWT_SUCCESS) && (attempt < SPI_LINK_RETRIES); attempt++) {
+		result = init_device(app);
+	}
+	if (result != DWT_SUCCESS) {
+		/* Stay responsive to commands, a different application can still be selected */
+		return DWT_ERROR;
+	}
+
+	if (app->check_config != NULL && app->check_config(&device_config) != DWT_SUCCESS) {
+		/* Keep the configuration of a parameter sweep, but make the failing exchanges visible in the log */
+		stdio_write("config warning: the exchanges of this application will fail, use \"config default\"\n");
+	}
+
+	app->start();
+	current_app = app;
+	return DWT_SUCCESS;
+}
+
+void app_framework_command(const char *line)
+{
+	if (strncmp(line, "app ", 4) == 0) {
+		app_framework_select(line + 4);
+	} else if (strcmp(line, "apps") == 0) {
+		for (size_t i = 0; i < APPLICATION_COUNT; i++) {
+			snprintf(print_buffer, sizeof(print_buffer), "App: %s%s\n", applications[i]->name,
+					(applications[i] == current_app) ? " (running)" : "");
+			stdio_write(print_buffer);
+		}
+	} else if (strcmp(line, "config") == 0) {
+		radio_config_export(&device_config, config_count);
+	} else if (strncmp(line, "config ", 7) == 0) {
+		/* Changes are collected until the application is idle, later commands build on earlier ones */
+		dwt_config_t new_config = config_pending ? pending_config : device_config;
+		int result;
+		if (strcmp(line + 7, "default") == 0) {
+			radio_config_default(&new_config);
+			result = DWT_SUCCESS;
+		} else {
+			result = radio_config_parse(&new_config, line + 7);
+		}
+		if (result == DWT_SUCCESS && current_app != NULL && current_app->check_config != NULL) {
+			result = current_app->check_config(&new_config);
+		}
+		if (result == DWT_SUCCESS) {
+			pending_config = new_config;
+			config_pending = 1;
+		}
+	} else if (strcmp(line, "aoa") == 0) {
+		aoa_command("");
+	} else if (strncmp(line, "aoa ", 4) == 0) {
+		aoa_command(line + 4);
+	} else if (current_app != NULL && current_app->command != NULL && current_app->command(line) == DWT_SUCCESS) {
+		/* handled by the application */
+	} else if (line[0] != '\0') {
+		snprintf(print_buffer, sizeof(print_buffer), "Unknown command: %s\n", line);
+		stdio_write(print_buffer);
+	}
+}
+
+/**
+ * Application entry point.
+ */
+int dw_main(void)
+{
+	/* The SPI starts at the CubeMX rate, the fastest reliable rate (DW IC supports up to 38 MHz) is
+	 * selected by spi_link_tune() before the first device initialization */
+	radio_config_default(&device_config);
+
+	app_framework_select(APPLICATION_DEFAULT);
+
+	while (1)
+	{
+		if (stdio_read_line(command_buffer, sizeof(command_buffer)) > 0) {
+			app_framework_command(command_buffer);
+		}
+
+		const int idle = (current_app == NULL || current_app->idle == NULL || current_app->idle());
+		if (config_pending && idle) {
+			apply_pending_config();
+		}
+
+		if (idle) {
+			PROFILE_POLL();
+		}
+
+		if (current_app != NULL) {
+			current_app->loop();
+		}
+	}
+
+	return DWT_SUCCESS;
+}
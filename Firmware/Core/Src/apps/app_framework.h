@@ -0,0 +1,61 @@
+/*
+ * app_framework.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_APP_FRAMEWORK_H_
+#define SRC_APPS_APP_FRAMEWORK_H_
+
+#include <stdint.h>
+
+#include "deca_device_api.h"
+
+/* Application plug-in description
+ *
+ * The framework resets, initializes and configures the DW3000, registers the callbacks and enables the
+ * interrupts of the selected application before calling start(). Afterwards loop() is called repeatedly
+ * from the main loop. loop() has to return regularly (i.e. one step of the state machine per call) so
+ * serial commands can be processed, blocking for a few hundred milliseconds is fine.
+ *
+ * Applications are switched at runtime with the serial command "app <name>", "apps" lists all of them.
+ * The radio configuration is changed with "config ..." (see radio_config.h). The new configuration is
+ * applied between two loop() calls once idle() reports that no exchange is in progress, the transceiver
+ * is switched off for this and resume() has to restart reception if the application needs it.
+ * Applications with fixed frame timing reject configurations with too long frames in check_config().
+ * Serial commands the framework does not know are passed to command() of the running application.
+ */
+typedef struct
+{
+	const char *name;			// Name used to select the application
+	const char *banner;			// Printed when the application is started (should contain "DW3000" for serial_reader.py)
+	uint32_t interrupts;		// Interrupts to enable (SYS_ENABLE_LO register), 0 for polled applications
+	dwt_cb_t tx_done_cb;		// TX frame sent
+	dwt_cb_t rx_ok_cb;			// RX good frame
+	dwt_cb_t rx_to_cb;			// RX timeout
+	dwt_cb_t rx_err_cb;			// RX error
+	void (*start)(void);		// Called once after the device is configured (reset application state here)
+	void (*loop)(void);			// Called repeatedly from the main loop
+	int (*idle)(void);			// Nonzero between exchanges, the radio is only reconfigured then (NULL: any time)
+	void (*resume)(void);		// Called after the radio was reconfigured (transceiver is off), NULL if not needed
+	int (*check_config)(const dwt_config_t *cfg);	// DWT_ERROR (with message) if the timing of the application does not work with cfg, NULL: any configuration
+	int (*command)(const char *line);	// Application specific serial command, DWT_ERROR if the command is unknown (NULL: none)
+} application_t;
+
+/* Interrupts used by all interrupt driven ranging applications (TX confirmation, RX good frames, RX timeouts
+ * and RX errors) */
+#define APP_INTERRUPTS_TXRX (SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK | \
+		SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK | \
+		SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK)
+
+/* Stop the running application and start the application with the given name.
+ * Returns DWT_ERROR if there is no such application or the device could not be initialized. */
+int app_framework_select(const char *name);
+
+/* Process one serial command line (without line ending) */
+void app_framework_command(const char *line);
+
+/* Active radio configuration */
+const dwt_config_t *app_framework_config(void);
+
+#endif /* SRC_APPS_APP_FRAMEWORK_H_ */
@@ -10,8 +10,9 @@
 
 #include "deca_device_api.h"
 
-/* Communication configuration (enabling STS mode 1 makes this incompatible with the DW1000!). */
-static dwt_config_t config = {
+/* Communication configuration (enabling STS mode 1 makes this incompatible with the DW1000!).
+ * Applied by the application framework (app_framework.c) when an application is started. */
+static const dwt_config_t config = {
     5,                /* Channel number. */
 	DWT_PLEN_64,      /* Preamble length. Used in TX only. */
     DWT_PAC8,         /* Preamble acquisition chunk size. Used in RX only. */
@@ -59,56 +60,55 @@ typedef struct
 } twr_final_frame_t;
 
 
-/* Binary measurement data structures */
+/* Broadcast-poll many-responder ranging (application_twr_multi_tag.c / application_twr_multi_anchor.c)
+ *
+ * The tag sends one broadcast poll, every anchor replies in its own delayed TX slot and the tag closes
+ * the exchange with a single final frame containing the round and reply times for all anchors. This
+ * needs N+2 frames for N anchors instead of 4N. Check the slot timing with Scripts/twr_timing_model.py
+ * after changing the radio configuration above or any of the values below. At runtime the "config"
+ * command rejects radio configurations whose frames do not fit into the slots (radio_config.c).
+ */
+#define MULTI_TWR_ANCHOR_COUNT		(4)		/* Number of response slots (i.e. maximum number of anchors) */
+#define MULTI_TWR_FIRST_SLOT_US		(1000)	/* Delay from RX of the poll to TX of the response in slot 0 */
+#define MULTI_TWR_SLOT_US			(1000)	/* Spacing between two response slots */
+#define MULTI_TWR_FINAL_GUARD_US	(1000)	/* Delay from the end of the last slot to TX of the final frame */
+#define MULTI_TWR_MARGIN_US			(200)	/* Processing time needed between the end of a frame and the next */
+#define MULTI_TWR_NO_DISTANCE		(0xFFFFFFFF)
 
 typedef struct
 {
-	// Version 3
-	uint32_t	cia_diag_1;		// Diagnostics common to both sequences (undocumented CIA_DIAG_1 register)
-	uint16_t	ip_poa;			// Preamble POA
-	uint16_t	sts1_poa;		// POA of STS block 1
-	uint16_t	sts2_poa;		// POA of STS block 2
-	int16_t		pdoa;			// PDoA from two STS POAs signed int [1:-11] in radians
-	int16_t		xtal_offset;	// Estimated xtal offset of remote device
-	int16_t		sts_qual_index;	// STS quality value
-	uint8_t		sts_qual;		// STS quality indicator
-	uint8_t		tdoa_sign;		// TDoA is a signed 41-bit integer, store the sign bit here
-	uint8_t		tdoa[5];		// TDoA from two STS RX timestamps (40-bit without sign)
-	uint8_t		ip_toa[5];		// Preamble/Ipatov RX timestamp
-	uint8_t		ip_toast;		// RX status of preamble
-	uint8_t		sts1_toa[5];	// STS RX timestamp on antenna 1
-	uint8_t		sts1_toast;		// RX status of STS on antenna 1 (only high 8-bits, discarding reserved bit 23 in the register)
-	uint8_t		sts2_toa[5];	// STS RX timestamp on antenna 2
-	uint8_t		sts2_toast;		// RX status of STS on antenna 2 (only high 8-bits, discarding reserved bit 23 in the register)
-	uint8_t		fp_th_md;		// First path threshold test mode
-	uint8_t		dgc_decision;	// DGC decision index (used for RSSI estimation)
-	uint8_t		padding[1];		// 43 bytes of data, padded to multiple of 4 (because of uint32_t)
-} meas_time_poa_t;  // with padding 44 bytes
-
+	uint8_t frame_control[2];	// Frame Control field (c.f. ISO/IEC 24730-62:2013 p. 35f)
+	uint8_t sequence_number;	// Data Sequence Number (DSN)
+	uint8_t pan_id[2];			// PAN ID (for ISO/IEC 24730-62:2013 TWR this should be 0x609A
+	uint8_t dst_address[2];		// Destination address (short address mode)
+	uint8_t src_address[2];		// Source address (short address mode)
+	uint8_t twr_function_code;	// Fuction code (borrowing from ISO/IEC 24730-62:2013, but this implementation is not standard conforming!)
+	uint8_t slot;				// Response slot used by the anchor
+	uint8_t last_dist_mm[4];	// Distance computed by the anchor in the previous exchange (MULTI_TWR_NO_DISTANCE if unknown)
+//	uint8_t fcs[2];				// Frame Check Sequence (FCS) (automatically generated by the DW3000)
+} twr_multi_response_frame_t;
 
 typedef struct
 {
-	// Version 1
-	uint32_t	peak;			// index and amplitude of peak sample in CIR
-	uint32_t	power;			// channel area allows estimation of channel power (note: 32-bit for preamble, 16-bit for STS)
-	uint32_t	F1;				// F1
-	uint32_t	F2;				// F2
-	uint32_t	F3;				// F3
-	uint16_t	fp_index;		// First path index
-	uint16_t	accum_count;	// Number accumulated symbols
-} meas_cir_analysis_t;  // 24 bytes, no padding required
-
+	uint8_t poll_resp_round_time[5];	// Time from TX of poll to RX of the response in this slot (i.e. Tround1)
+	uint8_t resp_final_reply_time[5];	// Time from RX of the response in this slot to TX of final frame (i.e. Treply2)
+} twr_multi_final_slot_t;
 
 typedef struct
 {
-	// Version 2
-	uint64_t	Treply1;		// Tag: tx response - rx poll
-	uint64_t	Treply2;		// Anchor: tx final - rx response
-	uint64_t	Tround1;		// Anchor: rx response - tx poll
-	uint64_t	Tround2;		// Tag: rx final - tx response
-	uint32_t	dist_mm;		// Estimated distance in mm
-	uint16_t	twr_count;		// Counter of TWR ranging exchanges
-	uint16_t	rotation;		// Rotation in degrees from initial position
-} meas_twr_t;  // 40 bytes, no padding required
+	uint8_t frame_control[2];	// Frame Control field (c.f. ISO/IEC 24730-62:2013 p. 35f)
+	uint8_t sequence_number;	// Data Sequence Number (DSN)
+	uint8_t pan_id[2];			// PAN ID (for ISO/IEC 24730-62:2013 TWR this should be 0x609A
+	uint8_t dst_address[2];		// Destination address (short address mode, broadcast)
+	uint8_t src_address[2];		// Source address (short address mode)
+	uint8_t twr_function_code;	// Fuction code (borrowing from ISO/IEC 24730-62:2013, but this implementation is not standard conforming!)
+	uint8_t valid_slots;		// Bit i is set if the response in slot i was received
+	twr_multi_final_slot_t slots[MULTI_TWR_ANCHOR_COUNT];
+//	uint8_t fcs[2];				// Frame Check Sequence (FCS) (automatically generated by the DW3000)
+} twr_multi_final_frame_t;
+
+
+/* Binary measurement data structures, generated from Scripts/blob_schema.py */
+#include "measurement_blobs.h"
 
 #endif /* SRC_APPS_APPLICATION_CONFIG_H_ */
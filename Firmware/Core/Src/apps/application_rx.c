@@ -5,11 +5,6 @@
  *      Author: Tobias Margiani
  */
 
-#include "applications.h"
-
-// RX example
-#ifdef APPLICATION_RX
-
 #include <stdio.h>
 #include <string.h>
 
@@ -18,96 +13,64 @@
 #include "port.h"
 #include "uart_stdio.h"
 
+#include "applications.h"
 #include "application_config.h"
+#include "rx_ring.h"
 
-/* Buffer to store received frame. See NOTE 1 below. */
-static uint8_t rx_buffer[127];
+// RX example
+static void rx_start(void);
+static void rx_loop(void);
+static int rx_idle(void);
+
+const application_t app_rx = {
+		.name = "rx",
+		.banner = "DW3000 TEST RX",
+		.interrupts = SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK | SYS_STATUS_ALL_RX_ERR,  /* RX good frames and RX errors */
+		.rx_ok_cb = rx_ring_rx_ok_cb,
+		.rx_to_cb = rx_ring_rx_err_cb,
+		.rx_err_cb = rx_ring_rx_err_cb,
+		.start = rx_start,
+		.loop = rx_loop,
+		.idle = rx_idle,
+		.resume = rx_ring_resume,  /* restart reception after reconfiguration */
+};
+
+static uint32_t reported_drops = 0;
+static char rx_print_buffer[48];
 
 /**
- * Application entry point.
+ * Start receiving frames in double buffer mode (frames are collected in the RX ring by the interrupt).
  */
-int dw_main(void)
+static void rx_start(void)
 {
-    /* Hold copy of status register state here for reference so that it can be examined at a debug breakpoint. */
-    uint32_t status_reg;
-    /* Hold copy of frame length of frame received (if good) so that it can be examined at a debug breakpoint. */
-    uint16_t frame_len;
-
-    stdio_write("DW3000 TEST RX\n");
-
-    /* Configure SPI rate, DW IC supports up to 38 MHz */
-    port_set_dw_ic_spi_fastrate();
-
-    /* Reset DW IC */
-    reset_DWIC(); /* Target specific drive of RSTn line into DW IC low for a period. */
-
-    Sleep(20); // Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC, or could wait for SPIRDY event)
-
-    while (!dwt_checkidlerc()) /* Need to make sure DW IC is in IDLE_RC before proceeding */
-    { };
-
-    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
-    {
-    	stdio_write("INIT FAILED\n");
-        while (1) { };
-    }
-
-    stdio_write("INITIALIZED\n");
-
-    /* Enabling LEDs here for debug so that for each RX-enable the D2 LED will flash on DW3000 red eval-shield boards. */
-    dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK) ;
+    reported_drops = 0;
+    rx_ring_start(1, 0);
+}
 
-    /* Configure DW IC. */
-    if(dwt_configure(&config)) /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration has failed the host should reset the device */
+/**
+ * Report the frames received since the last call.
+ */
+static void rx_loop(void)
+{
+    while (rx_ring_peek() != NULL)
     {
-    	stdio_write("CONFIG FAILED\n");
-        while (1)
-        { };
+        stdio_write("Frame Received\n");
+        rx_ring_release();
     }
 
-    stdio_write("CONFIGURED\n");
-
-    /* Loop forever receiving frames. */
-    while (1)
+    uint32_t dropped = rx_ring_dropped();
+    if (dropped != reported_drops)
     {
-        /* TESTING BREAKPOINT LOCATION #1 */
-
-        /* Clear local RX buffer to avoid having leftovers from previous receptions  This is not necessary but is included here to aid reading
-         * the RX buffer.
-         * This is a good place to put a breakpoint. Here (after first time through the loop) the local status register will be set for last event
-         * and if a good receive has happened the data buffer will have the data in it, and frame_len will be set to the length of the RX frame. */
-        memset(rx_buffer,0,sizeof(rx_buffer));
-
-        /* Activate reception immediately. See NOTE 2 below. */
-        dwt_rxenable(DWT_START_RX_IMMEDIATE);
-
-        /* Poll until a frame is properly received or an error/timeout occurs. See NOTE 3 below.
-         * STATUS register is 5 bytes long but, as the event we are looking at is in the first byte of the register, we can use this simplest API
-         * function to access it. */
-        while (!((status_reg = dwt_read32bitreg(SYS_STATUS_ID)) & (SYS_STATUS_RXFCG_BIT_MASK | SYS_STATUS_ALL_RX_ERR )))
-        { };
-
-        if (status_reg & SYS_STATUS_RXFCG_BIT_MASK)
-        {
-            /* A frame has been received, copy it to our local buffer. */
-            frame_len = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFLEN_BIT_MASK;
-            if (frame_len <= 127)
-            {
-                dwt_readrxdata(rx_buffer, frame_len-FCS_LEN, 0); /* No need to read the FCS/CRC. */
-            }
-
-            /* Clear good RX frame event in the DW IC status register. */
-            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RXFCG_BIT_MASK);
-
-            //stdio_write("Frame Received");
-            stdio_write("Frame Received\n");
-        }
-        else
-        {
-            /* Clear RX error events in the DW IC status register. */
-            dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_ALL_RX_ERR);
-        }
+        reported_drops = dropped;
+        snprintf(rx_print_buffer, sizeof(rx_print_buffer), "Frames dropped: %lu\n", dropped);
+        stdio_write(rx_print_buffer);
     }
 }
 
-#endif
+/**
+ * No frame waiting to be reported.
+ */
+static int rx_idle(void)
+{
+    return rx_ring_peek() == NULL;
+}
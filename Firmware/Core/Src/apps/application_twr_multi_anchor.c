@@ -0,0 +1,390 @@
+/*
+ * application_twr_multi_anchor.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "deca_regs.h"
+#include "deca_spi.h"
+#include "port.h"
+#include "timebase.h"
+#include "uart_stdio.h"
+
+#include "applications.h"
+#include "application_config.h"
+#include "shared_functions.h"
+#include "radio_config.h"
+#include "ranging_math.h"
+
+/* Response slot of this anchor after reset, every anchor taking part in the ranging needs a different
+ * slot in the range 0..MULTI_TWR_ANCHOR_COUNT-1 (changed at runtime with the serial command "slot <n>") */
+#define ANCHOR_SLOT_DEFAULT 0
+
+static void twr_multi_anchor_start(void);
+static void twr_multi_anchor_loop(void);
+static int twr_multi_anchor_idle(void);
+static void twr_multi_anchor_resume(void);
+static int twr_multi_anchor_command(const char *line);
+static void tx_done_cb(const dwt_cb_data_t *cb_data);
+static void rx_ok_cb(const dwt_cb_data_t *cb_data);
+static void rx_err_cb(const dwt_cb_data_t *cb_data);
+
+const application_t app_twr_multi_anchor = {
+		.name = "twr_multi_anchor",
+		.banner = "DW3000 TEST TWR Multi Anchor",
+		.interrupts = APP_INTERRUPTS_TXRX,
+		.tx_done_cb = tx_done_cb,
+		.rx_ok_cb = rx_ok_cb,
+		.rx_to_cb = rx_err_cb,
+		.rx_err_cb = rx_err_cb,
+		.start = twr_multi_anchor_start,
+		.loop = twr_multi_anchor_loop,
+		.idle = twr_multi_anchor_idle,
+		.resume = twr_multi_anchor_resume,
+		.check_config = radio_config_check_multi_twr,
+		.command = twr_multi_anchor_command,
+};
+
+static volatile uint8_t new_frame = 0;  /* Flag to indicate a new frame was received from the interrupt */
+static volatile uint16_t new_frame_length = 0;
+static volatile uint8_t tx_done = 0;
+
+static char print_buffer[64];
+
+static twr_multi_response_frame_t response_frame = {
+		{ 0x41, 0x88 },					/* Frame Control: data frame, short addresses */
+		0,								/* Sequence number */
+		{ 'X', 'X' },					/* PAN ID */
+		{ 'T', 'T' },					/* Destination address */
+		{ 'A', '0' + ANCHOR_SLOT_DEFAULT },	/* Source address */
+		0x10,							/* Function code: 0x10 activity control */
+		ANCHOR_SLOT_DEFAULT,			/* Response slot */
+		{ 0xFF, 0xFF, 0xFF, 0xFF },		/* Distance of the last exchange (none yet) */
+};
+
+#define MAX_FRAME_LENGTH (sizeof(twr_multi_final_frame_t) + 2)
+
+/* Response slot in use and slot requested by the "slot" command (applied between exchanges) */
+static uint8_t anchor_slot = ANCHOR_SLOT_DEFAULT;
+static uint8_t requested_slot = ANCHOR_SLOT_DEFAULT;
+
+/* Response delay relative to the RX timestamp of the poll */
+static uint64_t response_tx_delay = (MULTI_TWR_FIRST_SLOT_US + ANCHOR_SLOT_DEFAULT*MULTI_TWR_SLOT_US)*(uint64_t)US_TO_DWT_TIME;
+
+static uint64_t rx_timestamp_poll = 0;
+static uint64_t tx_timestamp_response = 0;
+static uint64_t rx_timestamp_final = 0;
+static int16_t remote_clock_offset = 0;	/* clock offset of the final frame (2^-26 units) */
+
+static uint8_t exchange_sequence_number = 0;
+
+enum state_t {
+	TWR_POLL_STATE,
+	TWR_FINAL_STATE,
+	TWR_ERROR,
+};
+
+static enum state_t state = TWR_POLL_STATE;
+
+/* timeout before waiting for the final frame will be abandoned */
+const static uint64_t ranging_timeout_us = 100000;
+
+/* Application state kept between loop calls */
+static uint8_t timestamp_buffer[5];
+static uint8_t rx_buffer[MAX_FRAME_LENGTH];
+static twr_multi_final_frame_t *rx_final_frame_pointer;
+static uint64_t last_poll_us;
+static uint32_t last_dist_mm;
+
+/**
+ * Switch to the requested response slot (source address, slot field and response delay).
+ */
+static void apply_slot(void)
+{
+	anchor_slot = requested_slot;
+	response_frame.src_address[1] = '0' + anchor_slot;
+	response_frame.slot = anchor_slot;
+	response_tx_delay = (MULTI_TWR_FIRST_SLOT_US + anchor_slot*MULTI_TWR_SLOT_US)*(uint64_t)US_TO_DWT_TIME;
+
+	/* The distance of the previous slot belongs to a different tag-anchor pair for the tag */
+	last_dist_mm = MULTI_TWR_NO_DISTANCE;
+}
+
+/**
+ * Reset the ranging state machine and wait for the broadcast poll of the tag.
+ */
+static void twr_multi_anchor_start(void)
+{
+	state = TWR_POLL_STATE;
+	tx_done = 0;
+	new_frame = 0;
+
+	/* Enable IC diagnostic calculation and logging */
+	dwt_configciadiag(DW_CIA_DIAG_LOG_ALL);
+
+	/* Activate reception immediately. */
+	dwt_rxenable(DWT_START_RX_IMMEDIATE);
+
+	apply_slot();
+	snprintf(print_buffer, sizeof(print_buffer), "Waiting for frames (slot %u of %u)\n", anchor_slot, MULTI_TWR_ANCHOR_COUNT);
+	stdio_write(print_buffer);
+
+	last_poll_us = timebase_us();
+}
+
+/**
+ * Run one step of the ranging state machine.
+ */
+static void twr_multi_anchor_loop(void)
+{
+	twr_base_frame_t *rx_frame_pointer;
+	int16_t sts_quality_index;
+
+	/* abandon the exchange if the final frame does not arrive */
+	if (state == TWR_FINAL_STATE && (timebase_us() - last_poll_us) > ranging_timeout_us) {
+		dwt_forcetrxoff();
+		stdio_write("Timeout -> reset\n");
+		state = TWR_POLL_STATE;
+		tx_done = 0;
+		new_frame = 0;
+		dwt_rxenable(DWT_START_RX_IMMEDIATE);
+	}
+
+	switch (state) {
+	case TWR_POLL_STATE:
+		/* Change the slot between exchanges only (the final frame refers to the slot of the response) */
+		if (requested_slot != anchor_slot) {
+			apply_slot();
+			snprintf(print_buffer, sizeof(print_buffer), "Anchor slot: %u of %u\n", anchor_slot, MULTI_TWR_ANCHOR_COUNT);
+			stdio_write(print_buffer);
+		}
+
+		/* Wait for broadcast poll frame (1/N+2) */
+		if (new_frame)
+		{
+			new_frame = 0;
+
+			if (new_frame_length != sizeof(twr_base_frame_t)+2) {
+				/* Most likely a frame of an exchange we are not part of, keep listening */
+				dwt_rxenable(DWT_START_RX_IMMEDIATE);
+				return;
+			}
+
+			int sts_quality = dwt_readstsquality(&sts_quality_index);
+			if (sts_quality < 0) { /* >= 0 good STS, < 0 bad STS */
+				stdio_write("RX ERR: bad STS quality\n");
+				state = TWR_ERROR;
+				return;
+			}
+
+			dwt_readrxdata(rx_buffer, new_frame_length, 0);
+			/* We assume this is a TWR frame, but not necessarily the right one */
+			rx_frame_pointer = (twr_base_frame_t *)rx_buffer;
+
+			if (rx_frame_pointer->twr_function_code != 0x21) {  /* broadcast poll */
+				stdio_write("RX ERR: wrong frame (expected poll)\n");
+				state = TWR_ERROR;
+				return;
+			}
+
+			dwt_readrxtimestamp(timestamp_buffer);
+			rx_timestamp_poll = decode_40bit_timestamp(timestamp_buffer);
+			last_poll_us = timebase_us();
+
+			/* All frames of one exchange carry the sequence number of the poll */
+			exchange_sequence_number = rx_frame_pointer->sequence_number;
+
+			/* Send response frame in our slot (2/N+2) */
+			response_frame.sequence_number = exchange_sequence_number;
+			response_frame.last_dist_mm[0] = (uint8_t)last_dist_mm;
+			response_frame.last_dist_mm[1] = (uint8_t)(last_dist_mm >> 8);
+			response_frame.last_dist_mm[2] = (uint8_t)(last_dist_mm >> 16);
+			response_frame.last_dist_mm[3] = (uint8_t)(last_dist_mm >> 24);
+			dwt_writetxdata(sizeof(response_frame), (uint8_t *)&response_frame, 0);
+			dwt_writetxfctrl(sizeof(response_frame)+2, 0, 1); /* Zero offset in TX buffer, ranging. */
+
+			/* The receiver stays on after the response to catch the final frame (the responses
+			 * of the other anchors will be received too and are skipped below) */
+			state = TWR_FINAL_STATE; /* Set early to ensure tx done interrupt arrives in new state */
+			dwt_setdelayedtrxtime((uint32_t)((rx_timestamp_poll + response_tx_delay) >> 8));
+			int r = dwt_starttx(DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED);
+			if (r != DWT_SUCCESS) {
+				stdio_write("TX ERR: delayed send time missed\n");
+				state = TWR_ERROR;
+				return;
+			}
+		}
+		break;
+	case TWR_FINAL_STATE:
+		if (tx_done == 1) {
+			tx_done = 2;
+			dwt_readtxtimestamp(timestamp_buffer);
+			tx_timestamp_response = decode_40bit_timestamp(timestamp_buffer);
+		}
+
+		/* Wait for final frame (N+2/N+2) */
+		if (new_frame == 1) {
+			new_frame = 0; /* reset */
+
+			if (new_frame_length != sizeof(twr_multi_final_frame_t)+2) {
+				/* Response of another anchor, keep listening for the final frame */
+				dwt_rxenable(DWT_START_RX_IMMEDIATE);
+				return;
+			}
+
+			int sts_quality = dwt_readstsquality(&sts_quality_index);
+			if (sts_quality < 0) { /* >= 0 good STS, < 0 bad STS */
+				stdio_write("RX ERR: bad STS quality\n");
+				state = TWR_ERROR;
+				return;
+			}
+
+			dwt_readrxdata(rx_buffer, new_frame_length, 0);
+			rx_final_frame_pointer = (twr_multi_final_frame_t *)rx_buffer;
+
+			if (rx_final_frame_pointer->twr_function_code != 0x23) { /* final */
+				stdio_write("RX ERR: wrong frame (expected final)\n");
+				state = TWR_ERROR;
+				return;
+			}
+
+			if (rx_final_frame_pointer->sequence_number != exchange_sequence_number) {
+				stdio_write("RX ERR: wrong sequence number\n");
+				state = TWR_ERROR;
+				return;
+			}
+
+			if (!(rx_final_frame_pointer->valid_slots & (1 << anchor_slot))) {
+				stdio_write("RX ERR: response not received by tag\n");
+				last_dist_mm = MULTI_TWR_NO_DISTANCE;
+				state = TWR_ERROR;
+				return;
+			}
+
+			dwt_readrxtimestamp(timestamp_buffer);
+			rx_timestamp_final = decode_40bit_timestamp(timestamp_buffer);
+			remote_clock_offset = dwt_readclockoffset();
+			new_frame = 2;
+		}
+
+		if ((tx_done == 2) && (new_frame == 2)) {
+			tx_done = 0;
+			new_frame = 0;
+
+			const twr_multi_final_slot_t *slot = &rx_final_frame_pointer->slots[anchor_slot];
+
+			const uint64_t Treply1 = tx_timestamp_response - rx_timestamp_poll;
+			const uint64_t Tround2 = rx_timestamp_final - tx_timestamp_response;
+
+			const uint64_t Tround1 = decode_40bit_timestamp(slot->poll_resp_round_time);
+			const uint64_t Treply2 = decode_40bit_timestamp(slot->resp_final_reply_time);
+
+			last_dist_mm = ranging_distance_mm(Treply1, Tround2, Tround1, Treply2, remote_clock_offset);
+
+			/* The tag receives the distance with our response in the next exchange */
+			snprintf(print_buffer, sizeof(print_buffer), "seq: %u, dist_mm: %lu\n", exchange_sequence_number, last_dist_mm);
+			stdio_write(print_buffer);
+
+			state = TWR_POLL_STATE;
+			dwt_rxenable(DWT_START_RX_IMMEDIATE);
+		}
+		break;
+	case TWR_ERROR:
+		stdio_write("Ranging error -> reset\n");
+		state = TWR_POLL_STATE;
+		tx_done = 0;
+		new_frame = 0;
+		dwt_forcetrxoff();
+		dwt_rxenable(DWT_START_RX_IMMEDIATE);
+	}
+}
+
+/**
+ * Idle while waiting for the broadcast poll of the next exchange.
+ */
+static int twr_multi_anchor_idle(void)
+{
+	return state == TWR_POLL_STATE && !new_frame;
+}
+
+/**
+ * Restart reception after the radio was reconfigured.
+ */
+static void twr_multi_anchor_resume(void)
+{
+	dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+/**
+ * Serial command "slot" (print the response slot) and "slot <n>" (select the response slot).
+ */
+static int twr_multi_anchor_command(const char *line)
+{
+	if (strncmp(line, "slot ", 5) == 0) {
+		char *end;
+		unsigned long slot = strtoul(line + 5, &end, 10);
+		if (end == line + 5 || *end != '\0' || slot >= MULTI_TWR_ANCHOR_COUNT) {
+			snprintf(print_buffer, sizeof(print_buffer), "slot error: %s is not in 0..%u\n", line + 5, MULTI_TWR_ANCHOR_COUNT - 1);
+			stdio_write(print_buffer);
+			return DWT_SUCCESS;
+		}
+		requested_slot = (uint8_t)slot;
+		return DWT_SUCCESS;
+	}
+	if (strcmp(line, "slot") == 0) {
+		snprintf(print_buffer, sizeof(print_buffer), "Anchor slot: %u of %u\n", requested_slot, MULTI_TWR_ANCHOR_COUNT);
+		stdio_write(print_buffer);
+		return DWT_SUCCESS;
+	}
+	return DWT_ERROR;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_done_cb()
+ *
+ * @brief Callback called after TX
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+static void tx_done_cb(const dwt_cb_data_t *cb_data)
+{
+	UNUSED(cb_data);
+	tx_done = 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_ok_cb()
+ *
+ * @brief Callback to process RX good frame events
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+static void rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+	new_frame = 1;
+	new_frame_length = cb_data->datalength;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_cb()
+ *
+ * @brief Callback to process RX error and timeout events
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+static void rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+	UNUSED(cb_data);
+	dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
@@ -0,0 +1,408 @@
+/*
+ * application_twr_multi_tag.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "deca_regs.h"
+#include "deca_spi.h"
+#include "port.h"
+#include "timebase.h"
+#include "uart_stdio.h"
+
+#include "applications.h"
+#include "application_config.h"
+#include "shared_functions.h"
+#include "radio_config.h"
+#include "trace_log.h"
+#include "measurement_export.h"
+
+static void twr_multi_tag_start(void);
+static void twr_multi_tag_loop(void);
+static int twr_multi_tag_idle(void);
+static void tx_done_cb(const dwt_cb_data_t *cb_data);
+static void rx_ok_cb(const dwt_cb_data_t *cb_data);
+static void rx_err_cb(const dwt_cb_data_t *cb_data);
+
+const application_t app_twr_multi_tag = {
+		.name = "twr_multi_tag",
+		.banner = "DW3000 TEST TWR Multi Tag",
+		.interrupts = APP_INTERRUPTS_TXRX,
+		.tx_done_cb = tx_done_cb,
+		.rx_ok_cb = rx_ok_cb,
+		.rx_to_cb = rx_err_cb,
+		.rx_err_cb = rx_err_cb,
+		.start = twr_multi_tag_start,
+		.loop = twr_multi_tag_loop,
+		.idle = twr_multi_tag_idle,
+		.check_config = radio_config_check_multi_twr,
+};
+
+static volatile uint8_t rx_done = 0;  /* Flag to indicate a new frame was received from the interrupt */
+static volatile uint16_t new_frame_length = 0;
+static volatile uint8_t tx_done = 0;
+
+static char print_buffer[64];
+
+static twr_base_frame_t poll_frame = {
+		{ 0x41, 0x88 },	/* Frame Control: data frame, short addresses */
+		0,				/* Sequence number */
+		{ 'X', 'X' },	/* PAN ID */
+		{ 0xFF, 0xFF },	/* Destination address (broadcast) */
+		{ 'T', 'T' },	/* Source address */
+		0x21,			/* Function code: 0x21 ranging poll */
+};
+
+static twr_multi_final_frame_t final_frame = {
+		{ 0x41, 0x88 },	/* Frame Control: data frame, short addresses */
+		0,				/* Sequence number */
+		{ 'X', 'X' },	/* PAN ID */
+		{ 0xFF, 0xFF },	/* Destination address (broadcast) */
+		{ 'T', 'T' },	/* Source address */
+		0x23,			/* Function code: 0x23 ranging final with embedded timestamps */
+		0,				/* Valid slots */
+		{ { { 0 } } },	/* Round and reply times of each slot */
+};
+
+#define MAX_FRAME_LENGTH (sizeof(twr_multi_final_frame_t) + 2)
+
+/* Final frame delay relative to the TX timestamp of the poll (after the last response slot) */
+const static uint64_t final_tx_delay = (MULTI_TWR_FIRST_SLOT_US + MULTI_TWR_ANCHOR_COUNT*MULTI_TWR_SLOT_US
+		+ MULTI_TWR_FINAL_GUARD_US)*(uint64_t)US_TO_DWT_TIME;
+
+/* Stop waiting for missing responses this long before the final frame is due (in units of 256 DW time units
+ * as returned by dwt_readsystimestamphi32()) */
+const static uint32_t final_prepare_time = (MULTI_TWR_FINAL_GUARD_US/2)*(uint64_t)US_TO_DWT_TIME >> 8;
+
+/* The DW3000 ignores the low 9 bits of the delayed TX time */
+#define DELAYED_TX_MASK (0xFFFFFFFE00llu)
+
+/* Intervals between 40-bit timestamps (the device time wraps every 17.2 s) */
+#define TIMESTAMP_MASK (0xFFFFFFFFFFllu)
+
+/* Measurement data of one response slot, collected while the exchange is running and transmitted after
+ * the final frame was sent (there is no time to transmit it between the slots) */
+typedef struct
+{
+	uint64_t rx_timestamp;
+	uint32_t last_dist_mm;
+	meas_time_poa_t toa;
+	meas_cir_analysis_t cir_analysis[3];
+} slot_data_t;
+
+static slot_data_t slot_data[MULTI_TWR_ANCHOR_COUNT];
+static uint8_t valid_slots = 0;
+static uint8_t received_count = 0;
+
+static uint64_t tx_timestamp_poll = 0;
+static uint64_t tx_timestamp_final = 0;
+
+static uint8_t next_sequence_number = 0;
+static uint8_t exchange_sequence_number = 0;
+
+enum state_t {
+	TWR_POLL_STATE,
+	TWR_RESPONSE_STATE,
+	TWR_FINAL_STATE,
+	TWR_ERROR,
+};
+
+static enum state_t state = TWR_POLL_STATE;
+
+/* timeout before the ranging exchange will be abandoned and restarted */
+const static uint64_t ranging_timeout_us = 1000000;
+
+static int send_final_frame(void);
+static void transmit_slot_data(uint16_t twr_count);
+
+/* Application state kept between loop calls */
+static uint8_t timestamp_buffer[5];
+static uint8_t rx_buffer[MAX_FRAME_LENGTH];
+static uint64_t last_poll_us;
+static uint16_t twr_count;
+
+/**
+ * Reset the ranging state machine, the first broadcast poll is sent from the loop.
+ */
+static void twr_multi_tag_start(void)
+{
+	state = TWR_POLL_STATE;
+	tx_done = 0;
+	rx_done = 0;
+
+	/* Enable IC diagnostic calculation and logging */
+	dwt_configciadiag(DW_CIA_DIAG_LOG_ALL);
+
+	last_poll_us = timebase_us();
+	twr_count = 0;
+
+	stdio_write("Wait 3s before starting...");
+	Sleep(3000);
+
+	snprintf(print_buffer, sizeof(print_buffer), "Config: twr/angle: -, slots: %u\n", MULTI_TWR_ANCHOR_COUNT);
+	stdio_write(print_buffer);
+}
+
+/**
+ * Run one step of the ranging state machine.
+ */
+static void twr_multi_tag_loop(void)
+{
+	twr_multi_response_frame_t *rx_response_pointer;
+	int16_t sts_quality_index;
+
+	/* check timeout and restart ranging if necessary (if there is an overflow in the tick counter the difference
+	 * will overflow too and will trigger the timeout, but that shouldn't be much of an issue) */
+	if ((timebase_us() - last_poll_us) > ranging_timeout_us) {
+		dwt_forcetrxoff();  // make sure receiver is off after a timeout
+		last_poll_us = timebase_us();
+		TRACE(TRACE_TIMEOUT);
+		trace_flush();
+		state = TWR_POLL_STATE;
+		tx_done = 0;
+		rx_done = 0;
+	}
+
+	switch (state) {
+	case TWR_POLL_STATE:
+		/* Send broadcast poll frame (1/N+2) */
+		last_poll_us = timebase_us();
+		valid_slots = 0;
+		received_count = 0;
+		exchange_sequence_number = next_sequence_number++;
+		poll_frame.sequence_number = exchange_sequence_number;
+		dwt_writetxdata(sizeof(poll_frame), (uint8_t *)&poll_frame, 0);
+		dwt_writetxfctrl(sizeof(poll_frame)+2, 0, 1); /* Zero offset in TX buffer, ranging. */
+
+		state = TWR_RESPONSE_STATE; /* Set early to ensure tx done interrupt arrives in new state */
+		int r = dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+		if (r != DWT_SUCCESS) {
+			state = TWR_ERROR;
+			TRACE(TRACE_TX_ERR_POLL);
+			return;
+		}
+		break;
+	case TWR_RESPONSE_STATE:
+		if (tx_done == 1) {
+			tx_done = 2;
+			dwt_readtxtimestamp(timestamp_buffer);
+			tx_timestamp_poll = decode_40bit_timestamp(timestamp_buffer);
+			tx_timestamp_final = (tx_timestamp_poll + final_tx_delay) & DELAYED_TX_MASK;
+		}
+
+		/* Collect responses (2..N+1/N+2) */
+		if (rx_done == 1) {
+			rx_done = 0; /* reset */
+
+			dwt_readrxdata(rx_buffer, sizeof(twr_multi_response_frame_t), 0);
+			rx_response_pointer = (twr_multi_response_frame_t *)rx_buffer;
+
+			/* Frames not belonging to this exchange are skipped, the remaining slots may still arrive */
+			if ((new_frame_length != sizeof(twr_multi_response_frame_t)+2)
+					|| (rx_response_pointer->twr_function_code != 0x10)
+					|| (rx_response_pointer->sequence_number != exchange_sequence_number)
+					|| (rx_response_pointer->slot >= MULTI_TWR_ANCHOR_COUNT)
+					|| (valid_slots & (1 << rx_response_pointer->slot))
+					|| (dwt_readstsquality(&sts_quality_index) < 0)) {
+				dwt_rxenable(DWT_START_RX_IMMEDIATE);
+				return;
+			}
+
+			/* Only the timestamp and the diagnostics registers are read now, everything else is
+			 * postponed until the exchange is complete. */
+			slot_data_t *data = &slot_data[rx_response_pointer->slot];
+			dwt_readrxtimestamp(timestamp_buffer);
+			data->rx_timestamp = decode_40bit_timestamp(timestamp_buffer);
+			data->last_dist_mm = ((uint32_t)rx_response_pointer->last_dist_mm[0])
+					+ ((uint32_t)rx_response_pointer->last_dist_mm[1] << 8)
+					+ ((uint32_t)rx_response_pointer->last_dist_mm[2] << 16)
+					+ ((uint32_t)rx_response_pointer->last_dist_mm[3] << 24);
+			export_read_rx_diagnostics(&data->toa, data->cir_analysis);
+
+			valid_slots |= 1 << rx_response_pointer->slot;
+			received_count++;
+
+			if (received_count < MULTI_TWR_ANCHOR_COUNT) {
+				dwt_rxenable(DWT_START_RX_IMMEDIATE);
+			}
+		}
+
+		if (tx_done == 2) {
+			/* Send the final frame when all anchors responded or the last slot is over */
+			const uint32_t deadline = (uint32_t)(tx_timestamp_final >> 8) - final_prepare_time;
+			if ((received_count == MULTI_TWR_ANCHOR_COUNT)
+					|| ((int32_t)(dwt_readsystimestamphi32() - deadline) >= 0)) {
+				tx_done = 0;
+				state = TWR_FINAL_STATE; /* Set early to ensure tx done interrupt arrives in new state */
+				if (send_final_frame() != DWT_SUCCESS) {
+					TRACE(TRACE_TX_ERR_DELAYED);
+					state = TWR_ERROR;
+					return;
+				}
+			}
+		}
+		break;
+	case TWR_FINAL_STATE:
+		/* Send final frame (N+2/N+2) */
+		if (tx_done == 1) {
+			tx_done = 0;
+
+			/* Transmit measurement data collected during the exchange */
+			transmit_slot_data(twr_count);
+
+			TRACE3(TRACE_MULTI_RESPONSES, twr_count, received_count, MULTI_TWR_ANCHOR_COUNT);
+			trace_flush();
+
+			/* Begin next ranging exchange */
+			twr_count++;
+			Sleep(5);
+			rx_done = 0;
+			state = TWR_POLL_STATE;
+		}
+		break;
+	case TWR_ERROR:
+		dwt_forcetrxoff();  // make sure receiver is off after an error
+		TRACE(TRACE_RANGING_ERROR);
+		trace_flush();
+		state = TWR_POLL_STATE;
+		Sleep(200);
+	}
+}
+
+/**
+ * Idle before the broadcast poll of the next exchange is sent.
+ */
+static int twr_multi_tag_idle(void)
+{
+	return state == TWR_POLL_STATE;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn send_final_frame()
+ *
+ * @brief Fill in the round and reply times of all received responses and schedule the final frame
+ *
+ * @return  DWT_SUCCESS if the delayed transmission was started in time
+ */
+static int send_final_frame(void)
+{
+	/* The receiver may still wait for missing responses */
+	dwt_forcetrxoff();
+
+	final_frame.sequence_number = exchange_sequence_number;
+	final_frame.valid_slots = valid_slots;
+
+	for (uint8_t i = 0; i < MULTI_TWR_ANCHOR_COUNT; i++) {
+		twr_multi_final_slot_t *slot = &final_frame.slots[i];
+		uint64_t Tround1 = 0;
+		uint64_t Treply2 = 0;
+
+		if (valid_slots & (1 << i)) {
+			Tround1 = slot_data[i].rx_timestamp - tx_timestamp_poll;
+			Treply2 = tx_timestamp_final - slot_data[i].rx_timestamp;
+		}
+
+		for (uint8_t j = 0; j < 5; j++) {
+			slot->poll_resp_round_time[j] = (uint8_t)(Tround1 >> (8*j));
+			slot->resp_final_reply_time[j] = (uint8_t)(Treply2 >> (8*j));
+		}
+	}
+
+	dwt_writetxdata(sizeof(final_frame), (uint8_t *)&final_frame, 0);
+	dwt_writetxfctrl(sizeof(final_frame)+2, 0, 1); /* Zero offset in TX buffer, ranging. */
+
+	/* Start transmission at the time used for the reply times embedded into the message */
+	dwt_setdelayedtrxtime((uint32_t)(tx_timestamp_final >> 8));
+	return dwt_starttx(DWT_START_TX_DELAYED);
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn transmit_slot_data()
+ *
+ * @brief Transmit the measurement data of all responses received in the last exchange
+ *
+ * @param  twr_count  counter of the exchange
+ *
+ * @return  none
+ */
+static void transmit_slot_data(uint16_t twr_count)
+{
+	for (uint8_t i = 0; i < MULTI_TWR_ANCHOR_COUNT; i++) {
+		if (!(valid_slots & (1 << i))) {
+			continue;
+		}
+		slot_data_t *data = &slot_data[i];
+
+		/* Marker for serial output parsing script*/
+		export_frame_marker("response", exchange_sequence_number);
+		export_transmit_rx_diagnostics(&data->toa, data->cir_analysis);
+
+		meas_twr_multi_t twr_blob = {
+				(data->rx_timestamp - tx_timestamp_poll) & TIMESTAMP_MASK,
+				(tx_timestamp_final - data->rx_timestamp) & TIMESTAMP_MASK,
+				data->last_dist_mm,
+				twr_count,
+				i,
+				{ 0 },
+		};
+		stdio_write(TWR_MULTI_BLOB_HEADER);
+		stdio_write_binary((uint8_t*)&twr_blob, TWR_MULTI_BLOB_SIZE);
+		stdio_write("\n");
+
+		/* The anchors compute the distance, it arrives with the response of the next exchange */
+		if (data->last_dist_mm != MULTI_TWR_NO_DISTANCE) {
+			TRACE2(TRACE_MULTI_RESULT, i, data->last_dist_mm);
+		}
+	}
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn tx_done_cb()
+ *
+ * @brief Callback called after TX
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+static void tx_done_cb(const dwt_cb_data_t *cb_data)
+{
+	UNUSED(cb_data);
+	tx_done = 1;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_ok_cb()
+ *
+ * @brief Callback to process RX good frame events
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+static void rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+	rx_done = 1;
+	new_frame_length = cb_data->datalength;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_err_cb()
+ *
+ * @brief Callback to process RX error and timeout events
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+static void rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+	UNUSED(cb_data);
+	/* restart rx on error */
+	dwt_forcetrxoff();
+	dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
@@ -5,10 +5,6 @@
  *      Author: Tobias Margiani
  */
 
-#include "applications.h"
-
-#ifdef APPLICATION_TWR_TAG
-
 #include <stdio.h>
 #include <string.h>
 
@@ -16,22 +12,61 @@
 #include "deca_regs.h"
 #include "deca_spi.h"
 #include "port.h"
+#include "timebase.h"
 #include "uart_stdio.h"
 
+#include "applications.h"
 #include "application_config.h"
 #include "shared_functions.h"
-
+#include "ranging_math.h"
+#include "measurement_export.h"
+#include "duty_cycle.h"
+
+static void twr_tag_start(void);
+static void twr_tag_duty_start(void);
+static void twr_tag_loop(void);
+static int twr_tag_idle(void);
 static void tx_done_cb(const dwt_cb_data_t *cb_data);
 static void rx_ok_cb(const dwt_cb_data_t *cb_data);
 static void rx_err_cb(const dwt_cb_data_t *cb_data);
 
-volatile uint8_t rx_done = 0;  /* Flag to indicate a new frame was received from the interrupt */
-volatile uint16_t new_frame_length = 0;
-volatile uint8_t tx_done = 0;
+const application_t app_twr_tag = {
+		.name = "twr_tag",
+		.banner = "DW3000 TEST TWR Tag",
+		.interrupts = APP_INTERRUPTS_TXRX,
+		.tx_done_cb = tx_done_cb,
+		.rx_ok_cb = rx_ok_cb,
+		.rx_to_cb = rx_err_cb,
+		.rx_err_cb = rx_err_cb,
+		.start = twr_tag_start,
+		.loop = twr_tag_loop,
+		.idle = twr_tag_idle,
+};
+
+/* Same exchange, the DW3000 sleeps and the STM32 is in STOP mode between the exchanges (see duty_cycle.h).
+ * Each exchange is followed by an energy blob with the time the DW3000 spent in each state. */
+const application_t app_twr_tag_duty = {
+		.name = "twr_tag_duty",
+		.banner = "DW3000 TEST TWR Tag (duty cycled)",
+		.interrupts = APP_INTERRUPTS_TXRX,
+		.tx_done_cb = tx_done_cb,
+		.rx_ok_cb = rx_ok_cb,
+		.rx_to_cb = rx_err_cb,
+		.rx_err_cb = rx_err_cb,
+		.start = twr_tag_duty_start,
+		.loop = twr_tag_loop,
+		.idle = twr_tag_idle,
+};
+
+#define EXCHANGE_PERIOD_MS (500)  /* Time from one sync frame to the next (duty cycled: sleep in between) */
 
-char print_buffer[64];
+static volatile uint8_t rx_done = 0;  /* Flag to indicate a new frame was received from the interrupt */
+static volatile uint16_t new_frame_length = 0;
+static volatile uint8_t tx_done = 0;
 
-twr_base_frame_t sync_frame = {
+static char print_buffer[64];
+
+static twr_base_frame_t sync_frame = {
 		{ 0x41, 0x88 },	/* Frame Control: data frame, short addresses */
 		0,				/* Sequence number */
 		{ 'X', 'X' },	/* PAN ID */
@@ -44,7 +79,7 @@ twr_base_frame_t sync_frame = {
 		 * for short address in this message for simplicity. */
 };
 
-twr_base_frame_t response_frame = {
+static twr_base_frame_t response_frame = {
 		{ 0x41, 0x88 },	/* Frame Control: data frame, short addresses */
 		0,				/* Sequence number */
 		{ 'X', 'X' },	/* PAN ID */
@@ -55,15 +90,16 @@ twr_base_frame_t response_frame = {
 		 * option code and parameters we skip this here fore simplicity. */
 };
 
-const static size_t max_frame_length = sizeof(twr_final_frame_t) + 2;
+#define MAX_FRAME_LENGTH (sizeof(twr_final_frame_t) + 2)
 
 const static uint64_t round_tx_delay = 10llu*1000llu*US_TO_DWT_TIME;  // reply time (10ms)
 
-uint64_t rx_timestamp_poll = 0;
-uint64_t tx_timestamp_response = 0;
-uint64_t rx_timestamp_final = 0;
+static uint64_t rx_timestamp_poll = 0;
+static uint64_t tx_timestamp_response = 0;
+static uint64_t rx_timestamp_final = 0;
+static int16_t remote_clock_offset = 0;	/* clock offset of the final frame (2^-26 units) */
 
-uint8_t next_sequence_number = 0;
+static uint8_t next_sequence_number = 0;
 
 enum state_t {
 	TWR_SYNC_STATE,
@@ -72,267 +108,288 @@ enum state_t {
 	TWR_ERROR,
 };
 
-enum state_t state = TWR_SYNC_STATE;
+static enum state_t state = TWR_SYNC_STATE;
 
 /* timeout before the ranging exchange will be abandoned and restarted */
-const static int ranging_timeout = 2000;
+const static uint64_t ranging_timeout_us = 2000000;
+
+/* Application state kept between loop calls */
+static uint8_t timestamp_buffer[5];
+static uint8_t rx_buffer[MAX_FRAME_LENGTH];
+static uint64_t last_sync_us;
+static uint8_t duty_cycled = 0;
+static uint16_t twr_count = 0;
 
 /**
- * Application entry point.
+ * Report a state change of the DW3000 for the energy accounting of the duty cycled mode.
  */
-int dw_main(void)
+static void dw_state(duty_cycle_dw_state_t new_state)
 {
-    stdio_write("DW3000 TEST TWR Tag\n");
+	if (duty_cycled) {
+		duty_cycle_state(new_state);
+	}
+}
 
-    /* Configure SPI rate, DW IC supports up to 38 MHz */
-    port_set_dw_ic_spi_fastrate();
+/**
+ * Wait between two exchanges (in the duty cycled mode with the DW3000 and the STM32 sleeping).
+ */
+static void wait_ms(uint32_t ms)
+{
+	if (duty_cycled) {
+		duty_cycle_sleep(ms);
+	} else {
+		Sleep(ms);
+	}
+}
 
-    /* Reset DW IC */
-    reset_DWIC(); /* Target specific drive of RSTn line into DW IC low for a period. */
+/**
+ * Reset the ranging state machine, the first sync frame is sent from the loop.
+ */
+static void twr_tag_start(void)
+{
+	duty_cycled = 0;
+	twr_count = 0;
+	state = TWR_SYNC_STATE;
+	tx_done = 0;
+	rx_done = 0;
 
-    Sleep(20); // Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC, or could wait for SPIRDY event)
+	/* Enable IC diagnostic calculation and logging */
+	dwt_configciadiag(DW_CIA_DIAG_LOG_ALL);
 
-    while (!dwt_checkidlerc()) /* Need to make sure DW IC is in IDLE_RC before proceeding */
-    { };
+	last_sync_us = timebase_us();
+}
 
-    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
-    {
-    	stdio_write("INIT FAILED\n");
-        while (1) { };
-    }
+/**
+ * Start the duty cycled variant.
+ */
+static void twr_tag_duty_start(void)
+{
+	twr_tag_start();
+	duty_cycled = 1;
+	duty_cycle_start(app_twr_tag_duty.interrupts);
+}
 
-    stdio_write("INITIALIZED\n");
+/**
+ * Run one step of the ranging state machine.
+ */
+static void twr_tag_loop(void)
+{
+	twr_base_frame_t *rx_frame_pointer;
+	twr_final_frame_t *rx_final_frame_pointer;
+	int16_t sts_quality_index;
+
+	/* check timeout and restart ranging if necessary (if there is an overflow in the tick counter the difference
+	 * will overflow too and will trigger the timeout, but that shouldn't be much of an issue) */
+	if ((timebase_us() - last_sync_us) > ranging_timeout_us) {
+		dwt_forcetrxoff();  // make sure receiver is off after a timeout
+		dw_state(DUTY_DW_IDLE);
+		last_sync_us = timebase_us();
+		stdio_write("Timeout -> reset\n");
+		state = TWR_SYNC_STATE;
+		rx_timestamp_poll = 0;
+		tx_timestamp_response = 0;
+		rx_timestamp_final = 0;
+		tx_done = 0;
+		rx_done = 0;
+	}
 
-    /* Enabling LEDs here for debug so that for each RX-enable the D2 LED will flash on DW3000 red eval-shield boards. */
-    dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
+	switch (state) {
+	case TWR_SYNC_STATE:
+		/* Send sync frame (1/4) */
+		last_sync_us = timebase_us();
+		sync_frame.sequence_number = next_sequence_number++;
+		dwt_writetxdata(sizeof(sync_frame), (uint8_t *)&sync_frame, 0);
+		dwt_writetxfctrl(sizeof(sync_frame)+2, 0, 1); /* Zero offset in TX buffer, ranging. */
+
+		state = TWR_POLL_RESPONSE_STATE; /* Set early to ensure tx done interrupt arrives in new state */
+		dw_state(DUTY_DW_TX);
+		int r = dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+		if (r != DWT_SUCCESS) {
+			dw_state(DUTY_DW_IDLE);
+			state = TWR_ERROR;
+			stdio_write("TX ERR: could not send sync frame");
+			return;
+		}
+		break;
+	case TWR_POLL_RESPONSE_STATE:
+		if (tx_done == 1) {
+			tx_done = 2;
+			stdio_write("TX: Sync frame\n");
+		}
 
-    /* Configure DW IC. */
-    if(dwt_configure(&config)) /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration has failed the host should reset the device */
-    {
-    	stdio_write("CONFIG FAILED\n");
-        while (1)
-        { };
-    }
+		/* Wait for poll frame (2/4) */
+		if (rx_done == 1) {
+			rx_done = 0; /* reset */
 
-    stdio_write("CONFIGURED\n");
+			if (new_frame_length != sizeof(twr_base_frame_t)+2) {
+				stdio_write("RX ERR: wrong frame length\n");
+				state = TWR_ERROR;
+				return;
+			}
 
-    /* Register RX call-back. */
-    dwt_setcallbacks(tx_done_cb, rx_ok_cb, rx_err_cb, rx_err_cb, NULL, NULL);
+			int sts_quality = dwt_readstsquality(&sts_quality_index);
+			if (sts_quality < 0) { /* >= 0 good STS, < 0 bad STS */
+				stdio_write("RX ERR: bad STS quality\n");
+				state = TWR_ERROR;
+				return;
+			}
 
-    /* Enable wanted interrupts (TX confirmation, RX good frames, RX timeouts and RX errors). */
-    dwt_setinterrupt(SYS_ENABLE_LO_TXFRS_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFCG_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFTO_ENABLE_BIT_MASK |
-            SYS_ENABLE_LO_RXPTO_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXPHE_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXFCE_ENABLE_BIT_MASK |
-            SYS_ENABLE_LO_RXFSL_ENABLE_BIT_MASK | SYS_ENABLE_LO_RXSTO_ENABLE_BIT_MASK, 0, DWT_ENABLE_INT);
+			dwt_readrxdata(rx_buffer, new_frame_length, 0);
+			/* We assume this is a TWR frame, but not necessarily the right one */
+			rx_frame_pointer = (twr_base_frame_t *)rx_buffer;
 
+			if (rx_frame_pointer->twr_function_code != 0x21) { /* poll */
+				stdio_write("RX ERR: wrong frame (expected poll)\n");
+				state = TWR_ERROR;
+				return;
+			}
 
-    /*Clearing the SPI ready interrupt*/
-    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+			if (rx_frame_pointer->sequence_number != next_sequence_number) {
+				stdio_write("RX ERR: wrong sequence number\n");
+				state = TWR_ERROR;
+				return;
+			}
 
-    /* Install DW IC IRQ handler. */
-    port_set_dwic_isr(dwt_isr);
+			stdio_write("RX: Poll frame\n");
 
-    /* Enable IC diagnostic calculation and logging */
-    dwt_configciadiag(DW_CIA_DIAG_LOG_ALL);
+			// TODO: Collect PDoA, CIR and RSSI
 
-    uint8_t timestamp_buffer[5];
-    uint8_t rx_buffer[max_frame_length];
-    twr_base_frame_t *rx_frame_pointer;
-    twr_final_frame_t *rx_final_frame_pointer;
-    int16_t sts_quality_index;
-    uint32_t last_sync_time = HAL_GetTick();
+			dwt_readrxtimestamp(timestamp_buffer);
+			rx_timestamp_poll = decode_40bit_timestamp(timestamp_buffer);
 
-	while (1)
-	{
-		/* check timeout and restart ranging if necessary (if there is an overflow in the tick counter the difference
-		 * will overflow too and will trigger the timeout, but that shouldn't be much of an issue) */
-		if ((HAL_GetTick() - last_sync_time) > ranging_timeout) {
-			dwt_forcetrxoff();  // make sure receiver is off after a timeout
-			last_sync_time = HAL_GetTick();
-			stdio_write("Timeout -> reset\n");
-			state = TWR_SYNC_STATE;
-			rx_timestamp_poll = 0;
-			tx_timestamp_response = 0;
-			rx_timestamp_final = 0;
+			/* Accept frame and continue ranging */
+			next_sequence_number++;
+			rx_done = 2;
+		}
+
+		if ((tx_done == 2) && (rx_done == 2)) {
 			tx_done = 0;
 			rx_done = 0;
-		}
 
-		switch (state) {
-		case TWR_SYNC_STATE:
-			/* Send sync frame (1/4) */
-			last_sync_time = HAL_GetTick();
-			sync_frame.sequence_number = next_sequence_number++;
-			dwt_writetxdata(sizeof(sync_frame), (uint8_t *)&sync_frame, 0);
-			dwt_writetxfctrl(sizeof(sync_frame)+2, 0, 1); /* Zero offset in TX buffer, ranging. */
+			/* Send response frame (3/4) */
+			response_frame.sequence_number = next_sequence_number++;
+			dwt_writetxdata(sizeof(response_frame), (uint8_t *)&response_frame, 0);
+			dwt_writetxfctrl(sizeof(response_frame)+2, 0, 1); /* Zero offset in TX buffer, ranging. */
 
-			state = TWR_POLL_RESPONSE_STATE; /* Set early to ensure tx done interrupt arrives in new state */
-			int r = dwt_starttx(DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED);
+			// Send response after a fixed delay
+			state = TWR_FINAL_STATE; /* Set early to ensure tx done interrupt arrives in new state */
+			dwt_setdelayedtrxtime((uint32_t)((rx_timestamp_poll + round_tx_delay) >> 8));
+			dw_state(DUTY_DW_TX_DELAYED);
+			int r = dwt_starttx(DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED);
 			if (r != DWT_SUCCESS) {
+				dw_state(DUTY_DW_IDLE);
+				stdio_write("TX ERR: delayed send time missed\n");
 				state = TWR_ERROR;
-				stdio_write("TX ERR: could not send sync frame");
-				continue;
-			}
-			break;
-		case TWR_POLL_RESPONSE_STATE:
-			if (tx_done == 1) {
-				tx_done = 2;
-				stdio_write("TX: Sync frame\n");
+				return;
 			}
+		}
+		break;
+	case TWR_FINAL_STATE:
+		if (tx_done == 1) {
+			tx_done = 2;
+			stdio_write("TX: Response frame\n");
+			dwt_readtxtimestamp(timestamp_buffer);
+			tx_timestamp_response = decode_40bit_timestamp(timestamp_buffer);
+		}
+
+		/* Wait for final frame (4/4) */
+		if (rx_done == 1) {
+			rx_done = 0; /* reset */
 
-			/* Wait for poll frame (2/4) */
-			if (rx_done == 1) {
-				rx_done = 0; /* reset */
-
-				if (new_frame_length != sizeof(twr_base_frame_t)+2) {
-					stdio_write("RX ERR: wrong frame length\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				int sts_quality = dwt_readstsquality(&sts_quality_index);
-				if (sts_quality < 0) { /* >= 0 good STS, < 0 bad STS */
-					stdio_write("RX ERR: bad STS quality\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				dwt_readrxdata(rx_buffer, new_frame_length, 0);
-				/* We assume this is a TWR frame, but not necessarily the right one */
-				rx_frame_pointer = (twr_base_frame_t *)rx_buffer;
-
-				if (rx_frame_pointer->twr_function_code != 0x21) { /* poll */
-					stdio_write("RX ERR: wrong frame (expected poll)\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				if (rx_frame_pointer->sequence_number != next_sequence_number) {
-					stdio_write("RX ERR: wrong sequence number\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				stdio_write("RX: Poll frame\n");
-
-				// TODO: Collect PDoA, CIR and RSSI
-
-				dwt_readrxtimestamp(timestamp_buffer);
-				rx_timestamp_poll = decode_40bit_timestamp(timestamp_buffer);
-
-				/* Accept frame and continue ranging */
-				next_sequence_number++;
-				rx_done = 2;
+			if (new_frame_length != sizeof(twr_final_frame_t)+2) {
+				stdio_write("RX ERR: wrong frame length\n");
+				state = TWR_ERROR;
+				return;
 			}
 
-			if ((tx_done == 2) && (rx_done == 2)) {
-				tx_done = 0;
-				rx_done = 0;
-
-				/* Send response frame (3/4) */
-				response_frame.sequence_number = next_sequence_number++;
-				dwt_writetxdata(sizeof(response_frame), (uint8_t *)&response_frame, 0);
-				dwt_writetxfctrl(sizeof(response_frame)+2, 0, 1); /* Zero offset in TX buffer, ranging. */
-
-				// Send response after a fixed delay
-				state = TWR_FINAL_STATE; /* Set early to ensure tx done interrupt arrives in new state */
-				dwt_setdelayedtrxtime((uint32_t)((rx_timestamp_poll + round_tx_delay) >> 8));
-				int r = dwt_starttx(DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED);
-				if (r != DWT_SUCCESS) {
-					stdio_write("TX ERR: delayed send time missed\n");
-					state = TWR_ERROR;
-					continue;
-				}
+			int sts_quality = dwt_readstsquality(&sts_quality_index);
+			if (sts_quality < 0) { /* >= 0 good STS, < 0 bad STS */
+				stdio_write("RX ERR: bad STS quality\n");
+				state = TWR_ERROR;
+				return;
 			}
-			break;
-		case TWR_FINAL_STATE:
-			if (tx_done == 1) {
-				tx_done = 2;
-				stdio_write("TX: Response frame\n");
-				dwt_readtxtimestamp(timestamp_buffer);
-				tx_timestamp_response = decode_40bit_timestamp(timestamp_buffer);
+
+			dwt_readrxdata(rx_buffer, new_frame_length, 0);
+			/* For simplicity we assume this is a TWR frame, but not necessarily the right one */
+			rx_frame_pointer = (twr_base_frame_t *)rx_buffer;
+
+			if (rx_frame_pointer->twr_function_code != 0x23) { /* final */
+				stdio_write("RX ERR: wrong frame (expected final)\n");
+				state = TWR_ERROR;
+				return;
 			}
 
-			/* Wait for final frame (4/4) */
-			if (rx_done == 1) {
-				rx_done = 0; /* reset */
-
-				if (new_frame_length != sizeof(twr_final_frame_t)+2) {
-					stdio_write("RX ERR: wrong frame length\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				int sts_quality = dwt_readstsquality(&sts_quality_index);
-				if (sts_quality < 0) { /* >= 0 good STS, < 0 bad STS */
-					stdio_write("RX ERR: bad STS quality\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				dwt_readrxdata(rx_buffer, new_frame_length, 0);
-				/* For simplicity we assume this is a TWR frame, but not necessarily the right one */
-				rx_frame_pointer = (twr_base_frame_t *)rx_buffer;
-
-				if (rx_frame_pointer->twr_function_code != 0x23) { /* final */
-					stdio_write("RX ERR: wrong frame (expected final)\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				if (rx_frame_pointer->sequence_number != next_sequence_number) {
-					stdio_write("RX ERR: wrong sequence number\n");
-					state = TWR_ERROR;
-					continue;
-				}
-
-				stdio_write("RX: Final frame\n");
-
-				// TODO: Collect PDoA, CIR and RSSI
-
-				dwt_readrxtimestamp(timestamp_buffer);
-				rx_timestamp_final = decode_40bit_timestamp(timestamp_buffer);
-
-				/* Accept frame continue with ranging */
-				next_sequence_number++;
-				rx_done = 2;
+			if (rx_frame_pointer->sequence_number != next_sequence_number) {
+				stdio_write("RX ERR: wrong sequence number\n");
+				state = TWR_ERROR;
+				return;
 			}
 
-			if ((tx_done == 2) && (rx_done == 2)) {
-				rx_final_frame_pointer = (twr_final_frame_t *)rx_buffer;
+			stdio_write("RX: Final frame\n");
+
+			// TODO: Collect PDoA, CIR and RSSI
 
-				const uint64_t Treply1 = tx_timestamp_response - rx_timestamp_poll;
-				const uint64_t Tround2 = rx_timestamp_final - tx_timestamp_response;
+			dwt_readrxtimestamp(timestamp_buffer);
+			rx_timestamp_final = decode_40bit_timestamp(timestamp_buffer);
+			remote_clock_offset = dwt_readclockoffset();
+
+			/* Accept frame continue with ranging */
+			next_sequence_number++;
+			rx_done = 2;
+		}
 
-				const uint64_t Tround1 = decode_40bit_timestamp(rx_final_frame_pointer->poll_resp_round_time);
-				const uint64_t Treply2 = decode_40bit_timestamp(rx_final_frame_pointer->resp_final_reply_time);
+		if ((tx_done == 2) && (rx_done == 2)) {
+			rx_final_frame_pointer = (twr_final_frame_t *)rx_buffer;
 
-				const uint64_t subtraction = (Tround1*Tround2 - Treply1*Treply2);
-				const uint64_t denominator = (Tround1 + Tround2 + Treply1 + Treply2);
+			const uint64_t Treply1 = tx_timestamp_response - rx_timestamp_poll;
+			const uint64_t Tround2 = rx_timestamp_final - tx_timestamp_response;
 
-				// timestamp resolution is approximately u=15.65ps => 1ns = 63.898*u
-				// to get ns the division by 63.898 is approximated by an division by 64 using a bit shift
-				const float tprop_ns = ((double)subtraction) / (denominator << 6);
-				const uint32_t dist_mm = (uint32_t)(tprop_ns*299.792458);  // usint c = 299.7... mm/ns
+			const uint64_t Tround1 = decode_40bit_timestamp(rx_final_frame_pointer->poll_resp_round_time);
+			const uint64_t Treply2 = decode_40bit_timestamp(rx_final_frame_pointer->resp_final_reply_time);
 
-				snprintf(print_buffer, sizeof(print_buffer), "dist_mm: %lu\n", dist_mm);
-				stdio_write(print_buffer);
+			const uint32_t dist_mm = ranging_distance_mm(Treply1, Tround2, Tround1, Treply2, remote_clock_offset);
 
-				/* Begin next ranging exchange */
-				tx_done = 0;
-				rx_done = 0;
-				Sleep(500);
-				state = TWR_SYNC_STATE;
+			twr_count++;
+			if (duty_cycled) {
+				/* Marker for serial output parsing script */
+				export_frame_marker("twr", twr_count);
+			}
+
+			snprintf(print_buffer, sizeof(print_buffer), "dist_mm: %lu\n", dist_mm);
+			stdio_write(print_buffer);
+
+			if (duty_cycled) {
+				duty_cycle_export(twr_count);
+			}
+
+			/* Begin next ranging exchange */
+			tx_done = 0;
+			rx_done = 0;
+			if (duty_cycled) {
+				/* Keep the exchange period, the sync frame was sent at last_sync_us */
+				const uint32_t elapsed = (uint32_t)((timebase_us() - last_sync_us) / 1000);
+				wait_ms((elapsed < EXCHANGE_PERIOD_MS) ? (EXCHANGE_PERIOD_MS - elapsed) : 1);
+			} else {
+				wait_ms(EXCHANGE_PERIOD_MS);
 			}
-			break;
-		case TWR_ERROR:
-			dwt_forcetrxoff();  // make sure receiver is off after an error
-			stdio_write("Ranging error -> reset\n");
 			state = TWR_SYNC_STATE;
-			Sleep(3000);
 		}
+		break;
+	case TWR_ERROR:
+		dwt_forcetrxoff();  // make sure receiver is off after an error
+		dw_state(DUTY_DW_IDLE);
+		stdio_write("Ranging error -> reset\n");
+		state = TWR_SYNC_STATE;
+		wait_ms(3000);
 	}
+}
 
-    return DWT_SUCCESS;
+/**
+ * Idle before the sync frame of the next exchange is sent.
+ */
+static int twr_tag_idle(void)
+{
+	return state == TWR_SYNC_STATE;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -348,6 +405,7 @@ static void tx_done_cb(const dwt_cb_data_t *cb_data)
 {
 	UNUSED(cb_data);
 	tx_done = 1;
+	dw_state(DUTY_DW_RX);  /* all frames are sent with response expected */
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -363,6 +421,7 @@ static void rx_ok_cb(const dwt_cb_data_t *cb_data)
 {
 	rx_done = 1;
 	new_frame_length = cb_data->datalength;
+	dw_state(DUTY_DW_IDLE);
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -381,5 +440,3 @@ static void rx_err_cb(const dwt_cb_data_t *cb_data)
 	dwt_forcetrxoff();
 	dwt_rxenable(DWT_START_RX_IMMEDIATE);
 }
-
-#endif
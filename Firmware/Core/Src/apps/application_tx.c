@@ -5,11 +5,6 @@
  *      Author: Tobias Margiani
  */
 
-#include "applications.h"
-
-// TX example
-#ifdef APPLICATION_TX
-
 #include <stdio.h>
 #include <string.h>
 
@@ -18,8 +13,21 @@
 #include "port.h"
 #include "uart_stdio.h"
 
+#include "applications.h"
 #include "application_config.h"
 
+// TX example
+static void tx_start(void);
+static void tx_loop(void);
+
+const application_t app_tx = {
+		.name = "tx",
+		.banner = "DW3000 TEST TX",
+		.interrupts = 0,  /* polled */
+		.start = tx_start,
+		.loop = tx_loop,
+};
+
 /* The frame sent in this example is an 802.15.4e standard blink. It is a 12-byte frame composed of the following fields:
  *     - byte 0: frame type (0xC5 for a blink).
  *     - byte 1: sequence number, incremented for each new frame.
@@ -35,26 +43,10 @@ static uint8_t tx_msg[] = { 0xC5, 0, 'D', 'E', 'C', 'A', 'W', 'A', 'V', 'E' };
 #define TX_DELAY_MS 500
 
 /**
- * Application entry point.
+ * Check the device ID, the device is already configured by the framework.
  */
-int dw_main(void)
+static void tx_start(void)
 {
-	stdio_write("DW3000 TEST TX\n");
-
-    /* Configure SPI rate, DW3000 supports up to 36 MHz */
-    port_set_dw_ic_spi_fastrate();
-
-    /* Reset DW IC */
-    reset_DWIC(); /* Target specific drive of RSTn line into DW IC low for a period. */
-
-    stdio_write("Reset\n");
-
-    Sleep(20); // Time needed for DW3000 to start up (transition from INIT_RC to IDLE_RC, or could wait for SPIRDY event)
-
-    while (!dwt_checkidlerc()) { }; /* Need to make sure DW IC is in IDLE_RC before proceeding */
-
-    stdio_write("IDLE_RC\n");
-
     /* Reads and validate device ID returns DWT_ERROR if it does not match expected else DWT_SUCCESS */
     if (dwt_check_dev_id() == DWT_SUCCESS)
     {
@@ -64,60 +56,40 @@ int dw_main(void)
     {
     	stdio_write("DEV ID FAILED\n");
     }
+}
 
-    if (dwt_initialise(DWT_DW_INIT) == DWT_ERROR)
-    {
-    	stdio_write("INIT FAILED\n");
-        while (1) { };
-    }
-
-    stdio_write("INITIALIZED\n");
-
-    /* Enabling LEDs here for debug so that for each TX the D1 LED will flash on DW3000 red eval-shield boards. */
-    dwt_setleds(DWT_LEDS_ENABLE | DWT_LEDS_INIT_BLINK);
-
-    /* Configure DW IC. See NOTE 5 below. */
-    /* if the dwt_configure returns DWT_ERROR either the PLL or RX calibration has failed the host should reset the device */
-    if (dwt_configure(&config))
-    {
-    	stdio_write("CONFIG FAILED\n");
-        while (1) { };
-    }
-
-    stdio_write("CONFIGURED\n");
-
-    /* Loop forever sending frames periodically. */
-    while (1)
-    {
-        /* Write frame data to DW IC and prepare transmission. See NOTE 3 below.*/
-        dwt_writetxdata(FRAME_LENGTH - FCS_LEN, tx_msg, 0); /* Zero offset in TX buffer. */
-
-        /* In this example since the length of the transmitted frame does not change,
-         * nor the other parameters of the dwt_writetxfctrl function, the
-         * dwt_writetxfctrl call could be outside the main while(1) loop.
-         */
-        dwt_writetxfctrl(FRAME_LENGTH, 0, 0); /* Zero offset in TX buffer, no ranging. */
+/**
+ * Send one frame and wait for the inter-frame delay.
+ */
+static void tx_loop(void)
+{
+    /* Write frame data to DW IC and prepare transmission. See NOTE 3 below.*/
+    dwt_writetxdata(FRAME_LENGTH - FCS_LEN, tx_msg, 0); /* Zero offset in TX buffer. */
 
-        /* Start transmission. */
-        dwt_starttx(DWT_START_TX_IMMEDIATE);
-        /* Poll DW IC until TX frame sent event set. See NOTE 4 below.
-         * STATUS register is 4 bytes long but, as the event we are looking
-         * at is in the first byte of the register, we can use this simplest
-         * API function to access it.*/
-        while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS_BIT_MASK)) { };
+    /* In this example since the length of the transmitted frame does not change,
+     * nor the other parameters of the dwt_writetxfctrl function, the
+     * dwt_writetxfctrl call could be done once in tx_start().
+     */
+    dwt_writetxfctrl(FRAME_LENGTH, 0, 0); /* Zero offset in TX buffer, no ranging. */
 
-        /* Clear TX frame sent event. */
-        dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS_BIT_MASK);
+    /* Start transmission. */
+    dwt_starttx(DWT_START_TX_IMMEDIATE);
+    /* Poll DW IC until TX frame sent event set. See NOTE 4 below.
+     * STATUS register is 4 bytes long but, as the event we are looking
+     * at is in the first byte of the register, we can use this simplest
+     * API function to access it.*/
+    while (!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS_BIT_MASK)) { };
 
-        stdio_write("TX Frame Sent\n");
+    /* Clear TX frame sent event. */
+    dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS_BIT_MASK);
 
-        /* Execute a delay between transmissions. */
-        Sleep(TX_DELAY_MS);
+    stdio_write("TX Frame Sent\n");
 
-        /* Increment the blink frame sequence number (modulo 256). */
-        tx_msg[BLINK_FRAME_SN_IDX]++;
-    }
+    /* Execute a delay between transmissions. */
+    Sleep(TX_DELAY_MS);
 
+    /* Increment the blink frame sequence number (modulo 256). */
+    tx_msg[BLINK_FRAME_SN_IDX]++;
 }
 /*****************************************************************************************************************************************************
  * NOTES:
@@ -136,5 +108,3 @@ int dw_main(void)
  * 5. Desired configuration by user may be different to the current programmed configuration. dwt_configure is called to set desired
  *    configuration.
  ****************************************************************************************************************************************************/
-
-#endif
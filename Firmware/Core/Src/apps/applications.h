@@ -8,16 +8,24 @@
 #ifndef SRC_APPS_APPLICATIONS_H_
 #define SRC_APPS_APPLICATIONS_H_
 
-/* --- uncomment exactly one, each will define dw_main() --- */
-//#define APPLICATION_TX            // Demo application transmitter
-//#define APPLICATION_RX            // Demo application receiver
-//#define APPLICATION_CIR           // Basic CIR readout
-//#define APPLICATION_PDOA          // Simple measurement readout (fully text based transmission)
-//#define APPLICATION_TWR_TAG       // TWR tag test (double antenna module)
-#define APPLICATION_TWR_PDOA_TAG  // TWR tag with full data collection (double antenna module) => used for final measurements
-//#define APPLICATION_TWR_ANCHOR    // TWR anchor (single antenna module) => used for final measurements
-//#define APPLICATION_TX_TEST       // Transmission debug application
+#include "app_framework.h"
 
+/* Application started after reset, others can be selected at runtime with the serial command "app <name>" */
+#define APPLICATION_DEFAULT "twr_pdoa_tag"
+
+extern const application_t app_tx;                // Demo application transmitter
+extern const application_t app_rx;                // Demo application receiver
+extern const application_t app_cir;               // Basic CIR readout
+extern const application_t app_pdoa;              // Simple measurement readout
+extern const application_t app_twr_tag;           // TWR tag test (double antenna module)
+extern const application_t app_twr_tag_duty;      // TWR tag test with DW3000 sleep and STM32 STOP mode between exchanges
+extern const application_t app_twr_pdoa_tag;      // TWR tag with full data collection (double antenna module) => used for final measurements
+extern const application_t app_twr_anchor;        // TWR anchor (single antenna module) => used for final measurements
+extern const application_t app_twr_multi_tag;     // TWR tag ranging with several anchors using a single broadcast poll
+extern const application_t app_twr_multi_anchor;  // TWR anchor for the broadcast poll ranging (set ANCHOR_SLOT per module)
+extern const application_t app_tx_test;           // Transmission debug application
+
+/* Main loop of the application framework (see app_framework.c) */
 int dw_main(void);
 
 /* Microsecond to device time unit (40-bit timestamps, around 15.65 ps) conversion factor.
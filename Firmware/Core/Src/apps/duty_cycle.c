@@ -0,0 +1,131 @@
+/*
+ * duty_cycle.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include "deca_regs.h"
+#include "port.h"
+#include "power.h"
+#include "timebase.h"
+#include "uart_stdio.h"
+
+#include "duty_cycle.h"
+
+static uint32_t app_interrupts = 0;
+
+/* Accounting of the current period (since the last export) */
+static duty_cycle_dw_state_t current_state = DUTY_DW_IDLE;
+static uint64_t state_since_us = 0;
+static uint64_t wake_request_us = 0;
+static uint8_t latency_pending = 0;
+static meas_energy_t energy;
+
+/* Add the time since the last state change to the current state, called with the DW3000 IRQ masked */
+static void account(uint64_t now_us)
+{
+	const uint32_t elapsed = (uint32_t)(now_us - state_since_us);
+	state_since_us = now_us;
+
+	switch (current_state) {
+	case DUTY_DW_SLEEP:
+		energy.sleep_us += elapsed;
+		break;
+	case DUTY_DW_WAKE:
+		energy.wake_us += elapsed;
+		break;
+	case DUTY_DW_IDLE:
+		energy.idle_us += elapsed;
+		break;
+	case DUTY_DW_TX:
+		energy.tx_us += elapsed;
+		break;
+	case DUTY_DW_TX_DELAYED:
+		energy.tx_delayed_us += elapsed;
+		break;
+	case DUTY_DW_RX:
+		energy.rx_us += elapsed;
+		break;
+	default:
+		break;
+	}
+}
+
+void duty_cycle_start(uint32_t interrupts)
+{
+	app_interrupts = interrupts;
+
+	/* Keep the configuration in the AON memory and restore it on wakeup (including the PGF calibration),
+	 * wake up with the chip select line */
+	dwt_configuresleep(DWT_CONFIG | DWT_PGFCAL, DWT_PRES_SLEEP | DWT_WAKE_CSN | DWT_SLP_EN);
+
+	memset(&energy, 0, sizeof(energy));
+	current_state = DUTY_DW_IDLE;
+	state_since_us = timebase_us();
+	latency_pending = 0;
+}
+
+void duty_cycle_state(duty_cycle_dw_state_t state)
+{
+	decaIrqStatus_t irq = decamutexon();
+	const uint64_t now_us = timebase_us();
+
+	account(now_us);
+	current_state = state;
+
+	if (state == DUTY_DW_TX || state == DUTY_DW_TX_DELAYED) {
+		if (state == DUTY_DW_TX) {
+			energy.tx_count++;
+		} else {
+			energy.tx_delayed_count++;
+		}
+		if (latency_pending) {
+			latency_pending = 0;
+			energy.latency_us += (uint32_t)(now_us - wake_request_us);
+		}
+	}
+
+	decamutexoff(irq);
+}
+
+void duty_cycle_sleep(uint32_t ms)
+{
+	dwt_forcetrxoff();
+	duty_cycle_state(DUTY_DW_SLEEP);
+	dwt_entersleep(DWT_DW_IDLE);
+
+	energy.mcu_stop_us += power_stop_ms(ms);
+
+	/* Wake up with the chip select line and wait until the DW3000 is back in IDLE_RC */
+	wake_request_us = timebase_us();
+	duty_cycle_state(DUTY_DW_WAKE);
+	latency_pending = 1;
+
+	wakeup_device_with_io();
+	while (!dwt_checkidlerc())
+	{ };
+
+	/* Restore the configuration from the AON memory and enable the interrupts of the application again */
+	dwt_restoreconfig();
+	dwt_setinterrupt(app_interrupts, 0, DWT_ENABLE_INT_ONLY);
+	dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK);
+
+	duty_cycle_state(DUTY_DW_IDLE);
+}
+
+void duty_cycle_export(uint16_t twr_count)
+{
+	decaIrqStatus_t irq = decamutexon();
+	account(timebase_us());
+	meas_energy_t export = energy;
+	memset(&energy, 0, sizeof(energy));
+	decamutexoff(irq);
+
+	export.twr_count = twr_count;
+
+	stdio_write(ENERGY_BLOB_HEADER);
+	stdio_write_binary((const uint8_t*)&export, ENERGY_BLOB_SIZE);
+	stdio_write("\n");
+}
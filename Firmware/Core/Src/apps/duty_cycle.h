@@ -0,0 +1,51 @@
+/*
+ * duty_cycle.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_DUTY_CYCLE_H_
+#define SRC_APPS_DUTY_CYCLE_H_
+
+#include <stdint.h>
+
+#include "application_config.h"
+
+/* Duty cycled operation with DW3000 DEEPSLEEP and STM32 STOP mode between exchanges
+ *
+ * duty_cycle_sleep() saves the configuration of the DW3000 to its always-on memory, puts it into
+ * DEEPSLEEP and the STM32 into STOP mode. After the wakeup the DW3000 restores the configuration from
+ * the AON memory (no reset and dwt_configure() needed) and the interrupts of the application are
+ * enabled again.
+ *
+ * The application reports the state of the DW3000 at the points where it changes it (start of TX or
+ * RX, TX done, RX done) with duty_cycle_state(). The time spent in each state is accumulated and
+ * transmitted as energy blob with duty_cycle_export(), Scripts/power_model.py estimates the current
+ * draw from it.
+ */
+
+typedef enum
+{
+	DUTY_DW_SLEEP,
+	DUTY_DW_WAKE,
+	DUTY_DW_IDLE,
+	DUTY_DW_TX,				// immediate TX started, until TX done
+	DUTY_DW_TX_DELAYED,		// delayed TX scheduled, until TX done
+	DUTY_DW_RX,				// receiver on
+	DUTY_DW_STATE_COUNT,
+} duty_cycle_dw_state_t;
+
+/* Configure the DW3000 sleep mode and reset the accounting, interrupts are the DW3000 interrupts of
+ * the application (enabled again after each wakeup) */
+void duty_cycle_start(uint32_t interrupts);
+
+/* Record a state change of the DW3000 (can be called from the DW3000 callbacks) */
+void duty_cycle_state(duty_cycle_dw_state_t state);
+
+/* Sleep for the given time, returns with the DW3000 idle and configured */
+void duty_cycle_sleep(uint32_t ms);
+
+/* Transmit the accounting since the previous export as energy blob and start a new period */
+void duty_cycle_export(uint16_t twr_count);
+
+#endif /* SRC_APPS_DUTY_CYCLE_H_ */
@@ -0,0 +1,273 @@
+/*
+ * measurement_blobs.h
+ *
+ * Generated by Scripts/blob_schema.py, do not edit. Change the schema and run
+ * "python3 blob_schema.py --write" in the Scripts directory.
+ */
+
+#ifndef SRC_APPS_MEASUREMENT_BLOBS_H_
+#define SRC_APPS_MEASUREMENT_BLOBS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary measurement data structures
+ *
+ * Transmitted as "<BLOB_HEADER><BLOB_SIZE bytes of the struct>\n" (the trailing padding is not
+ * transmitted unless noted).
+ */
+
+typedef struct
+{
+	// Version 3
+	uint32_t	cia_diag_1;		// Diagnostics common to both sequences (undocumented CIA_DIAG_1 register)
+	uint16_t	ip_poa;			// Preamble POA
+	uint16_t	sts1_poa;		// POA of STS block 1
+	uint16_t	sts2_poa;		// POA of STS block 2
+	int16_t		pdoa;			// PDoA from two STS POAs signed int [1:-11] in radians
+	int16_t		xtal_offset;	// Estimated xtal offset of remote device
+	int16_t		sts_qual_index;	// STS quality value
+	uint8_t		sts_qual;		// STS quality indicator
+	uint8_t		tdoa_sign;		// TDoA is a signed 41-bit integer, store the sign bit here
+	uint8_t		tdoa[5];		// TDoA from two STS RX timestamps (40-bit without sign)
+	uint8_t		ip_toa[5];		// Preamble/Ipatov RX timestamp
+	uint8_t		ip_toast;		// RX status of preamble
+	uint8_t		sts1_toa[5];	// STS RX timestamp on antenna 1
+	uint8_t		sts1_toast;		// RX status of STS on antenna 1 (only high 8-bits, discarding reserved bit 23 in the register)
+	uint8_t		sts2_toa[5];	// STS RX timestamp on antenna 2
+	uint8_t		sts2_toast;		// RX status of STS on antenna 2 (only high 8-bits, discarding reserved bit 23 in the register)
+	uint8_t		fp_th_md;		// First path threshold test mode
+	uint8_t		dgc_decision;	// DGC decision index (used for RSSI estimation)
+	uint8_t		padding[1];		// 43 bytes of data, padded to multiple of 4 (because of uint32_t)
+} meas_time_poa_t;  // with padding 44 bytes
+
+#define TOA_BLOB_VERSION	(3)
+#define TOA_BLOB_SIZE		(43)	/* transmitted bytes */
+#define TOA_BLOB_HEADER		"BLOB / toa / v3 / 43\n"
+
+_Static_assert(sizeof(meas_time_poa_t) == 44, "meas_time_poa_t size");
+_Static_assert(offsetof(meas_time_poa_t, cia_diag_1) == 0, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, ip_poa) == 4, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts1_poa) == 6, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts2_poa) == 8, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, pdoa) == 10, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, xtal_offset) == 12, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts_qual_index) == 14, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts_qual) == 16, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, tdoa_sign) == 17, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, tdoa) == 18, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, ip_toa) == 23, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, ip_toast) == 28, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts1_toa) == 29, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts1_toast) == 34, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts2_toa) == 35, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, sts2_toast) == 40, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, fp_th_md) == 41, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, dgc_decision) == 42, "meas_time_poa_t layout");
+_Static_assert(offsetof(meas_time_poa_t, padding) == 43, "meas_time_poa_t layout");
+
+
+typedef struct
+{
+	// Version 1
+	uint32_t	peak;			// index and amplitude of peak sample in CIR
+	uint32_t	power;			// channel area allows estimation of channel power (note: 32-bit for preamble, 16-bit for STS)
+	uint32_t	F1;				// F1
+	uint32_t	F2;				// F2
+	uint32_t	F3;				// F3
+	uint16_t	fp_index;		// First path index
+	uint16_t	accum_count;	// Number accumulated symbols
+} meas_cir_analysis_t;  // 24 bytes, no padding required
+
+#define CIR_ANALYSIS_BLOB_VERSION		(1)
+#define CIR_ANALYSIS_BLOB_SIZE			(24)	/* transmitted bytes */
+#define CIR_ANALYSIS_IP_BLOB_HEADER		"BLOB / cir analysis ip / v1 / 24\n"
+#define CIR_ANALYSIS_STS1_BLOB_HEADER	"BLOB / cir analysis sts1 / v1 / 24\n"
+#define CIR_ANALYSIS_STS2_BLOB_HEADER	"BLOB / cir analysis sts2 / v1 / 24\n"
+
+_Static_assert(sizeof(meas_cir_analysis_t) == 24, "meas_cir_analysis_t size");
+_Static_assert(offsetof(meas_cir_analysis_t, peak) == 0, "meas_cir_analysis_t layout");
+_Static_assert(offsetof(meas_cir_analysis_t, power) == 4, "meas_cir_analysis_t layout");
+_Static_assert(offsetof(meas_cir_analysis_t, F1) == 8, "meas_cir_analysis_t layout");
+_Static_assert(offsetof(meas_cir_analysis_t, F2) == 12, "meas_cir_analysis_t layout");
+_Static_assert(offsetof(meas_cir_analysis_t, F3) == 16, "meas_cir_analysis_t layout");
+_Static_assert(offsetof(meas_cir_analysis_t, fp_index) == 20, "meas_cir_analysis_t layout");
+_Static_assert(offsetof(meas_cir_analysis_t, accum_count) == 22, "meas_cir_analysis_t layout");
+
+
+typedef struct
+{
+	// Version 2
+	uint64_t	Treply1;	// Tag: tx response - rx poll
+	uint64_t	Treply2;	// Anchor: tx final - rx response
+	uint64_t	Tround1;	// Anchor: rx response - tx poll
+	uint64_t	Tround2;	// Tag: rx final - tx response
+	uint32_t	dist_mm;	// Estimated distance in mm
+	uint16_t	twr_count;	// Counter of TWR ranging exchanges
+	uint16_t	rotation;	// Rotation in degrees from initial position
+} meas_twr_t;  // 40 bytes, no padding required
+
+#define TWR_BLOB_VERSION	(2)
+#define TWR_BLOB_SIZE		(40)	/* transmitted bytes */
+#define TWR_BLOB_HEADER		"BLOB / twr / v2 / 40\n"
+
+_Static_assert(sizeof(meas_twr_t) == 40, "meas_twr_t size");
+_Static_assert(offsetof(meas_twr_t, Treply1) == 0, "meas_twr_t layout");
+_Static_assert(offsetof(meas_twr_t, Treply2) == 8, "meas_twr_t layout");
+_Static_assert(offsetof(meas_twr_t, Tround1) == 16, "meas_twr_t layout");
+_Static_assert(offsetof(meas_twr_t, Tround2) == 24, "meas_twr_t layout");
+_Static_assert(offsetof(meas_twr_t, dist_mm) == 32, "meas_twr_t layout");
+_Static_assert(offsetof(meas_twr_t, twr_count) == 36, "meas_twr_t layout");
+_Static_assert(offsetof(meas_twr_t, rotation) == 38, "meas_twr_t layout");
+
+
+typedef struct
+{
+	// Version 1
+	uint64_t	Tround1;		// Tag: rx response - tx poll
+	uint64_t	Treply2;		// Tag: tx final - rx response
+	uint32_t	last_dist_mm;	// Distance estimated by the anchor in the previous exchange
+	uint16_t	twr_count;		// Counter of TWR ranging exchanges
+	uint8_t		slot;			// Response slot of the anchor
+	uint8_t		padding[1];		// 23 bytes of data, padded to multiple of 8 (because of uint64_t)
+} meas_twr_multi_t;  // with padding 24 bytes (padding is transmitted)
+
+#define TWR_MULTI_BLOB_VERSION	(1)
+#define TWR_MULTI_BLOB_SIZE		(24)	/* transmitted bytes */
+#define TWR_MULTI_BLOB_HEADER	"BLOB / twr multi / v1 / 24\n"
+
+_Static_assert(sizeof(meas_twr_multi_t) == 24, "meas_twr_multi_t size");
+_Static_assert(offsetof(meas_twr_multi_t, Tround1) == 0, "meas_twr_multi_t layout");
+_Static_assert(offsetof(meas_twr_multi_t, Treply2) == 8, "meas_twr_multi_t layout");
+_Static_assert(offsetof(meas_twr_multi_t, last_dist_mm) == 16, "meas_twr_multi_t layout");
+_Static_assert(offsetof(meas_twr_multi_t, twr_count) == 20, "meas_twr_multi_t layout");
+_Static_assert(offsetof(meas_twr_multi_t, slot) == 22, "meas_twr_multi_t layout");
+_Static_assert(offsetof(meas_twr_multi_t, padding) == 23, "meas_twr_multi_t layout");
+
+
+typedef struct
+{
+	// Version 1
+	uint16_t	preamble_length;	// Preamble length in symbols
+	uint16_t	sfd_timeout;		// SFD timeout in symbols
+	uint16_t	sts_length;			// STS length in symbols
+	uint16_t	config_count;		// Incremented with every applied configuration
+	uint8_t		channel;			// Channel number (5 or 9)
+	uint8_t		pac;				// Preamble acquisition chunk size in symbols
+	uint8_t		tx_code;			// TX preamble code
+	uint8_t		rx_code;			// RX preamble code
+	uint8_t		sfd_type;			// SFD type (0-3)
+	uint8_t		data_rate;			// Data rate (DWT_BR_850K or DWT_BR_6M8)
+	uint8_t		phr_mode;			// PHY header mode (DWT_PHRMODE_*)
+	uint8_t		phr_rate;			// PHY header rate (DWT_PHRRATE_*)
+	uint8_t		sts_mode;			// STS mode (DWT_STS_MODE_*, including DWT_STS_MODE_SDC)
+	uint8_t		pdoa_mode;			// PDoA mode (0, 1 or 3)
+} meas_radio_config_t;  // 18 bytes, no padding required
+
+#define CONFIG_BLOB_VERSION	(1)
+#define CONFIG_BLOB_SIZE	(18)	/* transmitted bytes */
+#define CONFIG_BLOB_HEADER	"BLOB / config / v1 / 18\n"
+
+_Static_assert(sizeof(meas_radio_config_t) == 18, "meas_radio_config_t size");
+_Static_assert(offsetof(meas_radio_config_t, preamble_length) == 0, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, sfd_timeout) == 2, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, sts_length) == 4, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, config_count) == 6, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, channel) == 8, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, pac) == 9, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, tx_code) == 10, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, rx_code) == 11, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, sfd_type) == 12, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, data_rate) == 13, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, phr_mode) == 14, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, phr_rate) == 15, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, sts_mode) == 16, "meas_radio_config_t layout");
+_Static_assert(offsetof(meas_radio_config_t, pdoa_mode) == 17, "meas_radio_config_t layout");
+
+
+typedef struct
+{
+	// Version 1
+	int32_t		angle_mdeg;	// Turntable angle interpolated between motor steps in millidegrees (not wrapped)
+	int32_t		steps;		// Motor position in steps
+	uint32_t	tick_ms;	// HAL_GetTick() when the angle was sampled
+	uint16_t	twr_count;	// Counter of TWR ranging exchanges
+	int16_t		rate;		// Commanded rotation rate in degrees/s (0: one angle after the other)
+} meas_rotation_t;  // 16 bytes, no padding required
+
+#define ROTATION_BLOB_VERSION	(1)
+#define ROTATION_BLOB_SIZE		(16)	/* transmitted bytes */
+#define ROTATION_BLOB_HEADER	"BLOB / rotation / v1 / 16\n"
+
+_Static_assert(sizeof(meas_rotation_t) == 16, "meas_rotation_t size");
+_Static_assert(offsetof(meas_rotation_t, angle_mdeg) == 0, "meas_rotation_t layout");
+_Static_assert(offsetof(meas_rotation_t, steps) == 4, "meas_rotation_t layout");
+_Static_assert(offsetof(meas_rotation_t, tick_ms) == 8, "meas_rotation_t layout");
+_Static_assert(offsetof(meas_rotation_t, twr_count) == 12, "meas_rotation_t layout");
+_Static_assert(offsetof(meas_rotation_t, rate) == 14, "meas_rotation_t layout");
+
+
+typedef struct
+{
+	// Version 1
+	uint32_t	sleep_us;			// DW3000 in DEEPSLEEP
+	uint32_t	wake_us;			// DW3000 waking up and restoring its configuration
+	uint32_t	idle_us;			// DW3000 idle (PLL locked)
+	uint32_t	tx_us;				// Immediate TX from start until TX done
+	uint32_t	tx_delayed_us;		// Delayed TX from start until TX done (includes the wait in idle)
+	uint32_t	rx_us;				// Receiver on
+	uint32_t	mcu_stop_us;		// STM32 in STOP mode (running otherwise)
+	uint32_t	latency_us;			// From the wake up request to the first TX (0 without sleep)
+	uint16_t	twr_count;			// Counter of TWR ranging exchanges
+	uint8_t		tx_count;			// Number of immediate transmissions
+	uint8_t		tx_delayed_count;	// Number of delayed transmissions
+} meas_energy_t;  // 36 bytes, no padding required
+
+#define ENERGY_BLOB_VERSION	(1)
+#define ENERGY_BLOB_SIZE	(36)	/* transmitted bytes */
+#define ENERGY_BLOB_HEADER	"BLOB / energy / v1 / 36\n"
+
+_Static_assert(sizeof(meas_energy_t) == 36, "meas_energy_t size");
+_Static_assert(offsetof(meas_energy_t, sleep_us) == 0, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, wake_us) == 4, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, idle_us) == 8, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, tx_us) == 12, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, tx_delayed_us) == 16, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, rx_us) == 20, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, mcu_stop_us) == 24, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, latency_us) == 28, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, twr_count) == 32, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, tx_count) == 34, "meas_energy_t layout");
+_Static_assert(offsetof(meas_energy_t, tx_delayed_count) == 35, "meas_energy_t layout");
+
+
+typedef struct
+{
+	// Version 2
+	int32_t		angle_mdeg;		// Filtered angle of arrival in millidegrees (0: broadside)
+	int16_t		pdoa;			// Filtered PDoA after the board offset correction [1:-11] radians
+	int16_t		pdoa_raw;		// Last PDoA reported by the DW3000 [1:-11] radians
+	uint32_t	dist_mm;		// Estimated distance of the exchange in mm
+	int16_t		rx_power_cdbm;	// Receive power level of the last frame in 0.01 dBm (INT16_MIN: invalid)
+	int16_t		fp_power_cdbm;	// First path power level of the last frame in 0.01 dBm (INT16_MIN: invalid)
+	uint16_t	twr_count;		// Counter of TWR ranging exchanges
+	uint8_t		flags;			// AOA_FLAG_* since the previous blob
+	uint8_t		padding[1];		// 19 bytes of data, padded to multiple of 4 (because of uint32_t)
+} meas_aoa_t;  // with padding 20 bytes (padding is transmitted)
+
+#define AOA_BLOB_VERSION	(2)
+#define AOA_BLOB_SIZE		(20)	/* transmitted bytes */
+#define AOA_BLOB_HEADER		"BLOB / aoa / v2 / 20\n"
+
+_Static_assert(sizeof(meas_aoa_t) == 20, "meas_aoa_t size");
+_Static_assert(offsetof(meas_aoa_t, angle_mdeg) == 0, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, pdoa) == 4, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, pdoa_raw) == 6, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, dist_mm) == 8, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, rx_power_cdbm) == 12, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, fp_power_cdbm) == 14, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, twr_count) == 16, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, flags) == 18, "meas_aoa_t layout");
+_Static_assert(offsetof(meas_aoa_t, padding) == 19, "meas_aoa_t layout");
+
+#endif /* SRC_APPS_MEASUREMENT_BLOBS_H_ */
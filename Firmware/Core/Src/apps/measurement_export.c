@@ -0,0 +1,151 @@
+/*
+ * measurement_export.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "deca_regs.h"
+#include "uart_stdio.h"
+#include "timebase.h"
+#include "profile.h"
+
+#include "spi_link.h"
+#include "measurement_export.h"
+
+/* Full accumulator memory (ACC_MEM) readout, the DW3000 returns a dummy byte first */
+#define CIR_ACC_MEM_LEN (12288)
+static uint8_t cir_buffer[CIR_ACC_MEM_LEN+1];
+
+static char export_print_buffer[64];
+
+/* Bytes 3 of STS_TOA_HI and STS1_TOA_HI and the first path threshold mode (bit 14 of 0x0C001E) are
+ * in register file 0x0C and read as one range from STS_TOA_HI byte 3 to 0x0C001F */
+#define STS_RANGE_START		(STS_TOA_HI_ID + 3)
+#define STS_RANGE_LEN		(0x0C001F - STS_RANGE_START + 1)
+#define DGC_DECISION_REG	(0x030060 + 3)
+
+void export_frame_marker(const char *frame_type, uint32_t sequence_number)
+{
+	snprintf(export_print_buffer, sizeof(export_print_buffer), "New Frame: %s: %lu\n", frame_type, sequence_number);
+	stdio_write(export_print_buffer);
+}
+
+void export_read_rx_buffer_diagnostics(meas_time_poa_t *toa, meas_cir_analysis_t cir_analysis[3])
+{
+	dwt_rxdiag_t rx_diag = {0};
+	SPI_LINK_RETRY(dwt_readdiagnostics(&rx_diag));
+
+	toa->cia_diag_1 = rx_diag.ciaDiag1;
+	toa->ip_poa = rx_diag.ipatovPOA;
+	toa->sts1_poa = rx_diag.stsPOA;
+	toa->sts2_poa = rx_diag.sts2POA;
+	toa->pdoa = rx_diag.pdoa;
+	toa->xtal_offset = rx_diag.xtalOffset;
+	toa->sts_qual_index = 0;
+	toa->sts_qual = 0;
+
+	toa->tdoa_sign = rx_diag.tdoa[5] & 0x01;
+	memcpy(toa->tdoa, rx_diag.tdoa, 5);
+	memcpy(toa->ip_toa, rx_diag.ipatovRxTime, 5);
+	toa->ip_toast = rx_diag.ipatovRxStatus;
+	memcpy(toa->sts1_toa, rx_diag.stsRxTime, 5);
+	toa->sts1_toast = 0;
+	memcpy(toa->sts2_toa, rx_diag.sts2RxTime, 5);
+	toa->sts2_toast = 0;
+	toa->fp_th_md = 0;
+	toa->dgc_decision = 0;
+	toa->padding[0] = 0;
+
+	cir_analysis[0].peak = rx_diag.ipatovPeak;
+	cir_analysis[0].power = rx_diag.ipatovPower;
+	cir_analysis[0].F1 = rx_diag.ipatovF1;
+	cir_analysis[0].F2 = rx_diag.ipatovF2;
+	cir_analysis[0].F3 = rx_diag.ipatovF3;
+	cir_analysis[0].fp_index = rx_diag.ipatovFpIndex;
+	cir_analysis[0].accum_count = rx_diag.ipatovAccumCount;
+	cir_analysis[1].peak = rx_diag.stsPeak;
+	cir_analysis[1].power = rx_diag.stsPower;
+	cir_analysis[1].F1 = rx_diag.stsF1;
+	cir_analysis[1].F2 = rx_diag.stsF2;
+	cir_analysis[1].F3 = rx_diag.stsF3;
+	cir_analysis[1].fp_index = rx_diag.stsFpIndex;
+	cir_analysis[1].accum_count = rx_diag.stsAccumCount;
+	cir_analysis[2].peak = rx_diag.sts2Peak;
+	cir_analysis[2].power = rx_diag.sts2Power;
+	cir_analysis[2].F1 = rx_diag.sts2F1;
+	cir_analysis[2].F2 = rx_diag.sts2F2;
+	cir_analysis[2].F3 = rx_diag.sts2F3;
+	cir_analysis[2].fp_index = rx_diag.sts2FpIndex;
+	cir_analysis[2].accum_count = rx_diag.sts2AccumCount;
+}
+
+void export_read_rx_diagnostics(meas_time_poa_t *toa, meas_cir_analysis_t cir_analysis[3])
+{
+	PROFILE_BEGIN(PROFILE_SPI_READ_DIAG);
+	export_read_rx_buffer_diagnostics(toa, cir_analysis);
+
+	toa->sts_qual = dwt_readstsquality(&toa->sts_qual_index);  // the quality threshold is known by the driver only
+
+	// read manually (because of an error in the API) in a single chained access
+	uint8_t sts_range[STS_RANGE_LEN];
+	uint8_t dgc_decision;
+	const spi_link_read_t reads[] = {
+			{STS_RANGE_START, STS_RANGE_LEN, sts_range},
+			{DGC_DECISION_REG, 1, &dgc_decision},
+	};
+	spi_link_gather(reads, sizeof(reads) / sizeof(reads[0]));
+
+	// discard the first bit which is reserved anyways
+	toa->sts1_toast = sts_range[0];
+	toa->sts2_toast = sts_range[STS1_TOA_HI_ID + 3 - STS_RANGE_START];
+	toa->fp_th_md = (sts_range[0x0C001F - STS_RANGE_START] & 0x40) >> 6;  // bit 14 of the 16-bit register
+	toa->dgc_decision = (dgc_decision & 0x70) >> 4;
+	PROFILE_END(PROFILE_SPI_READ_DIAG);
+}
+
+void export_transmit_rx_diagnostics(const meas_time_poa_t *toa, const meas_cir_analysis_t cir_analysis[3])
+{
+	stdio_write(TOA_BLOB_HEADER);
+	stdio_write_binary((const uint8_t*)toa, TOA_BLOB_SIZE);  // no need to transmit the padding bytes
+	stdio_write("\n" CIR_ANALYSIS_IP_BLOB_HEADER);
+	stdio_write_binary((const uint8_t*)&cir_analysis[0], CIR_ANALYSIS_BLOB_SIZE);
+	stdio_write("\n" CIR_ANALYSIS_STS1_BLOB_HEADER);
+	stdio_write_binary((const uint8_t*)&cir_analysis[1], CIR_ANALYSIS_BLOB_SIZE);
+	stdio_write("\n" CIR_ANALYSIS_STS2_BLOB_HEADER);
+	stdio_write_binary((const uint8_t*)&cir_analysis[2], CIR_ANALYSIS_BLOB_SIZE);
+	stdio_write("\n");
+}
+
+void export_rx_diagnostics(void)
+{
+	meas_time_poa_t toa;
+	meas_cir_analysis_t cir_analysis[3];
+
+	export_read_rx_diagnostics(&toa, cir_analysis);
+	export_transmit_rx_diagnostics(&toa, cir_analysis);
+}
+
+void export_read_cir(void)
+{
+	PROFILE_BEGIN(PROFILE_SPI_READ_ACC);
+	SPI_LINK_RETRY(dwt_readaccdata(cir_buffer, CIR_ACC_MEM_LEN+1, 0));
+	PROFILE_END(PROFILE_SPI_READ_ACC);
+}
+
+void export_transmit_cir(void)
+{
+	/* Version 1 of the blob is the raw readout including the leading dummy byte (the last byte of the
+	 * accumulator memory is not transmitted). */
+	stdio_write("BLOB / cir / v1 / 12288\n");
+	stdio_write_binary(cir_buffer, CIR_ACC_MEM_LEN);
+	stdio_write("\n");
+}
+
+void export_cir(void)
+{
+	export_read_cir();
+	export_transmit_cir();
+}
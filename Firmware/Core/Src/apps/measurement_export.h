@@ -0,0 +1,42 @@
+/*
+ * measurement_export.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_MEASUREMENT_EXPORT_H_
+#define SRC_APPS_MEASUREMENT_EXPORT_H_
+
+#include <stdint.h>
+
+#include "application_config.h"
+
+/* Binary measurement output shared by all applications, see Scripts/binary_parser.py for the host side. */
+
+/* Marker for serial output parsing script ("New Frame: <frame_type>: <sequence_number>") */
+void export_frame_marker(const char *frame_type, uint32_t sequence_number);
+
+/* Read the diagnostics of the last received frame (cir_analysis: preamble, STS1, STS2) */
+void export_read_rx_diagnostics(meas_time_poa_t *toa, meas_cir_analysis_t cir_analysis[3]);
+
+/* Read only the diagnostics the CIA copies into the register set of the current RX buffer (valid in
+ * double buffer mode), the STS quality, STS RX status, first path threshold mode and DGC decision are
+ * zero */
+void export_read_rx_buffer_diagnostics(meas_time_poa_t *toa, meas_cir_analysis_t cir_analysis[3]);
+
+/* Transmit diagnostics as toa and cir analysis blobs */
+void export_transmit_rx_diagnostics(const meas_time_poa_t *toa, const meas_cir_analysis_t cir_analysis[3]);
+
+/* Read and transmit the diagnostics of the last received frame */
+void export_rx_diagnostics(void);
+
+/* Read the full accumulator memory of the last received frame into a static buffer */
+void export_read_cir(void);
+
+/* Transmit the accumulator memory read by export_read_cir() as cir blob */
+void export_transmit_cir(void);
+
+/* Read and transmit the full accumulator memory of the last received frame as cir blob */
+void export_cir(void);
+
+#endif /* SRC_APPS_MEASUREMENT_EXPORT_H_ */
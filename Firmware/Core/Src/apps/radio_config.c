@@ -0,0 +1,289 @@
+/*
+ * radio_config.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uart_stdio.h"
+
+#include "application_config.h"
+#include "radio_config.h"
+
+/* Mapping between a value in symbols (or kb/s) and the corresponding driver constant */
+typedef struct
+{
+	uint16_t value;
+	uint8_t setting;
+} radio_config_map_t;
+
+static const radio_config_map_t preamble_lengths[] = {
+		{ 32, DWT_PLEN_32 }, { 64, DWT_PLEN_64 }, { 72, DWT_PLEN_72 }, { 128, DWT_PLEN_128 },
+		{ 256, DWT_PLEN_256 }, { 512, DWT_PLEN_512 }, { 1024, DWT_PLEN_1024 }, { 1536, DWT_PLEN_1536 },
+		{ 2048, DWT_PLEN_2048 }, { 4096, DWT_PLEN_4096 },
+};
+
+static const radio_config_map_t pac_sizes[] = {
+		{ 4, DWT_PAC4 }, { 8, DWT_PAC8 }, { 16, DWT_PAC16 }, { 32, DWT_PAC32 },
+};
+
+static const radio_config_map_t sts_lengths[] = {
+		{ 32, DWT_STS_LEN_32 }, { 64, DWT_STS_LEN_64 }, { 128, DWT_STS_LEN_128 }, { 256, DWT_STS_LEN_256 },
+		{ 512, DWT_STS_LEN_512 }, { 1024, DWT_STS_LEN_1024 }, { 2048, DWT_STS_LEN_2048 },
+};
+
+static const radio_config_map_t data_rates[] = {
+		{ 850, DWT_BR_850K }, { 6800, DWT_BR_6M8 },
+};
+
+#define MAP_SIZE(map) (sizeof(map) / sizeof(map[0]))
+
+/* Frame duration model in units of 10 ps (see Scripts/twr_timing_model.py) */
+#define SYMBOL_16M_10PS		(99359)		/* preamble and SFD symbol, 16 MHz PRF (codes 3, 4) */
+#define SYMBOL_64M_10PS		(101763)	/* preamble and SFD symbol, 64 MHz PRF (codes 9-12) */
+#define STS_BLOCK_10PS		(102564)	/* 512 chips */
+#define BIT_850K_10PS		(102564)
+#define BIT_6M8_10PS		(12821)
+#define PHR_BITS			(19)
+#define RS_BLOCK_BITS		(330)		/* Reed-Solomon parity bits per block of data bits */
+#define RS_PARITY_BITS		(48)
+
+static char radio_config_buffer[64];
+
+static int map_to_setting(const radio_config_map_t *map, size_t size, uint16_t value, uint8_t *setting)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (map[i].value == value) {
+			*setting = map[i].setting;
+			return DWT_SUCCESS;
+		}
+	}
+	return DWT_ERROR;
+}
+
+static uint16_t map_to_value(const radio_config_map_t *map, size_t size, uint8_t setting)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (map[i].setting == setting) {
+			return map[i].value;
+		}
+	}
+	return 0;
+}
+
+/* SFD timeout as recommended by the driver examples (preamble length + 1 + SFD length - PAC size) */
+static uint16_t sfd_timeout(const dwt_config_t *cfg)
+{
+	uint16_t sfd_length = (cfg->sfdType == 2) ? 16 : 8;
+	return map_to_value(preamble_lengths, MAP_SIZE(preamble_lengths), cfg->txPreambLength) + 1 + sfd_length
+			- map_to_value(pac_sizes, MAP_SIZE(pac_sizes), cfg->rxPAC);
+}
+
+static int parse_number(const char *value, uint16_t *number)
+{
+	char *end;
+	unsigned long parsed = strtoul(value, &end, 10);
+	if (*value == '\0' || *end != '\0' || parsed > UINT16_MAX) {
+		return DWT_ERROR;
+	}
+	*number = parsed;
+	return DWT_SUCCESS;
+}
+
+static int set_field(dwt_config_t *cfg, const char *key, const char *value)
+{
+	uint16_t number = 0;
+	uint8_t setting;
+	int is_number = (parse_number(value, &number) == DWT_SUCCESS);
+
+	if (strcmp(key, "sts_mode") == 0) {
+		uint8_t sdc = cfg->stsMode & DWT_STS_MODE_SDC;
+		if (strcmp(value, "off") == 0) {
+			cfg->stsMode = DWT_STS_MODE_OFF | sdc;
+		} else if (strcmp(value, "1") == 0) {
+			cfg->stsMode = DWT_STS_MODE_1 | sdc;
+		} else if (strcmp(value, "2") == 0) {
+			cfg->stsMode = DWT_STS_MODE_2 | sdc;
+		} else if (strcmp(value, "nd") == 0) {
+			cfg->stsMode = DWT_STS_MODE_ND | sdc;
+		} else {
+			return DWT_ERROR;
+		}
+		return DWT_SUCCESS;
+	}
+
+	if (!is_number) {
+		return DWT_ERROR;
+	}
+
+	if (strcmp(key, "channel") == 0) {
+		if (number != 5 && number != 9) {
+			return DWT_ERROR;
+		}
+		cfg->chan = number;
+	} else if (strcmp(key, "plen") == 0) {
+		if (map_to_setting(preamble_lengths, MAP_SIZE(preamble_lengths), number, &setting) != DWT_SUCCESS) {
+			return DWT_ERROR;
+		}
+		cfg->txPreambLength = setting;
+	} else if (strcmp(key, "pac") == 0) {
+		if (map_to_setting(pac_sizes, MAP_SIZE(pac_sizes), number, &setting) != DWT_SUCCESS) {
+			return DWT_ERROR;
+		}
+		cfg->rxPAC = setting;
+	} else if (strcmp(key, "code") == 0) {
+		/* codes of channels 5 and 9 supported by the DW3000 */
+		if (number != 3 && number != 4 && (number < 9 || number > 12)) {
+			return DWT_ERROR;
+		}
+		cfg->txCode = number;
+		cfg->rxCode = number;
+	} else if (strcmp(key, "sfd") == 0) {
+		if (number > 3) {
+			return DWT_ERROR;
+		}
+		cfg->sfdType = number;
+	} else if (strcmp(key, "rate") == 0) {
+		if (map_to_setting(data_rates, MAP_SIZE(data_rates), number, &setting) != DWT_SUCCESS) {
+			return DWT_ERROR;
+		}
+		cfg->dataRate = setting;
+	} else if (strcmp(key, "sts_sdc") == 0) {
+		if (number > 1) {
+			return DWT_ERROR;
+		}
+		cfg->stsMode = (cfg->stsMode & ~DWT_STS_MODE_SDC) | (number ? DWT_STS_MODE_SDC : 0);
+	} else if (strcmp(key, "sts_len") == 0) {
+		if (map_to_setting(sts_lengths, MAP_SIZE(sts_lengths), number, &setting) != DWT_SUCCESS) {
+			return DWT_ERROR;
+		}
+		cfg->stsLength = setting;
+	} else if (strcmp(key, "pdoa") == 0) {
+		if (number != DWT_PDOA_M0 && number != DWT_PDOA_M1 && number != DWT_PDOA_M3) {
+			return DWT_ERROR;
+		}
+		cfg->pdoaMode = number;
+	} else {
+		return DWT_ERROR;
+	}
+
+	return DWT_SUCCESS;
+}
+
+void radio_config_default(dwt_config_t *cfg)
+{
+	*cfg = config;
+}
+
+int radio_config_parse(dwt_config_t *cfg, const char *args)
+{
+	char *save;
+
+	strncpy(radio_config_buffer, args, sizeof(radio_config_buffer) - 1);
+	radio_config_buffer[sizeof(radio_config_buffer) - 1] = '\0';
+
+	char *key = strtok_r(radio_config_buffer, " ", &save);
+	while (key != NULL) {
+		char *value = strtok_r(NULL, " ", &save);
+		if (value == NULL || set_field(cfg, key, value) != DWT_SUCCESS) {
+			/* the command line is at most 64 characters, key and value fit into the message */
+			char message[96];
+			snprintf(message, sizeof(message), "config error: invalid %s %s\n", key, value ? value : "");
+			stdio_write(message);
+			return DWT_ERROR;
+		}
+		key = strtok_r(NULL, " ", &save);
+	}
+
+	/* PDoA mode 3 compares the two STS segments, it needs the STS and a length of a multiple of 128 */
+	if (cfg->pdoaMode == DWT_PDOA_M3 &&
+			((cfg->stsMode & ~DWT_STS_MODE_SDC) == DWT_STS_MODE_OFF || cfg->stsLength < DWT_STS_LEN_128)) {
+		stdio_write("config error: pdoa 3 needs sts_mode 1, 2 or nd and sts_len >= 128\n");
+		return DWT_ERROR;
+	}
+
+	cfg->sfdTO = sfd_timeout(cfg);
+	return DWT_SUCCESS;
+}
+
+uint32_t radio_config_rmarker_ns(const dwt_config_t *cfg)
+{
+	const uint32_t symbol = (cfg->txCode >= 9) ? SYMBOL_64M_10PS : SYMBOL_16M_10PS;
+	const uint32_t sfd_length = (cfg->sfdType == 2) ? 16 : 8;
+	return (map_to_value(preamble_lengths, MAP_SIZE(preamble_lengths), cfg->txPreambLength) + sfd_length)
+			* symbol / 100;
+}
+
+uint32_t radio_config_after_rmarker_ns(const dwt_config_t *cfg, uint16_t length)
+{
+	const uint8_t sts_mode = cfg->stsMode & ~DWT_STS_MODE_SDC;
+	uint32_t duration = 0;
+
+	if (sts_mode != DWT_STS_MODE_OFF) {
+		duration += map_to_value(sts_lengths, MAP_SIZE(sts_lengths), cfg->stsLength) * STS_BLOCK_10PS / 100;
+	}
+	/* no PHR and payload in STS mode 3 (STS packet configuration 3) */
+	if (sts_mode != DWT_STS_MODE_ND) {
+		const uint32_t bit = (cfg->dataRate == DWT_BR_850K) ? BIT_850K_10PS : BIT_6M8_10PS;
+		const uint32_t phr_bit = (cfg->phrRate == DWT_PHRRATE_DTA) ? bit : BIT_850K_10PS;
+		const uint32_t bits = 8 * length;
+		const uint32_t parity = (bits + RS_BLOCK_BITS - 1) / RS_BLOCK_BITS * RS_PARITY_BITS;
+		duration += (PHR_BITS * phr_bit + (bits + parity) * bit) / 100;
+	}
+	return duration;
+}
+
+/* Required and configured duration of one constraint in us, prints a config error if it is violated */
+static int check_slot(const char *name, uint32_t required_ns, uint32_t configured_us)
+{
+	if (required_ns <= configured_us * 1000) {
+		return DWT_SUCCESS;
+	}
+	char message[96];
+	snprintf(message, sizeof(message), "config error: %s needs %lu us, configured %lu us\n", name,
+			(unsigned long)(required_ns + 999) / 1000, (unsigned long)configured_us);
+	stdio_write(message);
+	return DWT_ERROR;
+}
+
+int radio_config_check_multi_twr(const dwt_config_t *cfg)
+{
+	const uint32_t margin_ns = MULTI_TWR_MARGIN_US * 1000;
+	const uint32_t before_ns = radio_config_rmarker_ns(cfg);
+	const uint32_t poll_after_ns = radio_config_after_rmarker_ns(cfg, sizeof(twr_base_frame_t) + 2);
+	const uint32_t response_after_ns = radio_config_after_rmarker_ns(cfg, sizeof(twr_multi_response_frame_t) + 2);
+	/* the tag stops waiting for responses half of the guard time before the final frame */
+	const uint32_t guard_ns = 2 * (((response_after_ns > before_ns) ? response_after_ns : before_ns) + margin_ns);
+
+	int result = check_slot("first slot", poll_after_ns + margin_ns + before_ns, MULTI_TWR_FIRST_SLOT_US);
+	result |= check_slot("slot spacing", response_after_ns + margin_ns + before_ns, MULTI_TWR_SLOT_US);
+	result |= check_slot("final guard", guard_ns, MULTI_TWR_FINAL_GUARD_US);
+	return (result == DWT_SUCCESS) ? DWT_SUCCESS : DWT_ERROR;
+}
+
+void radio_config_export(const dwt_config_t *cfg, uint16_t config_count)
+{
+	meas_radio_config_t export = {
+			.preamble_length = map_to_value(preamble_lengths, MAP_SIZE(preamble_lengths), cfg->txPreambLength),
+			.sfd_timeout = cfg->sfdTO,
+			.sts_length = map_to_value(sts_lengths, MAP_SIZE(sts_lengths), cfg->stsLength),
+			.config_count = config_count,
+			.channel = cfg->chan,
+			.pac = map_to_value(pac_sizes, MAP_SIZE(pac_sizes), cfg->rxPAC),
+			.tx_code = cfg->txCode,
+			.rx_code = cfg->rxCode,
+			.sfd_type = cfg->sfdType,
+			.data_rate = cfg->dataRate,
+			.phr_mode = cfg->phrMode,
+			.phr_rate = cfg->phrRate,
+			.sts_mode = cfg->stsMode,
+			.pdoa_mode = cfg->pdoaMode,
+	};
+
+	stdio_write(CONFIG_BLOB_HEADER);
+	stdio_write_binary((const uint8_t*)&export, CONFIG_BLOB_SIZE);
+	stdio_write("\n");
+}
@@ -0,0 +1,52 @@
+/*
+ * radio_config.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_RADIO_CONFIG_H_
+#define SRC_APPS_RADIO_CONFIG_H_
+
+#include <stdint.h>
+
+#include "deca_device_api.h"
+
+/* Runtime radio configuration
+ *
+ * The serial command "config" changes fields of the radio configuration given as key/value pairs, e.g.
+ * "config plen 128 pac 8 sts_len 256". Several pairs in one command are applied together. The SFD timeout
+ * follows the preamble length, PAC size and SFD type automatically. Supported keys and values:
+ *   channel  5, 9
+ *   plen     32, 64, 72, 128, 256, 512, 1024, 1536, 2048, 4096 (preamble length in symbols)
+ *   pac      4, 8, 16, 32 (preamble acquisition chunk size in symbols)
+ *   code     preamble code for TX and RX, 3, 4 (16 MHz PRF) or 9-12 (64 MHz PRF)
+ *   sfd      SFD type 0-3
+ *   rate     850, 6800 (data rate in kb/s)
+ *   sts_mode off, 1, 2, nd
+ *   sts_sdc  0, 1 (deterministic STS)
+ *   sts_len  32, 64, 128, 256, 512, 1024, 2048 (STS length in symbols)
+ *   pdoa     0, 1, 3
+ * "config default" restores the configuration from application_config.h, "config" alone echoes the
+ * active configuration.
+ */
+
+/* Copy the compile time configuration (application_config.h) */
+void radio_config_default(dwt_config_t *cfg);
+
+/* Parse the key/value pairs of a config command and update cfg, prints an error and returns DWT_ERROR
+ * (cfg may be partially updated) on an unknown key, invalid value or inconsistent configuration */
+int radio_config_parse(dwt_config_t *cfg, const char *args);
+
+/* Transmit the configuration as config blob, config_count identifies the configuration in the log */
+void radio_config_export(const dwt_config_t *cfg, uint16_t config_count);
+
+/* Estimated airtime of a frame in ns (same model as Scripts/twr_timing_model.py): preamble and SFD up to
+ * the RMARKER, STS, PHR and length payload bytes (including the FCS) after it */
+uint32_t radio_config_rmarker_ns(const dwt_config_t *cfg);
+uint32_t radio_config_after_rmarker_ns(const dwt_config_t *cfg, uint16_t length);
+
+/* Check the response slots of the broadcast poll ranging (MULTI_TWR_* in application_config.h) against the
+ * frame durations of cfg, prints the violated constraint and returns DWT_ERROR if the frames do not fit */
+int radio_config_check_multi_twr(const dwt_config_t *cfg);
+
+#endif /* SRC_APPS_RADIO_CONFIG_H_ */
@@ -0,0 +1,142 @@
+/*
+ * ranging_math.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ranging_math.h"
+
+#define INTERVAL_MASK		(0xFFFFFFFFFFllu)	/* intervals of 40-bit timestamps (wrap of the device time) */
+#define CLOCK_OFFSET_BITS	(26)				/* clock offset in 2^-26 units */
+
+/* mm per DTU = c / (128 * 499.2 MHz) = 299792458 / 63897600 = 149896229 / 31948800 */
+#define MM_PER_DTU_NUM		(149896229llu)
+#define MM_PER_DTU_DEN		(31948800llu)
+
+/* Unsigned 128-bit integer */
+typedef struct
+{
+	uint64_t hi;
+	uint64_t lo;
+} u128_t;
+
+static u128_t mul_64x64(uint64_t a, uint64_t b)
+{
+	const uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+	const uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+
+	const uint64_t lo_lo = a_lo * b_lo;
+	const uint64_t hi_lo = a_hi * b_lo;
+	const uint64_t lo_hi = a_lo * b_hi;
+	const uint64_t hi_hi = a_hi * b_hi;
+	/* cannot overflow: at most 2 * (2^32 - 1) + (2^32 - 1)^2 */
+	const uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+
+	u128_t result;
+	result.hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+	result.lo = (cross << 32) | (uint32_t)lo_lo;
+	return result;
+}
+
+static int less(u128_t a, u128_t b)
+{
+	return (a.hi < b.hi) || ((a.hi == b.hi) && (a.lo < b.lo));
+}
+
+static u128_t sub(u128_t a, u128_t b)
+{
+	u128_t result;
+	result.lo = a.lo - b.lo;
+	result.hi = a.hi - b.hi - (a.lo < b.lo);
+	return result;
+}
+
+static u128_t add_64(u128_t a, uint64_t b)
+{
+	u128_t result;
+	result.lo = a.lo + b;
+	result.hi = a.hi + (result.lo < b);
+	return result;
+}
+
+/* Shift left by 0 < bits < 64 */
+static u128_t shift_left(u128_t a, unsigned bits)
+{
+	u128_t result;
+	result.hi = (a.hi << bits) | (a.lo >> (64 - bits));
+	result.lo = a.lo << bits;
+	return result;
+}
+
+/* n / d rounded to nearest, saturated to 2^64 - 1 if the quotient does not fit */
+static uint64_t div_round(u128_t n, uint64_t d)
+{
+	if (d == 0) {
+		return UINT64_MAX;
+	}
+
+	n = add_64(n, d / 2);
+	if (n.hi >= d) {
+		return UINT64_MAX;
+	}
+
+	/* restoring division, the remainder starts with the high word (which is smaller than d) */
+	uint64_t remainder = n.hi;
+	uint64_t quotient = 0;
+	for (int bit = 63; bit >= 0; bit--) {
+		const uint64_t carry = remainder >> 63;
+		remainder = (remainder << 1) | ((n.lo >> bit) & 1);
+		quotient <<= 1;
+		if (carry || (remainder >= d)) {
+			remainder -= d;
+			quotient |= 1;
+		}
+	}
+	return quotient;
+}
+
+uint64_t ranging_remote_to_local(uint64_t interval, int16_t clock_offset)
+{
+	interval &= INTERVAL_MASK;
+	/* at most 2^40 * 2^15, arithmetic shift (rounds towards minus infinity) */
+	const int64_t correction = ((int64_t)interval * clock_offset) >> CLOCK_OFFSET_BITS;
+	return (uint64_t)((int64_t)interval - correction);
+}
+
+int64_t ranging_tof(uint64_t Treply1, uint64_t Tround2, uint64_t Tround1, uint64_t Treply2, int16_t clock_offset)
+{
+	Treply1 &= INTERVAL_MASK;
+	Tround2 &= INTERVAL_MASK;
+	Tround1 = ranging_remote_to_local(Tround1, clock_offset);
+	Treply2 = ranging_remote_to_local(Treply2, clock_offset);
+
+	const u128_t round_product = mul_64x64(Tround1, Tround2);
+	const u128_t reply_product = mul_64x64(Treply1, Treply2);
+	const uint64_t denominator = Tround1 + Tround2 + Treply1 + Treply2;
+
+	/* |numerator| < 2^82, shifted < 2^92 */
+	const int negative = less(round_product, reply_product);
+	const u128_t numerator = negative ? sub(reply_product, round_product) : sub(round_product, reply_product);
+	const uint64_t magnitude = div_round(shift_left(numerator, RANGING_TOF_FRACTION_BITS), denominator);
+
+	if (magnitude > INT64_MAX) {
+		return negative ? INT64_MIN : INT64_MAX;
+	}
+	const int64_t tof = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+	return tof - ((int64_t)RANGING_ANTENNA_DELAY_DTU << RANGING_TOF_FRACTION_BITS);
+}
+
+uint32_t ranging_tof_to_mm(int64_t tof)
+{
+	if (tof <= 0) {
+		return 0;
+	}
+
+	const uint64_t mm = div_round(mul_64x64((uint64_t)tof, MM_PER_DTU_NUM), MM_PER_DTU_DEN << RANGING_TOF_FRACTION_BITS);
+	return (mm > UINT32_MAX) ? UINT32_MAX : (uint32_t)mm;
+}
+
+uint32_t ranging_distance_mm(uint64_t Treply1, uint64_t Tround2, uint64_t Tround1, uint64_t Treply2, int16_t clock_offset)
+{
+	return ranging_tof_to_mm(ranging_tof(Treply1, Tround2, Tround1, Treply2, clock_offset));
+}
@@ -0,0 +1,47 @@
+/*
+ * ranging_math.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_RANGING_MATH_H_
+#define SRC_APPS_RANGING_MATH_H_
+
+#include <stdint.h>
+
+/* Time of flight and distance of the double sided TWR with asymmetric reply times
+ *
+ *   tof = (Tround1 * Tround2 - Treply1 * Treply2) / (Tround1 + Tround2 + Treply1 + Treply2)
+ *
+ * Treply1 and Tround2 are measured by the local device, Tround1 and Treply2 by the remote device (sent
+ * in the final frame). The remote intervals run on the crystal of the remote device and are converted
+ * to the local clock with the clock offset of its frames first (dwt_readclockoffset(), 2^-26 units).
+ *
+ * The products of the 40-bit intervals need up to 80 bits, they are evaluated with 128-bit integers
+ * made of two uint64_t (the Cortex-M4 compiler has no __int128). The time of flight is kept in 1/1024
+ * device time units (DTU) and converted with the exact DTU of 1 / (128 * 499.2 MHz) = 15.65 ps, the
+ * previous division by 64 instead of 63.8976 DTU/ns made the distances 0.16 % too short.
+ *
+ * RANGING_ANTENNA_DELAY_DTU is subtracted from the time of flight (the antenna delays of the devices
+ * are not configured, all timestamps include them). Scripts/ranging_math.py implements the same
+ * integer arithmetic and estimates the delay from a log taken at a known distance. Both are checked
+ * against exact arithmetic by "make test-ranging" of the host build (Host/test_ranging.c).
+ */
+
+#define RANGING_ANTENNA_DELAY_DTU	(0)		/* Antenna delay of tag and anchor in the time of flight */
+#define RANGING_TOF_FRACTION_BITS	(10)	/* Time of flight in 1/1024 DTU */
+
+/* Convert an interval measured by the remote device to the local clock */
+uint64_t ranging_remote_to_local(uint64_t interval, int16_t clock_offset);
+
+/* Time of flight in 1/1024 DTU including the antenna delay correction (can be negative at short
+ * distances), clock_offset is the offset of the remote device */
+int64_t ranging_tof(uint64_t Treply1, uint64_t Tround2, uint64_t Tround1, uint64_t Treply2, int16_t clock_offset);
+
+/* Distance in mm of a time of flight in 1/1024 DTU (0 if negative) */
+uint32_t ranging_tof_to_mm(int64_t tof);
+
+/* ranging_tof() and ranging_tof_to_mm() */
+uint32_t ranging_distance_mm(uint64_t Treply1, uint64_t Tround2, uint64_t Tround1, uint64_t Treply2, int16_t clock_offset);
+
+#endif /* SRC_APPS_RANGING_MATH_H_ */
@@ -0,0 +1,129 @@
+/*
+ * rx_ring.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <string.h>
+
+#include "deca_regs.h"
+#include "port.h"
+
+#include "rx_ring.h"
+#include "measurement_export.h"
+
+static rx_descriptor_t ring[RX_RING_SIZE];
+
+/* head is only written by the receive callback, tail only by the main loop */
+static volatile uint32_t ring_head = 0;
+static volatile uint32_t ring_tail = 0;
+static volatile uint32_t dropped = 0;
+static uint32_t sequence = 0;
+static uint8_t read_diagnostics = 0;
+static uint8_t double_buffer = 0;
+
+void rx_ring_start(uint8_t double_buffered, uint8_t capture_diagnostics)
+{
+	ring_head = 0;
+	ring_tail = 0;
+	dropped = 0;
+	sequence = 0;
+	read_diagnostics = capture_diagnostics;
+	double_buffer = double_buffered;
+
+	/* Enable IC diagnostic calculation and logging, including the copy for each RX buffer */
+	dwt_configciadiag(DW_CIA_DIAG_LOG_ALL | DW_CIA_DIAG_LOG_MAX);
+
+	if (double_buffer) {
+		dwt_setdblrxbuffmode(DBL_BUF_STATE_EN, DBL_BUF_MODE_AUTO);
+	} else {
+		dwt_setdblrxbuffmode(DBL_BUF_STATE_DIS, DBL_BUF_MODE_MAN);
+	}
+	dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+void rx_ring_resume(void)
+{
+	dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
+
+const rx_descriptor_t *rx_ring_peek(void)
+{
+	if (ring_tail == ring_head) {
+		return NULL;
+	}
+	return &ring[ring_tail & (RX_RING_SIZE - 1)];
+}
+
+void rx_ring_release(void)
+{
+	if (ring_tail != ring_head) {
+		ring_tail++;
+		if (!double_buffer) {
+			dwt_rxenable(DWT_START_RX_IMMEDIATE);
+		}
+	}
+}
+
+uint32_t rx_ring_dropped(void)
+{
+	return dropped;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_ring_rx_ok_cb()
+ *
+ * @brief Copy the received frame into the ring and release the RX buffer of the DW3000 (double buffered)
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+void rx_ring_rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+	sequence++;
+
+	if (ring_head - ring_tail >= RX_RING_SIZE) {
+		dropped++;
+		if (double_buffer) {
+			dwt_signal_rx_buff_free();
+		} else {
+			dwt_rxenable(DWT_START_RX_IMMEDIATE);
+		}
+		return;
+	}
+
+	rx_descriptor_t *descriptor = &ring[ring_head & (RX_RING_SIZE - 1)];
+	descriptor->sequence = sequence;
+	descriptor->length = (cb_data->datalength > FCS_LEN) ? (cb_data->datalength - FCS_LEN) : 0;
+	if (descriptor->length > RX_RING_FRAME_LEN) {
+		descriptor->length = RX_RING_FRAME_LEN;
+	}
+	dwt_readrxdata(descriptor->data, descriptor->length, 0);
+	dwt_readrxtimestamp(descriptor->rx_timestamp);
+	if (read_diagnostics && double_buffer) {
+		export_read_rx_buffer_diagnostics(&descriptor->toa, descriptor->cir_analysis);
+	} else if (read_diagnostics) {
+		export_read_rx_diagnostics(&descriptor->toa, descriptor->cir_analysis);
+	}
+
+	if (double_buffer) {
+		dwt_signal_rx_buff_free();
+	}
+	ring_head++;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn rx_ring_rx_err_cb()
+ *
+ * @brief Restart reception after RX errors and timeouts
+ *
+ * @param  cb_data  callback data
+ *
+ * @return  none
+ */
+void rx_ring_rx_err_cb(const dwt_cb_data_t *cb_data)
+{
+	UNUSED(cb_data);
+	dwt_rxenable(DWT_START_RX_IMMEDIATE);
+}
@@ -0,0 +1,67 @@
+/*
+ * rx_ring.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_RX_RING_H_
+#define SRC_APPS_RX_RING_H_
+
+#include <stdint.h>
+
+#include "deca_device_api.h"
+#include "application_config.h"
+
+/* Reception into a ring of descriptors for the receive-only applications (rx, pdoa)
+ *
+ * The receive callback (interrupt context) copies frame, RX timestamp and optionally the diagnostics
+ * into the next descriptor of a ring, the main loop exports them with rx_ring_peek() and
+ * rx_ring_release(). Frames are counted and dropped when the ring is full.
+ *
+ * Double buffered: the DW3000 receives into its two RX buffers alternately and re-enables the receiver
+ * after every frame, the callback releases the DW3000 buffer right away, so frames arriving while the
+ * main loop transmits the previous ones are kept. Only the diagnostics the CIA copies into the register
+ * set of each buffer (dwt_readdiagnostics()) belong to the frame of the descriptor. The live registers
+ * (STS quality, STS RX status, first path threshold mode, DGC decision) may already hold the next
+ * frame, these fields are zero in the descriptors. The accumulator (CIR) is not double buffered
+ * either, applications exporting the CIR cannot use this mode.
+ *
+ * Single buffered: the receiver stays off from the callback until rx_ring_release(), the ring holds
+ * at most one frame and all diagnostics and the accumulator belong to it until the release.
+ */
+
+#define RX_RING_SIZE		(8)		/* Number of descriptors, must be a power of two */
+#define RX_RING_FRAME_LEN	(127)	/* Maximum frame length (without FCS) */
+
+typedef struct
+{
+	uint32_t sequence;					// Number of the frame since rx_ring_start(), including dropped frames
+	uint16_t length;					// Frame length without FCS
+	uint8_t rx_timestamp[5];			// RX timestamp (RMARKER)
+	uint8_t data[RX_RING_FRAME_LEN];
+	meas_time_poa_t toa;				// Diagnostics (only with capture_diagnostics, see above)
+	meas_cir_analysis_t cir_analysis[3];
+} rx_descriptor_t;
+
+/* Clear the ring, enable or disable double buffer mode and start reception. With capture_diagnostics
+ * the diagnostics of every frame are read in the receive callback as well. */
+void rx_ring_start(uint8_t double_buffered, uint8_t capture_diagnostics);
+
+/* Restart reception after the radio was reconfigured */
+void rx_ring_resume(void);
+
+/* Oldest received frame, NULL if the ring is empty */
+const rx_descriptor_t *rx_ring_peek(void);
+
+/* Remove the oldest frame (returned by rx_ring_peek()) from the ring, single buffered this re-enables
+ * the receiver */
+void rx_ring_release(void);
+
+/* Number of frames dropped because the ring was full */
+uint32_t rx_ring_dropped(void);
+
+/* Callbacks for the application_t of the application */
+void rx_ring_rx_ok_cb(const dwt_cb_data_t *cb_data);
+void rx_ring_rx_err_cb(const dwt_cb_data_t *cb_data);
+
+#endif /* SRC_APPS_RX_RING_H_ */
@@ -9,6 +9,7 @@
 #include "port.h"
 #include "main.h"
 #include "shared_functions.h"
+#include "motor.h"
 
 
 int32_t decode_24bit(const uint8_t* buffer) {
@@ -29,6 +30,16 @@ int32_t decode_24bit(const uint8_t* buffer) {
 }
 
 
+uint32_t decode_32bit(const uint8_t buffer[4]) {
+	/* combine four bytes into one integer */
+	const uint32_t value = ((uint32_t)buffer[0]) \
+							+ ((uint32_t)buffer[1] << 8) \
+							+ ((uint32_t)buffer[2] << 16) \
+							+ ((uint32_t)buffer[3] << 24);
+	return value;
+}
+
+
 uint64_t decode_40bit_timestamp(const uint8_t buffer[5]) {
 	/* combine five bytes into one integer */
 	const uint64_t value = ((uint64_t)buffer[0]) \
@@ -40,20 +51,12 @@ uint64_t decode_40bit_timestamp(const uint8_t buffer[5]) {
 }
 
 
+int32_t rotation_angle_mdeg(void) {
+	return ((int64_t)motor_position_substeps() * 1000) / (MOTOR_SUBSTEPS * MOTOR_STEPS_PER_DEGREE);
+}
+
+
 void rotate_reciever(int degrees) {
-	if (0 == degrees) {
-		return;
-	} else if (0 < degrees) {
-		HAL_GPIO_WritePin(MOTOR_DIR_GPIO_Port, MOTOR_DIR_Pin, GPIO_PIN_RESET);
-	} else {
-		HAL_GPIO_WritePin(MOTOR_DIR_GPIO_Port, MOTOR_DIR_Pin, GPIO_PIN_SET);
-		degrees = -degrees;
-	}
-
-	for (int i = 0; i < degrees; i++) {
-		HAL_GPIO_WritePin(MOTOR_STEP_GPIO_Port, MOTOR_STEP_Pin, GPIO_PIN_SET);
-		Sleep(40);
-		HAL_GPIO_WritePin(MOTOR_STEP_GPIO_Port, MOTOR_STEP_Pin, GPIO_PIN_RESET);
-		Sleep(40);
-	}
+	/* Added to the pending target, the timer interrupt generates the steps (motor.c) */
+	motor_move_by(degrees * MOTOR_STEPS_PER_DEGREE);
 }
@@ -11,10 +11,17 @@
 /* Decode a 24-bit number stored in a 3-byte uint8_t array */
 int32_t decode_24bit(const uint8_t* buffer);
 
+/* Decode a 32-bit number stored in a 4-byte uint8_t array */
+uint32_t decode_32bit(const uint8_t buffer[4]);
+
 /* Decode a 40-bit number stored in a 5-byte uint8_t array */
 uint64_t decode_40bit_timestamp(const uint8_t buffer[5]);
 
-/* Rotate the stepper motor */
+/* Rotate the stepper motor by the given angle relative to the current target (returns immediately,
+ * the actual angle is motor_position() / MOTOR_STEPS_PER_DEGREE) */
 void rotate_reciever(int degrees);
 
+/* Angle of the turntable in millidegrees, interpolated between the motor steps */
+int32_t rotation_angle_mdeg(void);
+
 #endif /* SRC_APPS_SHARED_FUNCTIONS_H_ */
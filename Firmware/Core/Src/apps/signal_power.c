@@ -0,0 +1,66 @@
+/*
+ * signal_power.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "signal_power.h"
+
+#define LOG2_FRACTION_BITS	(16)		/* log2 in Q16 */
+#define LOG2_TABLE_BITS		(5)			/* table step 1/32 of the mantissa */
+#define CDB_PER_LOG2_Q32	(19728302)	/* 100 * 10 * log10(2) / 2^16 in Q32 */
+#define RX_POWER_SCALE_BITS	(21)		/* C * 2^21 */
+#define DGC_STEP_CDB		(600)		/* 6 dB per DGC decision */
+
+/* log2(1 + i / 32) in Q16, i = 0..32 */
+static const int32_t log2_table[33] = {
+	0, 2909, 5732, 8473, 11136, 13727, 16248, 18704,
+	21098, 23433, 25711, 27936, 30109, 32234, 34312, 36346,
+	38336, 40286, 42196, 44068, 45904, 47705, 49472, 51207,
+	52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047,
+	65536,
+};
+
+/* log2 of value > 0 in Q16 */
+static int32_t log2_q16(uint64_t value)
+{
+	const int32_t exponent = 63 - __builtin_clzll(value);
+	const uint64_t mantissa = value << (63 - exponent);	/* highest bit at 63 */
+	const int32_t index = (int32_t)(mantissa >> (63 - LOG2_TABLE_BITS)) & ((1 << LOG2_TABLE_BITS) - 1);
+	const int32_t fraction = (int32_t)(mantissa >> (63 - LOG2_TABLE_BITS - 16)) & 0xFFFF;
+
+	return (exponent << LOG2_FRACTION_BITS) + log2_table[index]
+			+ (((log2_table[index + 1] - log2_table[index]) * fraction) >> 16);
+}
+
+/* 10 * log10(power / N^2) + 6 * D - A in 0.01 dBm, power and N not 0 */
+static int16_t power_level_cdbm(int32_t log2_power, uint16_t accum_count, uint8_t dgc_decision, uint8_t rx_code)
+{
+	const int32_t log2_ratio = log2_power - 2 * log2_q16(accum_count);
+	const int32_t level = (int32_t)(((int64_t)log2_ratio * CDB_PER_LOG2_Q32 + (1ll << 31)) >> 32);
+	const int32_t a = (rx_code >= 9) ? SIGNAL_POWER_A_PRF64_CDB : SIGNAL_POWER_A_PRF16_CDB;
+
+	return (int16_t)(level + DGC_STEP_CDB * dgc_decision - a);
+}
+
+int16_t signal_power_rx_cdbm(const meas_cir_analysis_t *ip_analysis, uint8_t dgc_decision, uint8_t rx_code)
+{
+	if (ip_analysis->accum_count == 0 || ip_analysis->power == 0) {
+		return SIGNAL_POWER_INVALID;
+	}
+	return power_level_cdbm(log2_q16(ip_analysis->power) + (RX_POWER_SCALE_BITS << LOG2_FRACTION_BITS),
+			ip_analysis->accum_count, dgc_decision, rx_code);
+}
+
+int16_t signal_power_fp_cdbm(const meas_cir_analysis_t *ip_analysis, uint8_t dgc_decision, uint8_t rx_code)
+{
+	const uint64_t f1 = ip_analysis->F1;
+	const uint64_t f2 = ip_analysis->F2;
+	const uint64_t f3 = ip_analysis->F3;
+	const uint64_t power = f1 * f1 + f2 * f2 + f3 * f3;
+
+	if (ip_analysis->accum_count == 0 || power == 0) {
+		return SIGNAL_POWER_INVALID;
+	}
+	return power_level_cdbm(log2_q16(power), ip_analysis->accum_count, dgc_decision, rx_code);
+}
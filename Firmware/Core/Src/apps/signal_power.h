@@ -0,0 +1,39 @@
+/*
+ * signal_power.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_SIGNAL_POWER_H_
+#define SRC_APPS_SIGNAL_POWER_H_
+
+#include <stdint.h>
+
+#include "measurement_blobs.h"
+
+/* Receive and first path power level of a frame (DW3000 user manual section 4.7)
+ *
+ *   rx power = 10 * log10(C * 2^21 / N^2) + 6 * D - A
+ *   fp power = 10 * log10((F1^2 + F2^2 + F3^2) / N^2) + 6 * D - A
+ *
+ * C, F1-F3 and N (power, F1-F3 and accum_count) are taken from the CIR analysis of the Ipatov
+ * preamble, D is the DGC decision (dgc_decision of the toa blob) and A depends on the PRF of the RX
+ * preamble code. Only integer arithmetic: log2 from the position of the highest bit and an
+ * interpolated table of the mantissa, results in 0.01 dBm (error < 0.01 dB). F1-F3 are 22-bit
+ * register fields, the sum of their squares fits into 64 bits.
+ *
+ * SIGNAL_POWER_INVALID is returned without accumulated symbols (N = 0) or with zero power.
+ * Scripts/signal_power.py computes the same integers (and the floating point values for whole logs).
+ */
+
+#define SIGNAL_POWER_INVALID		(INT16_MIN)
+#define SIGNAL_POWER_A_PRF64_CDB	(12170)		/* A for PRF 64 MHz (preamble codes 9-24) */
+#define SIGNAL_POWER_A_PRF16_CDB	(11380)		/* A for PRF 16 MHz (preamble codes 1-8) */
+
+/* Receive power level in 0.01 dBm */
+int16_t signal_power_rx_cdbm(const meas_cir_analysis_t *ip_analysis, uint8_t dgc_decision, uint8_t rx_code);
+
+/* First path power level in 0.01 dBm */
+int16_t signal_power_fp_cdbm(const meas_cir_analysis_t *ip_analysis, uint8_t dgc_decision, uint8_t rx_code);
+
+#endif /* SRC_APPS_SIGNAL_POWER_H_ */
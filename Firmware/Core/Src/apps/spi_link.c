@@ -0,0 +1,180 @@
+/*
+ * spi_link.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "deca_spi.h"
+#include "port.h"
+#include "uart_stdio.h"
+
+#include "spi_link.h"
+
+#define SCRATCH_RAM_LEN		(127)	/* Scratch RAM of the DW3000 (SCRATCH_RAM_ID), not used by the driver */
+
+/* Read transaction header in extended address mode (DW3000 user manual, SPI transaction formats):
+ * 5-bit register file and 7-bit offset */
+#define SPI_HEADER_EAM		(0x40)
+#define SPI_REG_FILE(reg)	(((reg) >> 16) & 0x1F)
+#define SPI_REG_OFFSET(reg)	((reg) & 0x7F)
+
+/* Rates tested by spi_link_tune(), fastest first */
+static const uint32_t test_dividers[] = {2, 4, 8, 16};
+
+#define TEST_DIVIDER_COUNT (sizeof(test_dividers) / sizeof(test_dividers[0]))
+
+/* Byte patterns written to the scratch RAM (the last one is a sequence varied per round) */
+static const uint8_t test_patterns[] = {0x00, 0xFF, 0xAA, 0x55, 0x00};
+
+#define TEST_PATTERN_COUNT (sizeof(test_patterns) / sizeof(test_patterns[0]))
+
+static volatile uint8_t read_error = 0;
+
+static uint8_t scratch_write[SCRATCH_RAM_LEN];
+static uint8_t scratch_read[SCRATCH_RAM_LEN];
+
+#ifdef SPI_LINK_CRC
+/* Called by the driver when the CRC of a read does not match */
+static void read_error_cb(void)
+{
+	read_error = 1;
+}
+#endif
+
+void spi_link_enable_crc(void)
+{
+#ifdef SPI_LINK_CRC
+	dwt_enablespicrccheck(DWT_SPI_CRC_MODE_WRRD, read_error_cb);
+#endif
+}
+
+void spi_link_clear_error(void)
+{
+	read_error = 0;
+}
+
+uint8_t spi_link_read_error(void)
+{
+	return read_error;
+}
+
+uint8_t spi_link_write_error(void)
+{
+#ifdef SPI_LINK_CRC
+	if (dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_SPICRCE_BIT_MASK)
+	{
+		dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_SPICRCE_BIT_MASK);
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+void spi_link_gather(const spi_link_read_t *reads, uint16_t count)
+{
+	if (count > SPI_LINK_GATHER_MAX)
+	{
+		count = SPI_LINK_GATHER_MAX;
+	}
+
+#ifdef SPI_LINK_CRC
+	/* The driver checks the CRC of its own reads only */
+	for (uint16_t i = 0; i < count; i++)
+	{
+		SPI_LINK_RETRY(dwt_readfromdevice(reads[i].reg, 0, reads[i].length, reads[i].buffer));
+	}
+#else
+	spi_read_t chain[SPI_LINK_GATHER_MAX];
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		const uint32_t file = SPI_REG_FILE(reads[i].reg);
+		const uint32_t offset = SPI_REG_OFFSET(reads[i].reg);
+
+		chain[i].headerLength = 2;
+		chain[i].headerBuffer[0] = (uint8_t)(SPI_HEADER_EAM | (file << 1) | (offset >> 6));
+		chain[i].headerBuffer[1] = (uint8_t)(offset << 2);
+		chain[i].readlength = reads[i].length;
+		chain[i].readBuffer = reads[i].buffer;
+	}
+
+	readfromspichain(chain, count);
+#endif
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn test_rate()
+ *
+ * @brief Access the device at the current SPI rate and count the errors
+ *
+ * Every round checks the device ID and writes and reads back the patterns on the full scratch RAM. Only
+ * the scratch RAM is written, the configuration of the device is not touched.
+ *
+ * @return  number of failed accesses
+ */
+static uint32_t test_rate(void)
+{
+	uint32_t errors = 0;
+
+	for (uint32_t round = 0; round < SPI_LINK_TEST_ROUNDS; round++)
+	{
+		if (dwt_check_dev_id() != DWT_SUCCESS)
+		{
+			errors++;
+		}
+
+		for (uint32_t i = 0; i < TEST_PATTERN_COUNT; i++)
+		{
+			for (uint32_t j = 0; j < SCRATCH_RAM_LEN; j++)
+			{
+				scratch_write[j] = (i == TEST_PATTERN_COUNT - 1) ? (uint8_t)(j * 37 + round) : test_patterns[i];
+			}
+			dwt_writetodevice(SCRATCH_RAM_ID, 0, SCRATCH_RAM_LEN, scratch_write);
+			dwt_readfromdevice(SCRATCH_RAM_ID, 0, SCRATCH_RAM_LEN, scratch_read);
+			if (memcmp(scratch_read, scratch_write, SCRATCH_RAM_LEN) != 0)
+			{
+				errors++;
+			}
+		}
+	}
+
+	return errors;
+}
+
+void spi_link_tune(void)
+{
+	char print_buffer[48];
+	uint32_t selected = SPI_LINK_SLOW_DIVIDER;
+
+	for (uint32_t i = 0; i < TEST_DIVIDER_COUNT; i++)
+	{
+		port_set_dw_ic_spi_prescaler(test_dividers[i]);
+		const uint32_t errors = test_rate();
+
+		snprintf(print_buffer, sizeof(print_buffer), "SPI %lu kHz: %lu errors\n",
+				(unsigned long)(port_get_dw_ic_spi_clock(test_dividers[i]) / 1000), (unsigned long)errors);
+		stdio_write(print_buffer);
+
+		if (errors == 0)
+		{
+			selected = test_dividers[i];
+			break;
+		}
+	}
+
+	port_set_dw_ic_spi_prescaler(selected);
+	snprintf(print_buffer, sizeof(print_buffer), "SPI rate: %lu kHz%s\n",
+			(unsigned long)(port_get_dw_ic_spi_clock(selected) / 1000),
+#ifdef SPI_LINK_CRC
+			", CRC"
+#else
+			""
+#endif
+			);
+	stdio_write(print_buffer);
+}
@@ -0,0 +1,80 @@
+/*
+ * spi_link.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_SPI_LINK_H_
+#define SRC_APPS_SPI_LINK_H_
+
+#include <stdint.h>
+
+/* SPI link self-test and CRC protection of the DW3000 register accesses
+ *
+ * The DW3000 supports SPI clocks up to 38 MHz, whether the fastest rate of the STM32 (APB2 / 2 =
+ * 18 MHz, APB2 is HCLK / 4 = 36 MHz) works depends on the board and the cable to the shield.
+ * spi_link_tune() runs once after the first device reset, before dwt_initialise() writes the
+ * configuration: it sweeps the prescalers from the fastest to the slowest, checks the device ID and
+ * write/read patterns on the scratch RAM (a full 127 byte burst) and keeps the fastest rate without
+ * errors. The result of every rate is printed ("SPI <kHz> kHz: <errors> errors").
+ *
+ * With SPI_LINK_CRC defined the DW3000 checks a CRC-8 on every write (errors set SYS_STATUS SPICRCE)
+ * and the driver checks the CRC of every read (errors call the error callback of spi_link.c). Reads
+ * wrapped in SPI_LINK_RETRY() are repeated after a CRC error, a write error fails the device
+ * initialization (which is retried by the framework). The CRC costs an additional register read per
+ * read access.
+ *
+ * spi_link_gather() reads several registers in one chained access (deca_spi.c readfromspichain()):
+ * the interrupts are masked once and each register costs only a chip select cycle instead of a driver
+ * call. Registers close to each other in the same register file are cheaper to read as one range.
+ */
+
+//#define SPI_LINK_CRC  /* Define to enable the SPI CRC mode of the DW3000 */
+
+#define SPI_LINK_RETRIES		(3)		/* Attempts of a read (or device initialization) with CRC errors */
+#define SPI_LINK_SLOW_DIVIDER	(32)	/* Rate if all tested rates fail (same as the CubeMX initialization) */
+#define SPI_LINK_TEST_ROUNDS	(32)	/* Rounds of device ID and scratch RAM accesses per rate */
+#define SPI_LINK_GATHER_MAX		(4)		/* Reads per spi_link_gather() */
+
+/* One register read of spi_link_gather() */
+typedef struct
+{
+	uint32_t	reg;		// Register file ID plus byte offset (e.g. STS_TOA_HI_ID + 3)
+	uint16_t	length;		// Bytes to read
+	uint8_t		*buffer;
+} spi_link_read_t;
+
+/* Enable the CRC mode if configured, call after each dwt_initialise() (a reset disables it) */
+void spi_link_enable_crc(void);
+
+/* Sweep the SPI rates and select the fastest one without errors, call after the reset (IDLE_RC) and
+ * before dwt_initialise(), the test only accesses the device ID and the scratch RAM */
+void spi_link_tune(void);
+
+/* Clear the read error flag before a read */
+void spi_link_clear_error(void);
+
+/* A read since the last spi_link_clear_error() had a CRC error */
+uint8_t spi_link_read_error(void);
+
+/* A write since the last call had a CRC error (SYS_STATUS SPICRCE, cleared by this call) */
+uint8_t spi_link_write_error(void);
+
+/* Read up to SPI_LINK_GATHER_MAX registers in one chained access (with SPI_LINK_CRC: one driver read
+ * each, with CRC check and retry) */
+void spi_link_gather(const spi_link_read_t *reads, uint16_t count);
+
+#ifdef SPI_LINK_CRC
+#define SPI_LINK_RETRY(read) \
+	do { \
+		uint8_t spi_link_attempt = 0; \
+		do { \
+			spi_link_clear_error(); \
+			read; \
+		} while (spi_link_read_error() && (++spi_link_attempt < SPI_LINK_RETRIES)); \
+	} while (0)
+#else
+#define SPI_LINK_RETRY(read)	read
+#endif
+
+#endif /* SRC_APPS_SPI_LINK_H_ */
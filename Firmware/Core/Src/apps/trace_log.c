@@ -0,0 +1,110 @@
+/*
+ * trace_log.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+
+#include "main.h"
+#include "uart_stdio.h"
+#include "timebase.h"
+#include "profile.h"
+
+#include "trace_log.h"
+
+#ifdef TRACE_TEXT_OUTPUT
+
+#define TRACE_FORMAT_ENTRY(id, format) format,
+static const char *const trace_formats[TRACE_FORMAT_COUNT] = {
+	TRACE_FORMATS(TRACE_FORMAT_ENTRY)
+};
+#undef TRACE_FORMAT_ENTRY
+
+static char trace_print_buffer[64];
+
+void trace_log(trace_id_t id, uint8_t nargs, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+	UNUSED(nargs);
+	PROFILE_BEGIN(PROFILE_FORMAT);
+	snprintf(trace_print_buffer, sizeof(trace_print_buffer), trace_formats[id], arg0, arg1, arg2);
+	PROFILE_END(PROFILE_FORMAT);
+	stdio_write(trace_print_buffer);
+}
+
+void trace_flush(void)
+{
+}
+
+int trace_full(void)
+{
+	return 0;
+}
+
+#else
+
+static trace_record_t trace_ring[TRACE_RING_SIZE];
+static uint16_t trace_head = 0;		/* Index of the next record to write */
+static uint16_t trace_count = 0;	/* Number of stored records */
+static uint32_t trace_dropped = 0;	/* Number of overwritten records since the last flush */
+
+static char trace_header_buffer[32];
+
+void trace_log(trace_id_t id, uint8_t nargs, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+	static_assert(sizeof(trace_record_t) == 16);
+	static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0);
+	static_assert(TRACE_FORMAT_COUNT <= 256);
+
+	trace_record_t *record = &trace_ring[trace_head];
+	record->id = id;
+	record->nargs = nargs;
+	record->tick = (uint16_t)HAL_GetTick();
+	record->args[0] = arg0;
+	record->args[1] = arg1;
+	record->args[2] = arg2;
+
+	trace_head = (trace_head + 1) & (TRACE_RING_SIZE - 1);
+	if (trace_count < TRACE_RING_SIZE) {
+		trace_count++;
+	} else {
+		trace_dropped++;
+	}
+}
+
+void trace_flush(void)
+{
+	if (trace_count == 0) {
+		return;
+	}
+
+	const uint16_t total = trace_count + (trace_dropped ? 1 : 0);
+	snprintf(trace_header_buffer, sizeof(trace_header_buffer), "BLOB / trace / v1 / %u\n",
+			total*sizeof(trace_record_t));
+	stdio_write(trace_header_buffer);
+
+	if (trace_dropped) {
+		trace_record_t dropped_record = { TRACE_DROPPED, 1, (uint16_t)HAL_GetTick(), { trace_dropped, 0, 0 } };
+		stdio_write_binary((uint8_t*)&dropped_record, sizeof(trace_record_t));
+		trace_dropped = 0;
+	}
+
+	/* The stored records may wrap around the end of the ring buffer */
+	const uint16_t tail = (trace_head - trace_count) & (TRACE_RING_SIZE - 1);
+	if (tail + trace_count > TRACE_RING_SIZE) {
+		stdio_write_binary((uint8_t*)&trace_ring[tail], (TRACE_RING_SIZE - tail)*sizeof(trace_record_t));
+		stdio_write_binary((uint8_t*)&trace_ring[0], trace_head*sizeof(trace_record_t));
+	} else {
+		stdio_write_binary((uint8_t*)&trace_ring[tail], trace_count*sizeof(trace_record_t));
+	}
+	stdio_write("\n");
+
+	trace_count = 0;
+}
+
+int trace_full(void)
+{
+	return trace_count == TRACE_RING_SIZE;
+}
+
+#endif
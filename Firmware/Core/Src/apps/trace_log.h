@@ -0,0 +1,110 @@
+/*
+ * trace_log.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_APPS_TRACE_LOG_H_
+#define SRC_APPS_TRACE_LOG_H_
+
+#include <stdint.h>
+
+/* Deferred debug output
+ *
+ * Log sites only store a format ID, the tick count and up to three raw arguments into a RAM ring buffer
+ * without any formatting. trace_flush() transmits the records as binary blob ("BLOB / trace / v1 / <len>")
+ * once the timing critical part of an exchange is over and Scripts/trace_decoder.py reconstructs the text
+ * from the format table below. If the ring is full the oldest records are dropped (and reported on the
+ * next flush). Only use from the main loop, not from interrupt callbacks.
+ *
+ * The host scripts read the format table directly from this file: keep one entry per line and only
+ * append new entries at the end, otherwise logs recorded with an older firmware decode incorrectly.
+ * Regenerate the copy shipped with the scripts afterwards (Scripts/trace_decoder.py --generate).
+ * Arguments are stored as uint32_t, use %lu, %ld and %lX in the formats. Formats without a trailing
+ * newline are continued by the next record (e.g. to output several CIR samples on one line).
+ */
+
+//#define TRACE_TEXT_OUTPUT  /* Define to format and print immediately instead (slow, no host decoder needed) */
+
+#define TRACE_RING_SIZE (64)  /* Number of records in the ring buffer, must be a power of two */
+
+#define TRACE_FORMATS(X) \
+	X(TRACE_DROPPED,					"Trace: %lu records dropped\n") \
+	X(TRACE_TIMEOUT,					"Timeout -> reset\n") \
+	X(TRACE_RANGING_ERROR,				"Ranging error -> reset\n") \
+	X(TRACE_TX_SYNC,					"TX: Sync frame\n") \
+	X(TRACE_TX_RESPONSE,				"TX: Response frame\n") \
+	X(TRACE_RX_POLL,					"RX: Poll frame\n") \
+	X(TRACE_RX_FINAL,					"RX: Final frame\n") \
+	X(TRACE_TX_ERR_SYNC,				"TX ERR: could not send sync frame\n") \
+	X(TRACE_TX_ERR_POLL,				"TX ERR: could not send poll frame\n") \
+	X(TRACE_TX_ERR_DELAYED,				"TX ERR: delayed send time missed\n") \
+	X(TRACE_RX_ERR_LENGTH,				"RX ERR: wrong frame length\n") \
+	X(TRACE_RX_ERR_STS,					"RX ERR: bad STS quality\n") \
+	X(TRACE_RX_ERR_EXPECTED_POLL,		"RX ERR: wrong frame (expected poll)\n") \
+	X(TRACE_RX_ERR_EXPECTED_FINAL,		"RX ERR: wrong frame (expected final)\n") \
+	X(TRACE_RX_ERR_SEQUENCE,			"RX ERR: wrong sequence number\n") \
+	X(TRACE_TWR_RESULT,					"twr_count: %lu, dist_mm: %lu\n") \
+	X(TRACE_ROTATION,					"rotation: %lu, 360_count: %lu\n") \
+	X(TRACE_MULTI_RESULT,				"slot: %lu, dist_mm: %lu\n") \
+	X(TRACE_MULTI_RESPONSES,			"twr_count: %lu, responses: %lu/%lu\n") \
+	X(TRACE_FRAME_RECEIVED,				"Frame Received (v5)\n") \
+	X(TRACE_FRAME_COUNT,				"count: %lu\n") \
+	X(TRACE_IP_TOA,						"ip_toa: 0x%02lX%08lX\n") \
+	X(TRACE_IP_TOAST,					"ip_toast: 0x%lX\n") \
+	X(TRACE_IP_POA,						"ip_poa: %lu\n") \
+	X(TRACE_IP_FP,						"ip_fp: %lu\n") \
+	X(TRACE_STS1_TOA,					"sts1_toa: 0x%02lX%08lX\n") \
+	X(TRACE_STS1_TOAST,					"sts1_toast: 0x%lX\n") \
+	X(TRACE_STS1_POA,					"sts1_poa: %lu\n") \
+	X(TRACE_STS1_FP,					"sts1_fp: %lu\n") \
+	X(TRACE_STS2_TOA,					"sts2_toa: 0x%02lX%08lX\n") \
+	X(TRACE_STS2_TOAST,					"sts2_toast: 0x%lX\n") \
+	X(TRACE_STS2_POA,					"sts2_poa: %lu\n") \
+	X(TRACE_STS2_FP,					"sts2_fp: %lu\n") \
+	X(TRACE_XTAL_OFFSET,				"xtaloffset: %ld\n") \
+	X(TRACE_TDOA,						"tdoa: 0x%02lX%02lX%08lX\n") \
+	X(TRACE_PDOA,						"pdoa: %ld\n") \
+	X(TRACE_FPTH,						"fpth: %lu\n") \
+	X(TRACE_STS_QUAL_GOOD,				"sts qual: good (%ld)\n") \
+	X(TRACE_STS_QUAL_BAD,				"sts qual: bad (%ld)\n") \
+	X(TRACE_CIR_IP_START,				"CIR IP: ") \
+	X(TRACE_CIR_IP_END,					"END CIR IP\n") \
+	X(TRACE_CIR_STS1_START,				"CIR STS1: ") \
+	X(TRACE_CIR_STS1_END,				"END CIR STS1\n") \
+	X(TRACE_CIR_STS2_START,				"CIR STS2: ") \
+	X(TRACE_CIR_STS2_END,				"END CIR STS2\n") \
+	X(TRACE_CIR_SAMPLE,					"%lu r %ld i %ld | ") \
+	X(TRACE_MOTOR_STOPPED,				"motor: stopped at step %ld\n")
+
+#define TRACE_ENUM_ENTRY(id, format) id,
+typedef enum {
+	TRACE_FORMATS(TRACE_ENUM_ENTRY)
+	TRACE_FORMAT_COUNT
+} trace_id_t;
+#undef TRACE_ENUM_ENTRY
+
+/* Version 1 */
+typedef struct
+{
+	uint8_t		id;				// Format ID (trace_id_t)
+	uint8_t		nargs;			// Number of valid arguments
+	uint16_t	tick;			// Lower 16 bits of HAL_GetTick() (ms)
+	uint32_t	args[3];		// Raw arguments (signed values are stored as two's complement)
+} trace_record_t;  // 16 bytes, no padding required
+
+/* Store a trace record (use the TRACE macros below) */
+void trace_log(trace_id_t id, uint8_t nargs, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+/* Transmit all stored records as one binary blob and clear the ring buffer */
+void trace_flush(void);
+
+/* Returns 1 if the next record would overwrite the oldest one */
+int trace_full(void);
+
+#define TRACE(id)					trace_log((id), 0, 0, 0, 0)
+#define TRACE1(id, a)				trace_log((id), 1, (uint32_t)(a), 0, 0)
+#define TRACE2(id, a, b)			trace_log((id), 2, (uint32_t)(a), (uint32_t)(b), 0)
+#define TRACE3(id, a, b, c)			trace_log((id), 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c))
+
+#endif /* SRC_APPS_TRACE_LOG_H_ */
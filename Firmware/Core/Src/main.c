@@ -23,6 +23,9 @@
 /* USER CODE BEGIN Includes */
 #include "port.h"
 #include "uart_stdio.h"
+#include "motor.h"
+#include "power.h"
+#include "timebase.h"
 #include "apps/applications.h"
 /* USER CODE END Includes */
 
@@ -43,6 +46,8 @@
 /* Private variables ---------------------------------------------------------*/
  SPI_HandleTypeDef hspi5;
 
+TIM_HandleTypeDef htim6;
+
 UART_HandleTypeDef huart3;
 
 /* USER CODE BEGIN PV */
@@ -54,6 +59,7 @@ void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_USART3_UART_Init(void);
 static void MX_SPI5_Init(void);
+static void MX_TIM6_Init(void);
 /* USER CODE BEGIN PFP */
 
 /* USER CODE END PFP */
@@ -92,10 +98,13 @@ int main(void)
   MX_GPIO_Init();
   MX_USART3_UART_Init();
   MX_SPI5_Init();
+  MX_TIM6_Init();
   /* USER CODE BEGIN 2 */
 
   /* ----- Setup DW3000, USART and start main application ----- */
 
+  timebase_init();
+
   /* DW3000 will be configured and enabled later, if necessary, but CubeMX has
    * no option to generate code without enabling the interrupt. */
   HAL_NVIC_DisableIRQ(EXTI15_10_IRQn);
@@ -108,6 +117,10 @@ int main(void)
 
   stdio_init(&huart3);
 
+  motor_init();
+
+  power_init();
+
   dw_main();
 
   /* USER CODE END 2 */
@@ -206,6 +219,45 @@ static void MX_SPI5_Init(void)
 
 }
 
+/**
+  * @brief TIM6 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_TIM6_Init(void)
+{
+
+  /* USER CODE BEGIN TIM6_Init 0 */
+
+  /* USER CODE END TIM6_Init 0 */
+
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  /* USER CODE BEGIN TIM6_Init 1 */
+  /* Step timer of the motor driver (motor.c): 72 MHz / 720 = 100 kHz counter clock, the period is set
+   * for every step */
+  /* USER CODE END TIM6_Init 1 */
+  htim6.Instance = TIM6;
+  htim6.Init.Prescaler = 719;
+  htim6.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim6.Init.Period = 65535;
+  htim6.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim6) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim6, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN TIM6_Init 2 */
+
+  /* USER CODE END TIM6_Init 2 */
+
+}
+
 /**
   * @brief USART3 Initialization Function
   * @param None
@@ -197,6 +197,38 @@ int readfromspi(uint16_t  headerLength,
     return 0;
 } // end readfromspi()
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: readfromspichain()
+ *
+ * Low level abstract function to execute several reads back to back
+ * Each read has its own chip select cycle, the mutex is taken once for all of them
+ * returns 0 for success, or -1 for error
+ */
+int readfromspichain(const spi_read_t *reads, uint16_t count)
+{
+    uint16_t i;
+
+    decaIrqStatus_t  stat ;
+    stat = decamutexon() ;
+
+    /* Blocking: Check whether previous transfer has been finished */
+    while (HAL_SPI_GetState(&hspi5) != HAL_SPI_STATE_READY);
+
+    for(i=0; i<count; i++)
+    {
+        HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_RESET); /**< Put chip select line low */
+
+        HAL_SPI_Transmit(&hspi5, (uint8_t *)reads[i].headerBuffer, reads[i].headerLength, HAL_MAX_DELAY);
+        HAL_SPI_Receive(&hspi5, reads[i].readBuffer, reads[i].readlength, HAL_MAX_DELAY);
+
+        HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_SET); /**< Put chip select line high */
+    }
+
+    decamutexoff(stat);
+
+    return 0;
+} // end readfromspichain()
+
 /****************************************************************************//**
  *
  *                              END OF DW1000 SPI section
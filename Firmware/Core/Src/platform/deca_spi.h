@@ -37,6 +37,28 @@ int openspi(void) ;
  */
 int closespi(void) ;
 
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Structure: spi_read_t
+ *
+ * One read of readfromspichain(): header and read buffer of a single chip select cycle
+ */
+typedef struct
+{
+    uint16_t  headerLength;
+    uint8_t   headerBuffer[DECA_MAX_SPI_HEADER_LENGTH];
+    uint16_t  readlength;
+    uint8_t   *readBuffer;
+} spi_read_t;
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * Function: readfromspichain()
+ *
+ * Low level abstract function to execute several reads back to back (one chip select cycle each) with
+ * the interrupts masked only once
+ * returns 0 for success, or -1 for error
+ */
+int readfromspichain(const spi_read_t *reads, uint16_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,162 @@
+/*
+ * motor.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "main.h"
+#include "motor.h"
+#include "stepper.h"
+
+extern TIM_HandleTypeDef htim6;
+
+static stepper_t stepper;
+
+/* Every step takes two timer periods: the update interrupt sets the step pin and plans the following
+ * step, the next one clears the pin, sets the direction and waits for the rest of the step interval. */
+static volatile uint8_t pulse_high = 0;
+static volatile int8_t next_direction = 0;
+static volatile uint32_t next_interval = 0;
+
+static void set_direction(int8_t direction)
+{
+	HAL_GPIO_WritePin(MOTOR_DIR_GPIO_Port, MOTOR_DIR_Pin, (direction > 0) ? GPIO_PIN_RESET : GPIO_PIN_SET);
+}
+
+/* Next update interrupt after the given number of ticks (the auto-reload register is not buffered) */
+static void schedule(uint32_t ticks)
+{
+	if (ticks < 1) {
+		ticks = 1;
+	} else if (ticks > 0x10000) {
+		ticks = 0x10000;
+	}
+	__HAL_TIM_SET_COUNTER(&htim6, 0);
+	__HAL_TIM_SET_AUTORELOAD(&htim6, ticks - 1);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+	if (htim->Instance != TIM6) {
+		return;
+	}
+
+	if (!pulse_high) {
+		HAL_GPIO_WritePin(MOTOR_STEP_GPIO_Port, MOTOR_STEP_Pin, GPIO_PIN_SET);
+		pulse_high = 1;
+
+		int8_t direction;
+		next_interval = stepper_next(&stepper, &direction);
+		next_direction = direction;
+		schedule(MOTOR_PULSE_TICKS);
+	} else {
+		HAL_GPIO_WritePin(MOTOR_STEP_GPIO_Port, MOTOR_STEP_Pin, GPIO_PIN_RESET);
+		pulse_high = 0;
+
+		if (next_direction == 0) {
+			/* Target reached */
+			HAL_TIM_Base_Stop_IT(&htim6);
+			return;
+		}
+		set_direction(next_direction);
+		schedule(next_interval - MOTOR_PULSE_TICKS);
+	}
+}
+
+void motor_init(void)
+{
+	stepper_init(&stepper, MOTOR_TICK_HZ, MOTOR_MAX_RATE, MOTOR_ACCELERATION);
+	HAL_GPIO_WritePin(MOTOR_STEP_GPIO_Port, MOTOR_STEP_Pin, GPIO_PIN_RESET);
+}
+
+/* Output the first step of a move from rest (with the timer interrupt disabled) */
+static void start(int8_t direction)
+{
+	if (direction == 0) {
+		return;
+	}
+
+	if (pulse_high) {
+		/* The motor stopped with this pulse, the falling edge starts the new move */
+		next_direction = direction;
+		next_interval = MOTOR_PULSE_TICKS + MOTOR_SETUP_TICKS;
+	} else {
+		/* At rest until the first step, nothing to interpolate */
+		next_direction = 0;
+		set_direction(direction);
+		schedule(MOTOR_SETUP_TICKS);
+		__HAL_TIM_CLEAR_FLAG(&htim6, TIM_FLAG_UPDATE);
+		HAL_TIM_Base_Start_IT(&htim6);
+	}
+}
+
+void motor_move_to(int32_t position)
+{
+	HAL_NVIC_DisableIRQ(TIM6_DAC_IRQn);
+	start(stepper_start(&stepper, position));
+	HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
+}
+
+void motor_run(int8_t direction)
+{
+	HAL_NVIC_DisableIRQ(TIM6_DAC_IRQn);
+	start(stepper_run(&stepper, direction));
+	HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
+}
+
+void motor_set_rate(uint32_t rate)
+{
+	HAL_NVIC_DisableIRQ(TIM6_DAC_IRQn);
+	stepper_set_rate(&stepper, rate);
+	HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
+}
+
+void motor_move_by(int32_t steps)
+{
+	motor_move_to(stepper.target + steps);
+}
+
+int32_t motor_position(void)
+{
+	return stepper.position;
+}
+
+int32_t motor_position_substeps(void)
+{
+	/* A pending update interrupt has to be handled first, otherwise the counter belongs to the next
+	 * period already */
+	while (1) {
+		HAL_NVIC_DisableIRQ(TIM6_DAC_IRQn);
+		if (!__HAL_TIM_GET_FLAG(&htim6, TIM_FLAG_UPDATE)) {
+			break;
+		}
+		HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
+	}
+
+	const int32_t position = stepper.position;
+	int32_t fraction = 0;
+	if (next_direction != 0 && next_interval > 0) {
+		/* ticks since the rising edge of the last step */
+		const uint32_t elapsed = __HAL_TIM_GET_COUNTER(&htim6) + (pulse_high ? 0 : MOTOR_PULSE_TICKS);
+		fraction = (elapsed >= next_interval) ? (MOTOR_SUBSTEPS - 1) : (elapsed * MOTOR_SUBSTEPS / next_interval);
+		fraction *= next_direction;
+	}
+
+	HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
+
+	return position * MOTOR_SUBSTEPS + fraction;
+}
+
+int32_t motor_target(void)
+{
+	return stepper.target;
+}
+
+int motor_done(void)
+{
+	if (stepper.done) {
+		stepper.done = 0;
+		return 1;
+	}
+	return 0;
+}
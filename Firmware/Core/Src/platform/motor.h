@@ -0,0 +1,58 @@
+/*
+ * motor.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_PLATFORM_MOTOR_H_
+#define SRC_PLATFORM_MOTOR_H_
+
+#include <stdint.h>
+
+/* Turntable stepper motor driver
+ *
+ * The step pulses are generated from the TIM6 update interrupt, so the motor moves in the background
+ * while the applications keep ranging. A move is queued with motor_move_to() or motor_move_by() and
+ * follows a trapezoid speed profile (stepper.c), a new target may be set while the motor is moving.
+ * motor_run() turns the motor continuously at the rate set with motor_set_rate(). motor_position()
+ * is the number of steps output so far and can be stamped into measurements at any time,
+ * motor_position_substeps() interpolates between the steps for a smoothly moving turntable. On the host build the step timer runs on the virtual clock of the simulation (Host/host_motor.c).
+ */
+
+#define MOTOR_STEPS_PER_DEGREE	(1)			/* Steps (or microsteps) of the driver per degree of the turntable */
+#define MOTOR_MAX_RATE			(50)		/* Maximum step rate in steps/s */
+#define MOTOR_ACCELERATION		(400)		/* Acceleration in steps/s^2 */
+#define MOTOR_TICK_HZ			(100000)	/* Counter clock of TIM6 (see MX_TIM6_Init) */
+#define MOTOR_PULSE_TICKS		(10)		/* Length of the step pulse (100us) */
+#define MOTOR_SETUP_TICKS		(10)		/* Delay between a change of the direction pin and the step pulse */
+#define MOTOR_SUBSTEPS			(256)		/* Resolution of motor_position_substeps() */
+
+/* Set up the speed profile, the motor position starts at 0 */
+void motor_init(void);
+
+/* Move to an absolute position in steps (returns immediately) */
+void motor_move_to(int32_t position);
+
+/* Move relative to the current target (returns immediately) */
+void motor_move_by(int32_t steps);
+
+/* Rotate continuously in the given direction (1 or -1) until a target is set again (returns immediately) */
+void motor_run(int8_t direction);
+
+/* Change the maximum step rate in steps/s (MOTOR_MAX_RATE after motor_init) */
+void motor_set_rate(uint32_t rate);
+
+/* Steps output so far (exact position of the turntable) */
+int32_t motor_position(void);
+
+/* Position in 1/MOTOR_SUBSTEPS steps, interpolated from the time since the last step and the planned
+ * step interval (not to be called from an interrupt handler of higher priority than TIM6) */
+int32_t motor_position_substeps(void);
+
+/* Position the motor is moving to */
+int32_t motor_target(void);
+
+/* Completion event: returns 1 once after the motor stopped at the target, 0 otherwise */
+int motor_done(void);
+
+#endif /* SRC_PLATFORM_MOTOR_H_ */
@@ -14,6 +14,8 @@
 #include <port.h>
 //#include <stm32f1xx_hal_conf.h>
 #include "main.h"
+#include "timebase.h"
+#include "profile.h"
 
 /****************************************************************************//**
  *
@@ -51,18 +53,11 @@ portGetTickCnt(void)
 
 
 /* @fn    usleep
- * @brief precise usleep() delay
+ * @brief precise usleep() delay on the DWT cycle counter (see timebase.h)
  * */
-#pragma GCC optimize ("O0")
 int usleep(useconds_t usec)
 {
-    unsigned int i;
-
-    usec*=12;
-    for(i=0;i<usec;i++)
-    {
-        __NOP();
-    }
+    timebase_delay_us(usec);
     return 0;
 }
 
@@ -73,7 +68,9 @@ int usleep(useconds_t usec)
 __INLINE void
 Sleep(uint32_t x)
 {
+    PROFILE_BEGIN(PROFILE_SLEEP);
     HAL_Delay(x);
+    PROFILE_END(PROFILE_SLEEP);
 }
 
 /****************************************************************************//**
@@ -199,6 +196,8 @@ void setup_DWICRSTnIRQ(int enable)
 * @fn wakeup_device_with_io()
 *
 * @brief This function wakes up the device by toggling io with a delay.
+*        The wakeup io is the SPI chip select (active low), it has to be held low for at least 500us
+*        and released afterwards.
 *
 * input None
 *
@@ -207,9 +206,9 @@ void setup_DWICRSTnIRQ(int enable)
 */
 void wakeup_device_with_io(void)
 {
-    SET_WAKEUP_PIN_IO_HIGH;
-    WAIT_500uSEC;
     SET_WAKEUP_PIN_IO_LOW;
+    WAIT_500uSEC;
+    SET_WAKEUP_PIN_IO_HIGH;
 }
 
 /*! ------------------------------------------------------------------------------------------------------------------
@@ -226,10 +225,10 @@ void make_very_short_wakeup_io(void)
 {
     uint8_t   cnt;
 
-    SET_WAKEUP_PIN_IO_HIGH;
+    SET_WAKEUP_PIN_IO_LOW;
     for (cnt=0;cnt<10;cnt++)
         __NOP();
-    SET_WAKEUP_PIN_IO_LOW;
+    SET_WAKEUP_PIN_IO_HIGH;
 }
 
 
@@ -340,20 +339,46 @@ void led_on (led_t led)
  * */
 void port_set_dw_ic_spi_slowrate(void)
 {
-	hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16;
-    HAL_SPI_Init(&hspi5);
+	port_set_dw_ic_spi_prescaler(16);
 }
 
 /* @fn      port_set_dw_ic_spi_fastrate
  * @brief   set 18MHz
- *          note: hspi5 is clocked from 72MHz
+ *          note: hspi5 is clocked from APB2 (HCLK / 4 = 36MHz)
  * */
 void port_set_dw_ic_spi_fastrate(void)
 {
-	hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+	port_set_dw_ic_spi_prescaler(2);
+}
+
+/* @fn      port_set_dw_ic_spi_prescaler
+ * @brief   set the SPI clock to the APB2 clock divided by divider
+ *          (2, 4, ... 256, other values select 256)
+ * */
+void port_set_dw_ic_spi_prescaler(uint32_t divider)
+{
+	switch (divider)
+	{
+	case 2:   hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;   break;
+	case 4:   hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_4;   break;
+	case 8:   hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_8;   break;
+	case 16:  hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16;  break;
+	case 32:  hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_32;  break;
+	case 64:  hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_64;  break;
+	case 128: hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_128; break;
+	default:  hspi5.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_256; break;
+	}
     HAL_SPI_Init(&hspi5);
 }
 
+/* @fn      port_get_dw_ic_spi_clock
+ * @brief   SPI clock in Hz for the given divider
+ * */
+uint32_t port_get_dw_ic_spi_clock(uint32_t divider)
+{
+	return HAL_RCC_GetPCLK2Freq() / divider;
+}
+
 /* @fn      port_LCD_RS_set
  * @brief   wrapper to set LCD_RS pin
  * */
@@ -451,6 +476,7 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
  * */
 __INLINE void process_deca_irq(void)
 {
+    PROFILE_BEGIN(PROFILE_DW_ISR);
     while(port_CheckEXT_IRQ() != 0)
     {
         if(port_dwic_isr)
@@ -466,6 +492,7 @@ __INLINE void process_deca_irq(void)
         	break;
         }
     } //while DW3000 IRQ line active
+    PROFILE_END(PROFILE_DW_ISR);
 }
 
 
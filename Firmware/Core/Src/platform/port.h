@@ -162,6 +162,8 @@ int port_is_boot1_low(void);
 
 void port_set_dw_ic_spi_slowrate(void);
 void port_set_dw_ic_spi_fastrate(void);
+void port_set_dw_ic_spi_prescaler(uint32_t divider);
+uint32_t port_get_dw_ic_spi_clock(uint32_t divider);
 
 void process_dwRSTn_irq(void);
 void process_deca_irq(void);
@@ -224,7 +226,7 @@ void make_very_short_wakeup_io(void);
 #define SET_WAKEUP_PIN_IO_LOW     HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_RESET)
 #define SET_WAKEUP_PIN_IO_HIGH    HAL_GPIO_WritePin(DW_NSS_GPIO_Port, DW_NSS_Pin, GPIO_PIN_SET)
 
-#define WAIT_500uSEC    Sleep(1)/*This is should be a delay of 500uSec at least. In our example it is more than that*/
+#define WAIT_500uSEC    usleep(500)/*This is should be a delay of 500uSec at least*/
 
 #if (EVB1000_LCD_SUPPORT == 1)
 /*! ------------------------------------------------------------------------------------------------------------------
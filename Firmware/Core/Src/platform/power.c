@@ -0,0 +1,136 @@
+/*
+ * power.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "main.h"
+
+#include "power.h"
+#include "timebase.h"
+
+void SystemClock_Config(void);
+
+/* EXTI line of the RTC wakeup event */
+#define RTC_WAKEUP_EXTI_LINE	EXTI_IMR_MR22
+
+static uint8_t rtc_ready = 0;
+static volatile uint8_t wakeup_timer_elapsed = 0;
+static uint32_t stop_remainder_us = 0;  /* STOP time not yet added to the HAL tick */
+
+void power_init(void)
+{
+	RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+	RCC_PeriphCLKInitTypeDef PeriphClkInitStruct = {0};
+
+	/* LSE crystal as RTC clock (backup domain) */
+	__HAL_RCC_PWR_CLK_ENABLE();
+	HAL_PWR_EnableBkUpAccess();
+
+	RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_LSE;
+	RCC_OscInitStruct.LSEState = RCC_LSE_ON;
+	RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+	if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
+		/* No LSE crystal fitted, power_stop_ms() waits in run mode */
+		return;
+	}
+
+	PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_RTC;
+	PeriphClkInitStruct.RTCClockSelection = RCC_RTCCLKSOURCE_LSE;
+	if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK) {
+		return;
+	}
+	__HAL_RCC_RTC_ENABLE();
+
+	/* Wakeup timer clocked with RTCCLK / 16, stopped until power_stop_ms() */
+	RTC->WPR = 0xCA;
+	RTC->WPR = 0x53;
+	RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+	while (!(RTC->ISR & RTC_ISR_WUTWF)) {
+	}
+	RTC->CR &= ~RTC_CR_WUCKSEL;
+	RTC->CR |= RTC_CR_WUTIE;
+	RTC->WPR = 0xFF;
+
+	/* The wakeup event reaches the NVIC through EXTI line 22 (rising edge) */
+	EXTI->IMR |= RTC_WAKEUP_EXTI_LINE;
+	EXTI->RTSR |= RTC_WAKEUP_EXTI_LINE;
+	HAL_NVIC_SetPriority(RTC_WKUP_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+	rtc_ready = 1;
+}
+
+uint32_t power_stop_ms(uint32_t ms)
+{
+	if (ms == 0) {
+		return 0;
+	}
+	if (!rtc_ready) {
+		HAL_Delay(ms);
+		return 0;
+	}
+	if (ms > POWER_STOP_MAX_MS) {
+		ms = POWER_STOP_MAX_MS;
+	}
+
+	uint32_t counter = (ms * POWER_WAKEUP_CLOCK_HZ + 500) / 1000;
+	if (counter == 0) {
+		counter = 1;
+	}
+
+	wakeup_timer_elapsed = 0;
+	RTC->WPR = 0xCA;
+	RTC->WPR = 0x53;
+	RTC->CR &= ~RTC_CR_WUTE;
+	while (!(RTC->ISR & RTC_ISR_WUTWF)) {
+	}
+	RTC->WUTR = counter - 1;
+	RTC->ISR = ~(RTC_ISR_WUTF | RTC_ISR_INIT) | (RTC->ISR & RTC_ISR_INIT);
+	EXTI->PR = RTC_WAKEUP_EXTI_LINE;
+	RTC->CR |= RTC_CR_WUTE;
+	RTC->WPR = 0xFF;
+
+	HAL_SuspendTick();
+	timebase_suspend();
+	while (!wakeup_timer_elapsed) {
+		HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+	}
+
+	/* The MCU runs from the HSI after STOP mode, start HSE and PLL again */
+	SystemClock_Config();
+
+	RTC->WPR = 0xCA;
+	RTC->WPR = 0x53;
+	RTC->CR &= ~RTC_CR_WUTE;
+	RTC->WPR = 0xFF;
+
+	/* SysTick did not count during STOP mode */
+	const uint32_t stop_us = (uint32_t)(((uint64_t)counter * 1000000) / POWER_WAKEUP_CLOCK_HZ);
+	stop_remainder_us += stop_us;
+	uwTick += stop_remainder_us / 1000;
+	stop_remainder_us %= 1000;
+	timebase_resume(stop_us);
+	HAL_ResumeTick();
+
+	return stop_us;
+}
+
+/*! ------------------------------------------------------------------------------------------------------------------
+ * @fn RTC_WKUP_IRQHandler()
+ *
+ * @brief RTC wakeup timer interrupt (EXTI line 22). The RTC is not part of the CubeMX configuration, the
+ *        handler is defined here instead of stm32f4xx_it.c.
+ *
+ * @param  none
+ *
+ * @return  none
+ */
+void RTC_WKUP_IRQHandler(void)
+{
+	if (RTC->ISR & RTC_ISR_WUTF) {
+		RTC->ISR = ~(RTC_ISR_WUTF | RTC_ISR_INIT) | (RTC->ISR & RTC_ISR_INIT);
+		wakeup_timer_elapsed = 1;
+	}
+	EXTI->PR = RTC_WAKEUP_EXTI_LINE;
+}
@@ -0,0 +1,38 @@
+/*
+ * power.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_PLATFORM_POWER_H_
+#define SRC_PLATFORM_POWER_H_
+
+#include <stdint.h>
+
+/* Low power mode and time base of the STM32
+ *
+ * power_stop_ms() puts the MCU into STOP mode (all clocks off except the LSE, regulator in low power
+ * mode) until the RTC wakeup timer expires. Other interrupts (e.g. the user button) only wake the MCU
+ * for their handler, it returns to STOP mode until the wakeup timer expired. The system clock is
+ * restored afterwards, the HAL tick and the microsecond time base (timebase.h) are advanced by the time
+ * spent in STOP mode.
+ * Note that TIM6 (motor steps) and the UART receiver stop as well: do not enter STOP mode while the
+ * motor moves, serial commands sent meanwhile are lost.
+ *
+ * power_init() starts the LSE and sets up the RTC wakeup timer (called from main()), without LSE
+ * crystal power_stop_ms() falls back to HAL_Delay().
+ *
+ * On the host build STOP mode only advances the virtual clock of the simulation (Host/host_power.c).
+ */
+
+#define POWER_WAKEUP_CLOCK_HZ	(2048)		/* RTC wakeup timer clock (LSE / 16) */
+#define POWER_STOP_MAX_MS		(32000)		/* Longest STOP interval (16-bit wakeup counter) */
+
+/* Start the LSE and configure the RTC wakeup timer */
+void power_init(void);
+
+/* Enter STOP mode for the given time (rounded to the wakeup timer resolution, at most
+ * POWER_STOP_MAX_MS), returns the time spent in STOP mode in microseconds */
+uint32_t power_stop_ms(uint32_t ms);
+
+#endif /* SRC_PLATFORM_POWER_H_ */
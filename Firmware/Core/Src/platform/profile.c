@@ -0,0 +1,93 @@
+/*
+ * profile.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "deca_device_api.h"
+#include "timebase.h"
+#include "uart_stdio.h"
+
+#include "profile.h"
+
+#ifdef PROFILE
+
+static profile_point_t profile_points[PROFILE_POINT_COUNT];
+static profile_point_t profile_snapshot[PROFILE_POINT_COUNT];
+static uint32_t period_start_ms = 0;
+static uint32_t last_mark_cycles = 0;
+
+static char profile_header_buffer[32];
+
+void profile_record(profile_id_t id, uint32_t cycles)
+{
+	const uint32_t us = timebase_cycles_to_us(cycles);
+	uint32_t bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+	if (bucket >= PROFILE_BUCKETS) {
+		bucket = PROFILE_BUCKETS - 1;
+	}
+
+	const decaIrqStatus_t irq = decamutexon();
+	profile_point_t *point = &profile_points[id];
+	point->count++;
+	point->sum_cycles += cycles;
+	if (point->count == 1 || cycles < point->min_cycles) {
+		point->min_cycles = cycles;
+	}
+	if (cycles > point->max_cycles) {
+		point->max_cycles = cycles;
+	}
+	if (point->histogram[bucket] < UINT16_MAX) {
+		point->histogram[bucket]++;
+	}
+	decamutexoff(irq);
+}
+
+void profile_mark_start(void)
+{
+	last_mark_cycles = timebase_cycles();
+}
+
+void profile_mark(profile_id_t id)
+{
+	const uint32_t now = timebase_cycles();
+	profile_record(id, now - last_mark_cycles);
+	last_mark_cycles = now;
+}
+
+void profile_poll(void)
+{
+	static_assert(sizeof(profile_header_t) == 12);
+	static_assert(sizeof(profile_point_t) == 72);
+
+	const uint32_t now_ms = HAL_GetTick();
+	const uint32_t period_ms = now_ms - period_start_ms;
+	if (period_ms < PROFILE_PERIOD_MS) {
+		return;
+	}
+
+	/* Copy and restart the statistics first, the UART output below is profiled as well */
+	const decaIrqStatus_t irq = decamutexon();
+	memcpy(profile_snapshot, profile_points, sizeof(profile_snapshot));
+	memset(profile_points, 0, sizeof(profile_points));
+	decamutexoff(irq);
+	period_start_ms = now_ms;
+
+	for (int i = 0; i < PROFILE_POINT_COUNT; i++) {
+		profile_snapshot[i].id = i;
+	}
+
+	const profile_header_t header = { timebase_clock_hz(), period_ms, PROFILE_POINT_COUNT, PROFILE_BUCKETS };
+	snprintf(profile_header_buffer, sizeof(profile_header_buffer), "BLOB / profile / v1 / %u\n",
+			sizeof(header) + sizeof(profile_snapshot));
+	stdio_write(profile_header_buffer);
+	stdio_write_binary((const uint8_t*)&header, sizeof(header));
+	stdio_write_binary((const uint8_t*)profile_snapshot, sizeof(profile_snapshot));
+	stdio_write("\n");
+}
+
+#endif
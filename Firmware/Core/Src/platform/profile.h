@@ -0,0 +1,95 @@
+/*
+ * profile.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_PLATFORM_PROFILE_H_
+#define SRC_PLATFORM_PROFILE_H_
+
+#include <stdint.h>
+
+/* Execution time profiling of the hot path
+ *
+ * Profile points measure the core clock cycles (timebase_cycles()) of a code section or between two
+ * state transitions and accumulate count, minimum, maximum, sum and a histogram with logarithmic
+ * buckets per point. The framework transmits the statistics as binary blob ("BLOB / profile / v1 /
+ * <len>") every PROFILE_PERIOD_MS while the application is idle and starts a new period,
+ * Scripts/profile_histogram.py renders them.
+ *
+ * Profiling is compiled in only with PROFILE defined (here or with -DPROFILE, e.g. make PROFILE=1 for
+ * the host build), the macros below are empty otherwise. A measurement costs about 100 cycles.
+ *
+ * The host scripts read the point names from the table below: only append new points at the end.
+ */
+
+//#define PROFILE  /* Define to enable the profile points */
+
+#define PROFILE_PERIOD_MS	(10000)	/* Interval between two profile blobs */
+#define PROFILE_BUCKETS		(24)	/* Bucket 0: < 1 us, bucket b: 2^(b-1) to 2^b us, the last one is open */
+
+#define PROFILE_POINTS(X) \
+	X(PROFILE_DW_ISR,				"DW3000 interrupt handler") \
+	X(PROFILE_SPI_READ_ACC,			"dwt_readaccdata (CIR)") \
+	X(PROFILE_SPI_READ_DIAG,		"RX diagnostics read") \
+	X(PROFILE_UART_WRITE,			"stdio_write / stdio_write_binary") \
+	X(PROFILE_FORMAT,				"trace text formatting") \
+	X(PROFILE_SLEEP,				"Sleep()") \
+	X(PROFILE_TWR_SYNC_TO_POLL,		"TWR: sync TX start -> poll processed") \
+	X(PROFILE_TWR_POLL_TO_FINAL,	"TWR: poll processed -> final processed") \
+	X(PROFILE_TWR_FINAL_TO_RESULT,	"TWR: final processed -> result exported")
+
+#define PROFILE_ENUM_ENTRY(id, name) id,
+typedef enum {
+	PROFILE_POINTS(PROFILE_ENUM_ENTRY)
+	PROFILE_POINT_COUNT
+} profile_id_t;
+#undef PROFILE_ENUM_ENTRY
+
+/* Version 1, followed by PROFILE_POINT_COUNT profile_point_t */
+typedef struct
+{
+	uint32_t	clock_hz;		// Core clock (cycles per second)
+	uint32_t	period_ms;		// Time covered by the statistics
+	uint16_t	point_count;	// Number of points following
+	uint16_t	bucket_count;	// Number of histogram buckets of each point
+} profile_header_t;  // 12 bytes, no padding required
+
+typedef struct
+{
+	uint64_t	sum_cycles;		// Sum of all measurements
+	uint32_t	count;			// Number of measurements
+	uint32_t	min_cycles;		// Shortest measurement
+	uint32_t	max_cycles;		// Longest measurement
+	uint16_t	histogram[PROFILE_BUCKETS];	// Measurements per bucket (saturating)
+	uint8_t		id;				// Profile point (profile_id_t)
+	uint8_t		padding[3];
+} profile_point_t;  // 72 bytes, no padding required
+
+/* Add a measurement (also from interrupt handlers) */
+void profile_record(profile_id_t id, uint32_t cycles);
+
+/* Start a sequence of state transitions */
+void profile_mark_start(void);
+
+/* State transition, records the cycles since the previous mark (or profile_mark_start()) */
+void profile_mark(profile_id_t id);
+
+/* Transmit the statistics if PROFILE_PERIOD_MS passed, call between exchanges */
+void profile_poll(void);
+
+#ifdef PROFILE
+#define PROFILE_BEGIN(id)			const uint32_t profile_start_##id = timebase_cycles()
+#define PROFILE_END(id)				profile_record((id), timebase_cycles() - profile_start_##id)
+#define PROFILE_MARK_START()		profile_mark_start()
+#define PROFILE_MARK(id)			profile_mark(id)
+#define PROFILE_POLL()				profile_poll()
+#else
+#define PROFILE_BEGIN(id)
+#define PROFILE_END(id)
+#define PROFILE_MARK_START()
+#define PROFILE_MARK(id)
+#define PROFILE_POLL()
+#endif
+
+#endif /* SRC_PLATFORM_PROFILE_H_ */
@@ -0,0 +1,151 @@
+/*
+ * stepper.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "stepper.h"
+
+/* Integer square root (floor) */
+static uint32_t isqrt64(uint64_t value)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1llu << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)root;
+}
+
+/* Interval between step level-1 and step level of the acceleration ramp (level >= 1) */
+static uint32_t ramp_interval(const stepper_t *stepper, uint32_t level)
+{
+	return isqrt64(stepper->ramp_scale * level) - isqrt64(stepper->ramp_scale * (level - 1));
+}
+
+void stepper_init(stepper_t *stepper, uint32_t tick_hz, uint32_t max_rate, uint32_t acceleration)
+{
+	stepper->tick_hz = tick_hz;
+	stepper->ramp_scale = 2llu * tick_hz * tick_hz / acceleration;
+	stepper->min_interval = tick_hz / max_rate;
+	stepper->position = 0;
+	stepper->target = 0;
+	stepper->running = 0;
+	stepper->done = 0;
+	stepper->run = 0;
+	stepper->direction = 0;
+	stepper->level = 0;
+}
+
+void stepper_set_rate(stepper_t *stepper, uint32_t max_rate)
+{
+	stepper->min_interval = stepper->tick_hz / max_rate;
+}
+
+/* Start from rest in the given direction */
+static int8_t start_moving(stepper_t *stepper, int8_t direction)
+{
+	stepper->done = 0;
+	stepper->running = 1;
+	stepper->level = 0;
+	stepper->direction = direction;
+	return direction;
+}
+
+int8_t stepper_start(stepper_t *stepper, int32_t target)
+{
+	stepper->target = target;
+	stepper->run = 0;
+
+	if (stepper->running) {
+		/* picked up by stepper_next() */
+		return 0;
+	}
+
+	if (target == stepper->position) {
+		stepper->done = 1;
+		return 0;
+	}
+
+	return start_moving(stepper, (target > stepper->position) ? 1 : -1);
+}
+
+int8_t stepper_run(stepper_t *stepper, int8_t direction)
+{
+	stepper->run = direction;
+
+	if (stepper->running) {
+		/* picked up by stepper_next(), turns around if moving in the other direction */
+		return 0;
+	}
+
+	return start_moving(stepper, direction);
+}
+
+uint32_t stepper_next(stepper_t *stepper, int8_t *direction)
+{
+	uint32_t interval;
+
+	stepper->position += stepper->direction;
+
+	/* Steps left in the current direction (negative if the target is behind), a continuous rotation has
+	 * no end in its direction */
+	int32_t ahead;
+	if (stepper->run != 0) {
+		ahead = (stepper->run == stepper->direction) ? INT32_MAX : -1;
+	} else {
+		ahead = (stepper->target - stepper->position) * stepper->direction;
+	}
+
+	if (ahead == 0 && stepper->level <= 1) {
+		/* Target reached at the lowest speed */
+		stepper->level = 0;
+		stepper->direction = 0;
+		stepper->running = 0;
+		stepper->done = 1;
+		*direction = 0;
+		return 0;
+	}
+
+	if (ahead > (int32_t)stepper->level) {
+		/* Accelerate unless the maximum rate is reached */
+		if (stepper->level == 0 || ramp_interval(stepper, stepper->level + 1) >= stepper->min_interval) {
+			stepper->level++;
+			interval = ramp_interval(stepper, stepper->level);
+		} else {
+			interval = stepper->min_interval;
+		}
+	} else if (ahead == (int32_t)stepper->level) {
+		/* Keep the speed for one step, the deceleration then ends exactly at the target */
+		interval = ramp_interval(stepper, stepper->level);
+	} else {
+		/* Decelerate (also past the target if it moved too close or behind) */
+		if (stepper->level > 0) {
+			stepper->level--;
+		}
+		if (stepper->level == 0) {
+			/* Standstill and the target is behind, start again in the other direction */
+			stepper->direction = -stepper->direction;
+			interval = ramp_interval(stepper, 1);
+		} else {
+			interval = ramp_interval(stepper, stepper->level);
+		}
+	}
+
+	if (interval < stepper->min_interval) {
+		interval = stepper->min_interval;
+	}
+
+	*direction = stepper->direction;
+	return interval;
+}
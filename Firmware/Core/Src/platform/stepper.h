@@ -0,0 +1,57 @@
+/*
+ * stepper.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_PLATFORM_STEPPER_H_
+#define SRC_PLATFORM_STEPPER_H_
+
+#include <stdint.h>
+
+/* Step generator with trapezoid speed profile
+ *
+ * Hardware independent core of the motor driver (motor.c), the timer glue calls stepper_start() when a
+ * new target is set and stepper_next() whenever a step pulse is output. The step times follow
+ * t(n) = sqrt(2 n / a) while accelerating (n: steps since standstill, a: acceleration in steps/s^2) up
+ * to the maximum step rate and mirror this when decelerating, so the motor stops exactly at the target.
+ * The target can be changed at any time, if it is behind the motor or too close to stop, the motor
+ * decelerates, stops and returns. stepper_run() turns the motor continuously at the maximum rate until
+ * a target is set again.
+ */
+
+typedef struct
+{
+	/* Configuration (stepper_init) */
+	uint32_t tick_hz;			// frequency of the timer counting the step intervals
+	uint64_t ramp_scale;		// 2 * tick_hz^2 / acceleration, t(n) = sqrt(ramp_scale * n) ticks
+	uint32_t min_interval;		// step interval at the maximum rate in ticks
+
+	/* State, modified from the timer interrupt */
+	volatile int32_t position;	// steps output so far
+	volatile int32_t target;	// target position
+	volatile uint8_t running;	// a step is planned, the timer is active
+	volatile uint8_t done;		// set when the motor stopped at the target (completion event)
+	volatile int8_t run;		// direction of a continuous rotation (stepper_run), 0: move to target
+	int8_t direction;			// direction of the planned step
+	uint32_t level;				// speed level: steps needed to stop (or accelerated since standstill)
+} stepper_t;
+
+/* Set up the profile, tick_hz is the frequency of the timer counting the step intervals */
+void stepper_init(stepper_t *stepper, uint32_t tick_hz, uint32_t max_rate, uint32_t acceleration);
+
+/* Set a new target position (with the timer interrupt disabled), returns the direction of the first step if the motor was at rest and has to
+ * start (the timer glue sets the direction and outputs the step right away), 0 otherwise */
+int8_t stepper_start(stepper_t *stepper, int32_t target);
+
+/* Change the maximum rate (steps/s), takes effect with the next step */
+void stepper_set_rate(stepper_t *stepper, uint32_t max_rate);
+
+/* Rotate continuously in the given direction (1 or -1), same return value as stepper_start() */
+int8_t stepper_run(stepper_t *stepper, int8_t direction);
+
+/* Called when the planned step is output, plans the following step. Returns the interval to the next
+ * step in ticks and its direction in *direction (0: the motor stopped at the target, no further step) */
+uint32_t stepper_next(stepper_t *stepper, int8_t *direction);
+
+#endif /* SRC_PLATFORM_STEPPER_H_ */
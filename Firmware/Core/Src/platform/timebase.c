@@ -0,0 +1,111 @@
+/*
+ * timebase.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "main.h"
+
+#include "timebase.h"
+
+#define DELAY_CHUNK_US	(1000000)	/* longest busy wait on a single cycle counter difference */
+
+static uint32_t cycles_per_us = 0;	/* 0 until timebase_init() */
+static uint32_t last_cycles = 0;	/* CYCCNT at the previous update */
+static uint32_t remainder_cycles = 0;	/* cycles not yet accounted as a full microsecond */
+static uint64_t total_us = 0;
+
+void timebase_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	last_cycles = 0;
+	remainder_cycles = 0;
+	total_us = 0;
+	cycles_per_us = SystemCoreClock / 1000000;
+}
+
+/* Account the cycles since the previous call, with interrupts blocked */
+static void update(void)
+{
+	const uint32_t now = DWT->CYCCNT;
+	const uint32_t cycles = remainder_cycles + (now - last_cycles);
+
+	last_cycles = now;
+	total_us += cycles / cycles_per_us;
+	remainder_cycles = cycles % cycles_per_us;
+}
+
+void timebase_update(void)
+{
+	if (cycles_per_us == 0) {
+		return;
+	}
+
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	update();
+	__set_PRIMASK(primask);
+}
+
+uint64_t timebase_us(void)
+{
+	if (cycles_per_us == 0) {
+		return 0;
+	}
+
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	update();
+	const uint64_t now_us = total_us;
+	__set_PRIMASK(primask);
+
+	return now_us;
+}
+
+uint32_t timebase_cycles(void)
+{
+	return DWT->CYCCNT;
+}
+
+uint32_t timebase_clock_hz(void)
+{
+	return cycles_per_us * 1000000;
+}
+
+uint32_t timebase_cycles_to_us(uint32_t cycles)
+{
+	return (cycles_per_us != 0) ? cycles / cycles_per_us : 0;
+}
+
+void timebase_delay_us(uint32_t us)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	while (us > 0) {
+		const uint32_t chunk = (us > DELAY_CHUNK_US) ? DELAY_CHUNK_US : us;
+		const uint32_t cycles = chunk * cycles_per_us;
+
+		while ((DWT->CYCCNT - start) < cycles) {
+		}
+		start += cycles;
+		us -= chunk;
+	}
+}
+
+void timebase_suspend(void)
+{
+	timebase_update();
+}
+
+void timebase_resume(uint32_t elapsed_us)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	/* The cycles counted since timebase_suspend() (STOP entry and clock restart) are part of elapsed_us */
+	last_cycles = DWT->CYCCNT;
+	total_us += elapsed_us;
+	__set_PRIMASK(primask);
+}
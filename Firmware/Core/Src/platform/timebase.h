@@ -0,0 +1,50 @@
+/*
+ * timebase.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SRC_PLATFORM_TIMEBASE_H_
+#define SRC_PLATFORM_TIMEBASE_H_
+
+#include <stdint.h>
+
+/* Microsecond time base on the DWT cycle counter of the Cortex-M4
+ *
+ * CYCCNT counts core clock cycles (144 MHz, 6.9 ns resolution) and wraps after 29.8 s. timebase_us()
+ * extends it to a 64-bit microsecond counter, the SysTick handler calls timebase_update() so no wrap is
+ * missed. The core clock stops in STOP mode: power_stop_ms() calls timebase_suspend() before and
+ * timebase_resume() with the STOP time measured by the RTC afterwards.
+ *
+ * Use timebase_cycles() for short intervals (profiling, < 29.8 s) and timebase_us() for timestamps and
+ * timeouts. On the host build both run on the virtual clock of the simulation (Host/host_timebase.c).
+ */
+
+/* Enable the cycle counter, call after SystemClock_Config() */
+void timebase_init(void);
+
+/* Account the cycles since the previous call (called from the SysTick interrupt) */
+void timebase_update(void);
+
+/* Microseconds since timebase_init() */
+uint64_t timebase_us(void);
+
+/* Raw core clock cycle counter (wraps, use differences only) */
+uint32_t timebase_cycles(void);
+
+/* Frequency of the cycle counter */
+uint32_t timebase_clock_hz(void);
+
+/* Convert a difference of timebase_cycles() to microseconds */
+uint32_t timebase_cycles_to_us(uint32_t cycles);
+
+/* Busy wait for the given number of microseconds */
+void timebase_delay_us(uint32_t us);
+
+/* Core clock is stopped (STOP mode) */
+void timebase_suspend(void);
+
+/* Core clock runs again, elapsed_us is the time since timebase_suspend() */
+void timebase_resume(uint32_t elapsed_us);
+
+#endif /* SRC_PLATFORM_TIMEBASE_H_ */
@@ -21,9 +21,32 @@
 
 /* Platform specific includes */
 #include "main.h"
+#include "timebase.h"
+#include "profile.h"
 
 static UART_HandleTypeDef* uart = NULL;
 
+/* Line reception: rx_line is filled from the interrupt until a line ending arrives, then line_ready
+ * blocks further reception into it until the line was read with stdio_read_line(). */
+#define STDIO_LINE_LENGTH 64
+static uint8_t rx_byte;
+static char rx_line[STDIO_LINE_LENGTH];
+static volatile uint16_t rx_line_length = 0;
+static volatile uint8_t line_ready = 0;
+
+/* Reception is re-armed from the interrupt, this fails (HAL_BUSY) if the interrupt arrives while the
+ * main loop holds the HAL lock of the UART to set up a transmission. stdio_read_line() retries it then. */
+static volatile uint8_t rx_armed = 0;
+
+/*! ----------------------------------------------------------------------------
+ * @fn arm_reception
+ * @brief Start the interrupt reception of the next character
+ */
+static void arm_reception(void)
+{
+    rx_armed = (HAL_UART_Receive_IT(uart, &rx_byte, 1) == HAL_OK);
+}
+
 /*! ----------------------------------------------------------------------------
  * @fn port_stdio_init
  * @brief Initialize stdio on the given UART
@@ -32,6 +55,7 @@ static UART_HandleTypeDef* uart = NULL;
  */
 void stdio_init(UART_HandleTypeDef* huart) {
     uart = huart;
+    arm_reception();
 }
 
 /*! ----------------------------------------------------------------------------
@@ -44,7 +68,10 @@ void stdio_init(UART_HandleTypeDef* huart) {
 inline int stdio_write(const char *data)
 {
     uint16_t len = strlen(data);
-    if (HAL_UART_Transmit(uart, (uint8_t*) data, len, HAL_MAX_DELAY) == HAL_OK) {
+    PROFILE_BEGIN(PROFILE_UART_WRITE);
+    const HAL_StatusTypeDef status = HAL_UART_Transmit(uart, (uint8_t*) data, len, HAL_MAX_DELAY);
+    PROFILE_END(PROFILE_UART_WRITE);
+    if (status == HAL_OK) {
         return len;
     }
     return -1;
@@ -52,8 +79,82 @@ inline int stdio_write(const char *data)
 
 inline int stdio_write_binary(const uint8_t *data, uint16_t length)
 {
-    if (HAL_UART_Transmit(uart, data, length, HAL_MAX_DELAY) == HAL_OK) {
+    PROFILE_BEGIN(PROFILE_UART_WRITE);
+    const HAL_StatusTypeDef status = HAL_UART_Transmit(uart, data, length, HAL_MAX_DELAY);
+    PROFILE_END(PROFILE_UART_WRITE);
+    if (status == HAL_OK) {
         return length;
     }
     return -1;
 }
+
+/*! ----------------------------------------------------------------------------
+ * @fn stdio_read_line
+ * @brief Read a line received on standard input (non-blocking)
+ *
+ * @param[out] buffer Line without line ending, null terminated
+ * @param[in] size Size of the buffer, longer lines are truncated
+ * @return Length of the line or -1 if no complete line was received yet
+ */
+int stdio_read_line(char *buffer, uint16_t size)
+{
+    if (!rx_armed) {
+        arm_reception();
+    }
+
+    if (!line_ready || size == 0) {
+        return -1;
+    }
+
+    uint16_t len = rx_line_length;
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(buffer, rx_line, len);
+    buffer[len] = '\0';
+
+    rx_line_length = 0;
+    line_ready = 0;
+    return len;
+}
+
+/*! ----------------------------------------------------------------------------
+ * @fn HAL_UART_RxCpltCallback
+ * @brief Collect received characters into the line buffer (called from the UART interrupt)
+ *
+ * @param[in] huart UART that received a character
+ */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != uart) {
+        return;
+    }
+
+    if (!line_ready) {
+        if (rx_byte == '\r' || rx_byte == '\n') {
+            /* Ignore empty lines (e.g. the second character of "\r\n") */
+            if (rx_line_length > 0) {
+                line_ready = 1;
+            }
+        } else if (rx_line_length < STDIO_LINE_LENGTH) {
+            rx_line[rx_line_length++] = rx_byte;
+        }
+    }
+
+    arm_reception();
+}
+
+/*! ----------------------------------------------------------------------------
+ * @fn HAL_UART_ErrorCallback
+ * @brief Restart reception after a UART error (overrun, framing, ...)
+ *
+ * @param[in] huart UART with the error
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != uart) {
+        return;
+    }
+
+    arm_reception();
+}
@@ -40,6 +40,18 @@ int stdio_write(const char *data);
 
 int stdio_write_binary(const uint8_t *data, uint16_t length);
 
+/*! ----------------------------------------------------------------------------
+ * @fn stdio_read_line
+ * @brief Read a line received on standard input (non-blocking)
+ *
+ * Characters are received in the UART interrupt, a line is complete after '\r' or '\n'.
+ *
+ * @param[out] buffer Line without line ending, null terminated
+ * @param[in] size Size of the buffer, longer lines are truncated
+ * @return Length of the line or -1 if no complete line was received yet
+ */
+int stdio_read_line(char *buffer, uint16_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,21 @@
+/*
+ * main.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Host build replacement of Core/Inc/main.h (pin definitions used by the applications) */
+
+#ifndef HOST_MAIN_H_
+#define HOST_MAIN_H_
+
+#include "stm32f4xx_hal.h"
+
+#define MOTOR_DIR_Pin GPIO_PIN_0
+#define MOTOR_DIR_GPIO_Port GPIOC
+#define MOTOR_STEP_Pin GPIO_PIN_3
+#define MOTOR_STEP_GPIO_Port GPIOA
+
+void Error_Handler(void);
+
+#endif /* HOST_MAIN_H_ */
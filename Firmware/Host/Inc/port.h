@@ -0,0 +1,28 @@
+/*
+ * port.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Host build replacement of Core/Src/platform/port.h, implemented in host_hal.c */
+
+#ifndef HOST_PORT_H_
+#define HOST_PORT_H_
+
+#include <stdint.h>
+
+#include "stm32f4xx_hal.h"
+
+/* DW IC IRQ handler type. */
+typedef void (*port_dwic_isr_t)(void);
+
+void port_set_dwic_isr(port_dwic_isr_t isr);
+void port_set_dw_ic_spi_fastrate(void);
+void port_set_dw_ic_spi_slowrate(void);
+void port_set_dw_ic_spi_prescaler(uint32_t divider);
+uint32_t port_get_dw_ic_spi_clock(uint32_t divider);
+void reset_DWIC(void);
+void Sleep(uint32_t Delay);
+void wakeup_device_with_io(void);
+
+#endif /* HOST_PORT_H_ */
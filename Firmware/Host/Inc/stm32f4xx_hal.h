@@ -0,0 +1,73 @@
+/*
+ * stm32f4xx_hal.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Minimal replacement of the STM32 HAL for the host build (see "Host build" in Firmware/README.md).
+ * Only what the applications and the platform headers use is provided. */
+
+#ifndef HOST_STM32F4XX_HAL_H_
+#define HOST_STM32F4XX_HAL_H_
+
+#include <stdint.h>
+#include <assert.h>
+
+#define UNUSED(X) (void)X
+
+#ifndef __packed
+#define __packed __attribute__((packed))
+#endif
+
+typedef enum
+{
+	HAL_OK = 0x00U,
+	HAL_ERROR = 0x01U,
+	HAL_BUSY = 0x02U,
+	HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+typedef enum
+{
+	RESET = 0U,
+	SET = !RESET
+} FlagStatus, ITStatus;
+
+typedef enum
+{
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+	uint32_t id;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef host_gpio_a, host_gpio_b, host_gpio_c;
+#define GPIOA (&host_gpio_a)
+#define GPIOB (&host_gpio_b)
+#define GPIOC (&host_gpio_c)
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+
+typedef struct
+{
+	int fd;  /* file descriptor used for output */
+} UART_HandleTypeDef;
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+#endif /* HOST_STM32F4XX_HAL_H_ */
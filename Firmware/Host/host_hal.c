@@ -0,0 +1,107 @@
+/*
+ * host_hal.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* HAL and port functions of the host build, all time related functions run on the virtual clock of
+ * the simulated DW3000. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stm32f4xx_hal.h"
+#include "main.h"
+#include "port.h"
+
+#include "deca_device_api.h"
+
+#include "sim_dw3000.h"
+
+#define TICK_READ_PS (100000llu)	/* cost of reading the tick counter (keeps polling loops advancing) */
+#define HOST_APB2_CLOCK_HZ (36000000)	/* SPI5 kernel clock of the STM32 (HCLK 144 MHz / 4) */
+
+GPIO_TypeDef host_gpio_a = { 0 }, host_gpio_b = { 1 }, host_gpio_c = { 2 };
+
+uint32_t HAL_GetTick(void)
+{
+	sim_advance_ps(TICK_READ_PS);
+	return (uint32_t)(sim_time_ps() / SIM_PS_PER_MS);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	sim_advance_ps(Delay * SIM_PS_PER_MS);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	UNUSED(GPIOx);
+	UNUSED(GPIO_Pin);
+	UNUSED(PinState);
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	UNUSED(GPIOx);
+	UNUSED(GPIO_Pin);
+}
+
+void Error_Handler(void)
+{
+	fprintf(stderr, "Error_Handler called\n");
+	exit(1);
+}
+
+void Sleep(uint32_t Delay)
+{
+	HAL_Delay(Delay);
+}
+
+void reset_DWIC(void)
+{
+	sim_reset();
+	sim_advance_ps(2 * SIM_PS_PER_MS);
+}
+
+void wakeup_device_with_io(void)
+{
+	sim_wakeup();
+	HAL_Delay(1);  /* chip select held low (WAIT_500uSEC) */
+}
+
+decaIrqStatus_t decamutexon(void)
+{
+	/* interrupts are only delivered while the virtual clock advances */
+	return 0;
+}
+
+void decamutexoff(decaIrqStatus_t s)
+{
+	UNUSED(s);
+}
+
+void port_set_dwic_isr(port_dwic_isr_t isr)
+{
+	sim_set_isr(isr);
+}
+
+void port_set_dw_ic_spi_fastrate(void)
+{
+	port_set_dw_ic_spi_prescaler(2);
+}
+
+void port_set_dw_ic_spi_slowrate(void)
+{
+	port_set_dw_ic_spi_prescaler(16);
+}
+
+void port_set_dw_ic_spi_prescaler(uint32_t divider)
+{
+	sim_set_spi_clock(port_get_dw_ic_spi_clock(divider));
+}
+
+uint32_t port_get_dw_ic_spi_clock(uint32_t divider)
+{
+	return HOST_APB2_CLOCK_HZ / divider;
+}
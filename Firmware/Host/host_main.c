@@ -0,0 +1,118 @@
+/*
+ * host_main.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Host build entry point: runs the application framework against the simulated DW3000.
+ *
+ * Example: ./uwb_host --app twr_tag --run-ms 5000 --distance-mm 2500
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "applications.h"
+#include "uart_stdio.h"
+#include "motor.h"
+#include "power.h"
+
+#include "host_stdio.h"
+#include "sim_dw3000.h"
+
+#define APP_COMMAND_LENGTH (64)
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  --app NAME         start application NAME after the default application\n"
+			"  --command CMD      serial command sent after startup (repeatable)\n"
+			"  --run-ms MS        virtual run time (default 5000)\n"
+			"  --distance-mm MM   distance to the simulated peer (default 3000)\n"
+			"  --loss PERMILLE    frame loss probability in 1/1000 (default 0)\n"
+			"  --beacon TYPE      frames sent by the idle peer: none, sync or poll (default none)\n"
+			"  --beacon-ms MS     beacon period (default 100)\n"
+			"  --seed N           seed of the frame loss (default 1)\n",
+			name);
+}
+
+int main(int argc, char **argv)
+{
+	static char app_command[APP_COMMAND_LENGTH];
+	static const struct option long_options[] = {
+			{ "app", required_argument, NULL, 'a' },
+			{ "command", required_argument, NULL, 'c' },
+			{ "run-ms", required_argument, NULL, 'r' },
+			{ "distance-mm", required_argument, NULL, 'd' },
+			{ "loss", required_argument, NULL, 'l' },
+			{ "beacon", required_argument, NULL, 'b' },
+			{ "beacon-ms", required_argument, NULL, 'p' },
+			{ "seed", required_argument, NULL, 's' },
+			{ "help", no_argument, NULL, 'h' },
+			{ NULL, 0, NULL, 0 },
+	};
+
+	sim_options_t options = {
+			.run_ms = 5000,
+			.distance_mm = 3000,
+			.loss_per_mille = 0,
+			.beacon = SIM_BEACON_NONE,
+			.beacon_ms = 100,
+			.seed = 1,
+	};
+
+	int option;
+	while ((option = getopt_long(argc, argv, "a:c:r:d:l:b:p:s:h", long_options, NULL)) != -1) {
+		switch (option) {
+		case 'a':
+			snprintf(app_command, sizeof(app_command), "app %s", optarg);
+			host_stdio_queue_command(app_command);
+			break;
+		case 'c':
+			host_stdio_queue_command(optarg);
+			break;
+		case 'r':
+			options.run_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			options.distance_mm = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			options.loss_per_mille = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			if (strcmp(optarg, "sync") == 0) {
+				options.beacon = SIM_BEACON_SYNC;
+			} else if (strcmp(optarg, "poll") == 0) {
+				options.beacon = SIM_BEACON_POLL;
+			} else if (strcmp(optarg, "none") == 0) {
+				options.beacon = SIM_BEACON_NONE;
+			} else {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'p':
+			options.beacon_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			options.seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return (option == 'h') ? 0 : 2;
+		}
+	}
+
+	sim_init(&options);
+	stdio_init(NULL);
+	motor_init();
+	power_init();
+
+	/* never returns, the simulation exits after the run time */
+	dw_main();
+	return 0;
+}
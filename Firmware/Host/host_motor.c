@@ -0,0 +1,96 @@
+/*
+ * host_motor.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Motor driver of the host build (replaces Core/Src/platform/motor.c), the steps are timed on the
+ * virtual clock of the simulation with the same speed profile as on the target. */
+
+#include "motor.h"
+#include "stepper.h"
+
+#include "sim_dw3000.h"
+
+#define PS_PER_TICK (1000000000000llu / MOTOR_TICK_HZ)
+
+static stepper_t stepper;
+
+/* For the interpolation in motor_position_substeps() */
+static uint64_t last_step_ps = 0;
+static int8_t next_direction = 0;
+static uint32_t next_interval = 0;
+
+static void step(void)
+{
+	int8_t direction;
+	last_step_ps = sim_time_ps();
+	next_interval = stepper_next(&stepper, &direction);
+	next_direction = direction;
+	if (direction != 0) {
+		sim_set_timer(next_interval * PS_PER_TICK, step);
+	}
+}
+
+static void start(int8_t direction)
+{
+	if (direction != 0) {
+		next_direction = 0;
+		sim_set_timer(MOTOR_SETUP_TICKS * PS_PER_TICK, step);
+	}
+}
+
+void motor_init(void)
+{
+	stepper_init(&stepper, MOTOR_TICK_HZ, MOTOR_MAX_RATE, MOTOR_ACCELERATION);
+}
+
+void motor_move_to(int32_t position)
+{
+	start(stepper_start(&stepper, position));
+}
+
+void motor_run(int8_t direction)
+{
+	start(stepper_run(&stepper, direction));
+}
+
+void motor_set_rate(uint32_t rate)
+{
+	stepper_set_rate(&stepper, rate);
+}
+
+void motor_move_by(int32_t steps)
+{
+	motor_move_to(stepper.target + steps);
+}
+
+int32_t motor_position(void)
+{
+	return stepper.position;
+}
+
+int32_t motor_position_substeps(void)
+{
+	int32_t fraction = 0;
+	if (next_direction != 0 && next_interval > 0) {
+		const uint64_t elapsed = (sim_time_ps() - last_step_ps) / PS_PER_TICK;
+		fraction = (elapsed >= next_interval) ? (MOTOR_SUBSTEPS - 1) : (int32_t)(elapsed * MOTOR_SUBSTEPS / next_interval);
+		fraction *= next_direction;
+	}
+	return stepper.position * MOTOR_SUBSTEPS + fraction;
+}
+
+int32_t motor_target(void)
+{
+	return stepper.target;
+}
+
+int motor_done(void)
+{
+	if (stepper.done) {
+		stepper.done = 0;
+		return 1;
+	}
+	return 0;
+}
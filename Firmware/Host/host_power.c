@@ -0,0 +1,33 @@
+/*
+ * host_power.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Low power functions of the host build (replaces Core/Src/platform/power.c), STOP mode only advances
+ * the virtual clock. */
+
+#include "power.h"
+
+#include "sim_dw3000.h"
+
+void power_init(void)
+{
+}
+
+uint32_t power_stop_ms(uint32_t ms)
+{
+	if (ms > POWER_STOP_MAX_MS) {
+		ms = POWER_STOP_MAX_MS;
+	}
+
+	/* same resolution as the RTC wakeup timer */
+	uint32_t counter = (ms * POWER_WAKEUP_CLOCK_HZ + 500) / 1000;
+	if (ms != 0 && counter == 0) {
+		counter = 1;
+	}
+
+	const uint32_t stop_us = (uint32_t)(((uint64_t)counter * 1000000) / POWER_WAKEUP_CLOCK_HZ);
+	sim_advance_ps(stop_us * SIM_PS_PER_US);
+	return stop_us;
+}
@@ -0,0 +1,101 @@
+/*
+ * host_stdio.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Standard IO of the host build: output goes to stdout, commands are read from the command line
+ * (host_stdio_queue_command) and from stdin. */
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "uart_stdio.h"
+#include "host_stdio.h"
+
+#include "sim_dw3000.h"
+
+#define UART_BYTE_PS (4444444llu)	/* 10 bits at 2.25 MBaud */
+#define READ_LINE_PS (1000000llu)	/* cost of polling for a command */
+#define COMMAND_QUEUE_SIZE (16)
+#define STDIN_LINE_LENGTH (64)
+
+static const char *command_queue[COMMAND_QUEUE_SIZE];
+static int command_count = 0;
+static int command_index = 0;
+
+static char stdin_line[STDIN_LINE_LENGTH];
+static uint16_t stdin_line_length = 0;
+static uint8_t stdin_closed = 0;
+
+void host_stdio_queue_command(const char *command)
+{
+	if (command_count < COMMAND_QUEUE_SIZE) {
+		command_queue[command_count++] = command;
+	}
+}
+
+void stdio_init(UART_HandleTypeDef* huart)
+{
+	UNUSED(huart);
+}
+
+int stdio_write(const char *data)
+{
+	return stdio_write_binary((const uint8_t *)data, strlen(data));
+}
+
+int stdio_write_binary(const uint8_t *data, uint16_t length)
+{
+	if (fwrite(data, 1, length, stdout) != length) {
+		return -1;
+	}
+	sim_advance_ps(length * UART_BYTE_PS);
+	return length;
+}
+
+static int copy_line(char *buffer, uint16_t size, const char *line, size_t length)
+{
+	if (length >= size) {
+		length = size - 1;
+	}
+	memcpy(buffer, line, length);
+	buffer[length] = '\0';
+	return length;
+}
+
+int stdio_read_line(char *buffer, uint16_t size)
+{
+	sim_advance_ps(READ_LINE_PS);
+
+	if (size == 0) {
+		return -1;
+	}
+
+	if (command_index < command_count) {
+		const char *command = command_queue[command_index++];
+		return copy_line(buffer, size, command, strlen(command));
+	}
+
+	/* read stdin without blocking, one character at a time to keep partial lines */
+	struct pollfd fds = { .fd = STDIN_FILENO, .events = POLLIN };
+	while (!stdin_closed && poll(&fds, 1, 0) > 0) {
+		char c;
+		if (read(STDIN_FILENO, &c, 1) != 1) {
+			stdin_closed = 1;
+			break;
+		}
+		if (c == '\r' || c == '\n') {
+			if (stdin_line_length > 0) {
+				int length = copy_line(buffer, size, stdin_line, stdin_line_length);
+				stdin_line_length = 0;
+				return length;
+			}
+		} else if (stdin_line_length < STDIN_LINE_LENGTH) {
+			stdin_line[stdin_line_length++] = c;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,13 @@
+/*
+ * host_stdio.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HOST_HOST_STDIO_H_
+#define HOST_HOST_STDIO_H_
+
+/* Queue a command, queued commands are returned by stdio_read_line() before anything from stdin */
+void host_stdio_queue_command(const char *command);
+
+#endif /* HOST_HOST_STDIO_H_ */
@@ -0,0 +1,58 @@
+/*
+ * host_timebase.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Microsecond time base of the host build (replaces Core/Src/platform/timebase.c), runs on the
+ * virtual clock of the simulation with the core clock of the STM32. */
+
+#include "timebase.h"
+
+#include "sim_dw3000.h"
+
+#define HOST_CORE_CLOCK_MHZ	(144)
+#define TIME_READ_PS		(100000llu)	/* same cost as reading the HAL tick (keeps polling loops advancing) */
+
+void timebase_init(void)
+{
+}
+
+void timebase_update(void)
+{
+}
+
+uint64_t timebase_us(void)
+{
+	sim_advance_ps(TIME_READ_PS);
+	return sim_time_ps() / SIM_PS_PER_US;
+}
+
+uint32_t timebase_cycles(void)
+{
+	return (uint32_t)(sim_time_ps() * HOST_CORE_CLOCK_MHZ / SIM_PS_PER_US);
+}
+
+uint32_t timebase_clock_hz(void)
+{
+	return HOST_CORE_CLOCK_MHZ * 1000000;
+}
+
+uint32_t timebase_cycles_to_us(uint32_t cycles)
+{
+	return cycles / HOST_CORE_CLOCK_MHZ;
+}
+
+void timebase_delay_us(uint32_t us)
+{
+	sim_advance_ps(us * SIM_PS_PER_US);
+}
+
+void timebase_suspend(void)
+{
+}
+
+void timebase_resume(uint32_t elapsed_us)
+{
+	(void)elapsed_us;
+}
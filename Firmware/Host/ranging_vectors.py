@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+
+
+"""Compare the results of the firmware ranging math with Scripts/ranging_math.py.
+
+Reads the vectors written by `test_ranging --vectors FILE` (inputs Treply1,
+Tround2, Tround1, Treply2, clock offset and the results of ranging_tof() and
+ranging_tof_to_mm()) and recomputes them with the Python implementation used
+for the offline analysis. Both have to agree bit by bit. Exits with an error
+otherwise.
+"""
+
+import os
+import sys
+import argparse
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', '..', 'Scripts'))
+import ranging_math  # noqa: E402
+
+
+MAX_REPORTED = 5
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('vectors', help='File written by test_ranging')
+
+    args = parser.parse_args()
+    antenna_delay = ranging_math.load_antenna_delay()
+
+    cases = 0
+    offset_cases = 0
+    failures = 0
+    with open(args.vectors) as f:
+        for line in f:
+            (Treply1, Tround2, Tround1, Treply2, clock_offset, tof,
+             mm) = map(int, line.split())
+            expected_tof = ranging_math.tof(Treply1, Tround2, Tround1, Treply2,
+                                            clock_offset, antenna_delay)
+            expected_mm = ranging_math.tof_to_mm(expected_tof)
+            cases += 1
+            offset_cases += (clock_offset != 0)
+            if (tof, mm) != (expected_tof, expected_mm):
+                failures += 1
+                if failures <= MAX_REPORTED:
+                    print(f'FAIL ranging_math.py: {line.strip()}, expected '
+                          f'{expected_tof} {expected_mm}')
+
+    print(f'{"FAIL" if failures or not cases else "PASS"} ranging_math.py: '
+          f'{cases} cases ({offset_cases} with clock offset), '
+          f'{failures} failures')
+    if failures or not cases:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
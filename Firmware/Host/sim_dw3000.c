@@ -0,0 +1,994 @@
+/*
+ * sim_dw3000.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Simulated DW3000 for the host build, implementing the part of the driver API (version 04.00.00) used by
+ * the applications. Timestamps are derived from the virtual clock (no clock offset between the devices,
+ * no antenna delays), the frame durations follow the configuration passed to dwt_configure(). The peer
+ * answers the ranging frames like the anchor and tag applications do (see peer_receive()).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deca_device_api.h"
+#include "deca_regs.h"
+#include "deca_spi.h"
+
+#include "applications.h"
+#include "application_config.h"
+#include "sim_dw3000.h"
+
+#define DTU_MASK (0xFFFFFFFFFFllu)
+#define DELAYED_TX_MASK (0xFFFFFFFE00llu)	/* the lowest 9 bits of the delayed TX time are ignored */
+
+#define SPI_TRANSACTION_PS (2*SIM_PS_PER_US)	/* chip select and header of every register access */
+#define SPI_CHAINED_PS (1*SIM_PS_PER_US)		/* chip select of a chained read (no driver call and IRQ masking) */
+#define SPI_BYTE_PS (210000llu)					/* 8 bits at 38 MHz (until sim_set_spi_clock()) */
+#define TX_STARTUP_PS (10*SIM_PS_PER_US)		/* immediate TX start until the preamble is on air */
+#define PEER_TURNAROUND_PS (300*SIM_PS_PER_US)	/* peer reply time for frames sent without delay */
+#define PEER_FINAL_DELAY_DTU (10llu*1000llu*US_TO_DWT_TIME)  /* same as the reply time of the anchor (10ms) */
+#define PEER_SLOT_DISTANCE_MM (500)				/* additional distance per slot of the simulated multi anchors */
+#define PEER_STATE_TIMEOUT_PS (100*SIM_PS_PER_MS)
+
+#define SYMBOL_PS (1017630llu)					/* preamble symbol duration (64 MHz PRF) */
+#define SPEED_OF_LIGHT_MM_PER_NS (299.792458)
+
+#define WAKE_PS (500*SIM_PS_PER_US)			/* DEEPSLEEP to IDLE_RC after the wakeup line was asserted */
+#define RESTORE_PS (200*SIM_PS_PER_US)		/* dwt_restoreconfig() including the PGF calibration */
+
+#define EVENT_QUEUE_SIZE (32)
+#define FRAME_BUFFER_SIZE (128)
+#define SCRATCH_RAM_LEN (127)
+
+typedef enum
+{
+	EV_DEVICE_TX_DONE,	// frame of the device sent, forwarded to the peer
+	EV_DEVICE_RX,		// frame of the peer received by the device
+	EV_PEER_RX,			// frame of the device received by the peer
+	EV_PEER_FINAL,		// the simulated multi tag sends its final frame
+	EV_BEACON,
+	EV_TIMER,			// host timer (sim_set_timer)
+} event_type_t;
+
+typedef struct
+{
+	uint64_t time_ps;
+	event_type_t type;
+	uint64_t rmarker_ps;	// RMARKER of the frame (at the transmitter for EV_DEVICE_TX_DONE / EV_PEER_RX)
+	uint64_t timestamp;		// TX timestamp (EV_DEVICE_TX_DONE)
+	uint16_t length;		// without FCS
+	uint8_t data[FRAME_BUFFER_SIZE];
+} event_t;
+
+static event_t events[EVENT_QUEUE_SIZE];
+static int event_count = 0;
+
+static sim_options_t options;
+static uint64_t now_ps = 0;
+static uint64_t spi_byte_ps = SPI_BYTE_PS;
+static uint8_t in_isr = 0;
+static uint32_t random_state;
+static void (*timer_callback)(void) = NULL;
+
+static struct
+{
+	dwt_config_t config;
+	uint32_t status;
+	uint32_t int_mask;
+	dwt_cb_t tx_done_cb;
+	dwt_cb_t rx_ok_cb;
+	dwt_cb_t rx_to_cb;
+	dwt_cb_t rx_err_cb;
+	port_dwic_isr_t isr;
+
+	uint8_t tx_buffer[FRAME_BUFFER_SIZE];
+	uint16_t tx_frame_length;	// including FCS
+	uint32_t delayed_time;
+	uint8_t tx_busy;
+	uint8_t rx_after_tx;
+	uint64_t tx_timestamp;
+
+	uint8_t rx_enabled;
+	uint64_t rx_on_ps;
+	uint8_t rx_buffer[FRAME_BUFFER_SIZE];
+	uint16_t rx_frame_length;	// including FCS
+	uint64_t rx_timestamp;
+
+	/* Double buffer mode: rx_buffer is the buffer the host reads, a second frame is kept in the other
+	 * buffer until the host releases the first one (dwt_signal_rx_buff_free) */
+	uint8_t dbl_buff;
+	uint8_t rx_buffer_full;
+	uint8_t rx_pending;
+	uint8_t rx_pending_buffer[FRAME_BUFFER_SIZE];
+	uint16_t rx_pending_length;
+	uint64_t rx_pending_timestamp;
+
+	uint8_t scratch_ram[SCRATCH_RAM_LEN];
+
+	uint8_t asleep;
+	uint64_t sleep_ps;		// start of DEEPSLEEP
+	uint64_t idle_rc_ps;	// IDLE_RC reached after the wakeup
+} dev;
+
+typedef enum
+{
+	PEER_IDLE,
+	PEER_ANCHOR,		// answered the sync frame of a tag with a poll, waiting for the response
+	PEER_TAG,			// sent a sync beacon, waiting for the poll and final frame of an anchor
+	PEER_MULTI_TAG,		// sent a broadcast poll, collecting responses until the final frame is sent
+} peer_state_t;
+
+static struct
+{
+	peer_state_t state;
+	uint64_t state_ps;
+	uint8_t sequence_number;	// next expected sequence number
+	uint64_t poll_tx_dtu;
+	uint8_t valid_slots;
+	uint64_t response_rx_dtu[MULTI_TWR_ANCHOR_COUNT];
+} peer;
+
+static struct
+{
+	uint32_t device_tx;
+	uint32_t device_rx;
+	uint32_t device_missed;
+	uint32_t late_tx;
+	uint32_t lost;
+	uint32_t exchanges;
+	uint64_t sleep_ps;
+} stats;
+
+/* --- time ------------------------------------------------------------------------------------------ */
+
+static uint64_t ps_to_dtu(uint64_t ps)
+{
+	/* 1 dtu = 1/(499.2 MHz * 128) = 15.65 ps, split to avoid an overflow */
+	return ((ps / 10000000llu) * 638976llu + (ps % 10000000llu) * 638976llu / 10000000llu) & DTU_MASK;
+}
+
+static uint64_t dtu_to_ps(uint64_t dtu)
+{
+	return (dtu & DTU_MASK) * 10000000llu / 638976llu;
+}
+
+static uint64_t tof_ps(uint32_t distance_mm)
+{
+	return (uint64_t)(distance_mm / SPEED_OF_LIGHT_MM_PER_NS * 1000.0);
+}
+
+static uint32_t preamble_symbols(void)
+{
+	switch (dev.config.txPreambLength) {
+	case DWT_PLEN_32: return 32;
+	case DWT_PLEN_64: return 64;
+	case DWT_PLEN_72: return 72;
+	case DWT_PLEN_128: return 128;
+	case DWT_PLEN_256: return 256;
+	case DWT_PLEN_512: return 512;
+	case DWT_PLEN_1024: return 1024;
+	case DWT_PLEN_1536: return 1536;
+	case DWT_PLEN_2048: return 2048;
+	default: return 4096;
+	}
+}
+
+/* Start of the preamble to RMARKER (end of the SFD) */
+static uint64_t rmarker_offset_ps(void)
+{
+	const uint32_t sfd_symbols = (dev.config.sfdType == 2) ? 16 : 8;
+	return (preamble_symbols() + sfd_symbols) * SYMBOL_PS;
+}
+
+/* RMARKER to the end of the frame (STS, PHR and payload including FCS and Reed-Solomon parity) */
+static uint64_t after_rmarker_ps(uint16_t length)
+{
+	uint64_t sts_ps = 0;
+	if ((dev.config.stsMode & DWT_STS_CONFIG_MASK) != DWT_STS_MODE_OFF) {
+		sts_ps = (32llu << dev.config.stsLength) * SYMBOL_PS;
+	}
+	const uint64_t phr_ps = 21 * 1176470llu;  /* 850 kbps */
+	const uint64_t bit_ps = (dev.config.dataRate == DWT_BR_6M8) ? 147059llu : 1176470llu;
+	const uint64_t payload_ps = (length + FCS_LEN) * 8 * bit_ps * 115 / 100;
+	return sts_ps + phr_ps + payload_ps;
+}
+
+/* --- event queue ----------------------------------------------------------------------------------- */
+
+static void schedule(const event_t *event)
+{
+	if (event_count >= EVENT_QUEUE_SIZE) {
+		fprintf(stderr, "sim: event queue full\n");
+		exit(2);
+	}
+
+	/* keep the queue sorted, events with the same time stay in order */
+	int i = event_count;
+	while (i > 0 && events[i-1].time_ps > event->time_ps) {
+		events[i] = events[i-1];
+		i--;
+	}
+	events[i] = *event;
+	event_count++;
+}
+
+static void cancel(event_type_t type)
+{
+	int j = 0;
+	for (int i = 0; i < event_count; i++) {
+		if (events[i].type != type) {
+			events[j++] = events[i];
+		}
+	}
+	event_count = j;
+}
+
+static int frame_lost(void)
+{
+	random_state = random_state * 1103515245u + 12345u;
+	if (((random_state >> 16) % 1000) < options.loss_per_mille) {
+		stats.lost++;
+		return 1;
+	}
+	return 0;
+}
+
+/* --- peer ------------------------------------------------------------------------------------------ */
+
+static void encode_40bit(uint8_t buffer[5], uint64_t value)
+{
+	for (int i = 0; i < 5; i++) {
+		buffer[i] = (uint8_t)(value >> (8*i));
+	}
+}
+
+static void init_frame(twr_base_frame_t *frame, uint8_t sequence_number, uint8_t function_code, uint16_t dst, uint16_t src)
+{
+	frame->frame_control[0] = 0x41;
+	frame->frame_control[1] = 0x88;
+	frame->sequence_number = sequence_number;
+	frame->pan_id[0] = 'X';
+	frame->pan_id[1] = 'X';
+	frame->dst_address[0] = (uint8_t)(dst >> 8);
+	frame->dst_address[1] = (uint8_t)dst;
+	frame->src_address[0] = (uint8_t)(src >> 8);
+	frame->src_address[1] = (uint8_t)src;
+	frame->twr_function_code = function_code;
+}
+
+/* Send a frame to the device, rmarker_ps is the RMARKER at the peer */
+static void peer_transmit(const void *frame, uint16_t length, uint64_t rmarker_ps, uint64_t tof)
+{
+	if (frame_lost()) {
+		return;
+	}
+
+	event_t event = {0};
+	event.type = EV_DEVICE_RX;
+	event.rmarker_ps = rmarker_ps + tof;
+	event.time_ps = event.rmarker_ps + after_rmarker_ps(length);
+	event.length = length;
+	memcpy(event.data, frame, length);
+	schedule(&event);
+}
+
+static void peer_set_state(peer_state_t state)
+{
+	peer.state = state;
+	peer.state_ps = now_ps;
+}
+
+/* Frame of the device received, rmarker_ps is the RMARKER at the device */
+static void peer_receive(const uint8_t *data, uint16_t length, uint64_t rmarker_ps)
+{
+	if (length < sizeof(twr_base_frame_t)) {
+		return;
+	}
+
+	const twr_base_frame_t *frame = (const twr_base_frame_t *)data;
+	const uint64_t tof = tof_ps(options.distance_mm);
+	const uint64_t rx_ps = rmarker_ps + tof;
+	const uint64_t rx_dtu = ps_to_dtu(rx_ps);
+	const uint64_t reply_ps = rx_ps + after_rmarker_ps(length) + PEER_TURNAROUND_PS + rmarker_offset_ps();
+
+	switch (frame->twr_function_code) {
+	case 0x20:
+		/* Sync frame of a tag, answer with a poll like application_twr_anchor.c */
+		if (length == sizeof(twr_base_frame_t)) {
+			twr_base_frame_t poll;
+			init_frame(&poll, frame->sequence_number + 1, 0x21, 0x5454, 0x4141);
+			peer.poll_tx_dtu = ps_to_dtu(reply_ps);
+			peer.sequence_number = frame->sequence_number + 2;
+			peer_set_state(PEER_ANCHOR);
+			peer_transmit(&poll, sizeof(poll), reply_ps, tof);
+		}
+		break;
+	case 0x10:
+		if (peer.state == PEER_ANCHOR && length == sizeof(twr_base_frame_t)
+				&& frame->sequence_number == peer.sequence_number) {
+			/* Response of a tag, send the final frame with the round and reply times */
+			twr_final_frame_t final;
+			init_frame((twr_base_frame_t *)&final, frame->sequence_number + 1, 0x23, 0x5454, 0x4141);
+			const uint64_t final_tx_dtu = (rx_dtu + PEER_FINAL_DELAY_DTU) & DELAYED_TX_MASK;
+			encode_40bit(final.poll_resp_round_time, rx_dtu - peer.poll_tx_dtu);
+			encode_40bit(final.resp_final_reply_time, final_tx_dtu - rx_dtu);
+			peer_transmit(&final, sizeof(final), rx_ps + dtu_to_ps(final_tx_dtu - rx_dtu), tof);
+			peer_set_state(PEER_IDLE);
+			stats.exchanges++;
+		} else if (peer.state == PEER_MULTI_TAG && length == sizeof(twr_multi_response_frame_t)) {
+			/* Response of a multi anchor to our broadcast poll */
+			const twr_multi_response_frame_t *response = (const twr_multi_response_frame_t *)data;
+			if (response->sequence_number == peer.sequence_number && response->slot < MULTI_TWR_ANCHOR_COUNT) {
+				peer.valid_slots |= 1 << response->slot;
+				peer.response_rx_dtu[response->slot] = rx_dtu;
+			}
+		}
+		break;
+	case 0x21:
+		if (frame->dst_address[0] == 0xFF && frame->dst_address[1] == 0xFF) {
+			/* Broadcast poll of a multi tag, every simulated anchor answers in its slot */
+			for (uint8_t slot = 0; slot < MULTI_TWR_ANCHOR_COUNT; slot++) {
+				const uint32_t distance_mm = options.distance_mm + slot * PEER_SLOT_DISTANCE_MM;
+				const uint64_t slot_tof = tof_ps(distance_mm);
+				const uint64_t slot_rx_ps = rmarker_ps + slot_tof;
+				const uint64_t slot_rx_dtu = ps_to_dtu(slot_rx_ps);
+				const uint64_t tx_dtu = (slot_rx_dtu + (MULTI_TWR_FIRST_SLOT_US + slot*MULTI_TWR_SLOT_US)*(uint64_t)US_TO_DWT_TIME)
+						& DELAYED_TX_MASK;
+
+				twr_multi_response_frame_t response;
+				init_frame((twr_base_frame_t *)&response, frame->sequence_number, 0x10, 0x5454, 0x4130 + slot);
+				response.slot = slot;
+				for (int i = 0; i < 4; i++) {
+					response.last_dist_mm[i] = (uint8_t)(distance_mm >> (8*i));
+				}
+				peer_transmit(&response, sizeof(response), slot_rx_ps + dtu_to_ps(tx_dtu - slot_rx_dtu), slot_tof);
+			}
+			stats.exchanges++;
+		} else if (peer.state == PEER_TAG && length == sizeof(twr_base_frame_t)
+				&& frame->sequence_number == peer.sequence_number) {
+			/* Poll of an anchor answering our sync beacon, send the response like a tag */
+			twr_base_frame_t response;
+			init_frame(&response, frame->sequence_number + 1, 0x10, 0x4141, 0x5454);
+			peer.sequence_number = frame->sequence_number + 2;
+			peer_transmit(&response, sizeof(response), reply_ps, tof);
+		}
+		break;
+	case 0x23:
+		if (peer.state == PEER_TAG && frame->sequence_number == peer.sequence_number) {
+			peer_set_state(PEER_IDLE);
+			stats.exchanges++;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* Final frame of the simulated multi tag (after the last response slot) */
+static void peer_send_multi_final(void)
+{
+	twr_multi_final_frame_t final = {0};
+	init_frame((twr_base_frame_t *)&final, peer.sequence_number, 0x23, 0xFFFF, 0x5454);
+
+	const uint64_t final_tx_dtu = (peer.poll_tx_dtu + (MULTI_TWR_FIRST_SLOT_US + MULTI_TWR_ANCHOR_COUNT*MULTI_TWR_SLOT_US
+			+ MULTI_TWR_FINAL_GUARD_US)*(uint64_t)US_TO_DWT_TIME) & DELAYED_TX_MASK;
+	final.valid_slots = peer.valid_slots;
+	for (uint8_t slot = 0; slot < MULTI_TWR_ANCHOR_COUNT; slot++) {
+		if (peer.valid_slots & (1 << slot)) {
+			encode_40bit(final.slots[slot].poll_resp_round_time, peer.response_rx_dtu[slot] - peer.poll_tx_dtu);
+			encode_40bit(final.slots[slot].resp_final_reply_time, final_tx_dtu - peer.response_rx_dtu[slot]);
+		}
+	}
+
+	const uint64_t now_dtu = ps_to_dtu(now_ps);
+	peer_transmit(&final, sizeof(final), now_ps + dtu_to_ps(final_tx_dtu - now_dtu), tof_ps(options.distance_mm));
+	peer_set_state(PEER_IDLE);
+}
+
+static void peer_beacon(void)
+{
+	static uint8_t beacon_sequence_number = 0;
+
+	if (peer.state != PEER_IDLE && (now_ps - peer.state_ps) < PEER_STATE_TIMEOUT_PS) {
+		return;  // exchange in progress
+	}
+
+	const uint64_t tx_ps = now_ps + rmarker_offset_ps();
+	twr_base_frame_t frame;
+
+	if (options.beacon == SIM_BEACON_SYNC) {
+		init_frame(&frame, beacon_sequence_number, 0x20, 0x4141, 0x5454);
+		peer.sequence_number = beacon_sequence_number + 1;
+		peer_set_state(PEER_TAG);
+	} else {
+		init_frame(&frame, beacon_sequence_number, 0x21, 0xFFFF, 0x5454);
+		peer.sequence_number = beacon_sequence_number;
+		peer.poll_tx_dtu = ps_to_dtu(tx_ps);
+		peer.valid_slots = 0;
+		peer_set_state(PEER_MULTI_TAG);
+
+		/* prepare the final frame shortly before it is due */
+		event_t event = {0};
+		event.type = EV_PEER_FINAL;
+		event.time_ps = tx_ps + (MULTI_TWR_FIRST_SLOT_US + MULTI_TWR_ANCHOR_COUNT*MULTI_TWR_SLOT_US
+				+ MULTI_TWR_FINAL_GUARD_US/2)*SIM_PS_PER_US;
+		schedule(&event);
+	}
+	beacon_sequence_number += 4;
+
+	peer_transmit(&frame, sizeof(frame), tx_ps, tof_ps(options.distance_mm));
+}
+
+/* --- simulation ------------------------------------------------------------------------------------ */
+
+static void process_event(const event_t *event)
+{
+	switch (event->type) {
+	case EV_DEVICE_TX_DONE:
+		dev.tx_busy = 0;
+		dev.tx_timestamp = event->timestamp;
+		dev.status |= SYS_STATUS_TXFRS_BIT_MASK;
+		stats.device_tx++;
+		if (dev.rx_after_tx) {
+			dev.rx_enabled = 1;
+			dev.rx_on_ps = now_ps;
+		}
+		if (!frame_lost()) {
+			event_t peer_event = *event;
+			peer_event.type = EV_PEER_RX;
+			peer_event.time_ps = now_ps + tof_ps(options.distance_mm);
+			schedule(&peer_event);
+		}
+		break;
+	case EV_DEVICE_RX:
+		/* The receiver has to be on before the preamble starts */
+		if (dev.dbl_buff && dev.rx_buffer_full) {
+			/* the receiver stays on, the frame goes to the other buffer if it is free */
+			if (dev.rx_enabled && !dev.tx_busy && !dev.rx_pending
+					&& (dev.rx_on_ps + rmarker_offset_ps() <= event->rmarker_ps)) {
+				memcpy(dev.rx_pending_buffer, event->data, event->length);
+				memset(&dev.rx_pending_buffer[event->length], 0, FCS_LEN);
+				dev.rx_pending_length = event->length + FCS_LEN;
+				dev.rx_pending_timestamp = ps_to_dtu(event->rmarker_ps);
+				dev.rx_pending = 1;
+				stats.device_rx++;
+			} else {
+				stats.device_missed++;
+			}
+		} else if (dev.rx_enabled && !dev.tx_busy && (dev.rx_on_ps + rmarker_offset_ps() <= event->rmarker_ps)) {
+			memcpy(dev.rx_buffer, event->data, event->length);
+			memset(&dev.rx_buffer[event->length], 0, FCS_LEN);
+			dev.rx_frame_length = event->length + FCS_LEN;
+			dev.rx_timestamp = ps_to_dtu(event->rmarker_ps);
+			if (dev.dbl_buff) {
+				dev.rx_buffer_full = 1;
+			} else {
+				dev.rx_enabled = 0;
+			}
+			dev.status |= SYS_STATUS_RXFCG_BIT_MASK;
+			stats.device_rx++;
+		} else {
+			stats.device_missed++;
+		}
+		break;
+	case EV_PEER_RX:
+		peer_receive(event->data, event->length, event->rmarker_ps);
+		break;
+	case EV_PEER_FINAL:
+		if (peer.state == PEER_MULTI_TAG) {
+			peer_send_multi_final();
+		}
+		break;
+	case EV_BEACON:
+		peer_beacon();
+		event_t next = *event;
+		next.time_ps += options.beacon_ms * SIM_PS_PER_MS;
+		schedule(&next);
+		break;
+	case EV_TIMER:
+		/* like an interrupt handler, the callback does not advance the clock */
+		in_isr = 1;
+		timer_callback();
+		in_isr = 0;
+		break;
+	}
+}
+
+static void service_interrupt(void)
+{
+	if (in_isr || dev.isr == NULL) {
+		return;
+	}
+
+	/* Like the EXTI handler in port.c: call the handler as long as the IRQ line is active */
+	for (int i = 0; i < 4 && (dev.status & dev.int_mask); i++) {
+		in_isr = 1;
+		dev.isr();
+		in_isr = 0;
+	}
+}
+
+static void sim_exit(void)
+{
+	fflush(stdout);
+	fprintf(stderr, "sim: %llu ms, device tx: %lu, device rx: %lu, missed: %lu, late tx: %lu, lost: %lu, peer exchanges: %lu, device sleep: %llu ms\n",
+			(unsigned long long)(now_ps / SIM_PS_PER_MS), (unsigned long)stats.device_tx, (unsigned long)stats.device_rx,
+			(unsigned long)stats.device_missed, (unsigned long)stats.late_tx, (unsigned long)stats.lost,
+			(unsigned long)stats.exchanges, (unsigned long long)(stats.sleep_ps / SIM_PS_PER_MS));
+	exit(0);
+}
+
+void sim_advance_ps(uint64_t ps)
+{
+	const uint64_t target_ps = now_ps + ps;
+
+	if (in_isr) {
+		/* interrupts are not nested, events are processed after the handler returns */
+		now_ps = target_ps;
+		return;
+	}
+
+	while (event_count > 0 && events[0].time_ps <= target_ps) {
+		const event_t event = events[0];
+		event_count--;
+		memmove(&events[0], &events[1], event_count * sizeof(event_t));
+
+		if (event.time_ps > now_ps) {
+			now_ps = event.time_ps;
+		}
+		process_event(&event);
+		service_interrupt();
+	}
+
+	if (target_ps > now_ps) {
+		now_ps = target_ps;
+	}
+	service_interrupt();
+
+	if (now_ps >= options.run_ms * SIM_PS_PER_MS) {
+		sim_exit();
+	}
+}
+
+uint64_t sim_time_ps(void)
+{
+	return now_ps;
+}
+
+static void spi_access(uint32_t bytes)
+{
+	sim_advance_ps(SPI_TRANSACTION_PS + bytes * spi_byte_ps);
+}
+
+/* Chained reads (deca_spi.c), the simulated registers read as 0 */
+int readfromspichain(const spi_read_t *reads, uint16_t count)
+{
+	for (uint16_t i = 0; i < count; i++) {
+		sim_advance_ps(((i == 0) ? SPI_TRANSACTION_PS : SPI_CHAINED_PS)
+				+ reads[i].readlength * spi_byte_ps);
+		memset(reads[i].readBuffer, 0, reads[i].readlength);
+	}
+	return 0;
+}
+
+void sim_set_spi_clock(uint32_t hz)
+{
+	spi_byte_ps = 8 * 1000000000000llu / hz;
+}
+
+void sim_set_timer(uint64_t delay_ps, void (*callback)(void))
+{
+	cancel(EV_TIMER);
+	timer_callback = callback;
+	if (callback != NULL) {
+		event_t event = {0};
+		event.type = EV_TIMER;
+		event.time_ps = now_ps + delay_ps;
+		schedule(&event);
+	}
+}
+
+void sim_reset(void)
+{
+	cancel(EV_DEVICE_TX_DONE);
+	memset(&dev, 0, sizeof(dev));
+	dev.config = config;
+	dev.status = SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK;
+}
+
+void sim_set_isr(port_dwic_isr_t isr)
+{
+	dev.isr = isr;
+}
+
+void sim_init(const sim_options_t *sim_options)
+{
+	options = *sim_options;
+	random_state = options.seed;
+	sim_reset();
+	peer_set_state(PEER_IDLE);
+
+	if (options.beacon != SIM_BEACON_NONE) {
+		event_t event = {0};
+		event.type = EV_BEACON;
+		event.time_ps = options.beacon_ms * SIM_PS_PER_MS;
+		schedule(&event);
+	}
+}
+
+/* --- driver API ------------------------------------------------------------------------------------ */
+
+void sim_wakeup(void)
+{
+	if (dev.asleep) {
+		dev.asleep = 0;
+		stats.sleep_ps += now_ps - dev.sleep_ps;
+		dev.idle_rc_ps = now_ps + WAKE_PS;
+	}
+}
+
+uint8_t dwt_checkidlerc(void)
+{
+	spi_access(4);
+	return !dev.asleep && now_ps >= dev.idle_rc_ps;
+}
+
+int dwt_initialise(int mode)
+{
+	UNUSED(mode);
+	spi_access(64);
+	return DWT_SUCCESS;
+}
+
+int dwt_check_dev_id(void)
+{
+	spi_access(4);
+	return DWT_SUCCESS;
+}
+
+void dwt_enablespicrccheck(dwt_spi_crc_mode_e crc_mode, dwt_spierrcb_t spireaderr_cb)
+{
+	UNUSED(crc_mode);  /* the simulated SPI has no errors */
+	UNUSED(spireaderr_cb);
+	spi_access(4);
+}
+
+void dwt_setleds(uint8_t mode)
+{
+	UNUSED(mode);
+	spi_access(8);
+}
+
+int dwt_configure(dwt_config_t *configuration)
+{
+	spi_access(128);
+	dev.config = *configuration;
+	return DWT_SUCCESS;
+}
+
+void dwt_configuresleep(uint16_t mode, uint8_t wake)
+{
+	UNUSED(mode);
+	UNUSED(wake);
+	spi_access(8);
+}
+
+void dwt_entersleep(int idle_rc)
+{
+	UNUSED(idle_rc);
+	spi_access(8);
+	cancel(EV_DEVICE_TX_DONE);
+	dev.tx_busy = 0;
+	dev.rx_enabled = 0;
+	dev.rx_buffer_full = 0;
+	dev.rx_pending = 0;
+	dev.asleep = 1;
+	dev.sleep_ps = now_ps;
+	/* the wakeup sets the status like a reset */
+	dev.status = SYS_STATUS_RCINIT_BIT_MASK | SYS_STATUS_SPIRDY_BIT_MASK;
+}
+
+void dwt_restoreconfig(void)
+{
+	spi_access(16);
+	sim_advance_ps(RESTORE_PS);
+}
+
+void dwt_configciadiag(uint8_t enable_mask)
+{
+	UNUSED(enable_mask);
+	spi_access(4);
+}
+
+void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr, dwt_cb_t cbSPIErr, dwt_cb_t cbSPIRdy)
+{
+	UNUSED(cbSPIErr);
+	UNUSED(cbSPIRdy);
+	dev.tx_done_cb = cbTxDone;
+	dev.rx_ok_cb = cbRxOk;
+	dev.rx_to_cb = cbRxTo;
+	dev.rx_err_cb = cbRxErr;
+}
+
+void dwt_setinterrupt(uint32_t bitmask_lo, uint32_t bitmask_hi, dwt_INT_options_e INT_options)
+{
+	UNUSED(bitmask_hi);
+	spi_access(8);
+	if (INT_options == DWT_ENABLE_INT) {
+		dev.int_mask |= bitmask_lo;
+	} else if (INT_options == DWT_ENABLE_INT_ONLY) {
+		dev.int_mask = bitmask_lo;
+	} else {
+		dev.int_mask &= ~bitmask_lo;
+	}
+}
+
+void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32_t regval)
+{
+	spi_access(4);
+	if (regFileID == SYS_STATUS_ID && regOffset == 0) {
+		dev.status &= ~regval;  /* write 1 to clear */
+	} else if (regFileID == DX_TIME_ID && regOffset == 0) {
+		dev.delayed_time = regval;
+	}
+}
+
+/* Only the scratch RAM is simulated, other registers ignore writes and read as 0 */
+void dwt_writetodevice(uint32_t regFileID, uint16_t index, uint16_t length, uint8_t *buffer)
+{
+	spi_access(length);
+	if (regFileID == SCRATCH_RAM_ID && index + length <= SCRATCH_RAM_LEN) {
+		memcpy(&dev.scratch_ram[index], buffer, length);
+	}
+}
+
+void dwt_readfromdevice(uint32_t regFileID, uint16_t index, uint16_t length, uint8_t *buffer)
+{
+	spi_access(length);
+	if (regFileID == SCRATCH_RAM_ID && index + length <= SCRATCH_RAM_LEN) {
+		memcpy(buffer, &dev.scratch_ram[index], length);
+	} else {
+		memset(buffer, 0, length);
+	}
+}
+
+uint32_t dwt_read32bitoffsetreg(int regFileID, int regOffset)
+{
+	spi_access(4);
+	if (regOffset != 0) {
+		return 0;
+	}
+	switch (regFileID) {
+	case SYS_STATUS_ID:
+		return dev.status;
+	case RX_FINFO_ID:
+		return dev.rx_frame_length;
+	case DX_TIME_ID:
+		return dev.delayed_time;
+	case SYS_STATE_LO_ID:
+		/* only distinguishes TX, RX and idle (not the register encoding of the real device) */
+		return dev.tx_busy ? 0x2 : (dev.rx_enabled ? 0x6 : 0x0);
+	default:
+		return 0;
+	}
+}
+
+uint16_t dwt_read16bitoffsetreg(int regFileID, int regOffset)
+{
+	UNUSED(regFileID);
+	UNUSED(regOffset);
+	spi_access(2);
+	return 0;
+}
+
+uint8_t dwt_read8bitoffsetreg(int regFileID, int regOffset)
+{
+	UNUSED(regFileID);
+	UNUSED(regOffset);
+	spi_access(1);
+	return 0;
+}
+
+int dwt_rxenable(int mode)
+{
+	UNUSED(mode);  /* delayed reception is started immediately */
+	spi_access(4);
+	dev.rx_enabled = 1;
+	dev.rx_on_ps = now_ps;
+	return DWT_SUCCESS;
+}
+
+void dwt_forcetrxoff(void)
+{
+	spi_access(8);
+	cancel(EV_DEVICE_TX_DONE);
+	dev.tx_busy = 0;
+	dev.rx_enabled = 0;
+	dev.rx_buffer_full = 0;
+	dev.rx_pending = 0;
+	dev.status &= ~(SYS_STATUS_TXFRS_BIT_MASK | SYS_STATUS_ALL_RX_ERR | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_GOOD);
+}
+
+void dwt_setdblrxbuffmode(dwt_dbl_buff_state_e dbl_buff_state, dwt_dbl_buff_mode_e dbl_buff_mode)
+{
+	UNUSED(dbl_buff_mode);  /* the receiver is always re-enabled automatically */
+	spi_access(8);
+	dev.dbl_buff = (dbl_buff_state == DBL_BUF_STATE_EN);
+	dev.rx_buffer_full = 0;
+	dev.rx_pending = 0;
+}
+
+void dwt_signal_rx_buff_free(void)
+{
+	spi_access(1);
+	if (dev.rx_pending) {
+		/* the host continues with the other buffer */
+		memcpy(dev.rx_buffer, dev.rx_pending_buffer, dev.rx_pending_length);
+		dev.rx_frame_length = dev.rx_pending_length;
+		dev.rx_timestamp = dev.rx_pending_timestamp;
+		dev.rx_pending = 0;
+		dev.status |= SYS_STATUS_RXFCG_BIT_MASK;
+	} else {
+		dev.rx_buffer_full = 0;
+	}
+}
+
+int dwt_writetxdata(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset)
+{
+	if (txBufferOffset + txDataLength > FRAME_BUFFER_SIZE) {
+		return DWT_ERROR;
+	}
+	spi_access(txDataLength);
+	memcpy(&dev.tx_buffer[txBufferOffset], txDataBytes, txDataLength);
+	return DWT_SUCCESS;
+}
+
+void dwt_writetxfctrl(uint16_t txFrameLength, uint16_t txBufferOffset, uint8_t ranging)
+{
+	UNUSED(txBufferOffset);
+	UNUSED(ranging);
+	spi_access(4);
+	dev.tx_frame_length = txFrameLength;
+}
+
+void dwt_setdelayedtrxtime(uint32_t starttime)
+{
+	spi_access(4);
+	dev.delayed_time = starttime;
+}
+
+int dwt_starttx(uint8_t mode)
+{
+	spi_access(1);
+
+	const uint16_t length = (dev.tx_frame_length > FCS_LEN) ? dev.tx_frame_length - FCS_LEN : 0;
+	event_t event = {0};
+	event.type = EV_DEVICE_TX_DONE;
+
+	if (mode & DWT_START_TX_DELAYED) {
+		event.timestamp = ((uint64_t)dev.delayed_time << 8) & DELAYED_TX_MASK;
+		const uint64_t ahead_dtu = (event.timestamp - ps_to_dtu(now_ps)) & DTU_MASK;
+		/* the preamble has to start after now, otherwise the transmission is late */
+		if (ahead_dtu >= (DTU_MASK >> 1) || dtu_to_ps(ahead_dtu) < rmarker_offset_ps()) {
+			stats.late_tx++;
+			return DWT_ERROR;
+		}
+		event.rmarker_ps = now_ps + dtu_to_ps(ahead_dtu);
+	} else {
+		event.rmarker_ps = now_ps + TX_STARTUP_PS + rmarker_offset_ps();
+		event.timestamp = ps_to_dtu(event.rmarker_ps);
+	}
+
+	event.time_ps = event.rmarker_ps + after_rmarker_ps(length);
+	event.length = length;
+	memcpy(event.data, dev.tx_buffer, length);
+
+	dev.rx_enabled = 0;
+	dev.tx_busy = 1;
+	dev.rx_after_tx = (mode & DWT_RESPONSE_EXPECTED) ? 1 : 0;
+	schedule(&event);
+	return DWT_SUCCESS;
+}
+
+void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset)
+{
+	spi_access(length);
+	if (rxBufferOffset + length > FRAME_BUFFER_SIZE) {
+		return;
+	}
+	memcpy(buffer, &dev.rx_buffer[rxBufferOffset], length);
+}
+
+void dwt_readrxtimestamp(uint8_t *timestamp)
+{
+	spi_access(5);
+	encode_40bit(timestamp, dev.rx_timestamp);
+}
+
+void dwt_readtxtimestamp(uint8_t *timestamp)
+{
+	spi_access(5);
+	encode_40bit(timestamp, dev.tx_timestamp);
+}
+
+uint32_t dwt_readsystimestamphi32(void)
+{
+	spi_access(4);
+	return (uint32_t)(ps_to_dtu(now_ps) >> 8);
+}
+
+int16_t dwt_readclockoffset(void)
+{
+	spi_access(2);
+	return 0;  /* the peer runs on the same clock */
+}
+
+int dwt_readstsquality(int16_t *rxStsQualityIndex)
+{
+	spi_access(2);
+	*rxStsQualityIndex = 1500;
+	return 1;
+}
+
+void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
+{
+	spi_access(sizeof(dwt_rxdiag_t));
+	memset(diagnostics, 0, sizeof(dwt_rxdiag_t));
+	encode_40bit(diagnostics->ipatovRxTime, dev.rx_timestamp);
+	encode_40bit(diagnostics->stsRxTime, dev.rx_timestamp);
+	encode_40bit(diagnostics->sts2RxTime, dev.rx_timestamp);
+	diagnostics->ipatovFpIndex = 745 << 6;
+	diagnostics->stsFpIndex = 745 << 6;
+	diagnostics->sts2FpIndex = 745 << 6;
+	diagnostics->ipatovAccumCount = preamble_symbols();
+	/* about -75 dBm receive and -78 dBm first path power level (see signal_power.h) */
+	diagnostics->ipatovPower = preamble_symbols() * preamble_symbols() / 45;
+	diagnostics->ipatovF1 = preamble_symbols() * 88;
+	diagnostics->ipatovF2 = preamble_symbols() * 88;
+	diagnostics->ipatovF3 = preamble_symbols() * 88;
+}
+
+void dwt_readaccdata(uint8_t *buffer, uint16_t length, uint16_t accOffset)
+{
+	spi_access(length);
+	if (length == 0) {
+		return;
+	}
+
+	/* dummy byte followed by complex samples (24-bit real, 24-bit imaginary), single path at index 745 */
+	buffer[0] = 0;
+	for (uint16_t i = 1; i < length; i++) {
+		const uint32_t byte_index = accOffset * 6u + i - 1;
+		const int32_t sample = (int32_t)(byte_index / 6) - 745;
+		int32_t value = (sample == 0) ? 20000 : ((sample == 1 || sample == -1) ? 8000 : (int32_t)(byte_index % 7) * 10);
+		if ((byte_index % 6) >= 3) {
+			value /= 2;  /* imaginary part */
+		}
+		buffer[i] = (uint8_t)(value >> (8 * (byte_index % 3)));
+	}
+}
+
+void dwt_isr(void)
+{
+	dwt_cb_data_t cb_data = {0};
+	cb_data.status = dev.status;
+
+	if (dev.status & SYS_STATUS_TXFRS_BIT_MASK) {
+		dev.status &= ~SYS_STATUS_TXFRS_BIT_MASK;
+		if (dev.tx_done_cb) {
+			dev.tx_done_cb(&cb_data);
+		}
+	}
+
+	if (dev.status & SYS_STATUS_RXFCG_BIT_MASK) {
+		dev.status &= ~SYS_STATUS_ALL_RX_GOOD;
+		cb_data.datalength = dev.rx_frame_length;
+		if (dev.rx_ok_cb) {
+			dev.rx_ok_cb(&cb_data);
+		}
+	}
+}
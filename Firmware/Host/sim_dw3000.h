@@ -0,0 +1,66 @@
+/*
+ * sim_dw3000.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Simulated DW3000 for the host build
+ *
+ * The simulation runs on a virtual clock that advances with every access to the device (SPI transfer
+ * time), every UART write (transmission time at 2.25 MBaud) and every delay. A simulated peer answers
+ * the ranging frames of the applications, so the tag and anchor state machines run through complete
+ * exchanges including the delayed transmissions.
+ */
+
+#ifndef HOST_SIM_DW3000_H_
+#define HOST_SIM_DW3000_H_
+
+#include <stdint.h>
+
+#include "port.h"
+
+/* Frames sent by the peer when it is not part of an exchange (for the anchor and receiver applications) */
+typedef enum
+{
+	SIM_BEACON_NONE,
+	SIM_BEACON_SYNC,	// ranging initiation of a tag (0x20), answered by application_twr_anchor.c
+	SIM_BEACON_POLL,	// broadcast poll of a multi tag (0x21), answered by application_twr_multi_anchor.c
+} sim_beacon_t;
+
+typedef struct
+{
+	uint32_t run_ms;			// virtual run time, the simulation exits afterwards
+	uint32_t distance_mm;		// distance to the peer (anchor slot i of the multi ranging is i*500 mm further away)
+	uint32_t loss_per_mille;	// probability of a lost frame (both directions)
+	sim_beacon_t beacon;
+	uint32_t beacon_ms;			// beacon period
+	uint32_t seed;
+} sim_options_t;
+
+void sim_init(const sim_options_t *options);
+
+/* Advance the virtual clock, process the peer and deliver interrupts */
+void sim_advance_ps(uint64_t ps);
+
+/* Virtual time since start */
+uint64_t sim_time_ps(void);
+
+/* Reset the device (RSTn line) */
+void sim_reset(void);
+
+/* Call callback after delay_ps of virtual time (replaces a pending timer, NULL cancels it) */
+void sim_set_timer(uint64_t delay_ps, void (*callback)(void));
+
+/* Assert the wakeup line (chip select) of a sleeping device */
+void sim_wakeup(void);
+
+/* Install the interrupt handler (port_set_dwic_isr) */
+void sim_set_isr(port_dwic_isr_t isr);
+
+/* Clock of the SPI accesses (port_set_dw_ic_spi_prescaler) */
+void sim_set_spi_clock(uint32_t hz);
+
+#define SIM_PS_PER_US (1000000llu)
+#define SIM_PS_PER_MS (1000000000llu)
+
+#endif /* HOST_SIM_DW3000_H_ */
@@ -0,0 +1,309 @@
+/*
+ * test_ranging.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Property test of Core/Src/apps/ranging_math.c on the host (make test-ranging).
+ *
+ * The results are checked against exact rational arithmetic with the 128-bit integers of the host compiler
+ * (the firmware implements them with two uint64_t):
+ * - ranging_remote_to_local() is interval - floor(interval * clock_offset / 2^26)
+ * - ranging_tof() is (Tround1 * Tround2 - Treply1 * Treply2) * 1024 / (Tround1 + Tround2 + Treply1 + Treply2)
+ *   rounded to nearest, minus the antenna delay
+ * - ranging_tof_to_mm() is tof * c / 1024 DTU rounded to nearest, saturated to UINT32_MAX
+ * - the time of flight of a simulated exchange (remote device with a clock offset) is recovered within
+ *   TOF_TOLERANCE_DTU for any reply delay
+ *
+ * Intervals range from 1 DTU to 2^40 - 1 (log-uniform) and are taken from 40-bit timestamps, so long
+ * intervals often wrap. The clock offsets cover the whole int16_t range with the extremes. With
+ * --vectors FILE the inputs and results are written for ranging_vectors.py, which compares them with
+ * Scripts/ranging_math.py.
+ *
+ * Example: ./build/test_ranging --cases 200000 --vectors build/ranging_vectors.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <getopt.h>
+
+#include "ranging_math.h"
+
+#define INTERVAL_BITS		(40)
+#define INTERVAL_MASK		((1llu << INTERVAL_BITS) - 1)
+#define CLOCK_OFFSET_BITS	(26)
+#define MAX_TOF_DTU			(100000)	/* 470 m */
+#define TOF_TOLERANCE_DTU	(2)			/* rounding of the timestamps and of the clock offset correction */
+#define MAX_REPORTED		(5)			/* failures printed per property */
+
+/* mm per DTU = c / (128 * 499.2 MHz), same as ranging_math.c */
+#define MM_PER_DTU_NUM		(149896229)
+#define MM_PER_DTU_DEN		(31948800)
+
+typedef __int128 i128_t;
+
+typedef struct
+{
+	const char *name;
+	unsigned long cases;
+	unsigned long failures;
+} property_t;
+
+static property_t remote_to_local_property = { .name = "remote_to_local exact" };
+static property_t tof_property = { .name = "tof exact" };
+static property_t mm_property = { .name = "tof_to_mm exact" };
+static property_t exchange_property = { .name = "exchange tof recovered" };
+
+static uint64_t random_state = 1;
+static unsigned long wrapped_intervals = 0;
+static unsigned long negative_tofs = 0;
+static unsigned long saturated_mm = 0;
+static FILE *vectors = NULL;
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  --cases N          random cases per generator (default 100000)\n"
+			"  --seed N           seed of the random numbers (default 1)\n"
+			"  --vectors FILE     write the inputs and results for ranging_vectors.py\n",
+			name);
+}
+
+/* xorshift64* */
+static uint64_t random_u64(void)
+{
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return random_state * 0x2545F4914F6CDD1Dllu;
+}
+
+/* Interval from 1 to max_bits bits, log-uniform, the extremes 1 and 2^max_bits - 1 included */
+static uint64_t random_interval(int max_bits)
+{
+	const uint64_t choice = random_u64() % 64;
+	if (choice == 0) {
+		return 1;
+	}
+	if (choice == 1) {
+		return (1llu << max_bits) - 1;
+	}
+	const int bits = 1 + random_u64() % max_bits;
+	return (1llu << (bits - 1)) | (random_u64() & ((1llu << (bits - 1)) - 1));
+}
+
+static int16_t random_clock_offset(void)
+{
+	static const int16_t extremes[] = { INT16_MIN, INT16_MAX, 0, 1, -1 };
+	const uint64_t choice = random_u64() % 16;
+	if (choice < sizeof(extremes) / sizeof(extremes[0])) {
+		return extremes[choice];
+	}
+	/* half of the offsets in the range of real crystals (+-20 ppm = +-1342), the rest anywhere */
+	if (choice < 11) {
+		return (int16_t)(random_u64() % 2685) - 1342;
+	}
+	return (int16_t)random_u64();
+}
+
+/* Interval between two 40-bit timestamps as computed by the applications (64-bit difference, not masked) */
+static uint64_t timestamp_interval(uint64_t interval)
+{
+	const uint64_t start = random_u64() & INTERVAL_MASK;
+	const uint64_t end = (start + interval) & INTERVAL_MASK;
+	wrapped_intervals += (end < start);
+	return end - start;
+}
+
+static i128_t floor_div(i128_t n, i128_t d)
+{
+	const i128_t q = n / d;
+	return (((n % d) != 0) && ((n < 0) != (d < 0))) ? q - 1 : q;
+}
+
+static i128_t abs128(i128_t value)
+{
+	return (value < 0) ? -value : value;
+}
+
+/* Count a case of the property, returns nonzero if the failure has to be printed */
+static int failed(property_t *property, int ok)
+{
+	property->cases++;
+	if (ok) {
+		return 0;
+	}
+	property->failures++;
+	return (property->failures <= MAX_REPORTED);
+}
+
+static uint64_t reference_remote_to_local(uint64_t interval, int16_t clock_offset)
+{
+	interval &= INTERVAL_MASK;
+	return interval - (uint64_t)floor_div((i128_t)interval * clock_offset, (i128_t)1 << CLOCK_OFFSET_BITS);
+}
+
+static void check_remote_to_local(uint64_t interval, int16_t clock_offset)
+{
+	const uint64_t local = ranging_remote_to_local(interval, clock_offset);
+	const uint64_t expected = reference_remote_to_local(interval, clock_offset);
+	if (failed(&remote_to_local_property, local == expected)) {
+		printf("FAIL %s: interval %llu offset %d -> %llu, expected %llu\n", remote_to_local_property.name,
+				(unsigned long long)interval, clock_offset, (unsigned long long)local, (unsigned long long)expected);
+	}
+}
+
+/* |result - exact| <= 1/2 for exact = n / d (d > 0), i.e. |2 * (result * d - n)| <= d */
+static int rounded(i128_t result, i128_t n, i128_t d)
+{
+	return abs128(2 * (result * d - n)) <= d;
+}
+
+static void check_distance(uint64_t Treply1, uint64_t Tround2, uint64_t Tround1, uint64_t Treply2, int16_t clock_offset)
+{
+	check_remote_to_local(Tround1, clock_offset);
+	check_remote_to_local(Treply2, clock_offset);
+
+	const int64_t tof = ranging_tof(Treply1, Tround2, Tround1, Treply2, clock_offset);
+	const uint32_t mm = ranging_tof_to_mm(tof);
+
+	const i128_t round1 = reference_remote_to_local(Tround1, clock_offset);
+	const i128_t reply2 = reference_remote_to_local(Treply2, clock_offset);
+	const i128_t reply1 = Treply1 & INTERVAL_MASK;
+	const i128_t round2 = Tround2 & INTERVAL_MASK;
+	const i128_t numerator = (round1 * round2 - reply1 * reply2) << RANGING_TOF_FRACTION_BITS;
+	const i128_t denominator = round1 + round2 + reply1 + reply2;
+	const i128_t delay = (i128_t)RANGING_ANTENNA_DELAY_DTU << RANGING_TOF_FRACTION_BITS;
+	negative_tofs += (numerator < 0);
+	if (failed(&tof_property, rounded((i128_t)tof + delay, numerator, denominator))) {
+		printf("FAIL %s: Treply1 %llu Tround2 %llu Tround1 %llu Treply2 %llu offset %d -> %lld\n", tof_property.name,
+				(unsigned long long)Treply1, (unsigned long long)Tround2, (unsigned long long)Tround1,
+				(unsigned long long)Treply2, clock_offset, (long long)tof);
+	}
+
+	const i128_t mm_numerator = (i128_t)tof * MM_PER_DTU_NUM;
+	const i128_t mm_denominator = (i128_t)MM_PER_DTU_DEN << RANGING_TOF_FRACTION_BITS;
+	int mm_ok;
+	if (tof <= 0) {
+		mm_ok = (mm == 0);
+	} else if (mm == UINT32_MAX) {
+		saturated_mm++;
+		mm_ok = (2 * mm_numerator >= (2 * (i128_t)UINT32_MAX - 1) * mm_denominator);
+	} else {
+		mm_ok = rounded(mm, mm_numerator, mm_denominator);
+	}
+	if (failed(&mm_property, mm_ok)) {
+		printf("FAIL %s: tof %lld -> %lu mm\n", mm_property.name, (long long)tof, (unsigned long)mm);
+	}
+
+	if (vectors != NULL) {
+		fprintf(vectors, "%llu %llu %llu %llu %d %lld %lu\n", (unsigned long long)Treply1,
+				(unsigned long long)Tround2, (unsigned long long)Tround1, (unsigned long long)Treply2, clock_offset,
+				(long long)tof, (unsigned long)mm);
+	}
+}
+
+/* Independent intervals (the time of flight can be negative or huge) */
+static void random_intervals(void)
+{
+	const uint64_t Treply1 = timestamp_interval(random_interval(INTERVAL_BITS));
+	const uint64_t Tround2 = timestamp_interval(random_interval(INTERVAL_BITS));
+	/* the remote intervals are sent as 40-bit values in the final frame */
+	const uint64_t Tround1 = timestamp_interval(random_interval(INTERVAL_BITS)) & INTERVAL_MASK;
+	const uint64_t Treply2 = timestamp_interval(random_interval(INTERVAL_BITS)) & INTERVAL_MASK;
+	check_distance(Treply1, Tround2, Tround1, Treply2, random_clock_offset());
+}
+
+/* Exchange with a known time of flight, the remote device measures its intervals with a crystal that is
+ * clock_offset / 2^26 faster than the local one */
+static void simulated_exchange(void)
+{
+	const uint64_t tof_dtu = random_u64() % (MAX_TOF_DTU + 1);
+	const uint64_t reply1 = random_interval(INTERVAL_BITS - 1);
+	const uint64_t reply2 = random_interval(INTERVAL_BITS - 1);
+	const int16_t clock_offset = random_clock_offset();
+
+	/* remote interval of a local interval rounded to nearest */
+	const i128_t scale = (i128_t)1 << CLOCK_OFFSET_BITS;
+	const i128_t remote_scale = scale - clock_offset;
+	const uint64_t Tround1 = ((reply1 + 2 * tof_dtu) * scale + remote_scale / 2) / remote_scale;
+	const uint64_t Treply2 = (reply2 * scale + remote_scale / 2) / remote_scale;
+	const uint64_t Treply1 = timestamp_interval(reply1);
+	const uint64_t Tround2 = timestamp_interval(reply2 + 2 * tof_dtu);
+
+	check_distance(Treply1, Tround2, Tround1 & INTERVAL_MASK, Treply2 & INTERVAL_MASK, clock_offset);
+
+	const int64_t tof = ranging_tof(Treply1, Tround2, Tround1 & INTERVAL_MASK, Treply2 & INTERVAL_MASK,
+			clock_offset) + ((int64_t)RANGING_ANTENNA_DELAY_DTU << RANGING_TOF_FRACTION_BITS);
+	const int64_t error = tof - (int64_t)(tof_dtu << RANGING_TOF_FRACTION_BITS);
+	if (failed(&exchange_property, llabs(error) <= (TOF_TOLERANCE_DTU << RANGING_TOF_FRACTION_BITS))) {
+		printf("FAIL %s: reply times %llu and %llu, tof %llu DTU, offset %d: error %lld/1024 DTU\n",
+				exchange_property.name, (unsigned long long)reply1, (unsigned long long)reply2,
+				(unsigned long long)tof_dtu, clock_offset, (long long)error);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[] = {
+			{ "cases", required_argument, NULL, 'n' },
+			{ "seed", required_argument, NULL, 's' },
+			{ "vectors", required_argument, NULL, 'v' },
+			{ "help", no_argument, NULL, 'h' },
+			{ NULL, 0, NULL, 0 },
+	};
+
+	unsigned long cases = 100000;
+	const char *vectors_path = NULL;
+
+	int option;
+	while ((option = getopt_long(argc, argv, "n:s:v:h", long_options, NULL)) != -1) {
+		switch (option) {
+		case 'n':
+			cases = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			random_state = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			vectors_path = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return (option == 'h') ? 0 : 2;
+		}
+	}
+	if (random_state == 0) {
+		random_state = 1;	/* xorshift never leaves 0 */
+	}
+
+	if (vectors_path != NULL) {
+		vectors = fopen(vectors_path, "w");
+		if (vectors == NULL) {
+			perror(vectors_path);
+			return 1;
+		}
+	}
+
+	for (unsigned long i = 0; i < cases; i++) {
+		random_intervals();
+		simulated_exchange();
+	}
+	if (vectors != NULL) {
+		fclose(vectors);
+	}
+
+	const property_t *properties[] = { &remote_to_local_property, &tof_property, &mm_property, &exchange_property };
+	int status = 0;
+	for (size_t i = 0; i < sizeof(properties) / sizeof(properties[0]); i++) {
+		const property_t *property = properties[i];
+		printf("%s %s: %lu cases, %lu failures\n", property->failures ? "FAIL" : "PASS", property->name,
+				property->cases, property->failures);
+		status |= (property->failures != 0);
+	}
+	printf("%lu wrapped intervals, %lu negative and %lu saturated distances\n", wrapped_intervals, negative_tofs,
+			saturated_mm);
+	return status;
+}
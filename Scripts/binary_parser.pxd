@@ -13,3 +13,5 @@ cdef decode_blob_toa(str b64_buffer, int version)
 cdef decode_blob_cir_analysis(str b64_buffer, int version)
 cdef decode_blob_cir(str b64_buffer, int version)
 cdef decode_blob_twr(str b64_buffer, int version)
+cdef decode_blob_twr_multi(str b64_buffer, int version)
+cdef decode_blob_trace(str b64_buffer, int version)
@@ -5,12 +5,15 @@ import base64
 import struct
 from collections import namedtuple
 
+import blob_schema
+
 
 # mapping from "readable" c types to struct module codes
 type_mapping = {
     'u64': 'Q',  # uint64_t
     'u32': 'L',  # uint32_t
     'u16': 'H',  # uint16_t
+    'i32': 'l',  # int32_t
     'i16': 'h',  # int16_t
     'u8': 'B',  # uint8_t
 }
@@ -29,6 +32,60 @@ cir_data = namedtuple('cir_data', 'cir_ip cir_sts1 cir_sts2')
 twr_data = namedtuple('twr_data', 'Treply1 Treply2 Tround1 Tround2 dist_mm '
                       'twr_count rotation')
 
+trace_record = namedtuple('trace_record', 'id nargs tick args')
+
+twr_multi_data = namedtuple('twr_multi_data', 'Tround1 Treply2 last_dist_mm '
+                            'twr_count slot')
+
+radio_config_data = namedtuple('radio_config_data', 'preamble_length '
+                               'sfd_timeout sts_length config_count channel '
+                               'pac tx_code rx_code sfd_type data_rate '
+                               'phr_mode phr_rate sts_mode pdoa_mode')
+
+rotation_data = namedtuple('rotation_data', 'angle_mdeg steps tick_ms '
+                           'twr_count rate')
+
+profile_data = namedtuple('profile_data', 'clock_hz period_ms points')
+
+profile_point = namedtuple('profile_point', 'id count min_cycles max_cycles '
+                           'sum_cycles histogram')
+
+energy_data = namedtuple('energy_data', 'sleep_us wake_us idle_us tx_us '
+                         'tx_delayed_us rx_us mcu_stop_us latency_us '
+                         'twr_count tx_count tx_delayed_count')
+
+aoa_data = namedtuple('aoa_data', 'angle_mdeg pdoa pdoa_raw dist_mm '
+                      'rx_power_cdbm fp_power_cdbm twr_count flags')
+
+# flags of the aoa blob
+AOA_FLAG_CLAMPED = 0x01
+AOA_FLAG_FILTER_RESET = 0x02
+
+# precompiled formats of the fixed size blobs
+blob_structs = {blob.name: struct.Struct(blob_schema.struct_format(blob))
+                for blob in blob_schema.BLOBS}
+
+# the namedtuples of the blobs decoded without conversion follow the schema
+for _name, _decoded_type in (('cir_analysis', cir_analysis_data),
+                             ('twr', twr_data),
+                             ('twr_multi', twr_multi_data),
+                             ('config', radio_config_data),
+                             ('rotation', rotation_data),
+                             ('energy', energy_data),
+                             ('aoa', aoa_data)):
+    assert _decoded_type._fields == tuple(
+        f.name for f in blob_schema.transmitted_fields(
+            blob_schema.blobs[_name])), _name
+
+
+def _unpack_blob(name, b64_buffer, version):
+    '''Unpack a fixed size blob described in blob_schema.py.'''
+    if version != blob_schema.blobs[name].version:
+        raise ValueError('Unsupported version: {}'.format(version))
+
+    data = base64.b64decode(b64_buffer)
+    return blob_structs[name].unpack(data)
+
 
 def decode_40bit_int(buffer, negative=False):
     '''Decode a 40 bit (5 byte) integer.
@@ -60,7 +117,7 @@ def decode_24bit_int(data):
         # If the 24th bit is not zero we have a negative number, stored in 2's
         # complement. To get the decimal result we need to invert all bits add
         # one and multiply by (-1)
-        value = value ^ 0xFFFFFF - 1
+        value = -(value ^ 0xFFFFFF) - 1
 
     return value
 
@@ -89,43 +146,12 @@ def decode_48bit_complex_array(data):
 
 
 def decode_blob_toa(b64_buffer, version):
-    '''Decode the time/toa struct.
+    '''Decode the time/toa struct (meas_time_poa_t, see blob_schema.py).
 
-    Version 3:
-    typedef struct
-    {
-    0      uint32_t cia_diag_1;    // Diagnostics common to both sequences (undocumented CIA_DIAG_1 register)
-    1      uint16_t ip_poa;        // Preamble POA
-    2      uint16_t sts1_poa;      // POA of STS block 1
-    3      uint16_t sts2_poa;      // POA of STS block 2
-    4      int16_t pdoa;           // PDoA from two STS POAs signed int [1:-11] in radians
-    5      int16_t xtal_offset;    // Estimated xtal offset of remote device
-    6      int16_t sts_qual_index; // STS quality value
-    7      uint8_t sts_qual;       // STS quality indicator
-    8      uint8_t tdoa_sign;      // TDoA is a signed 41-bit integer, store the sign bit here
-    9-13   uint8_t tdoa[5];        // TDoA from two STS RX timestamps (40-bit without sign)
-    14-18  uint8_t ip_toa[5];      // Preamble/Ipatov RX timestamp
-    18     uint8_t ip_toast;       // RX status of preamble
-    20-24  uint8_t sts1_toa[5];    // STS RX timestamp on antenna 1
-    25     uint8_t sts1_toast;     // RX status of STS on antenna 1 (only high 8-bits, discarding reserved bit 23 in the register)
-    26-30  uint8_t sts2_toa[5];    // STS RX timestamp on antenna 2
-    31     uint8_t sts2_toast;     // RX status of STS on antenna 2 (only high 8-bits, discarding reserved bit 23 in the register)
-    32     uint8_t fp_th_md;       // First path threshold test mode
-    33     uint8_t dgc_decision;   // DGC decision index (used for RSSI estimation)
-    -      uint8_t padding[1];     // 43 bytes of data, padded to multiple of 4 (because of uint32_t)
-    } meas_time_poa_t;
-    // note padding is not transmitted
+    The 40-bit timestamps are combined into integers, the TDoA is a signed
+    41-bit integer (sign and 40-bit magnitude in 2's complement).
     '''
-    if version != 3:
-        raise ValueError('Unsupported version: {}'.format(version))
-
-    toa_blob_format = '< u32 u16 u16 u16 i16 i16 i16 u8 u8 5u8 5u8 u8 5u8 u8 5u8 u8 u8 u8'
-    for k, v in type_mapping.items():
-        toa_blob_format = toa_blob_format.replace(k, v)
-    assert struct.calcsize(toa_blob_format) == 43  # padding not transmitted
-
-    data = base64.b64decode(b64_buffer)
-    unpacked = struct.unpack(toa_blob_format, data)
+    unpacked = _unpack_blob('toa', b64_buffer, version)
 
     decoded = toa_data(
         cia_diag_1=unpacked[0],
@@ -151,30 +177,9 @@ def decode_blob_toa(b64_buffer, version):
 
 
 def decode_blob_cir_analysis(b64_buffer, version):
-    '''Decode the cir analysis struct.
-
-    Version 1:
-    typedef struct
-    {
-    0    uint32_t    peak;         // index and amplitude of peak sample in CIR
-    1    uint32_t    power;        // channel area allows estimation of channel power (note: 32-bit for preamble, 16-bit for STS)
-    2    uint32_t    F1;           // F1
-    3    uint32_t    F2;           // F2
-    4    uint32_t    F3;           // F3
-    5    uint16_t    fp_index;     // First path index
-    6    uint16_t    accum_count;  // Number accumulated symbols
-    } meas_cir_analysis_t;         // 24 bytes, no padding required
-    '''
-    if version != 1:
-        raise ValueError('Unsupported version: {}'.format(version))
-
-    cir_analysis_blob_format = '< u32 u32 u32 u32 u32 u16 u16'
-    for k, v in type_mapping.items():
-        cir_analysis_blob_format = cir_analysis_blob_format.replace(k, v)
-    assert struct.calcsize(cir_analysis_blob_format) == 24
-
-    data = base64.b64decode(b64_buffer)
-    unpacked = list(struct.unpack(cir_analysis_blob_format, data))
+    '''Decode the cir analysis struct (meas_cir_analysis_t, see
+    blob_schema.py).'''
+    unpacked = list(_unpack_blob('cir_analysis', b64_buffer, version))
 
     # fp_index is a [10.6] (ip, IP_FP) or [9.6] (sts, CP_FP) fixed point int
     unpacked[5] /= 64
@@ -213,32 +218,145 @@ def decode_blob_cir(b64_buffer, version):
 
 
 def decode_blob_twr(b64_buffer, version):
-    '''Decode the twr information struct.
+    '''Decode the twr information struct (meas_twr_t, see blob_schema.py).'''
+    unpacked = _unpack_blob('twr', b64_buffer, version)
+
+    decoded = twr_data._make(unpacked)
+
+    return decoded
+
+
+def decode_blob_twr_multi(b64_buffer, version):
+    '''Decode the twr information struct of the broadcast poll ranging
+    (meas_twr_multi_t, see blob_schema.py).'''
+    unpacked = _unpack_blob('twr_multi', b64_buffer, version)
+
+    decoded = twr_multi_data._make(unpacked)
+
+    return decoded
+
+
+def decode_blob_trace(b64_buffer, version):
+    '''Decode the records of a trace blob (use trace_decoder.py to get text).
 
-    Version 2:
+    Version 1:
     typedef struct
     {
-    1    uint64_t Treply1;   // Tag: tx response - rx poll
-    2    uint64_t Treply2;   // Anchor: tx final - rx response
-    3    uint64_t Tround1;   // Anchor: rx response - tx poll
-    4    uint64_t Tround2;   // Tag: rx final - tx response
-    5    uint32_t dist_mm;   // Estimated distance in mm
-    6    uint16_t twr_count; // Counter of TWR ranging exchanges
-    7    uint16_t rotation;  // Rotation in degrees form initial position
-    } meas_twr_t;  // 40 bytes, no padding required
+    1    uint8_t id;       // Format ID (trace_id_t)
+    2    uint8_t nargs;    // Number of valid arguments
+    3    uint16_t tick;    // Lower 16 bits of HAL_GetTick() (ms)
+    4    uint32_t args[3]; // Raw arguments
+    } trace_record_t;  // 16 bytes, no padding required
     '''
-    if version != 2:
+    if version != 1:
         raise ValueError('Unsupported version: {}'.format(version))
 
-    twr_blob_format = '< u64 u64 u64 u64 u32 u16 u16'
+    trace_blob_format = '< u8 u8 u16 u32 u32 u32'
     for k, v in type_mapping.items():
-        twr_blob_format = twr_blob_format.replace(k, v)
-    assert struct.calcsize(twr_blob_format) == 40
+        trace_blob_format = trace_blob_format.replace(k, v)
+    assert struct.calcsize(trace_blob_format) == 16
 
     data = base64.b64decode(b64_buffer)
-    unpacked = struct.unpack(twr_blob_format, data)
+    if len(data) % 16:
+        raise ValueError('Invalid trace blob length: {}'.format(len(data)))
 
-    decoded = twr_data._make(unpacked)
+    decoded = tuple(
+        trace_record(r[0], r[1], r[2], r[3:3+r[1]])
+        for r in struct.iter_unpack(trace_blob_format, data)
+    )
+
+    return decoded
+
+
+def decode_blob_profile(b64_buffer, version):
+    '''Decode the execution time statistics of the profile points.
+
+    Version 1:
+    typedef struct
+    {
+    1    uint32_t clock_hz;      // Core clock (cycles per second)
+    2    uint32_t period_ms;     // Time covered by the statistics
+    3    uint16_t point_count;   // Number of points following
+    4    uint16_t bucket_count;  // Number of histogram buckets of each point
+    } profile_header_t;  // 12 bytes, no padding required
+
+    followed by point_count times:
+    typedef struct
+    {
+    1    uint64_t sum_cycles;    // Sum of all measurements
+    2    uint32_t count;         // Number of measurements
+    3    uint32_t min_cycles;    // Shortest measurement
+    4    uint32_t max_cycles;    // Longest measurement
+    5    uint16_t histogram[bucket_count]; // Bucket 0: < 1 us, b: 2^(b-1) to 2^b us
+    6    uint8_t id;             // Profile point (profile_id_t)
+    7    uint8_t padding[3];
+    } profile_point_t;  // 72 bytes for 24 buckets, no padding required
+    '''
+    if version != 1:
+        raise ValueError('Unsupported version: {}'.format(version))
+
+    header_format = '< u32 u32 u16 u16'
+    for k, v in type_mapping.items():
+        header_format = header_format.replace(k, v)
+    assert struct.calcsize(header_format) == 12
+
+    data = base64.b64decode(b64_buffer)
+    clock_hz, period_ms, point_count, bucket_count = struct.unpack_from(
+        header_format, data)
+
+    point_format = '< u64 u32 u32 u32 ' + 'u16 ' * bucket_count + 'u8 3x'
+    for k, v in type_mapping.items():
+        point_format = point_format.replace(k, v)
+    point_size = struct.calcsize(point_format)
+    if len(data) != 12 + point_count * point_size:
+        raise ValueError('Invalid profile blob length: {}'.format(len(data)))
+
+    points = []
+    for p in struct.iter_unpack(point_format, data[12:]):
+        points.append(profile_point(p[-1], p[1], p[2], p[3], p[0],
+                                    p[4:4 + bucket_count]))
+
+    decoded = profile_data(clock_hz, period_ms, tuple(points))
+
+    return decoded
+
+
+def decode_blob_config(b64_buffer, version):
+    '''Decode the active radio configuration (meas_radio_config_t, see
+    blob_schema.py).'''
+    unpacked = _unpack_blob('config', b64_buffer, version)
+
+    decoded = radio_config_data._make(unpacked)
+
+    return decoded
+
+
+def decode_blob_rotation(b64_buffer, version):
+    '''Decode the turntable angle of a measurement (meas_rotation_t, see
+    blob_schema.py).'''
+    unpacked = _unpack_blob('rotation', b64_buffer, version)
+
+    decoded = rotation_data._make(unpacked)
+
+    return decoded
+
+
+def decode_blob_energy(b64_buffer, version):
+    '''Decode the time spent in each DW3000 state since the last exchange
+    (meas_energy_t, see blob_schema.py).'''
+    unpacked = _unpack_blob('energy', b64_buffer, version)
+
+    decoded = energy_data._make(unpacked)
+
+    return decoded
+
+
+def decode_blob_aoa(b64_buffer, version):
+    '''Decode the angle of arrival computed on the tag (meas_aoa_t, see
+    blob_schema.py).'''
+    unpacked = _unpack_blob('aoa', b64_buffer, version)
+
+    decoded = aoa_data._make(unpacked)
 
     return decoded
 
@@ -251,4 +369,11 @@ decoders = {
     'cir analysis sts2': decode_blob_cir_analysis,
     'cir': decode_blob_cir,
     'twr': decode_blob_twr,
+    'twr multi': decode_blob_twr_multi,
+    'trace': decode_blob_trace,
+    'config': decode_blob_config,
+    'rotation': decode_blob_rotation,
+    'energy': decode_blob_energy,
+    'profile': decode_blob_profile,
+    'aoa': decode_blob_aoa,
 }
@@ -0,0 +1,360 @@
+#!/usr/bin/env python3
+
+
+"""Layout of the fixed size binary measurement blobs (single source).
+
+The firmware structs (`Firmware/Core/Src/apps/measurement_blobs.h`), the
+struct formats of `binary_parser.py` and the NumPy dtypes of the bulk decoders
+are all generated from the `BLOBS` table below. To change a blob, edit its
+entry (increment `version` if the layout changes) and regenerate the header:
+
+    python3 blob_schema.py --write
+
+`--check` exits with an error if the header does not match the schema (e.g.
+after editing the header by hand).
+
+The structs keep the natural alignment of the Cortex-M4. Fields have to be
+ordered such that the compiler does not insert any padding, explicit padding
+fields (named `padding`) fill the struct to a multiple of its alignment. The
+generator refuses layouts with implicit padding and the header checks size and
+offset of every field with `_Static_assert`. Trailing padding is only sent if
+`send_padding` is set.
+
+The variable length blobs (`cir`, `trace`, `profile`) are not described here.
+"""
+
+import os
+import sys
+import struct
+import argparse
+from collections import namedtuple
+
+
+DEFAULT_HEADER_FILE = os.path.normpath(os.path.join(
+    os.path.dirname(os.path.abspath(__file__)),
+    '..', 'Firmware', 'Core', 'Src', 'apps', 'measurement_blobs.h'))
+
+# "readable" type: (C type, struct module code, NumPy type, size)
+types = {
+    'u64': ('uint64_t', 'Q', '<u8', 8),
+    'u32': ('uint32_t', 'L', '<u4', 4),
+    'u16': ('uint16_t', 'H', '<u2', 2),
+    'u8': ('uint8_t', 'B', 'u1', 1),
+    'i32': ('int32_t', 'l', '<i4', 4),
+    'i16': ('int16_t', 'h', '<i2', 2),
+}
+
+Field = namedtuple('Field', 'name type count comment')
+
+Blob = namedtuple('Blob', 'name struct_name version titles send_padding '
+                  'fields')
+
+
+def field(name, type_, comment, count=1):
+    return Field(name, type_, count, comment)
+
+
+BLOBS = (
+    Blob('toa', 'meas_time_poa_t', 3, ('toa',), False, (
+        field('cia_diag_1', 'u32', 'Diagnostics common to both sequences (undocumented CIA_DIAG_1 register)'),
+        field('ip_poa', 'u16', 'Preamble POA'),
+        field('sts1_poa', 'u16', 'POA of STS block 1'),
+        field('sts2_poa', 'u16', 'POA of STS block 2'),
+        field('pdoa', 'i16', 'PDoA from two STS POAs signed int [1:-11] in radians'),
+        field('xtal_offset', 'i16', 'Estimated xtal offset of remote device'),
+        field('sts_qual_index', 'i16', 'STS quality value'),
+        field('sts_qual', 'u8', 'STS quality indicator'),
+        field('tdoa_sign', 'u8', 'TDoA is a signed 41-bit integer, store the sign bit here'),
+        field('tdoa', 'u8', 'TDoA from two STS RX timestamps (40-bit without sign)', 5),
+        field('ip_toa', 'u8', 'Preamble/Ipatov RX timestamp', 5),
+        field('ip_toast', 'u8', 'RX status of preamble'),
+        field('sts1_toa', 'u8', 'STS RX timestamp on antenna 1', 5),
+        field('sts1_toast', 'u8', 'RX status of STS on antenna 1 (only high 8-bits, discarding reserved bit 23 in the register)'),
+        field('sts2_toa', 'u8', 'STS RX timestamp on antenna 2', 5),
+        field('sts2_toast', 'u8', 'RX status of STS on antenna 2 (only high 8-bits, discarding reserved bit 23 in the register)'),
+        field('fp_th_md', 'u8', 'First path threshold test mode'),
+        field('dgc_decision', 'u8', 'DGC decision index (used for RSSI estimation)'),
+        field('padding', 'u8', '43 bytes of data, padded to multiple of 4 (because of uint32_t)', 1),
+    )),
+    Blob('cir_analysis', 'meas_cir_analysis_t', 1,
+         ('cir analysis ip', 'cir analysis sts1', 'cir analysis sts2'), False, (
+        field('peak', 'u32', 'index and amplitude of peak sample in CIR'),
+        field('power', 'u32', 'channel area allows estimation of channel power (note: 32-bit for preamble, 16-bit for STS)'),
+        field('F1', 'u32', 'F1'),
+        field('F2', 'u32', 'F2'),
+        field('F3', 'u32', 'F3'),
+        field('fp_index', 'u16', 'First path index'),
+        field('accum_count', 'u16', 'Number accumulated symbols'),
+    )),
+    Blob('twr', 'meas_twr_t', 2, ('twr',), False, (
+        field('Treply1', 'u64', 'Tag: tx response - rx poll'),
+        field('Treply2', 'u64', 'Anchor: tx final - rx response'),
+        field('Tround1', 'u64', 'Anchor: rx response - tx poll'),
+        field('Tround2', 'u64', 'Tag: rx final - tx response'),
+        field('dist_mm', 'u32', 'Estimated distance in mm'),
+        field('twr_count', 'u16', 'Counter of TWR ranging exchanges'),
+        field('rotation', 'u16', 'Rotation in degrees from initial position'),
+    )),
+    Blob('twr_multi', 'meas_twr_multi_t', 1, ('twr multi',), True, (
+        field('Tround1', 'u64', 'Tag: rx response - tx poll'),
+        field('Treply2', 'u64', 'Tag: tx final - rx response'),
+        field('last_dist_mm', 'u32', 'Distance estimated by the anchor in the previous exchange'),
+        field('twr_count', 'u16', 'Counter of TWR ranging exchanges'),
+        field('slot', 'u8', 'Response slot of the anchor'),
+        field('padding', 'u8', '23 bytes of data, padded to multiple of 8 (because of uint64_t)', 1),
+    )),
+    Blob('config', 'meas_radio_config_t', 1, ('config',), False, (
+        field('preamble_length', 'u16', 'Preamble length in symbols'),
+        field('sfd_timeout', 'u16', 'SFD timeout in symbols'),
+        field('sts_length', 'u16', 'STS length in symbols'),
+        field('config_count', 'u16', 'Incremented with every applied configuration'),
+        field('channel', 'u8', 'Channel number (5 or 9)'),
+        field('pac', 'u8', 'Preamble acquisition chunk size in symbols'),
+        field('tx_code', 'u8', 'TX preamble code'),
+        field('rx_code', 'u8', 'RX preamble code'),
+        field('sfd_type', 'u8', 'SFD type (0-3)'),
+        field('data_rate', 'u8', 'Data rate (DWT_BR_850K or DWT_BR_6M8)'),
+        field('phr_mode', 'u8', 'PHY header mode (DWT_PHRMODE_*)'),
+        field('phr_rate', 'u8', 'PHY header rate (DWT_PHRRATE_*)'),
+        field('sts_mode', 'u8', 'STS mode (DWT_STS_MODE_*, including DWT_STS_MODE_SDC)'),
+        field('pdoa_mode', 'u8', 'PDoA mode (0, 1 or 3)'),
+    )),
+    Blob('rotation', 'meas_rotation_t', 1, ('rotation',), False, (
+        field('angle_mdeg', 'i32', 'Turntable angle interpolated between motor steps in millidegrees (not wrapped)'),
+        field('steps', 'i32', 'Motor position in steps'),
+        field('tick_ms', 'u32', 'HAL_GetTick() when the angle was sampled'),
+        field('twr_count', 'u16', 'Counter of TWR ranging exchanges'),
+        field('rate', 'i16', 'Commanded rotation rate in degrees/s (0: one angle after the other)'),
+    )),
+    Blob('energy', 'meas_energy_t', 1, ('energy',), False, (
+        field('sleep_us', 'u32', 'DW3000 in DEEPSLEEP'),
+        field('wake_us', 'u32', 'DW3000 waking up and restoring its configuration'),
+        field('idle_us', 'u32', 'DW3000 idle (PLL locked)'),
+        field('tx_us', 'u32', 'Immediate TX from start until TX done'),
+        field('tx_delayed_us', 'u32', 'Delayed TX from start until TX done (includes the wait in idle)'),
+        field('rx_us', 'u32', 'Receiver on'),
+        field('mcu_stop_us', 'u32', 'STM32 in STOP mode (running otherwise)'),
+        field('latency_us', 'u32', 'From the wake up request to the first TX (0 without sleep)'),
+        field('twr_count', 'u16', 'Counter of TWR ranging exchanges'),
+        field('tx_count', 'u8', 'Number of immediate transmissions'),
+        field('tx_delayed_count', 'u8', 'Number of delayed transmissions'),
+    )),
+    Blob('aoa', 'meas_aoa_t', 2, ('aoa',), True, (
+        field('angle_mdeg', 'i32', 'Filtered angle of arrival in millidegrees (0: broadside)'),
+        field('pdoa', 'i16', 'Filtered PDoA after the board offset correction [1:-11] radians'),
+        field('pdoa_raw', 'i16', 'Last PDoA reported by the DW3000 [1:-11] radians'),
+        field('dist_mm', 'u32', 'Estimated distance of the exchange in mm'),
+        field('rx_power_cdbm', 'i16', 'Receive power level of the last frame in 0.01 dBm (INT16_MIN: invalid)'),
+        field('fp_power_cdbm', 'i16', 'First path power level of the last frame in 0.01 dBm (INT16_MIN: invalid)'),
+        field('twr_count', 'u16', 'Counter of TWR ranging exchanges'),
+        field('flags', 'u8', 'AOA_FLAG_* since the previous blob'),
+        field('padding', 'u8', '19 bytes of data, padded to multiple of 4 (because of uint32_t)', 1),
+    )),
+)
+
+blobs = {blob.name: blob for blob in BLOBS}
+
+# blob type (title in the log) to schema
+blobs_by_title = {title: blob for blob in BLOBS for title in blob.titles}
+
+
+def offsets(blob):
+    '''Offset of each field, checks that the compiler adds no padding.'''
+    result = []
+    offset = 0
+    for f in blob.fields:
+        size = types[f.type][3]
+        if offset % size:
+            raise ValueError(f'{blob.struct_name}.{f.name}: offset {offset} '
+                             f'is not aligned, reorder or add padding')
+        result.append(offset)
+        offset += size * f.count
+    return result
+
+
+def struct_size(blob):
+    '''sizeof() of the C struct.'''
+    alignment = max(types[f.type][3] for f in blob.fields)
+    size = offsets(blob)[-1] + types[blob.fields[-1].type][3] * blob.fields[-1].count
+    if size % alignment:
+        raise ValueError(f'{blob.struct_name}: size {size} is not a multiple '
+                         f'of {alignment}, add padding')
+    return size
+
+
+def transmitted_size(blob):
+    '''Number of bytes in the blob (the trailing padding is optional).'''
+    if not blob.send_padding and blob.fields[-1].name == 'padding':
+        return offsets(blob)[-1]
+    return struct_size(blob)
+
+
+def struct_format(blob):
+    '''Format of the transmitted bytes for the struct module (padding is
+    skipped, arrays are unpacked as separate items).'''
+    fmt = '<'
+    for f in blob.fields[:len(transmitted_fields(blob))]:
+        fmt += f'{f.count if f.count > 1 else ""}{types[f.type][1]}'
+    if blob.send_padding and blob.fields[-1].name == 'padding':
+        fmt += 'x' * blob.fields[-1].count
+    assert struct.calcsize(fmt) == transmitted_size(blob)
+    return fmt
+
+
+def transmitted_fields(blob):
+    '''Fields of the blob without padding.'''
+    return tuple(f for f in blob.fields if f.name != 'padding')
+
+
+def numpy_dtype(blob):
+    '''Structured NumPy dtype of one transmitted blob (padding excluded,
+    arrays as subarrays).'''
+    import numpy as np
+
+    fields = transmitted_fields(blob)
+    return np.dtype({
+        'names': [f.name for f in fields],
+        'formats': [(types[f.type][2], (f.count,)) if f.count > 1
+                    else types[f.type][2] for f in fields],
+        'offsets': offsets(blob)[:len(fields)],
+        'itemsize': transmitted_size(blob),
+    })
+
+
+def _tabs(column, target):
+    '''Tabs (width 4) to move from column to target (at least one).'''
+    tabs = 1
+    column = (column // 4 + 1) * 4
+    while column < target:
+        column += 4
+        tabs += 1
+    return '\t' * tabs
+
+
+def _macro_name(name):
+    return name.upper()
+
+
+def generate_c_struct(blob):
+    declarations = []
+    for f in blob.fields:
+        ctype = types[f.type][0]
+        name = f'{f.name}[{f.count}];' if f.count > 1 or f.name == 'padding' \
+            else f'{f.name};'
+        declarations.append((ctype, name, f.comment))
+
+    # same alignment as the hand written structs: type column at 16, comment
+    # column after the longest name
+    name_column = 16
+    comment_column = max(name_column + len(name) for _, name, _ in declarations)
+    comment_column = (comment_column // 4 + 1) * 4
+
+    size = struct_size(blob)
+    if size == transmitted_size(blob):
+        padding = 'padding is transmitted' if blob.send_padding else \
+            'no padding required'
+        size_comment = f'{size} bytes, {padding}' if not blob.send_padding else \
+            f'with padding {size} bytes ({padding})'
+    else:
+        size_comment = f'with padding {size} bytes'
+
+    lines = ['typedef struct', '{', f'\t// Version {blob.version}']
+    for ctype, name, comment in declarations:
+        lines.append(f'\t{ctype}{_tabs(4 + len(ctype), name_column)}{name}'
+                     f'{_tabs(name_column + len(name), comment_column)}'
+                     f'// {comment}')
+    lines.append(f'}} {blob.struct_name};  // {size_comment}')
+    lines.append('')
+
+    prefix = _macro_name(blob.name)
+    defines = [(f'{prefix}_BLOB_VERSION', f'({blob.version})'),
+               (f'{prefix}_BLOB_SIZE',
+                f'({transmitted_size(blob)})\t/* transmitted bytes */')]
+    for title in blob.titles:
+        header = f'BLOB / {title} / v{blob.version} / {transmitted_size(blob)}'
+        defines.append((f'{_macro_name(title.replace(" ", "_"))}_BLOB_HEADER',
+                        f'"{header}\\n"'))
+    value_column = max(len('#define ') + len(name) for name, _ in defines)
+    value_column = (value_column // 4 + 1) * 4
+    for name, value in defines:
+        lines.append(f'#define {name}'
+                     f'{_tabs(len("#define ") + len(name), value_column)}{value}')
+    lines.append('')
+
+    lines.append(f'_Static_assert(sizeof({blob.struct_name}) == {size}, '
+                 f'"{blob.struct_name} size");')
+    for f, offset in zip(blob.fields, offsets(blob)):
+        lines.append(f'_Static_assert(offsetof({blob.struct_name}, {f.name}) '
+                     f'== {offset}, "{blob.struct_name} layout");')
+    return '\n'.join(lines)
+
+
+def generate_c_header():
+    parts = [
+        '/*',
+        ' * measurement_blobs.h',
+        ' *',
+        ' * Generated by Scripts/blob_schema.py, do not edit. Change the schema and run',
+        ' * "python3 blob_schema.py --write" in the Scripts directory.',
+        ' */',
+        '',
+        '#ifndef SRC_APPS_MEASUREMENT_BLOBS_H_',
+        '#define SRC_APPS_MEASUREMENT_BLOBS_H_',
+        '',
+        '#include <stddef.h>',
+        '#include <stdint.h>',
+        '',
+        '/* Binary measurement data structures',
+        ' *',
+        ' * Transmitted as "<BLOB_HEADER><BLOB_SIZE bytes of the struct>\\n" (the trailing padding is not',
+        ' * transmitted unless noted).',
+        ' */',
+        '',
+    ]
+    for blob in BLOBS:
+        parts.append(generate_c_struct(blob))
+        parts.append('')
+        parts.append('')
+    parts[-1] = '#endif /* SRC_APPS_MEASUREMENT_BLOBS_H_ */'
+    parts.append('')
+    return '\n'.join(parts)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--header-file', default=DEFAULT_HEADER_FILE,
+                        help='Generated C header')
+    action = parser.add_mutually_exclusive_group()
+    action.add_argument('--write', action='store_true',
+                        help='Write the C header')
+    action.add_argument('--check', action='store_true',
+                        help='Exit with an error if the C header is outdated')
+
+    args = parser.parse_args()
+    header = generate_c_header()
+
+    if args.write:
+        with open(args.header_file, 'w') as f:
+            f.write(header)
+        print(f'Wrote {args.header_file}')
+    elif args.check:
+        try:
+            with open(args.header_file) as f:
+                current = f.read()
+        except FileNotFoundError:
+            current = None
+        if current != header:
+            print(f'{args.header_file} does not match the schema, run '
+                  'blob_schema.py --write')
+            sys.exit(1)
+        print(f'{args.header_file} is up to date')
+    else:
+        for blob in BLOBS:
+            print(f'{blob.struct_name} v{blob.version}: '
+                  f'{transmitted_size(blob)} bytes, {struct_format(blob)}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+
+
+"""Decode all fixed size blobs of a log into NumPy structured arrays.
+
+`binary_parser.py` decodes one blob at a time into a namedtuple. For a full
+measurement (tens of thousands of exchanges) that is dominated by Python
+calls per blob and per field. This module collects the raw bytes of all blobs
+of a type, interprets them with the dtype of `blob_schema.py` (`np.frombuffer`,
+no copy) and converts the fields in bulk:
+
+- 40-bit timestamps (`uint8_t x[5]`) are combined into int64
+- a `<name>_sign` byte makes the 40-bit `<name>` a signed 41-bit integer
+  (TDoA)
+- the first path index of the CIR analysis is converted to float (/64)
+
+The CIR blobs are decoded into 2-D complex64 arrays with `decode_cir_blobs()`.
+
+The resulting arrays have the same field names and values as the namedtuples
+of `binary_parser.py`, plus the field `frame`: the index of the frame the blob
+belongs to (number of "New Frame" lines before the blob minus one, -1 before
+the first frame).
+
+Usage:
+    blobs = read_log_blobs('measurement.log')
+    toa = blobs['toa']              # structured array, one row per blob
+    pdoa = toa['pdoa'] / 2**11
+
+Run as script to compare the run time with the per blob decoders.
+"""
+
+import time
+import gzip
+import base64
+import binascii
+import argparse
+
+import numpy as np
+
+import blob_schema
+import binary_parser
+
+
+FORTY_BIT_MASK = 2**40
+
+# CIR blob: complex samples of 3 byte real and 3 byte imaginary part, split
+# like binary_parser.decode_blob_cir (c.f. user manual page 229ff)
+CIR_BLOB_SIZE = 12288
+CIR_BYTES_PER_SAMPLE = 6
+CIR_PARTS = {
+    'cir_ip': (0, 1016),  # 64MHz PRF
+    'cir_sts1': (1024, 512),
+    'cir_sts2': (1536, 512),
+}
+CIR_DECODE_CHUNK = 256  # blobs per step, limits the temporary arrays
+
+# fields converted to float with the given scale
+SCALED_FIELDS = {
+    ('cir_analysis', 'fp_index'): 1 / 64,  # [10.6] or [9.6] fixed point
+}
+
+
+def _is_40bit(f):
+    return f.type == 'u8' and f.count == 5
+
+
+def decoded_dtype(blob):
+    '''dtype of the decoded array of a blob (aligned, converted fields).'''
+    fields = blob_schema.transmitted_fields(blob)
+    names = {f.name for f in fields}
+    descr = [('frame', '<i4')]
+    for f in fields:
+        if f.name.endswith('_sign') and f.name[:-5] in names:
+            continue  # merged into the signed value
+        if (blob.name, f.name) in SCALED_FIELDS:
+            descr.append((f.name, '<f8'))
+        elif _is_40bit(f):
+            descr.append((f.name, '<i8'))
+        elif f.count > 1:
+            descr.append((f.name, blob_schema.types[f.type][2], (f.count,)))
+        else:
+            descr.append((f.name, blob_schema.types[f.type][2]))
+    return np.dtype(descr)
+
+
+def combine_40bit(data):
+    '''Combine an (n, 5) array of little endian bytes into int64.'''
+    padded = np.zeros((len(data), 8), dtype=np.uint8)
+    padded[:, :5] = data
+    return padded.view('<i8')[:, 0]
+
+
+def decode_blobs(title, data, frames=None):
+    '''Decode the concatenated bytes of all blobs of one type.
+
+    `title` is the blob type of the log (e.g. 'toa', 'cir analysis ip'),
+    `data` the concatenated raw blobs (bytes) and `frames` the frame index of
+    each blob (default -1).
+    '''
+    blob = blob_schema.blobs_by_title[title]
+    raw = np.frombuffer(data, dtype=blob_schema.numpy_dtype(blob))
+    decoded = np.empty(len(raw), dtype=decoded_dtype(blob))
+    decoded['frame'] = -1 if frames is None else frames
+
+    for f in blob_schema.transmitted_fields(blob):
+        if f.name not in decoded.dtype.names:
+            continue
+        if (blob.name, f.name) in SCALED_FIELDS:
+            decoded[f.name] = raw[f.name] * SCALED_FIELDS[(blob.name, f.name)]
+        elif _is_40bit(f):
+            value = combine_40bit(raw[f.name])
+            sign = f.name + '_sign'
+            if sign in raw.dtype.names:
+                # sign and 40-bit magnitude in 2's complement
+                value -= (raw[sign] != 0).astype(np.int64) * FORTY_BIT_MASK
+            decoded[f.name] = value
+        else:
+            decoded[f.name] = raw[f.name]
+
+    return decoded
+
+
+def decode_24bit(data):
+    '''Decode little endian signed 24-bit integers (last axis of size 3).
+
+    The values fit into float32 without rounding.
+    '''
+    data = data.astype(np.int32)
+    value = data[..., 0] | (data[..., 1] << 8) | (data[..., 2] << 16)
+    return (value ^ 0x800000) - 0x800000
+
+
+def decode_cir_blobs(data):
+    '''Decode the concatenated bytes of CIR blobs.
+
+    Returns a dict {'cir_ip': array, 'cir_sts1': array, 'cir_sts2': array}
+    of complex64 arrays with one row per blob.
+    '''
+    raw = np.frombuffer(data, dtype=np.uint8).reshape(-1, CIR_BLOB_SIZE)
+    decoded = {name: np.empty((len(raw), length), dtype=np.complex64)
+               for name, (_, length) in CIR_PARTS.items()}
+
+    for start in range(0, len(raw), CIR_DECODE_CHUNK):
+        chunk = raw[start:start + CIR_DECODE_CHUNK]
+        for name, (offset, length) in CIR_PARTS.items():
+            samples = chunk[:, offset * CIR_BYTES_PER_SAMPLE:
+                            (offset + length) * CIR_BYTES_PER_SAMPLE]
+            values = decode_24bit(samples.reshape(len(chunk), length, 2, 3))
+            out = decoded[name][start:start + len(chunk)]
+            out.real = values[..., 0]
+            out.imag = values[..., 1]
+
+    return decoded
+
+
+def iter_log_lines(log_file):
+    log_open = gzip.open if log_file.endswith('.gz') else open
+    with log_open(log_file, 'rt') as f:
+        yield from f
+
+
+def collect_blobs(lines, titles=None):
+    '''Collect the raw bytes of all fixed size blobs.
+
+    Returns a dict {title: (version, list of bytes, list of frame indices)}.
+    Blobs with an unsupported version or invalid data are skipped with a
+    message.
+    '''
+    titles = set(blob_schema.blobs_by_title if titles is None else titles)
+    sizes = {title: blob_schema.transmitted_size(blob)
+             for title, blob in blob_schema.blobs_by_title.items()}
+    collected = {}
+    frame = -1
+    expect = None  # (title, version) of the header in the previous line
+    for line in lines:
+        if expect is not None:
+            title, version = expect
+            expect = None
+            try:
+                data = binascii.a2b_base64(line.split(':', 2)[2])
+            except (IndexError, ValueError) as e:
+                print(f'Error decoding blob ({e}). Line: {line}')
+                continue
+            if len(data) != sizes[title]:
+                print(f'Invalid blob length {len(data)}. Line: {line}')
+                continue
+            entry = collected.setdefault(title, (version, [], []))
+            entry[1].append(data)
+            entry[2].append(frame)
+        elif 'BLOB /' in line:
+            try:
+                header = line.split('/')
+                title = header[1].strip()
+                version = int(header[2].strip()[1:])
+            except (IndexError, ValueError):
+                print(f'Error decoding blob. Line: {line}')
+                continue
+            if title not in titles:
+                continue
+            if version != blob_schema.blobs_by_title[title].version:
+                print(f'Unsupported version: {version}. Line: {line}')
+                continue
+            expect = (title, version)
+        elif 'New Frame' in line:
+            frame += 1
+    return collected
+
+
+def read_blobs(lines, titles=None):
+    '''Decode all fixed size blobs of the given log lines.
+
+    Returns a dict {title: structured array}.
+    '''
+    return {title: decode_blobs(title, b''.join(data), frames)
+            for title, (_, data, frames) in collect_blobs(lines, titles).items()}
+
+
+def read_log_blobs(log_file, titles=None):
+    '''Decode all fixed size blobs of a log file (optionally gzip compressed).
+
+    `titles` limits the decoded blob types (default: all in blob_schema.py).
+    Returns a dict {title: structured array}.
+    '''
+    return read_blobs(iter_log_lines(log_file), titles)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('log_file', help='Log file written by serial_reader.py')
+
+    args = parser.parse_args()
+
+    lines = list(iter_log_lines(args.log_file))
+
+    start = time.perf_counter()
+    collected = collect_blobs(lines)
+    collect_time = time.perf_counter() - start
+    start = time.perf_counter()
+    arrays = {title: decode_blobs(title, b''.join(data), frames)
+              for title, (_, data, frames) in collected.items()}
+    bulk_time = time.perf_counter() - start
+
+    encoded = {title: (version, [base64.b64encode(d) for d in data])
+               for title, (version, data, _) in collected.items()}
+    start = time.perf_counter()
+    for title, (version, data) in encoded.items():
+        decoder = binary_parser.decoders[title]
+        for d in data:
+            decoder(d, version)
+    single_time = time.perf_counter() - start
+
+    for title, array in arrays.items():
+        print(f'{title}: {len(array)} blobs')
+    print(f'collect (read lines, base64): {collect_time:.3f} s')
+    print(f'bulk decoding: {bulk_time:.3f} s')
+    print(f'per blob decoding (binary_parser): {single_time:.3f} s')
+
+
+if __name__ == '__main__':
+    main()
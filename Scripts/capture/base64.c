@@ -0,0 +1,77 @@
+/*
+ * base64.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "base64.h"
+
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64_encode(const uint8_t *data, size_t length, char *out)
+{
+	char *next = out;
+	size_t i = 0;
+
+	for (; i + 3 <= length; i += 3) {
+		const uint32_t word = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+		*next++ = alphabet[(word >> 18) & 0x3F];
+		*next++ = alphabet[(word >> 12) & 0x3F];
+		*next++ = alphabet[(word >> 6) & 0x3F];
+		*next++ = alphabet[word & 0x3F];
+	}
+	if (i < length) {
+		const uint32_t word = ((uint32_t)data[i] << 16) | ((i + 1 < length) ? ((uint32_t)data[i + 1] << 8) : 0);
+		*next++ = alphabet[(word >> 18) & 0x3F];
+		*next++ = alphabet[(word >> 12) & 0x3F];
+		*next++ = (i + 1 < length) ? alphabet[(word >> 6) & 0x3F] : '=';
+		*next++ = '=';
+	}
+	return next - out;
+}
+
+static int decode_char(char c)
+{
+	if (c >= 'A' && c <= 'Z') {
+		return c - 'A';
+	} else if (c >= 'a' && c <= 'z') {
+		return c - 'a' + 26;
+	} else if (c >= '0' && c <= '9') {
+		return c - '0' + 52;
+	} else if (c == '+') {
+		return 62;
+	} else if (c == '/') {
+		return 63;
+	}
+	return -1;
+}
+
+long base64_decode(const char *text, size_t length, uint8_t *out)
+{
+	uint8_t *next = out;
+
+	if (length % 4 != 0) {
+		return -1;
+	}
+	for (size_t i = 0; i < length; i += 4) {
+		const int last = (i + 4 == length);
+		const int padding = last ? ((text[i + 3] == '=') + (text[i + 2] == '=')) : 0;
+		uint32_t word = 0;
+
+		for (int j = 0; j < 4 - padding; j++) {
+			const int value = decode_char(text[i + j]);
+			if (value < 0) {
+				return -1;
+			}
+			word |= (uint32_t)value << (18 - 6 * j);
+		}
+		*next++ = word >> 16;
+		if (padding < 2) {
+			*next++ = (word >> 8) & 0xFF;
+		}
+		if (padding < 1) {
+			*next++ = word & 0xFF;
+		}
+	}
+	return next - out;
+}
@@ -0,0 +1,24 @@
+/*
+ * base64.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BASE64_H_
+#define BASE64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Encoded length of n bytes (with padding, without terminator) */
+#define BASE64_ENCODED_LENGTH(n) ((((n) + 2) / 3) * 4)
+
+/* Encode length bytes to out (BASE64_ENCODED_LENGTH(length) chars, not terminated), returns the
+ * number of chars */
+size_t base64_encode(const uint8_t *data, size_t length, char *out);
+
+/* Decode length chars to out (at most length / 4 * 3 bytes), returns the number of bytes or -1 for
+ * invalid input */
+long base64_decode(const char *text, size_t length, uint8_t *out);
+
+#endif /* BASE64_H_ */
@@ -0,0 +1,125 @@
+/*
+ * framer.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "framer.h"
+
+void framer_init(framer_t *framer)
+{
+	framer->length = 0;
+	framer->resync = 0;
+	framer->dropped_lines = 0;
+}
+
+void framer_reset(framer_t *framer)
+{
+	framer->length = 0;
+	framer->resync = 1;
+}
+
+uint8_t *framer_space(framer_t *framer, size_t *size)
+{
+	*size = FRAMER_BUFFER_SIZE - framer->length;
+	return framer->buffer + framer->length;
+}
+
+/* Strip the line start..end-1, returns the start (stop at the end) or NULL if empty or not
+ * printable */
+static char *clean_line(uint8_t *start, uint8_t *end, uint8_t **stop)
+{
+	while (start < end && (*start == ' ' || (*start >= '\t' && *start <= '\r'))) {
+		start++;
+	}
+	while (end > start && (end[-1] == ' ' || (end[-1] >= '\t' && end[-1] <= '\r'))) {
+		end--;
+	}
+	if (start == end) {
+		return NULL;
+	}
+	for (const uint8_t *c = start; c < end; c++) {
+		if (*c < 0x20 || *c > 0x7E) {
+			return NULL;
+		}
+	}
+	*stop = end;
+	return (char *)start;
+}
+
+/* Length of the blob announced by a header line, -1 if the line is no valid header */
+static long blob_length(const char *line)
+{
+	const char *header = strstr(line, "BLOB");
+	unsigned int version;
+	unsigned long length;
+	int end = 0;
+
+	if (header == NULL) {
+		return -1;
+	}
+	if (sscanf(header, "BLOB /%*[^/]/ v%u / %lu%n", &version, &length, &end) != 2 || header[end] != '\0'
+			|| length > FRAMER_MAX_BLOB_LENGTH) {
+		return -1;
+	}
+	return (long)length;
+}
+
+void framer_commit(framer_t *framer, size_t count, framer_record_cb record, void *context)
+{
+	uint8_t *const buffer = framer->buffer;
+	size_t start = 0;
+
+	framer->length += count;
+	while (start < framer->length) {
+		uint8_t *const newline = memchr(buffer + start, '\n', framer->length - start);
+		if (newline == NULL) {
+			if (framer->length - start > FRAMER_MAX_LINE_LENGTH) {
+				framer->dropped_lines++;
+				framer->resync = 1;
+				start = framer->length;
+			}
+			break;
+		}
+
+		const size_t line_end = newline - buffer;
+		uint8_t *stop;
+		char *const line = clean_line(buffer + start, newline, &stop);
+		if (line_end - start > FRAMER_MAX_LINE_LENGTH) {
+			framer->dropped_lines++;
+			framer->resync = 1;
+			start = line_end + 1;
+			continue;
+		}
+		if (line == NULL) {
+			start = line_end + 1;
+			continue;
+		}
+		const uint8_t stop_char = *stop;
+		*stop = '\0';
+
+		const long length = blob_length(line);
+		if (length >= 0) {
+			if (line_end + 1 + length > framer->length) {
+				/* header is parsed again with the rest of the blob */
+				*stop = stop_char;
+				break;
+			}
+			framer->resync = 0;
+			record(context, line, buffer + line_end + 1, length);
+			start = line_end + 1 + length;
+			continue;
+		}
+
+		if (!framer->resync) {
+			record(context, line, NULL, 0);
+		}
+		start = line_end + 1;
+	}
+
+	memmove(buffer, buffer + start, framer->length - start);
+	framer->length -= start;
+}
@@ -0,0 +1,48 @@
+/*
+ * framer.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FRAMER_H_
+#define FRAMER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Splits the byte stream of a UWB module into text lines and blobs, like StreamFramer of
+ * serial_reader.py: a blob header line "BLOB / title / v1 / length" is followed by length raw
+ * bytes. Lines are stripped, empty lines and lines that are not printable ASCII are skipped. Header
+ * lines that cannot be parsed (or announce more than FRAMER_MAX_BLOB_LENGTH bytes) are text lines.
+ *
+ * The data is read directly into the buffer of the framer (framer_space, framer_commit), the
+ * records point into the buffer and are only valid during the callback.
+ */
+
+#define FRAMER_MAX_LINE_LENGTH	(1024)		/* longer lines are dropped, then resync */
+#define FRAMER_MAX_BLOB_LENGTH	(65536)		/* as MAX_BLOB_LENGTH of serial_reader.py */
+#define FRAMER_BUFFER_SIZE		(2 * (FRAMER_MAX_LINE_LENGTH + FRAMER_MAX_BLOB_LENGTH))
+
+/* line is terminated, blob is NULL for a text line */
+typedef void (*framer_record_cb)(void *context, const char *line, const uint8_t *blob, size_t blob_length);
+
+typedef struct {
+	uint8_t buffer[FRAMER_BUFFER_SIZE];
+	size_t length;
+	int resync;				/* skip everything up to the next blob header */
+	uint64_t dropped_lines;	/* overlong lines */
+} framer_t;
+
+void framer_init(framer_t *framer);
+
+/* Discard the incomplete record after lost data, the data continues anywhere (e.g. inside the raw
+ * bytes of a blob) */
+void framer_reset(framer_t *framer);
+
+/* Free space to read into (at least FRAMER_BUFFER_SIZE / 2 bytes) */
+uint8_t *framer_space(framer_t *framer, size_t *size);
+
+/* Process count bytes read into the free space, calls record for every completed record */
+void framer_commit(framer_t *framer, size_t count, framer_record_cb record, void *context);
+
+#endif /* FRAMER_H_ */
@@ -0,0 +1,315 @@
+/*
+ * log_replay.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Stand-in for UWB modules: replays recorded logs of serial_reader.py (or raw captures with --raw)
+ * on ptys at the byte rate of the serial link. Every file is replayed on --copies ptys, pty i is
+ * reachable as PREFIXi (--link). The output is paced like a UART that does not wait for the
+ * reader: if the pty buffer is full the pty falls behind, the lag is reported at the end.
+ *
+ * Example: ./log_replay --copies 4 --link /tmp/uwb run1.log &
+ *          ./uwb_capture --no-reconnect --output replayed /tmp/uwb0 /tmp/uwb1 /tmp/uwb2 /tmp/uwb3
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "base64.h"
+
+#define MAX_PTYS			(64)
+#define DEFAULT_BAUDRATE	(2250000)
+#define BITS_PER_BYTE		(10)		/* 8N1 */
+#define WRITE_CHUNK			(4096)
+#define STEP_NS				(1000000)	/* 1 ms */
+#define DRAIN_TIMEOUT_S		(5.0)
+#define PATH_LENGTH			(256)
+
+typedef struct {
+	uint8_t *data;
+	size_t length;
+} stream_t;
+
+typedef struct {
+	const stream_t *stream;
+	int master;
+	int slave;				/* kept open, the pty stays configured until the reader opens it */
+	char link[PATH_LENGTH];
+	size_t sent;			/* of all repeats */
+	double finish_time;
+	double max_lag_s;
+} pty_t;
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [options] FILE...\n"
+			"  --copies N         ptys per file (default 1)\n"
+			"  --repeat N         replay every file N times (default 1)\n"
+			"  --link PREFIX      create symlinks PREFIX0, PREFIX1, ... to the ptys\n"
+			"  --baud N           byte rate as of a serial link with N baud (default %u)\n"
+			"  --delay S          wait S seconds before the replay (default 1)\n"
+			"  --raw              the files are raw captures, not logs\n",
+			name, DEFAULT_BAUDRATE);
+}
+
+static double monotonic_s(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static uint8_t *read_file(const char *path, size_t *length)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+		exit(1);
+	}
+	fseek(file, 0, SEEK_END);
+	*length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	uint8_t *data = malloc(*length + 1);
+	if (data == NULL || fread(data, 1, *length, file) != *length) {
+		fprintf(stderr, "Cannot read %s\n", path);
+		exit(1);
+	}
+	fclose(file);
+	data[*length] = '\0';
+	return data;
+}
+
+/* Byte stream of the module from a log: the timestamps are removed, "Data:" lines are decoded to
+ * the raw blob bytes (followed by a newline as sent by the firmware) and the lines written by
+ * serial_reader.py itself are skipped. The stream is built in place, it is never longer than the
+ * log. */
+static size_t log_to_stream(uint8_t *log, size_t length)
+{
+	static const char *const reader_lines[] = { "Logging started at:", "Logging finished at:", "Command:",
+			"Serial data lost:" };
+	uint8_t *out = log;
+	char *line = (char *)log;
+	char *const end = (char *)log + length;
+
+	while (line < end) {
+		char *newline = memchr(line, '\n', end - line);
+		if (newline == NULL) {
+			newline = end;
+		}
+		char *text = memmem(line, newline - line, ": ", 2);
+		const char *next = newline + 1;
+
+		if (text != NULL) {
+			text += 2;
+			size_t text_length = newline - text;
+			while (text_length > 0 && (text[text_length - 1] == '\r' || text[text_length - 1] == ' ')) {
+				text_length--;
+			}
+
+			int skip = 0;
+			for (size_t i = 0; i < sizeof(reader_lines) / sizeof(reader_lines[0]); i++) {
+				skip |= (strncmp(text, reader_lines[i], strlen(reader_lines[i])) == 0);
+			}
+
+			if (!skip && text_length >= 6 && strncmp(text, "Data: ", 6) == 0) {
+				/* at most 3/4 of the base64 text, decoding in place is safe */
+				const long count = base64_decode(text + 6, text_length - 6, out);
+				if (count < 0) {
+					fprintf(stderr, "Invalid blob data: %.60s\n", text);
+				} else {
+					out += count;
+					*out++ = '\n';
+				}
+			} else if (!skip) {
+				memmove(out, text, text_length);
+				out += text_length;
+				*out++ = '\n';
+			}
+		}
+		line = (char *)next;
+	}
+	return out - log;
+}
+
+static void open_pty(pty_t *pty, const char *link_prefix, int index)
+{
+	struct termios tio;
+
+	pty->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (pty->master < 0 || grantpt(pty->master) < 0 || unlockpt(pty->master) < 0) {
+		perror("posix_openpt");
+		exit(1);
+	}
+	const char *slave_path = ptsname(pty->master);
+	pty->slave = open(slave_path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if (pty->slave < 0 || tcgetattr(pty->slave, &tio) < 0) {
+		perror(slave_path);
+		exit(1);
+	}
+	cfmakeraw(&tio);
+	tcsetattr(pty->slave, TCSANOW, &tio);
+
+	pty->link[0] = '\0';
+	if (link_prefix != NULL) {
+		snprintf(pty->link, sizeof(pty->link), "%s%d", link_prefix, index);
+		unlink(pty->link);
+		if (symlink(slave_path, pty->link) < 0) {
+			perror(pty->link);
+			exit(1);
+		}
+	}
+	printf("pty %d: %s%s%s\n", index, slave_path, pty->link[0] ? " <- " : "", pty->link);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[] = {
+			{ "copies", required_argument, NULL, 'n' },
+			{ "repeat", required_argument, NULL, 'r' },
+			{ "link", required_argument, NULL, 'l' },
+			{ "baud", required_argument, NULL, 'b' },
+			{ "delay", required_argument, NULL, 'd' },
+			{ "raw", no_argument, NULL, 'w' },
+			{ "help", no_argument, NULL, 'h' },
+			{ NULL, 0, NULL, 0 },
+	};
+
+	static stream_t streams[MAX_PTYS];
+	static pty_t ptys[MAX_PTYS];
+	int copies = 1;
+	int repeat = 1;
+	const char *link_prefix = NULL;
+	uint32_t baudrate = DEFAULT_BAUDRATE;
+	double delay = 1.0;
+	int raw = 0;
+
+	int option;
+	while ((option = getopt_long(argc, argv, "n:r:l:b:d:wh", long_options, NULL)) != -1) {
+		switch (option) {
+		case 'n':
+			copies = atoi(optarg);
+			break;
+		case 'r':
+			repeat = atoi(optarg);
+			break;
+		case 'l':
+			link_prefix = optarg;
+			break;
+		case 'b':
+			baudrate = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			delay = strtod(optarg, NULL);
+			break;
+		case 'w':
+			raw = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return (option == 'h') ? 0 : 2;
+		}
+	}
+	const int file_count = argc - optind;
+	const int pty_count = file_count * copies;
+	if (file_count == 0 || copies < 1 || repeat < 1 || pty_count > MAX_PTYS) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	for (int i = 0; i < file_count; i++) {
+		streams[i].data = read_file(argv[optind + i], &streams[i].length);
+		if (!raw) {
+			streams[i].length = log_to_stream(streams[i].data, streams[i].length);
+		}
+	}
+	for (int i = 0; i < pty_count; i++) {
+		ptys[i].stream = &streams[i / copies];
+		open_pty(&ptys[i], link_prefix, i);
+	}
+	fflush(stdout);
+
+	const struct timespec delay_time = { .tv_sec = (time_t)delay, .tv_nsec = (long)((delay - (time_t)delay) * 1e9) };
+	nanosleep(&delay_time, NULL);
+
+	/* every pty sends its bytes as soon as the serial link would have them */
+	const double byte_rate = (double)baudrate / BITS_PER_BYTE;
+	const double start = monotonic_s();
+	int running = pty_count;
+	while (running > 0) {
+		const double now = monotonic_s();
+		for (int i = 0; i < pty_count; i++) {
+			pty_t *pty = &ptys[i];
+			const size_t total = pty->stream->length * repeat;
+			if (pty->sent == total) {
+				continue;
+			}
+
+			size_t due = (size_t)((now - start) * byte_rate);
+			if (due > total) {
+				due = total;
+			}
+			while (pty->sent < due) {
+				const size_t offset = pty->sent % pty->stream->length;
+				size_t count = due - pty->sent;
+				if (count > WRITE_CHUNK) {
+					count = WRITE_CHUNK;
+				}
+				if (count > pty->stream->length - offset) {
+					count = pty->stream->length - offset;
+				}
+				const ssize_t written = write(pty->master, pty->stream->data + offset, count);
+				if (written <= 0) {
+					break;		/* pty buffer full, the reader is behind */
+				}
+				pty->sent += written;
+			}
+			const double lag = (due - pty->sent) / byte_rate;
+			if (lag > pty->max_lag_s) {
+				pty->max_lag_s = lag;
+			}
+			if (pty->sent == total) {
+				pty->finish_time = monotonic_s();
+				running--;
+			}
+		}
+		const struct timespec step = { .tv_sec = 0, .tv_nsec = STEP_NS };
+		nanosleep(&step, NULL);
+	}
+
+	/* wait until the reader has read everything, the slave side hangs up with the master */
+	const double drain_end = monotonic_s() + DRAIN_TIMEOUT_S;
+	for (int i = 0; i < pty_count; i++) {
+		int pending = 0;
+		while (ioctl(ptys[i].slave, FIONREAD, &pending) == 0 && pending > 0 && monotonic_s() < drain_end) {
+			const struct timespec step = { .tv_sec = 0, .tv_nsec = STEP_NS };
+			nanosleep(&step, NULL);
+		}
+	}
+
+	for (int i = 0; i < pty_count; i++) {
+		const pty_t *pty = &ptys[i];
+		const double nominal = pty->sent / byte_rate;
+		printf("pty %d: %zu bytes in %.2f s (%.2f s at %u baud), max lag %.3f s\n", i, pty->sent,
+				pty->finish_time - start, nominal, baudrate, pty->max_lag_s);
+		close(pty->master);
+		close(pty->slave);
+		if (pty->link[0]) {
+			unlink(pty->link);
+		}
+	}
+	return 0;
+}
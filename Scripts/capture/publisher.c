@@ -0,0 +1,341 @@
+/*
+ * publisher.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "publisher.h"
+
+#define MAX_SUBSCRIBERS		(16)
+#define MIN_RING_SIZE		(1 << 20)
+#define WAIT_POLL_MS		(100)
+#define LISTEN_TAG			(PUBLISHER_EPOLL_TAG)
+#define SUBSCRIBER_TAG(i)	(PUBLISHER_EPOLL_TAG + 1 + (i))
+
+typedef struct {
+	int fd;					/* -1 if unused */
+	int ready;				/* policy received, ring sent */
+	int block;
+	uint64_t acknowledged;	/* read position of a blocking subscriber */
+	uint64_t notified;		/* last head sent */
+	uint64_t missed_notifications;
+	int64_t blocked_ns;		/* the publisher waited for this subscriber */
+} subscriber_t;
+
+static subscriber_t subscribers[MAX_SUBSCRIBERS];
+static int listen_fd = -1;
+static int ring_fd = -1;
+static int epoll_fd;
+static const volatile sig_atomic_t *stop_requested;
+static char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static publish_ring_t *ring;
+static uint8_t *records;
+static uint64_t ring_size;
+static uint64_t head;
+static uint64_t oldest;
+static uint64_t sequence;
+static uint64_t published_records;
+
+static int64_t monotonic_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+static publish_record_t *record_at(uint64_t position)
+{
+	return (publish_record_t *)(records + position % ring_size);
+}
+
+int publisher_open(const char *path, size_t size, int epoll, const volatile sig_atomic_t *stop)
+{
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+	if (size < MIN_RING_SIZE || strlen(path) >= sizeof(address.sun_path)) {
+		errno = EINVAL;
+		return -1;
+	}
+	ring_size = size & ~7ull;
+	epoll_fd = epoll;
+	stop_requested = stop;
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+		subscribers[i].fd = -1;
+	}
+
+	ring_fd = memfd_create("uwb_capture", MFD_CLOEXEC);
+	if (ring_fd < 0 || ftruncate(ring_fd, PUBLISH_DATA_OFFSET + ring_size) < 0) {
+		return -1;
+	}
+	void *memory = mmap(NULL, PUBLISH_DATA_OFFSET + ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+	if (memory == MAP_FAILED) {
+		return -1;
+	}
+	ring = memory;
+	records = (uint8_t *)memory + PUBLISH_DATA_OFFSET;
+	ring->magic = PUBLISH_MAGIC;
+	ring->version = PUBLISH_VERSION;
+	ring->size = ring_size;
+
+	strcpy(address.sun_path, path);
+	strcpy(socket_path, path);
+	unlink(path);
+	listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0
+			|| listen(listen_fd, MAX_SUBSCRIBERS) < 0) {
+		return -1;
+	}
+	struct epoll_event event = { .events = EPOLLIN, .data.u64 = LISTEN_TAG };
+	return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+}
+
+static void remove_subscriber(subscriber_t *subscriber)
+{
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, subscriber->fd, NULL);
+	close(subscriber->fd);
+	subscriber->fd = -1;
+	fprintf(stderr, "Subscriber %d disconnected\n", (int)(subscriber - subscribers));
+}
+
+/* First message: the policy, answered with the ring. Then the read positions of a blocking subscriber. */
+static void subscriber_message(subscriber_t *subscriber)
+{
+	uint8_t message[16];
+	const ssize_t length = recv(subscriber->fd, message, sizeof(message), MSG_DONTWAIT);
+
+	if (length < 0 && (errno == EAGAIN || errno == EINTR)) {
+		return;
+	}
+	if (length <= 0) {
+		remove_subscriber(subscriber);
+		return;
+	}
+
+	if (subscriber->ready) {
+		uint64_t position;
+		if (length == sizeof(position)) {
+			memcpy(&position, message, sizeof(position));
+			if (position > subscriber->acknowledged && position <= head) {
+				subscriber->acknowledged = position;
+			}
+		}
+		return;
+	}
+
+	const uint64_t welcome[4] = { PUBLISH_MAGIC | ((uint64_t)PUBLISH_VERSION << 32), PUBLISH_DATA_OFFSET,
+			ring_size, head };
+	char control[CMSG_SPACE(sizeof(int))] = { 0 };
+	struct iovec iov = { .iov_base = (void *)welcome, .iov_len = sizeof(welcome) };
+	struct msghdr reply = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control,
+			.msg_controllen = sizeof(control) };
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&reply);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &ring_fd, sizeof(int));
+
+	if (sendmsg(subscriber->fd, &reply, MSG_DONTWAIT) != sizeof(welcome)) {
+		remove_subscriber(subscriber);
+		return;
+	}
+	subscriber->ready = 1;
+	subscriber->block = (message[0] == PUBLISH_POLICY_BLOCK);
+	subscriber->acknowledged = head;
+	subscriber->notified = head;
+	fprintf(stderr, "Subscriber %d connected (%s)\n", (int)(subscriber - subscribers),
+			subscriber->block ? "block" : "drop oldest");
+}
+
+static void accept_subscriber(void)
+{
+	const int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+		subscriber_t *subscriber = &subscribers[i];
+		if (subscriber->fd >= 0) {
+			continue;
+		}
+		struct epoll_event event = { .events = EPOLLIN, .data.u64 = SUBSCRIBER_TAG(i) };
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+			break;
+		}
+		*subscriber = (subscriber_t) { .fd = fd };
+		return;
+	}
+	close(fd);
+}
+
+void publisher_event(uint64_t tag)
+{
+	if (tag == LISTEN_TAG) {
+		accept_subscriber();
+	} else if (tag - SUBSCRIBER_TAG(0) < MAX_SUBSCRIBERS) {
+		subscriber_message(&subscribers[tag - SUBSCRIBER_TAG(0)]);
+	}
+}
+
+void publisher_notify(void)
+{
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+		subscriber_t *subscriber = &subscribers[i];
+		if (subscriber->fd < 0 || !subscriber->ready || subscriber->notified == head) {
+			continue;
+		}
+		if (send(subscriber->fd, &head, sizeof(head), MSG_DONTWAIT | MSG_NOSIGNAL) == sizeof(head)) {
+			subscriber->notified = head;
+		} else if (errno == EAGAIN) {
+			/* the subscriber has not read the previous ones yet, it reads up to the head anyway */
+			subscriber->missed_notifications++;
+		} else {
+			remove_subscriber(subscriber);
+		}
+	}
+}
+
+/* Wait until the blocking subscribers have read everything before position */
+static void wait_for_subscribers(uint64_t position)
+{
+	publisher_notify();
+	while (!*stop_requested) {
+		struct pollfd fds[MAX_SUBSCRIBERS];
+		subscriber_t *waiting[MAX_SUBSCRIBERS];
+		int count = 0;
+
+		for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+			subscriber_t *subscriber = &subscribers[i];
+			if (subscriber->fd >= 0 && subscriber->ready && subscriber->block
+					&& subscriber->acknowledged < position) {
+				fds[count] = (struct pollfd) { .fd = subscriber->fd, .events = POLLIN };
+				waiting[count++] = subscriber;
+			}
+		}
+		if (count == 0) {
+			return;
+		}
+
+		const int64_t start = monotonic_ns();
+		poll(fds, count, WAIT_POLL_MS);
+		const int64_t blocked = monotonic_ns() - start;
+		for (int i = 0; i < count; i++) {
+			waiting[i]->blocked_ns += blocked;
+			if (fds[i].revents) {
+				subscriber_message(waiting[i]);
+			}
+		}
+	}
+}
+
+/* Free the ring up to end, overwritten records are skipped by advancing oldest */
+static void make_room(uint64_t end)
+{
+	if (end <= oldest + ring_size) {
+		return;
+	}
+	wait_for_subscribers(end - ring_size);
+
+	/* acknowledged positions are record boundaries, a blocking subscriber loses no record */
+	while (oldest < end - ring_size) {
+		oldest += record_at(oldest)->length;
+	}
+	__atomic_store_n(&ring->oldest, oldest, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void publisher_record(int device, int64_t receive_ns, const char *line, const uint8_t *blob, size_t blob_length)
+{
+	if (ring == NULL) {
+		return;
+	}
+
+	const size_t line_length = strlen(line);
+	const uint64_t length = (sizeof(publish_record_t) + line_length + blob_length + 7) & ~7ull;
+	const uint64_t pad = (head % ring_size + length > ring_size) ? ring_size - head % ring_size : 0;
+
+	make_room(head + pad + length);
+	if (pad > 0) {
+		publish_record_t *pad_record = record_at(head);
+		pad_record->length = pad;
+		pad_record->type = PUBLISH_RECORD_PAD;
+		head += pad;
+	}
+
+	publish_record_t *record = record_at(head);
+	*record = (publish_record_t) {
+		.length = length,
+		.type = (blob != NULL) ? PUBLISH_RECORD_BLOB : PUBLISH_RECORD_LINE,
+		.device = device,
+		.sequence = sequence++,
+		.receive_ns = receive_ns,
+		.line_length = line_length,
+		.data_length = blob_length,
+	};
+	if (blob != NULL) {
+		/* "BLOB / title / v1 / length", checked by the framer */
+		sscanf(line, "BLOB / %23[^/]/ v%u", record->title, &record->version);
+		for (int i = PUBLISH_TITLE_LENGTH - 1; i >= 0 && (record->title[i] == ' ' || record->title[i] == '\0'); i--) {
+			record->title[i] = '\0';
+		}
+	}
+	memcpy(record + 1, line, line_length);
+	if (blob != NULL) {
+		memcpy((uint8_t *)(record + 1) + line_length, blob, blob_length);
+	}
+	record->publish_ns = monotonic_ns();
+
+	head += length;
+	published_records++;
+	__atomic_store_n(&ring->sequence, sequence, __ATOMIC_RELAXED);
+	__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+}
+
+void publisher_print_statistics(void)
+{
+	if (ring == NULL) {
+		return;
+	}
+	fprintf(stderr, "Published %llu records (%.1f MB)\n", (unsigned long long)published_records, head / 1e6);
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+		const subscriber_t *subscriber = &subscribers[i];
+		if (subscriber->fd >= 0 && subscriber->ready) {
+			fprintf(stderr, "Subscriber %d (%s): %llu missed notifications, blocked %.3f s\n",
+					i, subscriber->block ? "block" : "drop oldest",
+					(unsigned long long)subscriber->missed_notifications, subscriber->blocked_ns * 1e-9);
+		}
+	}
+}
+
+void publisher_close(void)
+{
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+		if (subscribers[i].fd >= 0) {
+			close(subscribers[i].fd);
+		}
+	}
+	if (listen_fd >= 0) {
+		close(listen_fd);
+		unlink(socket_path);
+	}
+	if (ring != NULL) {
+		munmap(ring, PUBLISH_DATA_OFFSET + ring_size);
+		ring = NULL;
+	}
+	if (ring_fd >= 0) {
+		close(ring_fd);
+	}
+}
@@ -0,0 +1,89 @@
+/*
+ * publisher.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef PUBLISHER_H_
+#define PUBLISHER_H_
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Publishes the records of all devices to local subscribers (Scripts/capture_subscriber.py).
+ *
+ * The records are written to a ring in shared memory (memfd), subscribers map it read-only and read
+ * the records in place. A subscriber connects to the Unix socket (SOCK_SEQPACKET) and sends its
+ * policy, the publisher answers with the ring file descriptor (SCM_RIGHTS) and the current write
+ * position and notifies the new write position after every batch of reads.
+ *
+ * Policies:
+ * - drop oldest: the publisher never waits, a subscriber that falls behind by more than the ring
+ *   loses the oldest records (the sequence numbers have gaps).
+ * - block: the publisher does not overwrite records the subscriber has not acknowledged (it sends
+ *   its read position), the capture stops reading until then.
+ *
+ * Shared memory layout (little endian, 8 byte aligned): publish_ring_t at offset 0, the records
+ * from PUBLISH_DATA_OFFSET. A record never wraps, the rest of the ring is filled with a pad record.
+ * The publisher advances `oldest` before it overwrites a record and `head` after a record is
+ * complete, a reader checks `oldest` again after reading a record.
+ */
+
+#define PUBLISH_MAGIC			(0x52425755)	/* "UWBR" */
+#define PUBLISH_VERSION			(1)
+#define PUBLISH_DATA_OFFSET		(4096)
+#define PUBLISH_TITLE_LENGTH	(24)
+
+#define PUBLISH_POLICY_DROP		('d')		/* first byte of the message of a new subscriber */
+#define PUBLISH_POLICY_BLOCK	('b')
+
+#define PUBLISHER_EPOLL_TAG		(0x10000)	/* epoll data.u64 of the publisher sockets, >= tag */
+
+typedef enum {
+	PUBLISH_RECORD_PAD = 0,
+	PUBLISH_RECORD_LINE = 1,
+	PUBLISH_RECORD_BLOB = 2,
+} publish_record_type_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;			/* of the record area */
+	uint64_t head;			/* bytes written since the start (position = head % size) */
+	uint64_t oldest;		/* start of the oldest record that is not overwritten */
+	uint64_t sequence;		/* of the next record */
+} publish_ring_t;
+
+typedef struct {
+	uint32_t length;		/* of the record with this header, multiple of 8 */
+	uint16_t type;			/* publish_record_type_t, only length and type are valid for pad records */
+	uint16_t device;
+	uint64_t sequence;
+	int64_t receive_ns;		/* CLOCK_MONOTONIC of the read that completed the record */
+	int64_t publish_ns;
+	char title[PUBLISH_TITLE_LENGTH];	/* blob title, NUL padded (empty for text lines) */
+	uint32_t version;		/* blob version */
+	uint32_t line_length;	/* header or text line after this header (not terminated) */
+	uint32_t data_length;	/* raw blob bytes after the line */
+	uint32_t reserved;
+} publish_record_t;
+
+/* Listen on socket_path with a ring of ring_size bytes, the sockets are added to epoll_fd. The wait
+ * of blocking subscribers ends when stop is set. Returns -1 on error. */
+int publisher_open(const char *socket_path, size_t ring_size, int epoll_fd, const volatile sig_atomic_t *stop);
+
+/* Add a record (blob NULL for a text line) */
+void publisher_record(int device, int64_t receive_ns, const char *line, const uint8_t *blob, size_t blob_length);
+
+/* Notify the subscribers about the records added since the last call */
+void publisher_notify(void);
+
+/* Event of an epoll tag >= PUBLISHER_EPOLL_TAG */
+void publisher_event(uint64_t tag);
+
+void publisher_print_statistics(void);
+
+void publisher_close(void);
+
+#endif /* PUBLISHER_H_ */
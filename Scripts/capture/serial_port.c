@@ -0,0 +1,46 @@
+/*
+ * serial_port.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Only the kernel termios2 interface, <termios.h> of the C library cannot be included as well */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "serial_port.h"
+
+int serial_port_open(const char *path, uint32_t baudrate)
+{
+	struct termios2 tio;
+	int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+	if (fd < 0) {
+		return -1;
+	}
+	if (ioctl(fd, TCGETS2, &tio) == 0) {
+		/* raw mode as cfmakeraw() */
+		tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF);
+		tio.c_oflag &= ~OPOST;
+		tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+		tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD | (CBAUD << IBSHIFT));
+		tio.c_cflag |= CS8 | CREAD | CLOCAL | BOTHER | (BOTHER << IBSHIFT);
+		tio.c_ispeed = baudrate;
+		tio.c_ospeed = baudrate;
+		tio.c_cc[VMIN] = 1;
+		tio.c_cc[VTIME] = 0;
+
+		if (ioctl(fd, TCSETS2, &tio) == 0) {
+			return fd;
+		}
+	}
+
+	const int error = errno;
+	close(fd);
+	errno = error;
+	return -1;
+}
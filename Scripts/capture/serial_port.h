@@ -0,0 +1,16 @@
+/*
+ * serial_port.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef SERIAL_PORT_H_
+#define SERIAL_PORT_H_
+
+#include <stdint.h>
+
+/* Open a serial port (or pty) non-blocking in raw 8N1 mode. Any baud rate is set with termios2
+ * (2.25 MBaud is no standard rate of termios). Returns the file descriptor or -1 (errno set). */
+int serial_port_open(const char *path, uint32_t baudrate);
+
+#endif /* SERIAL_PORT_H_ */
@@ -0,0 +1,445 @@
+/*
+ * uwb_capture.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+/* Capture daemon for several UWB modules on one host: all serial ports (or ptys) are read by one
+ * thread with epoll, each stream is split into lines and blobs (framer.c) and written in the log
+ * format of serial_reader.py, one log per device (--output) and/or one merged stream (--merged).
+ * Records are timestamped with CLOCK_MONOTONIC when their data is read (seconds since the start).
+ *
+ * In the merged stream every log line of a device is prefixed with "D<device index> ", the log of
+ * device 1 is grep '^D1 ' | cut -d ' ' -f 2-
+ *
+ * With --publish the records are also published to local subscribers (publisher.h).
+ *
+ * Example: ./uwb_capture --output run1 /dev/ttyACM0 /dev/ttyACM1   (run1_0.log, run1_1.log)
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "base64.h"
+#include "framer.h"
+#include "publisher.h"
+#include "serial_port.h"
+
+#define MAX_DEVICES			(16)
+#define MAX_COMMANDS		(16)
+#define DEFAULT_BAUDRATE	(2250000)
+#define LOOP_TIMEOUT_MS		(100)
+#define RECONNECT_NS		(1000000000ll)
+#define FLUSH_NS			(1000000000ll)	/* consumers reading the logs see the data after at most this */
+#define DEFAULT_RING_MB		(16)
+#define OUTPUT_BUFFER_SIZE	(1 << 20)
+#define PATH_LENGTH			(256)
+
+#define LOG_TIME_FORMAT		"%010.5f: "
+#define LOG_NO_TIME			"XXXX.XXXXX: "
+#define DATA_PREFIX			LOG_NO_TIME "Data: "
+
+typedef struct {
+	const char *path;
+	int index;
+	int fd;					/* -1 while disconnected */
+	FILE *log;
+	int64_t receive_ns;		/* of the data given to the framer */
+	uint64_t bytes;
+	uint64_t lines;
+	uint64_t blobs;
+	uint32_t connects;
+	framer_t framer;
+} device_t;
+
+static device_t devices[MAX_DEVICES];
+static int device_count = 0;
+static FILE *merged = NULL;
+static const char *commands[MAX_COMMANDS];
+static int command_count = 0;
+static uint32_t baudrate = DEFAULT_BAUDRATE;
+static int64_t start_ns;
+static volatile sig_atomic_t stop_requested = 0;
+
+/* "Data: " line of the largest blob */
+static char data_line[sizeof(DATA_PREFIX) + BASE64_ENCODED_LENGTH(FRAMER_MAX_BLOB_LENGTH) + 1];
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [options] DEVICE...\n"
+			"  --output BASE      write the log of device i to BASE_i.log\n"
+			"  --merged FILE      write all devices to one stream (- for stdout)\n"
+			"  --baud N           baud rate (default %u)\n"
+			"  --command CMD      serial command sent after connecting (repeatable)\n"
+			"  --duration S       stop after S seconds (default: until SIGINT/SIGTERM)\n"
+			"  --no-reconnect     stop when all devices are disconnected\n"
+			"  --publish SOCKET   publish the records to subscribers connecting to SOCKET\n"
+			"  --ring-mb N        size of the shared memory ring of --publish (default %d MB)\n",
+			name, DEFAULT_BAUDRATE, DEFAULT_RING_MB);
+}
+
+static int64_t monotonic_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+static void stop_handler(int signal)
+{
+	(void)signal;
+	stop_requested = 1;
+}
+
+static void output(const device_t *device, const char *line, size_t length)
+{
+	if (device->log != NULL) {
+		fwrite(line, 1, length, device->log);
+	}
+	if (merged != NULL) {
+		fprintf(merged, "D%d ", device->index);
+		fwrite(line, 1, length, merged);
+	}
+}
+
+/* Log line with the time of the monotonic clock */
+static void log_line(const device_t *device, int64_t time_ns, const char *text)
+{
+	char line[FRAMER_MAX_LINE_LENGTH + 64];
+	int length = snprintf(line, sizeof(line), LOG_TIME_FORMAT "%s\n", (time_ns - start_ns) * 1e-9, text);
+
+	if (length >= (int)sizeof(line)) {
+		length = sizeof(line) - 1;
+		line[length - 1] = '\n';
+	}
+	output(device, line, length);
+}
+
+static void record(void *context, const char *line, const uint8_t *blob, size_t blob_length)
+{
+	device_t *const device = context;
+
+	publisher_record(device->index, device->receive_ns, line, blob, blob_length);
+	log_line(device, device->receive_ns, line);
+	if (blob == NULL) {
+		device->lines++;
+		return;
+	}
+
+	device->blobs++;
+	memcpy(data_line, DATA_PREFIX, sizeof(DATA_PREFIX) - 1);
+	size_t length = sizeof(DATA_PREFIX) - 1;
+	length += base64_encode(blob, blob_length, data_line + length);
+	data_line[length++] = '\n';
+	output(device, data_line, length);
+}
+
+static void log_all(int64_t time_ns, const char *text)
+{
+	for (int i = 0; i < device_count; i++) {
+		if (devices[i].log != NULL) {
+			log_line(&devices[i], time_ns, text);
+		}
+	}
+	if (merged != NULL) {
+		fprintf(merged, LOG_TIME_FORMAT "%s\n", (time_ns - start_ns) * 1e-9, text);
+	}
+}
+
+static void log_wall_time(const char *event)
+{
+	char text[64];
+	const time_t now = time(NULL);
+	size_t length = snprintf(text, sizeof(text), "Logging %s at: ", event);
+
+	strftime(text + length, sizeof(text) - length, "%d %b %Y %H:%M:%S", localtime(&now));
+	log_all(monotonic_ns(), text);
+}
+
+static void flush_outputs(void)
+{
+	for (int i = 0; i < device_count; i++) {
+		if (devices[i].log != NULL) {
+			fflush(devices[i].log);
+		}
+	}
+	if (merged != NULL) {
+		fflush(merged);
+	}
+}
+
+static FILE *open_output(const char *path)
+{
+	/* only create a file, do not overwrite */
+	FILE *file = (strcmp(path, "-") == 0) ? stdout : fopen(path, "wx");
+
+	if (file == NULL) {
+		fprintf(stderr, "Cannot create %s: %s\n", path, strerror(errno));
+		exit(1);
+	}
+	setvbuf(file, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+	return file;
+}
+
+static int device_connect(device_t *device, int epoll_fd)
+{
+	device->fd = serial_port_open(device->path, baudrate);
+	if (device->fd < 0) {
+		return -1;
+	}
+
+	struct epoll_event event = { .events = EPOLLIN, .data.u64 = device->index };
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, device->fd, &event) < 0) {
+		close(device->fd);
+		device->fd = -1;
+		return -1;
+	}
+
+	framer_init(&device->framer);
+	device->connects++;
+	fprintf(stderr, "Connected device %d: %s\n", device->index, device->path);
+
+	/* e.g. "config plen 128", applied by the firmware between two exchanges */
+	for (int i = 0; i < command_count; i++) {
+		char text[FRAMER_MAX_LINE_LENGTH];
+		const int length = snprintf(text, sizeof(text), "%s\n", commands[i]);
+
+		if (write(device->fd, text, length) != length) {
+			fprintf(stderr, "Device %d: sending command '%s' failed\n", device->index, commands[i]);
+		}
+		snprintf(text, sizeof(text), "Command: %s", commands[i]);
+		log_line(device, monotonic_ns(), text);
+	}
+	return 0;
+}
+
+static void device_disconnect(device_t *device, int epoll_fd, const char *reason)
+{
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+	close(device->fd);
+	device->fd = -1;
+	fprintf(stderr, "Lost connection to device %d: %s\n", device->index, reason);
+}
+
+static void device_read(device_t *device, int epoll_fd, int64_t now_ns)
+{
+	size_t size;
+	uint8_t *const space = framer_space(&device->framer, &size);
+	const ssize_t count = read(device->fd, space, size);
+
+	if (count > 0) {
+		device->bytes += count;
+		device->receive_ns = now_ns;
+		framer_commit(&device->framer, count, record, device);
+	} else if (count == 0) {
+		device_disconnect(device, epoll_fd, "end of file");
+	} else if (errno != EAGAIN && errno != EINTR) {
+		device_disconnect(device, epoll_fd, strerror(errno));
+	}
+}
+
+static void print_statistics(int64_t end_ns)
+{
+	struct rusage usage;
+	uint64_t bytes = 0;
+
+	for (int i = 0; i < device_count; i++) {
+		const device_t *device = &devices[i];
+		fprintf(stderr, "Device %d %s: %llu bytes, %llu lines, %llu blobs, %llu dropped lines, %u connects\n",
+				device->index, device->path, (unsigned long long)device->bytes, (unsigned long long)device->lines,
+				(unsigned long long)device->blobs, (unsigned long long)device->framer.dropped_lines, device->connects);
+		bytes += device->bytes;
+	}
+
+	getrusage(RUSAGE_SELF, &usage);
+	const double elapsed = (end_ns - start_ns) * 1e-9;
+	const double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6
+			+ usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+	fprintf(stderr, "Captured %.1f kB/s in %.1f s, CPU time %.2f s (%.1f %% of one core)\n",
+			bytes / elapsed / 1000, elapsed, cpu, 100 * cpu / elapsed);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_options[] = {
+			{ "output", required_argument, NULL, 'o' },
+			{ "merged", required_argument, NULL, 'm' },
+			{ "baud", required_argument, NULL, 'b' },
+			{ "command", required_argument, NULL, 'c' },
+			{ "duration", required_argument, NULL, 'd' },
+			{ "no-reconnect", no_argument, NULL, 'n' },
+			{ "publish", required_argument, NULL, 'p' },
+			{ "ring-mb", required_argument, NULL, 'r' },
+			{ "help", no_argument, NULL, 'h' },
+			{ NULL, 0, NULL, 0 },
+	};
+
+	const char *output_base = NULL;
+	const char *merged_path = NULL;
+	const char *publish_path = NULL;
+	size_t ring_mb = DEFAULT_RING_MB;
+	double duration = 0;
+	int reconnect = 1;
+
+	int option;
+	while ((option = getopt_long(argc, argv, "o:m:b:c:d:np:r:h", long_options, NULL)) != -1) {
+		switch (option) {
+		case 'o':
+			output_base = optarg;
+			break;
+		case 'm':
+			merged_path = optarg;
+			break;
+		case 'b':
+			baudrate = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			if (command_count < MAX_COMMANDS) {
+				commands[command_count++] = optarg;
+			}
+			break;
+		case 'd':
+			duration = strtod(optarg, NULL);
+			break;
+		case 'n':
+			reconnect = 0;
+			break;
+		case 'p':
+			publish_path = optarg;
+			break;
+		case 'r':
+			ring_mb = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return (option == 'h') ? 0 : 2;
+		}
+	}
+	if (optind == argc || argc - optind > MAX_DEVICES) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		perror("epoll_create1");
+		return 1;
+	}
+
+	for (int i = optind; i < argc; i++) {
+		device_t *device = &devices[device_count];
+		device->path = argv[i];
+		device->index = device_count++;
+		device->fd = -1;
+		if (output_base != NULL) {
+			char path[PATH_LENGTH];
+			const size_t base_length = strlen(output_base);
+			const int strip = (base_length > 4 && strcmp(output_base + base_length - 4, ".log") == 0) ? 4 : 0;
+			snprintf(path, sizeof(path), "%.*s_%d.log", (int)(base_length - strip), output_base, device->index);
+			device->log = open_output(path);
+		}
+	}
+	if (merged_path != NULL) {
+		merged = open_output(merged_path);
+	}
+
+	if (publish_path != NULL && publisher_open(publish_path, ring_mb << 20, epoll_fd, &stop_requested) < 0) {
+		fprintf(stderr, "Cannot publish on %s: %s\n", publish_path, strerror(errno));
+		return 1;
+	}
+
+	const struct sigaction action = { .sa_handler = stop_handler };
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	start_ns = monotonic_ns();
+	log_wall_time("started");
+
+	for (int i = 0; i < device_count; i++) {
+		if (device_connect(&devices[i], epoll_fd) < 0) {
+			fprintf(stderr, "Cannot open device %d %s: %s\n", i, devices[i].path, strerror(errno));
+			if (!reconnect) {
+				return 1;
+			}
+		}
+	}
+
+	int64_t next_flush = start_ns + FLUSH_NS;
+	int64_t next_reconnect = start_ns + RECONNECT_NS;
+	while (!stop_requested) {
+		struct epoll_event events[MAX_DEVICES];
+		const int count = epoll_wait(epoll_fd, events, MAX_DEVICES, LOOP_TIMEOUT_MS);
+		if (count < 0 && errno != EINTR) {
+			perror("epoll_wait");
+			break;
+		}
+
+		const int64_t now_ns = monotonic_ns();
+		for (int i = 0; i < count; i++) {
+			const uint64_t tag = events[i].data.u64;
+			if (tag >= PUBLISHER_EPOLL_TAG) {
+				publisher_event(tag);
+			} else if (devices[tag].fd >= 0) {
+				device_read(&devices[tag], epoll_fd, now_ns);
+			}
+		}
+		/* once per batch, a woken subscriber does not delay the other devices */
+		publisher_notify();
+
+		if (duration > 0 && (now_ns - start_ns) * 1e-9 >= duration) {
+			break;
+		}
+		if (now_ns >= next_flush) {
+			flush_outputs();
+			next_flush = now_ns + FLUSH_NS;
+		}
+
+		int connected = 0;
+		for (int i = 0; i < device_count; i++) {
+			connected += (devices[i].fd >= 0);
+		}
+		if (connected == device_count) {
+			continue;
+		}
+		if (!reconnect) {
+			if (connected == 0) {
+				break;
+			}
+		} else if (now_ns >= next_reconnect) {
+			for (int i = 0; i < device_count; i++) {
+				if (devices[i].fd < 0) {
+					device_connect(&devices[i], epoll_fd);
+				}
+			}
+			next_reconnect = now_ns + RECONNECT_NS;
+		}
+	}
+
+	const int64_t end_ns = monotonic_ns();
+	log_wall_time("finished");
+	for (int i = 0; i < device_count; i++) {
+		if (devices[i].fd >= 0) {
+			close(devices[i].fd);
+		}
+		if (devices[i].log != NULL) {
+			fclose(devices[i].log);
+		}
+	}
+	if (merged != NULL) {
+		fclose(merged);
+	}
+	print_statistics(end_ns);
+	publisher_print_statistics();
+	publisher_close();
+	return 0;
+}
@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+
+
+"""Receive the records published by `capture/uwb_capture --publish SOCKET`.
+
+The capture daemon writes the lines and blobs of all devices into a ring in
+shared memory (layout in `capture/publisher.h`). A `Subscriber` maps the ring
+read-only and hands every record to a callback without copying: `data` is a
+memoryview of the raw blob in the ring, `decode_record()` interprets it with
+the NumPy dtypes of `blob_schema.py` (via `bulk_decoder.py`). The views are
+only valid during the callback, copy what you keep (e.g. the decoded arrays).
+
+Backpressure policy per subscriber:
+- drop oldest (default): the daemon never waits, a subscriber that falls
+  behind by more than the ring loses the oldest records (counted in
+  `dropped`; `overruns` counts records overwritten during the callback).
+- block (`block=True`): the daemon does not overwrite records this
+  subscriber has not read yet and stops reading the serial ports until then.
+
+`latency_ns` of a record is the time from the read of its last byte by the
+daemon to the callback (same CLOCK_MONOTONIC), `publish_ns` the time the
+daemon wrote it to the ring.
+
+Usage:
+    with Subscriber('/tmp/uwb.sock') as subscriber:
+        subscriber.run(lambda record:
+                       print(record.title, decode_record(record)))
+
+Run as script to print the records and the latency statistics.
+"""
+
+import mmap
+import time
+import select
+import socket
+import struct
+import argparse
+from collections import namedtuple
+
+import numpy as np
+
+import blob_schema
+import bulk_decoder
+
+
+PUBLISH_MAGIC = 0x52425755  # "UWBR"
+PUBLISH_VERSION = 1
+POLICY_DROP = b'd'
+POLICY_BLOCK = b'b'
+
+RECORD_PAD = 0
+RECORD_LINE = 1
+RECORD_BLOB = 2
+
+# publish_ring_t: magic, version, size, head, oldest, sequence
+RING_HEAD_OFFSET = 16
+RING_OLDEST_OFFSET = 24
+# publish_record_t
+RECORD = struct.Struct('<IHHQqq24sIIII')
+RECORD_LENGTH_TYPE = struct.Struct('<IH')
+# welcome message: magic | version << 32, data offset, size, head
+WELCOME = struct.Struct('<QQQQ')
+POSITION = struct.Struct('<Q')
+
+ACK_INTERVAL = 1 << 20  # bytes, blocking subscribers report their position
+
+Record = namedtuple('Record', 'device sequence receive_ns publish_ns '
+                              'latency_ns title version line data')
+
+
+class Subscriber:
+    '''Connection to the publishing capture daemon.'''
+
+    def __init__(self, path, block=False):
+        self.block = block
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+        self.sock.connect(path)
+        self.sock.send(POLICY_BLOCK if block else POLICY_DROP)
+        message, fds, _, _ = socket.recv_fds(self.sock, WELCOME.size, 1)
+        magic_version, data_offset, self.size, self.tail = \
+            WELCOME.unpack(message)
+        if (magic_version != PUBLISH_MAGIC | (PUBLISH_VERSION << 32)
+                or len(fds) != 1):
+            raise ValueError('Unsupported publisher')
+
+        with open(fds[0], 'rb', buffering=0) as ring_file:
+            self.map = mmap.mmap(ring_file.fileno(), data_offset + self.size,
+                                 prot=mmap.PROT_READ)
+        self.view = memoryview(self.map)
+        self.data_offset = data_offset
+        self.acknowledged = self.tail
+        self.sequence = None  # of the next record
+
+        self.received = 0
+        self.dropped = 0
+        self.overruns = 0
+
+    def _head(self):
+        return POSITION.unpack_from(self.map, RING_HEAD_OFFSET)[0]
+
+    def _oldest(self):
+        return POSITION.unpack_from(self.map, RING_OLDEST_OFFSET)[0]
+
+    def fileno(self):
+        return self.sock.fileno()
+
+    def poll(self, callback, timeout=None):
+        '''Wait up to `timeout` seconds for a notification and hand all new
+        records to `callback`. Returns the number of records.'''
+        ready, _, _ = select.select([self.sock], [], [], timeout)
+        if not ready:
+            return 0
+        # skip queued notifications, the records are read up to the head
+        try:
+            while self.sock.recv(POSITION.size, socket.MSG_DONTWAIT):
+                pass
+        except BlockingIOError:
+            pass
+        return self.read(callback)
+
+    def read(self, callback):
+        '''Hand all records up to the current head to `callback`.'''
+        count = 0
+        head = self._head()
+        while self.tail < head:
+            if self.tail < self._oldest():
+                # overwritten, continue with the oldest record in the ring
+                self.tail = self._oldest()
+                continue
+
+            position = self.data_offset + self.tail % self.size
+            length, record_type = RECORD_LENGTH_TYPE.unpack_from(self.map,
+                                                                 position)
+            if record_type == RECORD_PAD:
+                if self.tail < self._oldest():
+                    continue  # overwritten while reading the length
+                self.tail += length
+                continue
+
+            (length, record_type, device, sequence, receive_ns, publish_ns,
+             title, version, line_length, data_length, _) = \
+                RECORD.unpack_from(self.map, position)
+            start = position + RECORD.size
+            line = bytes(self.view[start:start + line_length])
+            data = None
+            if record_type == RECORD_BLOB:
+                data = self.view[start + line_length:
+                                 start + line_length + data_length]
+            if self.tail < self._oldest():
+                continue  # overwritten while reading the header
+
+            if self.sequence is not None and sequence > self.sequence:
+                self.dropped += sequence - self.sequence
+            self.sequence = sequence + 1
+            latency_ns = time.clock_gettime_ns(time.CLOCK_MONOTONIC) \
+                - receive_ns
+            callback(Record(device, sequence, receive_ns, publish_ns,
+                            latency_ns, title.rstrip(b'\0').decode('ascii'),
+                            version, line.decode('ascii'), data))
+            if data is not None:
+                data.release()
+            if self.tail < self._oldest():
+                self.overruns += 1
+
+            self.tail += length
+            self.received += 1
+            count += 1
+            if self.block and self.tail - self.acknowledged >= ACK_INTERVAL:
+                self._acknowledge()
+        if self.block and self.tail != self.acknowledged:
+            self._acknowledge()
+        return count
+
+    def _acknowledge(self):
+        try:
+            self.sock.send(POSITION.pack(self.tail))
+        except OSError:
+            pass  # the publisher stopped, the ring stays readable
+        self.acknowledged = self.tail
+
+    def run(self, callback, duration=None):
+        '''Receive records until the daemon stops (or for `duration`
+        seconds).'''
+        end = None if duration is None else time.monotonic() + duration
+        while True:
+            timeout = None if end is None else end - time.monotonic()
+            if timeout is not None and timeout <= 0:
+                break
+            try:
+                self.poll(callback, timeout)
+            except (ConnectionError, OSError):
+                break
+            if self._closed_by_publisher():
+                self.read(callback)
+                break
+
+    def _closed_by_publisher(self):
+        try:
+            return self.sock.recv(1, socket.MSG_PEEK | socket.MSG_DONTWAIT) \
+                == b''
+        except BlockingIOError:
+            return False
+
+    def close(self):
+        self.view.release()
+        self.map.close()
+        self.sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+
+def decode_record(record):
+    '''Decode the blob of a record: a structured array with one row for the
+    fixed size blobs (see `bulk_decoder.decode_blobs()`), a dict of complex
+    arrays for 'cir' blobs, None for text lines, unknown titles or versions.'''
+    if record.data is None:
+        return None
+    if record.title == 'cir':
+        if len(record.data) != bulk_decoder.CIR_BLOB_SIZE:
+            return None
+        return {name: cir[0] for name, cir in
+                bulk_decoder.decode_cir_blobs(record.data).items()}
+    blob = blob_schema.blobs_by_title.get(record.title)
+    if (blob is None or record.version != blob.version
+            or len(record.data) != blob_schema.transmitted_size(blob)):
+        return None
+    return bulk_decoder.decode_blobs(record.title, record.data)[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('socket', help='Socket of uwb_capture --publish')
+    parser.add_argument('--block', action='store_true',
+                        help='The daemon waits for this subscriber instead '
+                             'of dropping the oldest records')
+    parser.add_argument('--titles', nargs='*',
+                        help='Only decode and print these blob types '
+                             '(e.g. twr toa cir)')
+    parser.add_argument('--duration', type=float,
+                        help='Stop after this many seconds')
+    parser.add_argument('--quiet', '-q', action='store_true',
+                        help='Only print the statistics')
+
+    args = parser.parse_args()
+
+    latencies = []
+    daemon_latencies = []
+
+    def callback(record):
+        latencies.append(record.latency_ns)
+        daemon_latencies.append(record.publish_ns - record.receive_ns)
+        if args.quiet or (args.titles is not None
+                          and record.title not in args.titles):
+            return
+        decoded = decode_record(record)
+        if record.data is None:
+            print(f'{record.device}: {record.line}')
+        elif isinstance(decoded, dict):
+            print(f'{record.device}: {record.title}: '
+                  + ', '.join(f'{name} {len(cir)} samples'
+                              for name, cir in decoded.items()))
+        else:
+            print(f'{record.device}: {record.title}: {decoded}')
+
+    with Subscriber(args.socket, args.block) as subscriber:
+        subscriber.run(callback, args.duration)
+        print(f'{subscriber.received} records, {subscriber.dropped} dropped, '
+              f'{subscriber.overruns} overwritten during the callback')
+
+    for name, values in (('read -> callback', latencies),
+                         ('read -> ring', daemon_latencies)):
+        if not values:
+            continue
+        values = np.array(values) / 1e3
+        p50, p99 = np.percentile(values, [50, 99])
+        print(f'latency {name}: median {p50:.0f} us, 99 % {p99:.0f} us, '
+              f'max {values.max():.0f} us, '
+              f'{np.mean(values > 1000) * 100:.2f} % above 1 ms')
+
+
+if __name__ == '__main__':
+    main()
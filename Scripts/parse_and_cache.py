@@ -3,7 +3,7 @@
 
 """Generate cache file efficiently storing data fields required for later analysis.
 
--> For specific field names and descriptions check the comment in `CacheV4` below.
+-> For specific field names and descriptions check the comment of `CacheV4` below.
 
 A configuration file is required to run this script. Specification:
 - Each line corresponds to one data file to be processed
@@ -11,11 +11,23 @@ A configuration file is required to run this script. Specification:
 - Line format: title;filename;description
 - Header line required (first line will be ignored)
 
-Some preprocessing is performed to simplify the data (c.f. CacheV? classes below):
+Some preprocessing is performed to simplify the data (c.f. CacheV? definitions
+below):
 - PDoA decoded as float
 - CIR restricted to a slice around the first path index
 - Power levels computed according to the DW3000 user manual
 
+A cache version is a declaration of its fields, the CIR window and the blobs
+a frame needs to be cached (see `CacheVersion`). It is computed for all
+frames of a log at once on the columns of the parsed log.
+
+Tables are only rebuilt if the log file (SHA-256 of its content), the cache
+version, its definition (SHA-256 of the declaration) or the parser version
+(`serial_parser.Frame.version`) changed since the table was written, use
+`--force` to rebuild all.
+Use `--jobs N` to parse N log files in parallel worker processes (the
+finished tables are written to the output file by the main process).
+
 Output file specification:
 - HDF5
 - Data tables for each processed data file
@@ -23,244 +35,153 @@ Output file specification:
   + "cache_{title}/df" - Data table
 """
 
+import io
+import os
 import csv
-import math
+import time
+import hashlib
 import argparse
+import contextlib
 from pprint import pprint
-from collections import OrderedDict
+from collections import OrderedDict, namedtuple
+from concurrent.futures import ProcessPoolExecutor, as_completed
 
+import numpy as np
 import pandas as pd
 
-from serial_parser import parse_log_file, Frame
+import signal_power
+from serial_parser import Frame, parse_log_file
 
 
 DEFAULT_CACHE_VERSION = '4'
 
-
-class CacheV4:
-    '''Cache version 4.
-
-    Fields:
-    - `timestamp`: Recording timestamp
-    - `number`: Frame Number
-    - `rotation`: True Rotation
-    - `pdoa`: PDoA measurement
-    - `tdoa`: TDoA measurement
-    - `dist_mm`: TWR distance estimate
-    - `rx_power_level`: Receive signal power estimate
-    - `fp_power_level`: First path power estimate
-    - `cir_sts1` and `cir_sts2`: Complex CIR samples (restricted to 5 samples
-      before the first path index and 99 samples after the first path index as
-      computed by the DW3220, i.e. 105 samples total)
+CIR_WINDOW_CHUNK = 1024  # frames per step, limits the temporary index arrays
+
+
+# Cache versions are defined by:
+# - `require`: blob data attributes a frame needs to be cached (e.g.
+#   'twr_data', 'cir', see `Frame.binary_to_attr`)
+# - `fields`: scalar columns, `Field(name, source, scale, require)`. The source
+#   is a frame column ('serial_timestamp', 'serial_count'), a blob field
+#   ('toa_data.pdoa') or a name of `derived_fields`. Missing values (frame
+#   without the blob or without the blobs in `require`) are NaN.
+# - `cir`: CIR columns, `CirWindow(names, start, stop, relative)` stores the
+#   samples start..stop-1 of each CIR in `names`, with `relative` counted from
+#   the first path index of its CIR analysis ('cir_sts1' ->
+#   'cir_analysis_sts1.fp_index'). Samples outside the CIR and CIRs of frames
+#   without CIR or first path index are NaN.
+#
+# All frames of a log are processed at once on the columns of the FrameTable
+# (see `build_dataframe`), a new version only needs a new definition.
+CacheVersion = namedtuple('CacheVersion', 'require fields cir')
+Field = namedtuple('Field', 'name source scale require',
+                   defaults=(None, ()))
+CirWindow = namedtuple('CirWindow', 'names start stop relative')
+
+
+def rotation(table, rows):
+    '''Turntable angle in degrees.
+
+    Interpolated angle of the rotation blob if available (continuous
+    rotation), otherwise the integer angle of the twr blob.
     '''
+    has_rotation = table.present('rotation_data')[rows]
+    valid = has_rotation | table.present('twr_data')[rows]
+    angle = table.column('twr_data', 'rotation')[rows]
+    if has_rotation.any():
+        angle = np.where(
+            has_rotation,
+            table.column('rotation_data', 'angle_mdeg')[rows] / 1000, angle)
+    return angle, valid
 
-    def __init__(self):
-        # slice of the STS1 and STS2 CIR around the FP index
-        self.cir_sts_slice = (-5, 100)
-        self.cir_sts_slice_len = self.cir_sts_slice[1] - self.cir_sts_slice[0]
 
-        # MultiIndex to group CIR slices
-        self.columns = pd.MultiIndex.from_arrays((
-            ['timestamp', 'number', 'rotation', 'pdoa', 'tdoa', 'dist_mm',
-             'rx_power_level', 'fp_power_level',
-             *(['cir_sts1']*self.cir_sts_slice_len),
-             *(['cir_sts2']*self.cir_sts_slice_len)],
-            ['', '', '', '', '', '', '', '',
-             *range(*self.cir_sts_slice), *range(*self.cir_sts_slice)]
-        ))
-
-    def check_frame(self, frame):
-        if frame.twr_data and frame.cir_analysis_sts1:
-            return True
-        else:
-            return False
-
-    def get_frame_data(self, frame: Frame):
-        has_cir = True
-        try:
-            fp_sts1 = int(frame.cir_analysis_sts1.fp_index)
-            fp_sts2 = int(frame.cir_analysis_sts2.fp_index)
-        except AttributeError:
-            has_cir = False
-
-        if not (hasattr(frame.cir, 'cir_sts1')
-                and hasattr(frame.cir, 'cir_sts2')):
-            has_cir = False
-
-        if has_cir:
-            cir_sts1_slice = slice(fp_sts1+self.cir_sts_slice[0],
-                                   fp_sts1+self.cir_sts_slice[1])
-            cir_sts2_slice = slice(fp_sts2+self.cir_sts_slice[0],
-                                   fp_sts2+self.cir_sts_slice[1])
-        else:
-            empty_cir = [None]*(self.cir_sts_slice[0]+self.cir_sts_slice[1])
-
-        # Compute power levels, c.f. DW3000 user manual section 4.7
-        try:
-            C = frame.cir_analysis_ip.power
-            N = frame.cir_analysis_ip.accum_count
-            D = frame.toa_data.dgc_decision
-            A = 121.7
-            F1 = frame.cir_analysis_ip.F1
-            F2 = frame.cir_analysis_ip.F2
-            F3 = frame.cir_analysis_ip.F3
-            rx_power_level = 10 * math.log10((C * 2**21) / N**2) + (6 * D) - A
-            fp_power_level = 10 * math.log10((F1**2 + F2**2 + F3**2) / N**2) + (6 * D) - A
-        except AttributeError:
-            rx_power_level = None
-            fp_power_level = None
-
-        data = (
-            frame.serial_timestamp,
-            frame.serial_count,
-            frame.twr_data.rotation,
-            frame.toa_data.pdoa/2**11,
-            frame.toa_data.tdoa,
-            frame.twr_data.dist_mm,
-            rx_power_level,
-            fp_power_level,
-            *(frame.cir.cir_sts1[cir_sts1_slice] if has_cir else empty_cir),
-            *(frame.cir.cir_sts2[cir_sts2_slice] if has_cir else empty_cir),
-        )
-        return data
-
-
-class CacheV4a:
-    '''Cache version 4a.
-
-    Differences to version 4:
-    - Full CIR
-    '''
+def _power_level_inputs(table, rows, *fields):
+    N = table.column('cir_analysis_ip', 'accum_count')[rows]
+    D = table.column('toa_data', 'dgc_decision')[rows]
+    valid = table.present('cir_analysis_ip') & table.present('toa_data')
+    return ([table.column('cir_analysis_ip', f)[rows] for f in fields], N, D,
+            valid[rows])
 
-    def __init__(self):
-        self.cir_sts_len = 512
-        # MultiIndex to group CIR slices
-        self.columns = pd.MultiIndex.from_arrays((
-            ['timestamp', 'number', 'rotation', 'pdoa', 'tdoa', 'dist_mm',
-             'rx_power_level', 'fp_power_level', 'sts1_fp_index',
-             'sts2_fp_index',
-             *(['cir_sts1']*self.cir_sts_len),
-             *(['cir_sts2']*self.cir_sts_len)],
-            ['', '', '', '', '', '', '', '', '', '',
-             *range(self.cir_sts_len), *range(self.cir_sts_len)]
-        ))
-
-    def check_frame(self, frame):
-        if frame.twr_data and frame.cir_analysis_sts1:
-            return True
-        else:
-            return False
-
-    def get_frame_data(self, frame: Frame):
-        has_cir = True
-        if not (hasattr(frame.cir, 'cir_sts1')
-                and hasattr(frame.cir, 'cir_sts2')):
-            has_cir = False
-
-        if not has_cir:
-            empty_cir = [None]*self.cir_sts_len
-
-        # Compute power levels, c.f. DW3000 user manual section 4.7
-        C = frame.cir_analysis_ip.power
-        N = frame.cir_analysis_ip.accum_count
-        D = frame.toa_data.dgc_decision
-        A = 121.7
-        F1 = frame.cir_analysis_ip.F1
-        F2 = frame.cir_analysis_ip.F2
-        F3 = frame.cir_analysis_ip.F3
-        rx_power_level = 10 * math.log10((C * 2**21) / N**2) + (6 * D) - A
-        fp_power_level = 10 * math.log10((F1**2 + F2**2 + F3**2) / N**2) + (6 * D) - A
-
-        data = (
-            frame.serial_timestamp,
-            frame.serial_count,
-            frame.twr_data.rotation,
-            frame.toa_data.pdoa/2**11,
-            frame.toa_data.tdoa,
-            frame.twr_data.dist_mm,
-            rx_power_level,
-            fp_power_level,
-            frame.cir_analysis_sts1.fp_index,
-            frame.cir_analysis_sts2.fp_index,
-            *(frame.cir.cir_sts1 if has_cir else empty_cir),
-            *(frame.cir.cir_sts2 if has_cir else empty_cir),
-        )
-        return data
-
-
-class CacheV5:
-    '''Cache version 5.
-
-    Differences to version 4:
-    - Store all frames, not only TWR result frames
-    - Only store frames with CIR
-    '''
 
-    def __init__(self):
-        # slice of the STS1 and STS2 CIR around the FP index
-        self.cir_sts_slice = (-5, 100)
-        self.cir_sts_slice_len = self.cir_sts_slice[1] - self.cir_sts_slice[0]
+def rx_power_level(table, rows):
+    '''Receive signal power estimate in dBm.'''
+    (C,), N, D, valid = _power_level_inputs(table, rows, 'power')
+    return signal_power.rx_power_level(C, N, D), valid
 
-        # MultiIndex to group CIR slices
-        self.columns = pd.MultiIndex.from_arrays((
-            ['timestamp', 'number', 'rotation', 'pdoa', 'tdoa', 'dist_mm',
-             'rx_power_level', 'fp_power_level',
-             *(['cir_sts1']*self.cir_sts_slice_len),
-             *(['cir_sts2']*self.cir_sts_slice_len)],
-            ['', '', '', '', '', '', '', '',
-             *range(*self.cir_sts_slice), *range(*self.cir_sts_slice)]
-        ))
-
-    def check_frame(self, frame):
-        if (
-                hasattr(frame.cir, 'cir_sts1')
-                and hasattr(frame.cir, 'cir_sts2')
-                and hasattr(frame.cir_analysis_sts1, 'fp_index')
-                and hasattr(frame.cir_analysis_sts2, 'fp_index')
-        ):
-            return True
-        else:
-            return False
-
-    def get_frame_data(self, frame: Frame):
-        fp_sts1 = int(frame.cir_analysis_sts1.fp_index)
-        fp_sts2 = int(frame.cir_analysis_sts2.fp_index)
-        cir_sts1_slice = slice(fp_sts1+self.cir_sts_slice[0],
-                               fp_sts1+self.cir_sts_slice[1])
-        cir_sts2_slice = slice(fp_sts2+self.cir_sts_slice[0],
-                               fp_sts2+self.cir_sts_slice[1])
-
-        # Compute power levels, c.f. DW3000 user section 4.7
-        C = frame.cir_analysis_ip.power
-        N = frame.cir_analysis_ip.accum_count
-        D = frame.toa_data.dgc_decision
-        A = 121.7
-        F1 = frame.cir_analysis_ip.F1
-        F2 = frame.cir_analysis_ip.F2
-        F3 = frame.cir_analysis_ip.F3
-        rx_power_level = 10 * math.log10((C * 2**21) / N**2) + (6 * D) - A
-        fp_power_level = 10 * math.log10((F1**2 + F2**2 + F3**2) / N**2) + (6 * D) - A
-
-        try:
-            rotation = frame.twr_data.rotation
-            dist_mm = frame.twr_data.dist_mm
-        except AttributeError:
-            rotation = None
-            dist_mm = None
-
-        data = (
-            frame.serial_timestamp,
-            frame.serial_count,
-            rotation,
-            frame.toa_data.pdoa/2**11,
-            frame.toa_data.tdoa,
-            dist_mm,
-            rx_power_level,
-            fp_power_level,
-            *frame.cir.cir_sts1[cir_sts1_slice],
-            *frame.cir.cir_sts2[cir_sts2_slice],
-        )
-        return data
+
+def fp_power_level(table, rows):
+    '''First path power estimate in dBm.'''
+    F, N, D, valid = _power_level_inputs(table, rows, 'F1', 'F2', 'F3')
+    return signal_power.fp_power_level(*F, N, D), valid
+
+
+# values and valid mask of the frames `rows` of a FrameTable
+derived_fields = {
+    'rotation': rotation,
+    'rx_power_level': rx_power_level,
+    'fp_power_level': fp_power_level,
+}
+
+
+# Cache version 4.
+#
+# Fields:
+# - `timestamp`: Recording timestamp
+# - `number`: Frame Number
+# - `rotation`: True Rotation
+# - `pdoa`: PDoA measurement
+# - `tdoa`: TDoA measurement
+# - `dist_mm`: TWR distance estimate
+# - `rx_power_level`: Receive signal power estimate
+# - `fp_power_level`: First path power estimate
+# - `cir_sts1` and `cir_sts2`: Complex CIR samples (restricted to 5 samples
+#   before the first path index and 99 samples after the first path index as
+#   computed by the DW3220, i.e. 105 samples total)
+CACHE_V4_FIELDS = (
+    Field('timestamp', 'serial_timestamp'),
+    Field('number', 'serial_count'),
+    Field('rotation', 'rotation'),
+    Field('pdoa', 'toa_data.pdoa', scale=2**-11),
+    Field('tdoa', 'toa_data.tdoa'),
+    Field('dist_mm', 'twr_data.dist_mm'),
+    Field('rx_power_level', 'rx_power_level'),
+    Field('fp_power_level', 'fp_power_level'),
+)
+
+CacheV4 = CacheVersion(
+    require=('twr_data', 'cir_analysis_sts1'),
+    fields=CACHE_V4_FIELDS,
+    cir=CirWindow(('cir_sts1', 'cir_sts2'), -5, 100, relative=True),
+)
+
+# Cache version 4a.
+#
+# Differences to version 4:
+# - Full CIR
+# - `sts1_fp_index` and `sts2_fp_index`: First path index of the STS CIRs
+CacheV4a = CacheVersion(
+    require=('twr_data', 'cir_analysis_sts1'),
+    fields=(
+        *CACHE_V4_FIELDS,
+        Field('sts1_fp_index', 'cir_analysis_sts1.fp_index'),
+        Field('sts2_fp_index', 'cir_analysis_sts2.fp_index'),
+    ),
+    cir=CirWindow(('cir_sts1', 'cir_sts2'), 0, 512, relative=False),
+)
+
+# Cache version 5.
+#
+# Differences to version 4:
+# - Store all frames, not only TWR result frames
+# - Only store frames with CIR
+CacheV5 = CacheVersion(
+    require=('cir', 'cir_analysis_sts1', 'cir_analysis_sts2'),
+    fields=tuple(
+        field._replace(require=('twr_data',))
+        if field.name in ('rotation', 'dist_mm') else field
+        for field in CACHE_V4_FIELDS),
+    cir=CacheV4.cir,
+)
 
 
 cache_versions = {
@@ -270,7 +191,140 @@ cache_versions = {
 }
 
 
-def parse_and_cache(log_files, cache_file, version):
+def _with_missing(values, valid):
+    '''Set the values of invalid rows to NaN (integers are converted to
+    float like a DataFrame built from rows with None).'''
+    if valid.all():
+        return values
+    if values.dtype.kind not in 'fc':
+        values = values.astype(np.float64)
+    values = values.copy()
+    values[~valid] = np.nan
+    return values
+
+
+def field_values(table, field, rows):
+    '''Values of a field of the cache version for the frames `rows`.'''
+    if field.source in derived_fields:
+        values, valid = derived_fields[field.source](table, rows)
+    elif '.' in field.source:
+        attr, name = field.source.split('.')
+        values = table.column(attr, name)[rows]
+        valid = table.present(attr)[rows]
+    else:
+        values = getattr(table, field.source)[rows]
+        valid = np.ones(len(rows), dtype=bool)
+    for attr in field.require:
+        valid = valid & table.present(attr)[rows]
+
+    if values.dtype.kind in 'iu':
+        values = values.astype(np.int64)
+    if field.scale is not None:
+        values = values * field.scale
+    return _with_missing(values, valid)
+
+
+def cir_window(table, window, name, rows):
+    '''CIR samples of the window for the frames `rows` (complex128, NaN
+    where missing).'''
+    length = window.stop - window.start
+    samples = np.full((len(rows), length), complex(np.nan, 0))
+    cir_rows = table.cir_index[rows]
+    valid = cir_rows >= 0
+    start = np.full(len(rows), window.start)
+    if window.relative:
+        # the CIRs of a frame are only stored if the first path index of all
+        # of them is available
+        for other in window.names:
+            valid &= table.present('cir_analysis_' + other[4:])[rows]
+        fp_index = table.column('cir_analysis_' + name[4:], 'fp_index')[rows]
+        start = start + fp_index.astype(np.int64)
+
+    cir = table.cir[name]
+    offsets = np.arange(length)
+    for first in range(0, len(rows), CIR_WINDOW_CHUNK):
+        chunk = slice(first, first + CIR_WINDOW_CHUNK)
+        index = start[chunk, None] + offsets
+        inside = valid[chunk, None] & (index >= 0) & (index < cir.shape[1])
+        row_index = np.broadcast_to(cir_rows[chunk, None], index.shape)
+        samples[chunk][inside] = cir[row_index[inside], index[inside]]
+    return samples
+
+
+# result of building the data table of one log file
+Dataset = namedtuple('Dataset', 'i title filename info content_hash df elapsed '
+                     'output')
+
+
+def file_hash(filename):
+    '''SHA-256 of the file content (hex string).'''
+    sha256 = hashlib.sha256()
+    with open(filename, 'rb') as f:
+        for chunk in iter(lambda: f.read(1 << 20), b''):
+            sha256.update(chunk)
+    return sha256.hexdigest()
+
+
+def definition_hash(version):
+    '''SHA-256 of the declaration of a cache version (hex string), changes
+    with its fields, CIR window and required blobs.'''
+    return hashlib.sha256(repr(cache_versions[version]).encode()).hexdigest()
+
+
+def is_up_to_date(store, title, content_hash, version):
+    '''Check if the cached table of `title` was built from a log with this
+    content hash, with this cache version and definition and with the
+    current parser.'''
+    if f'/cache_{title}/df' not in store.keys():
+        return False
+    info = store.get(f'cache_{title}/info')
+    if not {'content_hash', 'parser_version',
+            'definition_hash'} <= set(info.columns):
+        return False  # cached before these were recorded
+    return (info['content_hash'].iloc[0] == content_hash
+            and str(info['version'].iloc[0]) == str(version)
+            and info['definition_hash'].iloc[0] == definition_hash(version)
+            and int(info['parser_version'].iloc[0]) == Frame.version)
+
+
+def build_dataset(i, title, filename, info, content_hash, version,
+                  progress=True, capture=False):
+    """Parse one log file and build its data table.
+
+    With `capture` the text output is returned in `Dataset.output` instead of
+    printed (used in the worker processes to keep the reports of several files
+    apart).
+    """
+    start = time.perf_counter()
+    output = io.StringIO()
+    with contextlib.redirect_stdout(output) if capture \
+            else contextlib.nullcontext():
+        table, stats = parse_log_file(filename, progress=progress)
+
+        if not len(table):
+            print('No frames, skip building dataframe!')
+            df = None
+        else:
+            print('*** Input statistics')
+            stats.print_stats()
+            df = build_dataframe(table, cache_versions[version])
+
+    return Dataset(i, title, filename, info, content_hash, df,
+                   time.perf_counter() - start, output.getvalue())
+
+
+def parse_and_cache(log_files, cache_file, version, jobs=1, force=False):
+    """Parse the log files and write their data tables to the cache file.
+
+    Log files with the same content hash and cache version as the cached
+    table are skipped (only the info table is updated), unless `force` is set.
+
+    With `jobs` > 1 the files are parsed in a pool of worker processes, the
+    finished tables are written by this process (HDF5 does not support
+    concurrent writers).
+    """
+    start = time.perf_counter()
+
     # open an check output file
     store = pd.HDFStore(cache_file, mode='a')
     if store.keys():
@@ -279,69 +333,109 @@ def parse_and_cache(log_files, cache_file, version):
     else:
         print('Cache file did not exists or is empty...')
 
-    cache_cls = cache_versions[version]()
-
-    # read input files and update cache
-    file_count = len(log_files)
+    tasks = []
     for i, (title, (filename, info)) in enumerate(log_files.items()):
-        print('-------------------------------------')
-        print(f'*** Processing file {i+1}/{file_count} "{title}" '
-              f'(Filename: {filename}, Description: {info})')
-
-        frames, stats = parse_log_file(filename, progress=True)
-
-        if not frames:
-            print('No frames, skip building dataframe!')
+        content_hash = file_hash(filename)
+        if not force and is_up_to_date(store, title, content_hash, version):
+            print(f'*** Unchanged "{title}" (Filename: {filename}), skipped')
+            store_info(i, filename, title, info, content_hash, store,
+                       version)
             continue
-
-        print('*** Input statistics')
-        stats.print_stats()
-
-        df = build_dataframe(frames, cache_cls)
-        store_dataframe(i, filename, title, info, df, store, version)
-        print(f'Finished {title}')
+        tasks.append((i, title, filename, info, content_hash, version))
+    file_count = len(tasks)
+
+    if jobs == 1:
+        # read input files and update cache
+        for n, (i, title, filename, info, content_hash, _) in enumerate(tasks):
+            print('-------------------------------------')
+            print(f'*** Processing file {n+1}/{file_count} "{title}" '
+                  f'(Filename: {filename}, Description: {info})')
+            dataset = build_dataset(i, title, filename, info, content_hash,
+                                    version)
+            write_dataset(dataset, store, version)
+    else:
+        print(f'*** Processing {file_count} files with {jobs} workers')
+        with ProcessPoolExecutor(max_workers=jobs) as pool:
+            futures = [pool.submit(build_dataset, *task, progress=False,
+                                   capture=True)
+                       for task in tasks]
+            for finished, future in enumerate(as_completed(futures)):
+                dataset = future.result()
+                print('-------------------------------------')
+                print(f'*** Finished file {finished+1}/{file_count} '
+                      f'"{dataset.title}" in {dataset.elapsed:.1f} s '
+                      f'(Filename: {dataset.filename}, '
+                      f'Description: {dataset.info})')
+                print(dataset.output, end='')
+                write_dataset(dataset, store, version)
 
     print('Final cache keys:', store.keys())
     store.flush(fsync=True)
     store.close()
+    print(f'Total time: {time.perf_counter() - start:.1f} s')
 
 
-def build_dataframe(frames, cache_cls):
-    """Select relevant frame data and create a DataFrame."""
+def write_dataset(dataset, store, version):
+    if dataset.df is None:
+        return
+    store_dataframe(dataset.i, dataset.filename, dataset.title, dataset.info,
+                    dataset.content_hash, dataset.df, store, version)
+    print(f'Finished {dataset.title}')
 
-    data = []
-    skipped = 0
-    for frame in frames:
-        if not cache_cls.check_frame(frame):
-            # skip e.g. non TWR result frames
-            skipped += 1
-            continue
-        data.append(cache_cls.get_frame_data(frame))
 
-    df = pd.DataFrame(data)
+def build_dataframe(table, cache_version):
+    """Select relevant frame data and create a DataFrame."""
 
-    # Create multiindex to group CIR slices
-    df.columns = cache_cls.columns
+    cached = np.ones(len(table), dtype=bool)
+    for attr in cache_version.require:
+        # skip e.g. non TWR result frames
+        cached &= table.present(attr)
+    rows = np.flatnonzero(cached)
+
+    columns = {(field.name, ''): field_values(table, field, rows)
+               for field in cache_version.fields}
+    parts = [pd.DataFrame(columns)]
+    window = cache_version.cir
+    for name in window.names:
+        # MultiIndex to group CIR slices
+        parts.append(pd.DataFrame(
+            cir_window(table, window, name, rows),
+            columns=pd.MultiIndex.from_product(
+                ([name], range(window.start, window.stop)))))
+    df = pd.concat(parts, axis=1)
 
-    print(f'*** Cached {len(data)} frames (skipped {skipped})')
+    print(f'*** Cached {len(rows)} frames (skipped {len(table) - len(rows)})')
     print('*** DataFrame statistics')
     df.info(memory_usage='deep')
 
     return df
 
 
-def store_dataframe(i, filename, title, description, df, store, version):
-    cache_time = pd.Timestamp.now()
+def store_dataframe(i, filename, title, description, content_hash, df, store,
+                    version):
+    store_info(i, filename, title, description, content_hash, store, version,
+               pd.Timestamp.now())
+    store.put('cache_'+title+'/df', df, format='table')
+
+
+def store_info(i, filename, title, description, content_hash, store, version,
+               cache_time=None):
+    '''Write the info table of a data table (`cache_time` None keeps the
+    time of the cached table).'''
+    if cache_time is None:
+        cache_time = store.get('cache_'+title+'/info')['timestamp'].iloc[0]
+    definition = definition_hash(version)
     try:
         version = int(version)
     except ValueError:
         pass
     info_df = pd.DataFrame(
-        [(i, title, filename, description, cache_time, version)],
-        columns=['i', 'title', 'file_name', 'description', 'timestamp', 'version']
+        [(i, title, filename, description, cache_time, version, content_hash,
+          Frame.version, definition)],
+        columns=['i', 'title', 'file_name', 'description', 'timestamp', 'version',
+                 'content_hash', 'parser_version', 'definition_hash']
     )
     store.put('cache_'+title+'/info', info_df, format='fixed')
-    store.put('cache_'+title+'/df', df, format='table')
 
 
 def main():
@@ -355,6 +449,12 @@ def main():
     parser.add_argument('--version', choices=cache_versions.keys(),
                         default=DEFAULT_CACHE_VERSION,
                         help='Choose cache file/data version to compute.')
+    parser.add_argument('--force', action='store_true',
+                        help='Rebuild all tables, also if the log file and the '
+                        'cache version did not change.')
+    parser.add_argument('--jobs', '-j', type=int, default=1,
+                        help='Number of log files parsed in parallel '
+                        '(0: number of CPUs).')
 
     args = parser.parse_args()
 
@@ -372,7 +472,9 @@ def main():
     print('Input configuration')
     pprint(log_files)
 
-    parse_and_cache(log_files, args.output_file, args.version)
+    jobs = args.jobs if args.jobs > 0 else os.cpu_count()
+    parse_and_cache(log_files, args.output_file, args.version, jobs,
+                    args.force)
 
 
 if __name__ == '__main__':
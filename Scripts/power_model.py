@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+
+
+"""Estimate the current draw of the duty cycled tag from a recorded log.
+
+`twr_tag_duty` puts the DW3000 into DEEPSLEEP and the STM32 into STOP mode
+between two exchanges and reports the time spent in each state with an
+energy blob after every exchange. This script multiplies the times with the
+current of each state and prints per exchange averages:
+- charge and energy of one exchange (DW3000 and STM32 separately)
+- average current over the exchange period and the resulting battery life
+- wake latency, i.e. the time from the wakeup request to the first
+  transmission
+
+The default currents are typical values from the DW3000 and STM32F429
+datasheets at 3.3 V (channel 5, STM32 running from the PLL), measure the own
+hardware and override them with the options if the estimate matters. A
+delayed transmission is scheduled in idle and only draws the TX current while
+the frame is on air, the frame duration is estimated with the radio
+configuration from `application_config.h` (see `twr_timing_model.py`).
+"""
+
+import argparse
+
+import serial_parser
+import twr_timing_model
+
+
+# state of the energy blob -> (option, default current in mA, description)
+dw_states = (
+    ('sleep_us', 'dw-sleep-ma', 0.0005, 'DW3000 DEEPSLEEP'),
+    ('wake_us', 'dw-wake-ma', 4.0, 'DW3000 wakeup and restore (IDLE_RC)'),
+    ('idle_us', 'dw-idle-ma', 11.0, 'DW3000 idle (IDLE_PLL)'),
+    ('tx_us', 'dw-tx-ma', 35.0, 'DW3000 transmitting'),
+    ('rx_us', 'dw-rx-ma', 55.0, 'DW3000 receiver on'),
+)
+
+
+def summarize(samples, currents, frame_us):
+    '''Average charge (uC) of each part of an exchange.
+
+    Returns a dict of charges and the average period in us.
+    '''
+    charge = {}
+    period = 0
+    for sample in samples:
+        for field, option, _, _ in dw_states:
+            charge[field] = (charge.get(field, 0)
+                             + getattr(sample, field) * currents[option])
+
+        # delayed TX: on air for the frame duration, waiting in idle otherwise
+        airtime = min(sample.tx_delayed_count * frame_us,
+                      sample.tx_delayed_us)
+        charge['tx_delayed_us'] = (
+            charge.get('tx_delayed_us', 0)
+            + airtime * currents['dw-tx-ma']
+            + (sample.tx_delayed_us - airtime) * currents['dw-idle-ma'])
+
+        sample_period = (sample.sleep_us + sample.wake_us + sample.idle_us
+                         + sample.tx_us + sample.tx_delayed_us + sample.rx_us)
+        stop = min(sample.mcu_stop_us, sample_period)
+        charge['mcu_stop_us'] = (charge.get('mcu_stop_us', 0)
+                                 + stop * currents['mcu-stop-ma'])
+        charge['mcu_run_us'] = (charge.get('mcu_run_us', 0)
+                                + (sample_period - stop)
+                                * currents['mcu-run-ma'])
+        period += sample_period
+
+    # us * mA = nC, averaged over the exchanges in uC
+    count = len(samples)
+    charge = {k: v / count / 1000 for k, v in charge.items()}
+    return charge, period / count
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('log_file', help='Log file written by serial_reader.py')
+    for _, option, default, description in dw_states:
+        parser.add_argument(f'--{option}', type=float, default=default,
+                            help=f'Current of the {description} state in mA '
+                            '(default: %(default)s)')
+    parser.add_argument('--mcu-run-ma', type=float, default=40.0,
+                        help='Current of the running STM32 in mA '
+                        '(default: %(default)s)')
+    parser.add_argument('--mcu-stop-ma', type=float, default=0.3,
+                        help='Current of the STM32 in STOP mode in mA '
+                        '(default: %(default)s)')
+    parser.add_argument('--voltage', type=float, default=3.3,
+                        help='Supply voltage (default: %(default)s)')
+    parser.add_argument('--battery-mah', type=float, default=1000,
+                        help='Battery capacity for the lifetime estimate '
+                        '(default: %(default)s)')
+    parser.add_argument('--config-file',
+                        default=twr_timing_model.DEFAULT_CONFIG_FILE,
+                        help='Radio configuration for the frame duration '
+                        '(default: application_config.h)')
+
+    args = parser.parse_args()
+    currents = {option: getattr(args, option.replace('-', '_'))
+                for option in [s[1] for s in dw_states]
+                + ['mcu-run-ma', 'mcu-stop-ma']}
+
+    config, _ = twr_timing_model.read_config(args.config_file)
+    model = twr_timing_model.FrameModel(config)
+    frame_us = model.total(twr_timing_model.frame_lengths(1)['twr response'])
+
+    frames, _ = serial_parser.parse_log_file(args.log_file)
+    samples = [frame.energy_data for frame in frames
+               if frame.energy_data is not None]
+    if not samples:
+        print('No energy blobs in the log (application twr_tag_duty?)')
+        return
+
+    charge, period = summarize(samples, currents, frame_us)
+    total = sum(charge.values())
+    dw_total = total - charge['mcu_stop_us'] - charge['mcu_run_us']
+
+    print(f'{len(samples)} exchanges, average period {period / 1000:.1f} ms')
+    print('charge per exchange:')
+    names = {'sleep_us': 'DW3000 sleep', 'wake_us': 'DW3000 wakeup',
+             'idle_us': 'DW3000 idle', 'tx_us': 'DW3000 TX',
+             'tx_delayed_us': 'DW3000 delayed TX', 'rx_us': 'DW3000 RX',
+             'mcu_stop_us': 'STM32 STOP', 'mcu_run_us': 'STM32 running'}
+    for field, name in names.items():
+        share = 100 * charge[field] / total if total else 0
+        print(f'  {name:18} {charge[field]:9.3f} uC  {share:5.1f} %')
+    print(f'  {"DW3000 total":18} {dw_total:9.3f} uC')
+    print(f'  {"total":18} {total:9.3f} uC, '
+          f'{total * args.voltage:.3f} uJ at {args.voltage} V')
+
+    # uC / us = A
+    average_ma = total / period * 1000 if period else 0
+    print(f'average current {average_ma:.3f} mA', end='')
+    if average_ma > 0:
+        print(f', {args.battery_mah / average_ma / 24:.1f} days with '
+              f'{args.battery_mah:g} mAh')
+    else:
+        print()
+
+    latencies = [s.latency_us for s in samples if s.latency_us > 0]
+    if latencies:
+        print(f'wake latency: min {min(latencies)} us, '
+              f'mean {sum(latencies) / len(latencies):.0f} us, '
+              f'max {max(latencies)} us ({len(latencies)} wakeups)')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+
+
+"""Render the execution time statistics of the firmware profile points.
+
+A firmware built with `PROFILE` defined (see `profile.h`) transmits a profile
+blob every few seconds with count, minimum, maximum, sum and a histogram of
+the measured cycles of each profile point (SPI reads, UART output, interrupt
+handler, ranging state transitions, ...). This script sums the blobs of a log
+(or uses only the last one) and prints a table and a text histogram per point.
+The point names are read from the `PROFILE_POINTS` table in `profile.h`, the
+ID of each point is its position in the table.
+
+Histogram bucket 0 counts measurements below 1 us, bucket b measurements from
+2^(b-1) to 2^b us, the last bucket is open ended.
+"""
+
+import os
+import re
+import gzip
+import argparse
+
+import binary_parser
+
+
+DEFAULT_POINT_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                  '..', 'Firmware', 'Core', 'Src', 'platform',
+                                  'profile.h')
+
+point_entry_regex = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+
+BAR_WIDTH = 50
+
+
+def load_points(point_file=DEFAULT_POINT_FILE):
+    '''Read the point table from the PROFILE_POINTS macro.
+
+    Returns a list of (name, description) tuples, the index is the point ID.
+    '''
+    with open(point_file) as f:
+        text = f.read()
+
+    start = text.find('#define PROFILE_POINTS(X)')
+    if start < 0:
+        raise ValueError(f'No PROFILE_POINTS table found in {point_file}')
+    # the macro ends at the first line without continuation
+    end = start
+    while True:
+        end = text.find('\n', end)
+        if end < 0 or not text[:end].rstrip().endswith('\\'):
+            break
+        end += 1
+
+    return point_entry_regex.findall(text[start:end])
+
+
+def read_profiles(log_file):
+    '''Decode all profile blobs of a log written by serial_reader.py.'''
+    profiles = []
+    log_open = gzip.open if log_file.endswith('.gz') else open
+    with log_open(log_file, 'rt') as f:
+        for line in f:
+            if 'BLOB / profile' not in line:
+                continue
+            blob_data = f.readline()
+            try:
+                version = int(line.split('/')[2].strip()[1:])
+                profiles.append(binary_parser.decode_blob_profile(
+                    blob_data.split(':')[2].strip(), version))
+            except (IndexError, ValueError) as e:
+                print(f'Error decoding profile blob ({e}). Line: {line}')
+    return profiles
+
+
+def merge(profiles):
+    '''Sum the statistics of several periods.
+
+    Returns the clock, the total period in ms and a dict of point ID ->
+    (count, min_cycles, max_cycles, sum_cycles, histogram).
+    '''
+    merged = {}
+    for profile in profiles:
+        for point in profile.points:
+            if point.count == 0:
+                continue
+            if point.id not in merged:
+                merged[point.id] = (point.count, point.min_cycles,
+                                    point.max_cycles, point.sum_cycles,
+                                    list(point.histogram))
+                continue
+            count, min_cycles, max_cycles, sum_cycles, histogram = \
+                merged[point.id]
+            merged[point.id] = (
+                count + point.count, min(min_cycles, point.min_cycles),
+                max(max_cycles, point.max_cycles),
+                sum_cycles + point.sum_cycles,
+                [a + b for a, b in zip(histogram, point.histogram)])
+    period_ms = sum(profile.period_ms for profile in profiles)
+    return profiles[-1].clock_hz, period_ms, merged
+
+
+def bucket_label(bucket, bucket_count):
+    def us(value):
+        return f'{value / 1000:g} ms' if value >= 1000 else f'{value} us'
+    if bucket == 0:
+        return '< 1 us'
+    if bucket == bucket_count - 1:
+        return f'>= {us(2**(bucket - 1))}'
+    return f'{us(2**(bucket - 1))} - {us(2**bucket)}'
+
+
+def render(points, clock_hz, period_ms, merged):
+    cycles_per_us = clock_hz / 1e6
+    print(f'{period_ms / 1000:.1f} s profiled, core clock '
+          f'{clock_hz / 1e6:g} MHz')
+    print(f'{"point":28} {"count":>8} {"min us":>10} {"mean us":>10} '
+          f'{"max us":>10} {"% time":>7}')
+    for point_id, (count, min_cycles, max_cycles, sum_cycles, _) in \
+            sorted(merged.items()):
+        name = points[point_id][0] if point_id < len(points) \
+            else f'point {point_id}'
+        share = 100 * sum_cycles / cycles_per_us / 1000 / period_ms \
+            if period_ms else 0
+        print(f'{name:28} {count:8} {min_cycles / cycles_per_us:10.1f} '
+              f'{sum_cycles / count / cycles_per_us:10.1f} '
+              f'{max_cycles / cycles_per_us:10.1f} {share:7.2f}')
+
+    for point_id, (count, _, _, _, histogram) in sorted(merged.items()):
+        name, description = points[point_id] if point_id < len(points) \
+            else (f'point {point_id}', '')
+        print(f'\n{name}: {description}')
+        used = [i for i, n in enumerate(histogram) if n]
+        peak = max(histogram)
+        for bucket in range(used[0], used[-1] + 1):
+            n = histogram[bucket]
+            bar = '#' * round(BAR_WIDTH * n / peak) if peak else ''
+            print(f'  {bucket_label(bucket, len(histogram)):>22} '
+                  f'{n:8} {bar}')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('log_file', help='Log file written by serial_reader.py')
+    parser.add_argument('--last', action='store_true',
+                        help='Only show the last profile blob of the log')
+    parser.add_argument('--points', default=DEFAULT_POINT_FILE,
+                        help='Header file containing the profile point table '
+                        '(default: profile.h)')
+
+    args = parser.parse_args()
+
+    profiles = read_profiles(args.log_file)
+    if not profiles:
+        print('No profile blobs in the log (firmware built without PROFILE?)')
+        return
+    if args.last:
+        profiles = profiles[-1:]
+
+    clock_hz, period_ms, merged = merge(profiles)
+    render(load_points(args.points), clock_hz, period_ms, merged)
+
+
+if __name__ == '__main__':
+    main()
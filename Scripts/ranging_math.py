@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+
+
+"""Distance of the double sided TWR, same integer arithmetic as the firmware.
+
+    tof = (Tround1 * Tround2 - Treply1 * Treply2)
+          / (Tround1 + Tround2 + Treply1 + Treply2)
+
+Treply1 and Tround2 are measured by the device computing the distance,
+Tround1 and Treply2 by the remote device. The remote intervals are converted
+to the local clock with the clock offset of the remote frames (2^-26 units,
+`xtal_offset` of the toa blob). The time of flight is kept in 1/1024 device
+time units (DTU, 1 / (128 * 499.2 MHz) = 15.65 ps) and the antenna delay
+`RANGING_ANTENNA_DELAY_DTU` of `ranging_math.h` is subtracted. The functions
+give bit-identical results to `Firmware/Core/Src/apps/ranging_math.c`.
+
+Run on a log of `twr_pdoa_tag` to recompute the distances of the `twr` blobs.
+With the true distance of the measurement (--distance-mm), the script
+estimates the antenna delay to configure in `ranging_math.h`.
+"""
+
+import os
+import re
+import gzip
+import argparse
+import statistics
+
+import binary_parser
+
+
+DEFAULT_HEADER_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                   '..', 'Firmware', 'Core', 'Src', 'apps',
+                                   'ranging_math.h')
+
+INTERVAL_MASK = 0xFFFFFFFFFF
+CLOCK_OFFSET_BITS = 26
+TOF_FRACTION_BITS = 10
+
+# mm per DTU = c / (128 * 499.2 MHz) = 299792458 / 63897600
+MM_PER_DTU_NUM = 149896229
+MM_PER_DTU_DEN = 31948800
+
+UINT32_MAX = 2**32 - 1
+UINT64_MAX = 2**64 - 1
+INT64_MAX = 2**63 - 1
+
+
+def load_antenna_delay(header_file=DEFAULT_HEADER_FILE):
+    '''Read RANGING_ANTENNA_DELAY_DTU from ranging_math.h.'''
+    with open(header_file) as f:
+        match = re.search(r'#define\s+RANGING_ANTENNA_DELAY_DTU\s+\(?(-?\d+)',
+                          f.read())
+    if match is None:
+        raise ValueError(f'No RANGING_ANTENNA_DELAY_DTU in {header_file}')
+    return int(match.group(1))
+
+
+def div_round(numerator, denominator):
+    '''Division rounded to nearest, saturated like the 128-bit firmware
+    division.'''
+    if denominator == 0:
+        return UINT64_MAX
+    return min((numerator + denominator // 2) // denominator, UINT64_MAX)
+
+
+def remote_to_local(interval, clock_offset):
+    '''Convert an interval measured by the remote device to the local
+    clock.'''
+    interval &= INTERVAL_MASK
+    return interval - ((interval * clock_offset) >> CLOCK_OFFSET_BITS)
+
+
+def tof(Treply1, Tround2, Tround1, Treply2, clock_offset=0,
+        antenna_delay_dtu=0):
+    '''Time of flight in 1/1024 DTU (can be negative).'''
+    Treply1 &= INTERVAL_MASK
+    Tround2 &= INTERVAL_MASK
+    Tround1 = remote_to_local(Tround1, clock_offset)
+    Treply2 = remote_to_local(Treply2, clock_offset)
+
+    numerator = Tround1 * Tround2 - Treply1 * Treply2
+    denominator = Tround1 + Tround2 + Treply1 + Treply2
+    magnitude = div_round(abs(numerator) << TOF_FRACTION_BITS, denominator)
+    if magnitude > INT64_MAX:
+        return -INT64_MAX - 1 if numerator < 0 else INT64_MAX
+    value = -magnitude if numerator < 0 else magnitude
+    return value - (antenna_delay_dtu << TOF_FRACTION_BITS)
+
+
+def tof_to_mm(tof_value):
+    '''Distance in mm of a time of flight in 1/1024 DTU (0 if negative).'''
+    if tof_value <= 0:
+        return 0
+    mm = div_round(tof_value * MM_PER_DTU_NUM,
+                   MM_PER_DTU_DEN << TOF_FRACTION_BITS)
+    return min(mm, UINT32_MAX)
+
+
+def mm_to_dtu(mm):
+    '''Time of flight in DTU of a distance in mm.'''
+    return mm * MM_PER_DTU_DEN / MM_PER_DTU_NUM
+
+
+def distance_mm(Treply1, Tround2, Tround1, Treply2, clock_offset=0,
+                antenna_delay_dtu=0):
+    return tof_to_mm(tof(Treply1, Tround2, Tround1, Treply2, clock_offset,
+                         antenna_delay_dtu))
+
+
+def read_exchanges(log_file):
+    '''Collect the twr blobs of a log with the clock offset of the preceding
+    toa blob (the final frame of the exchange).
+
+    Returns a list of (twr_data, clock_offset) tuples.
+    '''
+    exchanges = []
+    clock_offset = 0
+    log_open = gzip.open if log_file.endswith('.gz') else open
+    with log_open(log_file, 'rt') as f:
+        for line in f:
+            if 'BLOB / toa /' in line:
+                title = 'toa'
+            elif 'BLOB / twr /' in line:
+                title = 'twr'
+            else:
+                continue
+            blob_data = f.readline()
+            try:
+                version = int(line.split('/')[2].strip()[1:])
+                decoded = binary_parser.decoders[title](
+                    blob_data.split(':')[2].strip(), version)
+            except (IndexError, ValueError) as e:
+                print(f'Error decoding blob ({e}). Line: {line}')
+                continue
+            if title == 'toa':
+                clock_offset = decoded.xtal_offset
+            else:
+                exchanges.append((decoded, clock_offset))
+    return exchanges
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('log_file', help='Log file written by serial_reader.py')
+    parser.add_argument('--distance-mm', type=float,
+                        help='True distance, estimate the antenna delay')
+    parser.add_argument('--antenna-delay', type=int,
+                        help='Antenna delay in DTU (default: '
+                        'RANGING_ANTENNA_DELAY_DTU of ranging_math.h)')
+
+    args = parser.parse_args()
+    antenna_delay = args.antenna_delay if args.antenna_delay is not None \
+        else load_antenna_delay()
+
+    exchanges = read_exchanges(args.log_file)
+    if not exchanges:
+        print('No twr blobs in the log')
+        return
+
+    firmware = [twr.dist_mm for twr, _ in exchanges]
+    raw_tof = [tof(twr.Treply1, twr.Tround2, twr.Tround1, twr.Treply2,
+                   clock_offset) / 2**TOF_FRACTION_BITS
+               for twr, clock_offset in exchanges]
+    recomputed = [distance_mm(twr.Treply1, twr.Tround2, twr.Tround1,
+                              twr.Treply2, clock_offset, antenna_delay)
+                  for twr, clock_offset in exchanges]
+    offsets = [clock_offset for _, clock_offset in exchanges]
+
+    print(f'{len(exchanges)} exchanges, clock offset '
+          f'{statistics.mean(offsets) / 2**CLOCK_OFFSET_BITS * 1e6:+.3f} ppm')
+    print(f'distance in the blobs: mean {statistics.mean(firmware):.0f} mm, '
+          f'stdev {statistics.pstdev(firmware):.0f} mm')
+    print(f'recomputed (antenna delay {antenna_delay} DTU): mean '
+          f'{statistics.mean(recomputed):.0f} mm, '
+          f'stdev {statistics.pstdev(recomputed):.0f} mm')
+
+    if args.distance_mm is not None:
+        delay = statistics.mean(raw_tof) - mm_to_dtu(args.distance_mm)
+        print(f'antenna delay at {args.distance_mm:.0f} mm: {delay:.1f} DTU '
+              f'(#define RANGING_ANTENNA_DELAY_DTU ({round(delay)}))')
+
+
+if __name__ == '__main__':
+    main()
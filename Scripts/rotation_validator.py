@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+
+
+"""Check the turntable angles of a recorded log.
+
+Every measurement of `twr_pdoa_tag` with `ROTATE` defined carries a rotation
+blob with the angle of the turntable when the final frame was received
+(interpolated between the motor steps). Before a log is used as dataset this
+script checks that:
+- the angle is monotonic within each sweep. A sweep ends where the commanded
+  direction changes (continuous rotation to 360 degrees and back) or, for the
+  stepping mode, where the direction changes at a multiple of 360 degrees.
+- the measurements are dense enough: the largest angle step between two
+  consecutive measurements of a sweep and the number of measurements in each
+  angle bin (angles wrapped to 0-360 degrees) are compared against limits.
+
+The measured rotation rate (least squares fit of angle over device time) is
+printed for each sweep, together with the commanded rate. The script exits
+with a nonzero status if a check fails.
+"""
+
+import sys
+import argparse
+
+import serial_parser
+
+
+def split_sweeps(samples, turn_tolerance_mdeg):
+    '''Split the rotation samples into sweeps of one direction.
+
+    Returns a list of (direction, samples) tuples, direction is 1, -1 or 0
+    (turntable did not move).
+    '''
+    sweeps = []
+    current = []
+    direction = 0
+
+    for sample in samples:
+        if current:
+            previous = current[-1]
+            delta = sample.angle_mdeg - previous.angle_mdeg
+            commanded_turn = (sample.rate != 0 and previous.rate != 0
+                              and (sample.rate > 0) != (previous.rate > 0))
+            at_turning_point = (
+                abs(previous.angle_mdeg - round(previous.angle_mdeg / 360000)
+                    * 360000) <= turn_tolerance_mdeg)
+            stepping_turn = (sample.rate == 0 and direction != 0
+                             and delta * direction < 0 and at_turning_point)
+
+            if commanded_turn or stepping_turn:
+                sweeps.append((direction, current))
+                current = [previous]
+                direction = 0
+
+            if direction == 0:
+                if sample.rate != 0:
+                    direction = 1 if sample.rate > 0 else -1
+                elif delta != 0:
+                    direction = 1 if delta > 0 else -1
+
+        current.append(sample)
+
+    if current:
+        sweeps.append((direction, current))
+    return sweeps
+
+
+def fit_rate(samples):
+    '''Least squares slope of the angle over the device time in deg/s.'''
+    if len(samples) < 2:
+        return None
+    t = [s.tick_ms / 1000 for s in samples]
+    a = [s.angle_mdeg / 1000 for s in samples]
+    t_mean = sum(t) / len(t)
+    a_mean = sum(a) / len(a)
+    var = sum((x - t_mean)**2 for x in t)
+    if var == 0:
+        return None
+    return sum((x - t_mean) * (y - a_mean) for x, y in zip(t, a)) / var
+
+
+def validate(samples, bin_deg=1.0, min_per_bin=1, max_gap_deg=1.0,
+             turn_tolerance_deg=1.0):
+    '''Check monotonicity and density of the rotation samples.
+
+    Returns a list of error messages (empty if the log is fine).
+    '''
+    errors = []
+
+    if not samples:
+        return ['No rotation blobs in the log (ROTATE not defined?)']
+
+    sweeps = split_sweeps(samples, turn_tolerance_deg * 1000)
+
+    print(f'{len(samples)} measurements in {len(sweeps)} sweep(s)')
+    for i, (direction, sweep) in enumerate(sweeps):
+        start = sweep[0].angle_mdeg / 1000
+        end = sweep[-1].angle_mdeg / 1000
+        rate = fit_rate(sweep)
+        commanded = sweep[-1].rate
+        rate_text = f'{rate:.3f} deg/s' if rate is not None else '-'
+        print(f'  sweep {i}: {start:.3f} -> {end:.3f} deg, '
+              f'{len(sweep)} measurements, rate {rate_text} '
+              f'(commanded {commanded if commanded else "stepping"})')
+
+        backwards = 0
+        max_gap = 0
+        for previous, sample in zip(sweep, sweep[1:]):
+            delta = sample.angle_mdeg - previous.angle_mdeg
+            if direction != 0 and delta * direction < 0:
+                backwards += 1
+                if backwards <= 5:
+                    errors.append(
+                        f'sweep {i}: angle not monotonic at twr_count '
+                        f'{sample.twr_count} ({previous.angle_mdeg / 1000:.3f}'
+                        f' -> {sample.angle_mdeg / 1000:.3f} deg)')
+            max_gap = max(max_gap, abs(delta) / 1000)
+        if backwards > 5:
+            errors.append(f'sweep {i}: {backwards - 5} more non-monotonic '
+                          'angles')
+        if max_gap > max_gap_deg:
+            errors.append(f'sweep {i}: largest angle step {max_gap:.3f} deg '
+                          f'exceeds {max_gap_deg} deg')
+
+    # measurements per angle bin over the wrapped angle
+    bin_count = int(round(360 / bin_deg))
+    bins = [0] * bin_count
+    for sample in samples:
+        wrapped = (sample.angle_mdeg / 1000) % 360
+        bins[min(int(wrapped / bin_deg), bin_count - 1)] += 1
+
+    sparse = [i for i, count in enumerate(bins) if count < min_per_bin]
+    print(f'measurements per {bin_deg} deg bin: min {min(bins)}, '
+          f'mean {sum(bins) / bin_count:.1f}, max {max(bins)}')
+    if sparse:
+        ranges = ', '.join(f'{i * bin_deg:g}' for i in sparse[:10])
+        more = f' (+{len(sparse) - 10} more)' if len(sparse) > 10 else ''
+        errors.append(f'{len(sparse)} bin(s) with less than {min_per_bin} '
+                      f'measurement(s), starting at {ranges}{more} deg')
+
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('log_file', help='Log file written by serial_reader.py')
+    parser.add_argument('--bin-deg', type=float, default=1.0,
+                        help='Width of the angle bins in degrees '
+                        '(default: %(default)s)')
+    parser.add_argument('--min-per-bin', type=int, default=1,
+                        help='Minimum number of measurements in each bin '
+                        '(default: %(default)s)')
+    parser.add_argument('--max-gap-deg', type=float, default=1.0,
+                        help='Maximum angle step between two consecutive '
+                        'measurements (default: %(default)s)')
+    parser.add_argument('--turn-tolerance-deg', type=float, default=1.0,
+                        help='Distance from a multiple of 360 degrees at which '
+                        'the stepping mode may turn around '
+                        '(default: %(default)s)')
+
+    args = parser.parse_args()
+
+    frames, _ = serial_parser.parse_log_file(args.log_file)
+    samples = [frame.rotation_data for frame in frames
+               if frame.rotation_data is not None]
+
+    errors = validate(samples, args.bin_deg, args.min_per_bin,
+                      args.max_gap_deg, args.turn_tolerance_deg)
+    for error in errors:
+        print('ERROR:', error)
+    if errors:
+        sys.exit(1)
+    print('OK')
+
+
+if __name__ == '__main__':
+    main()
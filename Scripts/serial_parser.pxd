@@ -7,8 +7,7 @@ cdef class Statistics:
     cdef public long file_size
     cpdef print_stats(self)
 
-@cython.locals(line=str, split_line=list, cir_split=list, cir=list)
-cdef parse_cir_line(str line)
+cdef count_status_line(str line, Statistics statistics)
 
 @cython.locals(line=str, info=list)
 cpdef parse_log_file(str: logfile, bint progress=*)
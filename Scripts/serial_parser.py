@@ -3,19 +3,124 @@
 
 import os
 import gzip
-import functools
+import binascii
 
 import tqdm
+import numpy as np
 
+import blob_schema
 import binary_parser
+import bulk_decoder
+import trace_decoder
+
+
+class FrameTable:
+    '''All frames of a log as columns (struct of arrays).
+
+    Frame information:
+    - `serial_timestamp` (float64), `frame_type` (str), `sequence_number`
+      (int64): one entry per frame
+    - `radio_configs`: list of the radio configurations of the log,
+      `config_index` (int32) the active configuration of each frame (-1 if
+      none was received yet)
+
+    Blob data (attribute names of `Frame.binary_to_attr`, e.g. 'toa_data'):
+    - `column(attr, field)` returns the values of one field for all frames
+      (contiguous array, `fill` where the frame has no such blob),
+      `present(attr)` the mask of frames with the blob
+    - `blobs[attr]` holds the structured array of all received blobs
+      (see bulk_decoder.py), `blob_index[attr]` the row of each frame (-1 if
+      missing)
+
+    CIR (`cir_index` maps frames to rows, -1 without CIR):
+    - `cir[name]`: 2-D complex64 array, name is 'cir_ip', 'cir_sts1' or
+      'cir_sts2'
+    - `cir_abs(name)`: magnitude, computed on first use for all frames
+
+    Indexing and iteration return `Frame` row views with the attributes of the
+    former per frame objects (namedtuples are created on access).
+    '''
+
+    def __init__(self, serial_timestamp, frame_type, sequence_number,
+                 config_index, radio_configs, blobs, blob_frames, cir,
+                 cir_frames):
+        self.serial_timestamp = np.asarray(serial_timestamp, dtype=np.float64)
+        self.frame_type = np.asarray(frame_type, dtype=str)
+        self.sequence_number = np.asarray(sequence_number, dtype=np.int64)
+        self.config_index = np.asarray(config_index, dtype=np.int32)
+        self.radio_configs = radio_configs
+        # counter of the frame (the first frame is 1)
+        self.serial_count = np.arange(1, len(self) + 1)
+
+        self.blobs = blobs
+        self.blob_index = {attr: self._index(blob_frames[attr])
+                           for attr in blobs}
+        self.cir = cir
+        self.cir_index = self._index(cir_frames)
+        self._cir_abs = {}
+
+    def _index(self, frames):
+        '''Row of each frame (if a frame has several blobs the last one is
+        used).'''
+        index = np.full(len(self), -1, dtype=np.int32)
+        frames = np.asarray(frames, dtype=np.int64)
+        index[frames] = np.arange(len(frames), dtype=np.int32)
+        return index
+
+    def __len__(self):
+        return len(self.serial_timestamp)
+
+    def __getitem__(self, i):
+        if i < 0:
+            i += len(self)
+        if not 0 <= i < len(self):
+            raise IndexError('frame index out of range')
+        return Frame(self, i)
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield Frame(self, i)
+
+    def present(self, attr):
+        '''Mask of the frames with blob data `attr` (e.g. 'toa_data').'''
+        if attr == 'cir':
+            return self.cir_index >= 0
+        if attr not in self.blob_index:
+            return np.zeros(len(self), dtype=bool)
+        return self.blob_index[attr] >= 0
+
+    def column(self, attr, field, fill=0):
+        '''Field of blob data `attr` of all frames (`fill` if missing).'''
+        if attr not in self.blobs:
+            return np.full(len(self), fill)
+        values = self.blobs[attr][field]
+        index = self.blob_index[attr]
+        mask = index >= 0
+        column = np.full(len(self), fill, dtype=np.result_type(values, fill))
+        column[mask] = values[index[mask]]
+        return column
+
+    def cir_abs(self, name):
+        '''Magnitude of the CIR `name` (rows of `cir_index`).'''
+        if name not in self._cir_abs:
+            self._cir_abs[name] = np.abs(self.cir[name])
+        return self._cir_abs[name]
+
+    def blob(self, attr, i):
+        '''Blob data `attr` of frame `i` as namedtuple (None if missing).'''
+        index = self.blob_index.get(attr)
+        if index is None or index[i] < 0:
+            return None
+        row = self.blobs[attr][index[i]]
+        return Frame.binary_to_type[attr]._make(
+            row[name].item() for name in Frame.binary_to_type[attr]._fields)
 
 
 class Frame:
-    version = 7
+    '''View of one frame of a FrameTable (attributes are read only).'''
+    version = 13
 
-    __slots__ = ('serial_timestamp', 'serial_count', 'frame_type',
-                 'sequence_number', 'toa_data', 'cir_analysis_ip',
-                 'cir_analysis_sts1', 'cir_analysis_sts2', 'cir', 'twr_data')
+    __slots__ = ('_table', '_index')
 
     binary_to_attr = {
         'toa': 'toa_data',
@@ -24,58 +129,104 @@ class Frame:
         'cir analysis sts2': 'cir_analysis_sts2',
         'cir': 'cir',
         'twr': 'twr_data',
+        'twr multi': 'twr_multi_data',
+        'rotation': 'rotation_data',
+        'energy': 'energy_data',
+        'aoa': 'aoa_data',
     }
 
-    def __init__(self):
-        # Set initial values and types separately to allow for type checking
-        self.serial_timestamp: float = None
-        self.serial_count: int = None
-        self.frame_type: str = None
-        self.sequence_number: int = None
-        self.toa_data: binary_parser.toa_data = None
-        self.cir_analysis_ip: binary_parser.cir_analysis_data = None
-        self.cir_analysis_sts1: binary_parser.cir_analysis_data = None
-        self.cir_analysis_sts2: binary_parser.cir_analysis_data = None
-        self.cir: binary_parser.cir_data = None
-        self.twr_data: binary_parser.twr_data = None
+    # namedtuple of the blob data attributes
+    binary_to_type = {
+        'toa_data': binary_parser.toa_data,
+        'cir_analysis_ip': binary_parser.cir_analysis_data,
+        'cir_analysis_sts1': binary_parser.cir_analysis_data,
+        'cir_analysis_sts2': binary_parser.cir_analysis_data,
+        'twr_data': binary_parser.twr_data,
+        'twr_multi_data': binary_parser.twr_multi_data,
+        'rotation_data': binary_parser.rotation_data,
+        'energy_data': binary_parser.energy_data,
+        'aoa_data': binary_parser.aoa_data,
+    }
+
+    attributes = ('serial_timestamp', 'serial_count', 'frame_type',
+                  'sequence_number', 'toa_data', 'cir_analysis_ip',
+                  'cir_analysis_sts1', 'cir_analysis_sts2', 'cir', 'twr_data',
+                  'twr_multi_data', 'rotation_data', 'energy_data',
+                  'aoa_data', 'radio_config')
+
+    def __init__(self, table, index):
+        self._table = table
+        self._index = index
 
     @property
-    @functools.cache
-    def cir_ip_abs(self):
-        if self.cir:
-            return tuple(abs(cir) for cir in self.cir.cir_ip)
-        else:
+    def serial_timestamp(self):
+        return float(self._table.serial_timestamp[self._index])
+
+    @property
+    def serial_count(self):
+        return int(self._table.serial_count[self._index])
+
+    @property
+    def frame_type(self):
+        return str(self._table.frame_type[self._index])
+
+    @property
+    def sequence_number(self):
+        return int(self._table.sequence_number[self._index])
+
+    @property
+    def radio_config(self):
+        '''Radio configuration active when the frame was received.'''
+        config = self._table.config_index[self._index]
+        return self._table.radio_configs[config] if config >= 0 else None
+
+    @property
+    def cir(self):
+        row = self._table.cir_index[self._index]
+        if row < 0:
             return None
+        # complex128 like the per blob decoder (the table stores complex64)
+        return binary_parser.cir_data(
+            *(self._table.cir[name][row].astype(np.complex128)
+              for name in binary_parser.cir_data._fields))
+
+    def _cir_abs(self, name):
+        row = self._table.cir_index[self._index]
+        if row < 0:
+            return None
+        return self._table.cir_abs(name)[row]
+
+    @property
+    def cir_ip_abs(self):
+        return self._cir_abs('cir_ip')
 
     @property
-    @functools.cache
     def cir_sts1_abs(self):
-        if self.cir:
-            return tuple(abs(cir) for cir in self.cir.cir_sts1)
-        else:
-            return None
+        return self._cir_abs('cir_sts1')
 
     @property
-    @functools.cache
     def cir_sts2_abs(self):
-        if self.cir:
-            return tuple(abs(cir) for cir in self.cir.cir_sts2)
-        else:
-            return None
+        return self._cir_abs('cir_sts2')
 
     def print_frame(self):
-        for attr in self.__slots__:
+        for attr in self.attributes:
             if attr == 'cir' and self.cir:
                 print('cir ip:', *(self.cir.cir_ip[i] for i in range(5)), '...')
                 print('cir sts1:', *(self.cir.cir_sts1[i] for i in range(5)), '...')
                 print('cir sts2:', *(self.cir.cir_sts2[i] for i in range(5)), '...')
                 continue
 
-            if attr.startswith('_'):
-                attr = attr[1:]
             print(attr + ':', getattr(self, attr))
 
 
+def _blob_property(attr):
+    return property(lambda self: self._table.blob(attr, self._index))
+
+
+for _attr in Frame.binary_to_type:
+    setattr(Frame, _attr, _blob_property(_attr))
+
+
 class Statistics:
     __slots__ = ('start_time', 'end_time', 'frame_count', 'twr_count',
                  'error_count_timeout', 'error_count_ranging',
@@ -90,22 +241,40 @@ class Statistics:
             print(attr + ':', getattr(self, attr))
 
 
-def parse_cir_line(line):
-    # remove serial receiver timestamp and line label
-    line = line[line.find(':')+1:]
-    # split line into separate samples and remove end marker
-    split_line = line.split('|')[:-1]
-    # split samples into separate numbers (real and imaginary part)
-    cir_split = [x.split() for x in split_line]
-    # convert samples into actual python complex numbers
-    cir = [int(x[2]) + 1j*int(x[4]) for x in cir_split]
-    return cir
+def count_status_line(line, statistics):
+    if 'dist_mm' in line:
+        # The distance is contained in the twr blob, this is only used
+        # as marker to count successful TWR exchanges.
+        statistics.twr_count += 1
+    elif 'Timeout' in line:
+        statistics.error_count_timeout += 1
+    elif 'Ranging error' in line:
+        # note this includes the sts count
+        statistics.error_count_ranging += 1
+    elif 'bad STS' in line:
+        statistics.error_count_sts_qual += 1
 
 
 def parse_log_file(logfile: str, progress=False):
-    frames: list[Frame] = []
-    current_frame = Frame()
+    '''Read a log file into a FrameTable.
+
+    The blobs are collected while reading and decoded in bulk at the end.
+    Blobs before the first frame and of frames with an invalid header are
+    ignored.
+    '''
     statistics = Statistics()
+    trace = trace_decoder.TraceDecoder()
+    radio_configs = []
+
+    serial_timestamp = []
+    frame_type = []
+    sequence_number = []
+    config_index = []
+    # blob title: (list of raw blobs, list of frame indices)
+    blob_data = {title: ([], []) for title in blob_schema.blobs_by_title}
+    blob_sizes = {title: blob_schema.transmitted_size(blob)
+                  for title, blob in blob_schema.blobs_by_title.items()}
+    cir_data = ([], [])
 
     compressed = logfile.endswith('.gz')
     if compressed:
@@ -125,8 +294,7 @@ def parse_log_file(logfile: str, progress=False):
             progress_bar = tqdm.tqdm(total=statistics.file_size, unit='B',
                                      unit_scale=True)
 
-        statistics.frame_count = 0
-        bad_frame = False
+        frame = -1  # index of the current frame, -1 if none or invalid
         while True:
             line = f.readline()
             if not line:
@@ -136,23 +304,23 @@ def parse_log_file(logfile: str, progress=False):
                 progress_bar.update(fo.tell() - progress_bar.n)
 
             if 'New Frame' in line:
-                if not bad_frame:
-                    frames.append(current_frame)
-                    statistics.frame_count += 1
-                current_frame = Frame()
-                bad_frame = False
+                frame = -1
                 try:
                     info = line.split(':')
-                    current_frame.serial_timestamp = float(info[0])
-                    current_frame.frame_type = info[2].strip()
-                    current_frame.sequence_number = int(info[3].strip())
-                    current_frame.serial_count = statistics.frame_count
-                except IndexError:
+                    timestamp = float(info[0])
+                    current_type = info[2].strip()
+                    current_sequence_number = int(info[3].strip())
+                except (IndexError, ValueError):
                     print(f'Error reading frame info: {line}')
-                    bad_frame = True
+                    continue
+                frame = len(serial_timestamp)
+                serial_timestamp.append(timestamp)
+                frame_type.append(current_type)
+                sequence_number.append(current_sequence_number)
+                config_index.append(len(radio_configs) - 1)
 
             elif 'BLOB' in line:
-                blob_data = f.readline()
+                blob_line = f.readline()
 
                 try:
                     header = line.split('/')
@@ -162,53 +330,90 @@ def parse_log_file(logfile: str, progress=False):
                     print(f'Error decoding blob. Line: {line}')
                     continue
 
-                try:
-                    decoder = binary_parser.decoders[title]
-                    attribute = Frame.binary_to_attr[title]
-                    decoded = decoder(blob_data.split(':')[2], version)
-                    setattr(current_frame, attribute, decoded)
-                except KeyError:
+                if title == 'trace':
+                    # debug text output, only used for the statistics
+                    try:
+                        lines = trace.decode_blob(blob_line.split(':')[2],
+                                                  version)
+                    except (ValueError, IndexError) as e:
+                        print('Binary decoding error!', e)
+                        continue
+                    for trace_line in lines:
+                        count_status_line(trace_line, statistics)
+                    continue
+
+                if title == 'profile':
+                    # execution time statistics of the firmware, not part
+                    # of a measurement (see profile_histogram.py)
+                    continue
+
+                if title == 'config':
+                    # applies to all following frames (sent after reset and
+                    # after every reconfiguration)
+                    try:
+                        radio_configs.append(binary_parser.decode_blob_config(
+                            blob_line.split(':')[2], version))
+                    except (ValueError, IndexError) as e:
+                        print('Binary decoding error!', e)
+                    continue
+
+                if title != 'cir' and title not in blob_data:
                     print('Unsupported binary!', line)
-                except (ValueError, IndexError, AttributeError) as e:
+                    continue
+
+                if frame < 0:
+                    continue
+
+                try:
+                    data = binascii.a2b_base64(blob_line.split(':', 2)[2])
+                except (ValueError, IndexError) as e:
                     print('Binary decoding error!', e)
+                    continue
 
-            elif 'dist_mm' in line:
-                # The distance is contained in the twr blob, this is only used
-                # as marker to count successful TWR exchanges.
-                statistics.twr_count += 1
-            elif 'Timeout' in line:
-                statistics.error_count_timeout += 1
-            elif 'Ranging error' in line:
-                # note this includes the sts count
-                statistics.error_count_ranging += 1
-            elif 'bad STS' in line:
-                statistics.error_count_sts_qual += 1
-
-    # add the last frame
-    frames.append(current_frame)
-    # remove data received before first frame header
-    del frames[0]
+                if title == 'cir':
+                    expected_version, expected_size = 1, bulk_decoder.CIR_BLOB_SIZE
+                    collected = cir_data
+                else:
+                    expected_version = blob_schema.blobs_by_title[title].version
+                    expected_size = blob_sizes[title]
+                    collected = blob_data[title]
+
+                if version != expected_version:
+                    print('Binary decoding error! Unsupported version:',
+                          version)
+                    continue
+                if len(data) != expected_size:
+                    print('Binary decoding error! Invalid length:', len(data))
+                    continue
+
+                collected[0].append(data)
+                collected[1].append(frame)
+
+            else:
+                count_status_line(line, statistics)
 
     if progress:
         progress_bar.close()
 
-    if frames:
-        statistics.start_time = frames[0].serial_timestamp
-        statistics.end_time = frames[-1].serial_timestamp
-        statistics.twr_count
+    blobs = {}
+    blob_frames = {}
+    for title, (data, frames) in blob_data.items():
+        if data:
+            attr = Frame.binary_to_attr[title]
+            blobs[attr] = bulk_decoder.decode_blobs(title, b''.join(data),
+                                                    frames)
+            blob_frames[attr] = frames
+    cir = bulk_decoder.decode_cir_blobs(b''.join(cir_data[0]))
+
+    table = FrameTable(serial_timestamp, frame_type, sequence_number,
+                       config_index, radio_configs, blobs, blob_frames, cir,
+                       cir_data[1])
+
+    statistics.frame_count = len(table)
+    if len(table):
+        statistics.start_time = table.serial_timestamp[0]
+        statistics.end_time = table.serial_timestamp[-1]
     else:
         print('No frames!!!')
 
-    return frames, statistics
-
-
-if __name__ == '__main__':
-    import argparse
-    parser = argparse.ArgumentParser()
-    parser.add_argument('log_file')
-    args = parser.parse_args()
-    frames, statistics = parse_log_file(args.log_file, progress=True)
-    statistics.print_stats()
-    for frame in frames:
-        frame.print_frame()
-        print('---------------')
+    return table, statistics
@@ -1,17 +1,45 @@
 #!/usr/bin/env python3
 
+"""Log the output of the UWB module received over the serial port.
+
+The serial port is read by a capture thread that only copies the received
+bytes into a ring of preallocated buffers and hands them over a bounded queue.
+The main thread splits the stream into lines and blobs and writes the log
+file, a third thread decodes and prints the data for the terminal at a limited
+rate (`--print-rate`, everything is logged). If the main thread falls behind
+until the ring is full, the received bytes are dropped and counted (`Serial
+data lost: <n> bytes` in the log) instead of overflowing the buffer of the
+operating system unnoticed.
+"""
+
 import sys
 import gzip
 import time
+import queue
 import base64
 import argparse
 import functools
+import threading
 from dataclasses import dataclass
 
 from tqdm import tqdm
 import serial
 
 import binary_parser
+import trace_decoder
+
+
+BAUDRATE = 2250000
+READ_TIMEOUT = 0.1  # s, the capture thread checks for stop requests
+
+# Capture ring: the largest blob (CIR, 12 KB) fits into one buffer, the ring
+# holds about 15 s of data at full rate
+SLOT_SIZE = 16384
+SLOT_COUNT = 256
+MAX_BLOB_LENGTH = 65536  # longer blobs are treated as corrupted header
+
+DISPLAY_QUEUE_SIZE = 64
+DEFAULT_PRINT_RATE = 50  # lines and blobs per second
 
 
 @dataclass
@@ -21,7 +49,10 @@ class Limits():
     last_twr_count: int
 
 
-def write_log_and_print(msg, time=None, time_offset=0, log_file=None):
+def write_log_and_print(msg, time=None, time_offset=0, log_file=None,
+                        echo=True):
+    '''Write a line to the log file (and the terminal with `echo`), returns
+    the formatted line.'''
     log_format = '{:010.5f}: {}'
     log_format_no_time = 'XXXX.XXXXX: {}'
 
@@ -30,17 +61,239 @@ def write_log_and_print(msg, time=None, time_offset=0, log_file=None):
     else:
         msg = log_format_no_time.format(msg)
 
+    if echo:
+        print_line(msg)
+
+    if log_file:
+        log_file.write(msg)
+        log_file.write('\n')
+
+    return msg
+
+
+def print_line(msg):
     if len(msg) > 200:
         tqdm.write(msg[:200] + ' ...')
     else:
         tqdm.write(msg)
 
-    if log_file:
-        log_file.write(msg)
-        log_file.write('\n')
+
+def parse_blob_header(line):
+    """Title, version and length of a blob header line.
+
+    Header line format: "BLOB / type / version / length"
+    example: "BLOB / rx diag / v1 / 10"
+    """
+    header = line.split('/')
+    title = header[1].strip()
+    version = int(header[2].strip()[1:])
+    length = int(header[3].strip())
+    return title, version, length
+
+
+class CaptureThread(threading.Thread):
+    '''Read the serial port into a ring of preallocated buffers.
+
+    Each filled buffer is queued as (receive time, data, lost bytes), `lost` is
+    the number of bytes dropped right before it because the queue was full.
+    The queue holds two buffers less than the ring, a buffer is not reused
+    before it was consumed.
+    '''
+
+    def __init__(self, ser, slot_size=SLOT_SIZE, slot_count=SLOT_COUNT):
+        super().__init__(name='serial capture', daemon=True)
+        self.ser = ser
+        self.slots = [memoryview(bytearray(slot_size))
+                      for _ in range(slot_count)]
+        self.queue = queue.Queue(maxsize=slot_count - 2)
+        self.stop_event = threading.Event()
+        self.error = None
+        self.lost_bytes = 0
+        self.high_water = 0  # maximum number of queued buffers
+
+    def run(self):
+        slot = 0
+        lost = 0
+        try:
+            while not self.stop_event.is_set():
+                buffer = self.slots[slot]
+                # blocks until the first byte (or timeout), then takes what
+                # has arrived
+                wanted = min(len(buffer), max(1, self.ser.in_waiting))
+                count = self.ser.readinto(buffer[:wanted])
+                if not count:
+                    continue
+                try:
+                    self.queue.put_nowait((time.time(), buffer[:count], lost))
+                except queue.Full:
+                    lost += count
+                    self.lost_bytes += count
+                    continue
+                lost = 0
+                slot = (slot + 1) % len(self.slots)
+                self.high_water = max(self.high_water, self.queue.qsize())
+        except serial.SerialException as e:
+            self.error = e
+        finally:
+            self.queue.put(None)
+
+    def chunks(self):
+        '''Received buffers until the thread stops, raises its serial
+        error.'''
+        while True:
+            item = self.queue.get()
+            if item is None:
+                break
+            yield item
+        if self.error is not None:
+            raise self.error
+
+    def stop(self):
+        self.stop_event.set()
+        while self.is_alive():
+            # unblock the end marker
+            try:
+                self.queue.get(timeout=READ_TIMEOUT)
+            except queue.Empty:
+                pass
+
+
+class StreamFramer:
+    '''Split the received bytes into text lines and blobs.
+
+    `feed()` returns the records completed by the data: (line, None) for a
+    text line and (header line, data) for a blob (the header is followed by
+    the number of raw bytes given in it). Lines are stripped, empty lines and
+    lines that are not printable ASCII are skipped. Header lines that cannot be
+    parsed (or announce more than MAX_BLOB_LENGTH bytes) are returned as text
+    lines.
+    '''
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.blob_header = None
+        self.blob_length = 0
+        self.resync = False
+
+    def reset(self):
+        '''Discard the incomplete record after lost data. The data continues
+        anywhere (e.g. inside the raw bytes of a blob), everything up to the
+        next blob header is skipped.'''
+        self.buffer.clear()
+        self.blob_header = None
+        self.resync = True
+
+    def feed(self, data):
+        self.buffer += data
+        records = []
+        start = 0
+        while True:
+            if self.blob_header is not None:
+                end = start + self.blob_length
+                if end > len(self.buffer):
+                    break
+                records.append((self.blob_header,
+                                bytes(self.buffer[start:end])))
+                self.blob_header = None
+                start = end
+                continue
+
+            end = self.buffer.find(b'\n', start)
+            if end < 0:
+                break
+            line_raw = self.buffer[start:end]
+            start = end + 1
+
+            try:
+                line = line_raw.decode('ascii').strip()
+            except UnicodeDecodeError:
+                continue
+            if not line or not line.isprintable():
+                continue
+
+            if 'BLOB' in line:
+                try:
+                    length = parse_blob_header(line)[2]
+                except (IndexError, ValueError):
+                    length = None
+                if length is not None and 0 <= length <= MAX_BLOB_LENGTH:
+                    self.blob_header = line
+                    self.blob_length = length
+                    self.resync = False
+                    continue
+            if not self.resync:
+                records.append((line, None))
+
+        del self.buffer[:start]
+        return records
+
+
+class LiveDecoder(threading.Thread):
+    '''Print log lines and decoded blobs for the terminal.
+
+    `offer()` never blocks the caller: records beyond `rate` per second (bursts
+    up to one second) or while the printing is behind are skipped and
+    counted, they are only in the log file.
+    '''
+
+    def __init__(self, rate):
+        super().__init__(name='live decoder', daemon=True)
+        self.queue = queue.Queue(maxsize=DISPLAY_QUEUE_SIZE)
+        self.rate = rate
+        self.tokens = rate
+        self.last_offer = time.monotonic()
+        self.skipped = 0
+
+    def offer(self, line, data_b64=None):
+        now = time.monotonic()
+        self.tokens = min(self.rate,
+                          self.tokens + (now - self.last_offer) * self.rate)
+        self.last_offer = now
+        if self.tokens < 1:
+            self.skipped += 1
+            return
+        try:
+            self.queue.put_nowait((line, data_b64))
+        except queue.Full:
+            self.skipped += 1
+            return
+        self.tokens -= 1
+
+    def run(self):
+        while True:
+            record = self.queue.get()
+            if record is None:
+                break
+            line, data_b64 = record
+            if data_b64 is None:
+                print_line(line)
+            else:
+                print_blob(line, data_b64)
+
+    def stop(self):
+        self.queue.put(None)
+        self.join()
+
+
+def print_blob(line, data_b64):
+    title, version, _ = parse_blob_header(line)
+    try:
+        decoder = binary_parser.decoders[title]
+    except KeyError:
+        tqdm.write('Unsupported binary!', file=sys.stderr)
+        return
+
+    try:
+        decoded = str(decoder(data_b64, version))
+    except ValueError as e:
+        tqdm.write(f'Binary decoding error! {e}')
+        return
+
+    print_line(decoded)
 
 
-def serial_read(port, wait_for_reset, logger, limit, restart_count=0):
+def serial_read(port, wait_for_reset, logger, limit, restart_count=0,
+                commands=(), print_rate=DEFAULT_PRINT_RATE):
     connected = False
     twr_count = limit.last_twr_count
     last_rotation = 0
@@ -48,12 +301,19 @@ def serial_read(port, wait_for_reset, logger, limit, restart_count=0):
     timeout_count = 0
     blob_error_count = 0
     progress_bar = None
+    capture = None
+    display = None
     try:
-        with serial.Serial(port, baudrate=2250000, timeout=1) as ser:
+        with serial.Serial(port, baudrate=BAUDRATE, timeout=READ_TIMEOUT) as ser:
             connected = True
             print('Connected', file=sys.stderr)
 
+            capture = CaptureThread(ser)
+            display = LiveDecoder(print_rate)
+            framer = StreamFramer()
+
             progress_bar_set = True
+            trace = trace_decoder.TraceDecoder()
             if limit.twr is not None:
                 progress_bar = tqdm(total=limit.twr, unit=' frames')
             elif limit.full_rot is not None:
@@ -62,64 +322,30 @@ def serial_read(port, wait_for_reset, logger, limit, restart_count=0):
             else:
                 progress_bar = tqdm(unit=' frames')
             progress_bar.n = twr_count
-            progress_bar.set_postfix({
-                'restart count': restart_count,
-                'rotation': last_rotation,
-                '360 count': full_rotation_count,
-                'timeouts': timeout_count,
-                'blob decode errors': blob_error_count,
-            })
-
-            if wait_for_reset:
-                while True:
-                    line_raw = ser.read_until(b'\n')
-
-                    try:
-                        line = line_raw.decode('ascii').strip()
-                    except UnicodeDecodeError:
-                        continue
-
-                    if 'DW3000' not in line:
-                        print('\rWaiting for reset ...', end='', flush=True)
-                        continue
-                    else:
-                        print('\nDevice reset, start logging', file=sys.stderr)
-                        break
-
-            while True:
-                line_raw = ser.read_until(b'\n')
 
-                try:
-                    line = line_raw.decode('ascii').strip()
-                except UnicodeDecodeError:
-                    continue
-
-                if not line:
-                    continue
-
-                logger(line, time.time())
-
-                if 'BLOB' in line:
-                    try:
-                        serial_read_blob(ser, line, logger)
-                    except (IndexError, ValueError):
-                        tqdm.write(f'Error decoding blob. Line: {line}',
-                                   file=sys.stderr)
-                        blob_error_count += 1
-                elif 'rotation' in line:  # rotation and 360 count
+            def update_postfix():
+                progress_bar.set_postfix({
+                    'restart count': restart_count,
+                    'rotation': last_rotation,
+                    '360 count': full_rotation_count,
+                    'timeouts': timeout_count,
+                    'blob decode errors': blob_error_count,
+                    'lost bytes': capture.lost_bytes,
+                })
+
+            update_postfix()
+
+            def process_status_line(line):
+                nonlocal twr_count, last_rotation, full_rotation_count
+                nonlocal timeout_count, progress_bar_set
+                if 'rotation' in line:  # rotation and 360 count
                     parts = line.split()
                     last_rotation = int(parts[1].strip().strip(','))
                     full_rotation_count_new = int(parts[3].strip().strip(','))
                     if full_rotation_count != full_rotation_count_new:
                         full_rotation_count = full_rotation_count_new
                 elif 'dist_mm' in line:  # TWR successful
-                    progress_bar.set_postfix({
-                        'restart count': restart_count,
-                        'rotation': last_rotation,
-                        '360 count': full_rotation_count,
-                        'timeouts': timeout_count,
-                        'blob decode errors': blob_error_count,
-                    })
+                    update_postfix()
                     progress_bar.update(1)
                     twr_count += 1
                 elif 'Config' in line:
@@ -130,28 +356,101 @@ def serial_read(port, wait_for_reset, logger, limit, restart_count=0):
                                 'Rotation is disabled on the receiver, cannot '
                                 'use --limit-full-rot.'
                             )
+                        elif twr_per_angle == 'cont':
+                            # Continuous rotation, the number of frames per
+                            # rotation is not known in advance, keep the
+                            # frame counter
+                            pass
                         else:
                             twr_per_angle = int(twr_per_angle)
-                        # After receiving TWR per angle config switch to finer
-                        # grained progress bar.
-                        progress_bar_set = False
-                        progress_bar.reset(twr_per_angle*360*limit.full_rot)
-                        progress_bar.n = twr_count
-                        progress_bar.refresh()
+                            # After receiving TWR per angle config switch to
+                            # finer grained progress bar.
+                            progress_bar_set = False
+                            progress_bar.reset(twr_per_angle*360*limit.full_rot)
+                            progress_bar.n = twr_count
+                            progress_bar.refresh()
                 elif 'Timeout' in line:
                     timeout_count += 1
 
-                # Check if data collection limit is reached
-                if ((limit.twr is not None and twr_count > limit.twr) or
-                    (limit.full_rot is not None
-                     and full_rotation_count >= limit.full_rot)):
-                    break
+            def limit_reached():
+                return ((limit.twr is not None and twr_count > limit.twr) or
+                        (limit.full_rot is not None
+                         and full_rotation_count >= limit.full_rot))
+
+            def send_commands():
+                # e.g. "config plen 128", applied by the firmware between two
+                # exchanges and confirmed with a config blob
+                for command in commands:
+                    ser.write(command.encode('ascii') + b'\n')
+                    logger(f'Command: {command}', time.time())
+
+            capture.start()
+            display.start()
+            try:
+                waiting = wait_for_reset
+                if not waiting:
+                    send_commands()
+
+                for receive_time, data, lost in capture.chunks():
+                    if lost:
+                        # the partial line or blob before the gap is useless
+                        framer.reset()
+                        logger(f'Serial data lost: {lost} bytes', receive_time)
+
+                    for line, blob in framer.feed(data):
+                        if waiting:
+                            if 'DW3000' not in line:
+                                print('\rWaiting for reset ...', end='',
+                                      flush=True)
+                                continue
+                            print('\nDevice reset, start logging',
+                                  file=sys.stderr)
+                            waiting = False
+                            send_commands()
+                            continue
+
+                        display.offer(logger(line, receive_time, echo=False))
+
+                        if blob is not None:
+                            data_b64 = base64.b64encode(blob).decode('ascii')
+                            logger('Data: ' + data_b64, echo=False)
+                            try:
+                                trace_lines = serial_read_blob(line, data_b64,
+                                                               trace, display)
+                            except (IndexError, ValueError):
+                                tqdm.write(f'Error decoding blob. Line: {line}',
+                                           file=sys.stderr)
+                                blob_error_count += 1
+                                trace_lines = []
+                            # debug text output sent as binary trace records
+                            for trace_line in trace_lines:
+                                display.offer(trace_line)
+                                process_status_line(trace_line)
+                        elif 'BLOB' in line:
+                            tqdm.write(f'Error decoding blob. Line: {line}',
+                                       file=sys.stderr)
+                            blob_error_count += 1
+                        else:
+                            process_status_line(line)
+
+                        # Check if data collection limit is reached
+                        if limit_reached():
+                            break
+                    if limit_reached():
+                        break
+            finally:
+                capture.stop()
+                display.stop()
     except serial.SerialException as e:
         print('Connection error:', e)
         if connected:
             tqdm.write('Lost connection.', file=sys.stderr)
     if progress_bar is not None:
         progress_bar.close()
+    if capture is not None:
+        print(f'Capture queue high-water mark {capture.high_water} of '
+              f'{capture.queue.maxsize} buffers, {capture.lost_bytes} bytes '
+              f'lost, {display.skipped} lines/blobs not printed')
 
     limit.last_twr_count = twr_count
     if limit.twr is not None:
@@ -163,42 +462,19 @@ def serial_read(port, wait_for_reset, logger, limit, restart_count=0):
     return limit
 
 
-def serial_read_blob(ser, line, logger):
-    """Parse binary measurement data.
+def serial_read_blob(line, data_b64, trace, display):
+    """Process a received blob.
 
-    Header line format: "BLOB / type / version / length"
-    example: "BLOB / rx diag / v1 / 10"
+    Trace blobs are decoded here, their text lines are returned (empty list
+    otherwise). Other blobs are handed to the live decoder for printing.
     """
-    header = line.split('/')
-    title = header[1].strip()
-    try:
-        version = int(header[2].strip()[1:])
-        length = int(header[3].strip())
-    except ValueError:
-        print('Error on input line: ', line)
-        raise
+    title, version, _ = parse_blob_header(line)
 
-    data = ser.read(length)
-    data_b64 = base64.b64encode(data).decode('utf-8')
+    if title == 'trace':
+        return trace.decode_blob(data_b64, version)
 
-    logger('Data: ' + data_b64)
-
-    try:
-        decoder = binary_parser.decoders[title]
-    except KeyError:
-        tqdm.write('Unsupported binary!', file=sys.stderr)
-        return
-
-    try:
-        decoded = str(decoder(data_b64, version))
-    except ValueError as e:
-        tqdm.write('Binary decoding error!', e)
-        return
-
-    if len(decoded) > 200:
-        tqdm.write(decoded[:200] + ' ...')
-    else:
-        tqdm.write(decoded)
+    display.offer(line, data_b64)
+    return []
 
 
 def main():
@@ -216,6 +492,16 @@ def main():
     limit_group.add_argument('--limit-full-rot', default=None, type=int,
                         help='Minimum number of full rotations to log before stopping')
 
+    parser.add_argument('--print-rate', type=float,
+                        default=DEFAULT_PRINT_RATE,
+                        help=('Maximum number of lines and decoded blobs '
+                              'printed per second (all are logged, 0: only '
+                              'the progress bar)'))
+    parser.add_argument('--command', '-c', action='append', default=[],
+                        help=('Serial command sent after connecting, e.g. '
+                              '"config plen 128" or "app twr_anchor" '
+                              '(repeatable)'))
+
     args = parser.parse_args()
 
     if args.limit_full_rot and not args.wait_for_reset:
@@ -248,7 +534,8 @@ def main():
         restart_counter = 0
         while True:
             limit = serial_read(args.port, args.wait_for_reset, logger,
-                                limit, restart_counter)
+                                limit, restart_counter, args.command,
+                                args.print_rate)
             if limit.twr is not None:
                 remaining = limit.twr-limit.last_twr_count
                 if remaining <= 0:
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+
+
+"""Receive and first path power level, DW3000 user manual section 4.7.
+
+    rx power = 10 * log10(C * 2^21 / N^2) + 6 * D - A
+    fp power = 10 * log10((F1^2 + F2^2 + F3^2) / N^2) + 6 * D - A
+
+C, F1-F3 and N are the `power`, `F1`-`F3` and `accum_count` of the Ipatov CIR
+analysis, D the `dgc_decision` of the toa blob and A depends on the PRF (121.7
+for PRF 64 MHz).
+
+`rx_power_level()` and `fp_power_level()` compute the levels in dBm for whole
+arrays (NaN without accumulated symbols or where `valid` is False, -inf for a
+power of 0), `frame_power_levels()` for all frames of a FrameTable of
+serial_parser.py.
+
+`rx_power_cdbm()` and `fp_power_cdbm()` give bit-identical results to
+`Firmware/Core/Src/apps/signal_power.c` (integer log2 with a table, 0.01 dBm,
+`SIGNAL_POWER_INVALID` instead of NaN).
+
+Run on a log to compare the integer approximation of the firmware to the
+floating point values.
+"""
+
+import argparse
+
+import numpy as np
+
+
+A_PRF64 = 121.7  # dB, preamble codes 9-24
+A_PRF16 = 113.8  # dB, preamble codes 1-8
+RX_POWER_SCALE = 2**21
+
+SIGNAL_POWER_INVALID = -2**15
+
+# integer approximation of signal_power.c
+LOG2_FRACTION_BITS = 16
+LOG2_TABLE_BITS = 5
+LOG2_TABLE = np.array([round(np.log2(1 + i / 2**LOG2_TABLE_BITS)
+                             * 2**LOG2_FRACTION_BITS)
+                       for i in range(2**LOG2_TABLE_BITS + 1)], dtype=np.int64)
+CDB_PER_LOG2_Q32 = 19728302  # 100 * 10 * log10(2) / 2^16 in Q32
+RX_POWER_SCALE_BITS = 21
+DGC_STEP_CDB = 600
+A_PRF64_CDB = 12170
+A_PRF16_CDB = 11380
+
+
+def correction_a(rx_code):
+    '''A of the power levels in dB for the RX preamble code(s).'''
+    return np.where(np.asarray(rx_code) >= 9, A_PRF64, A_PRF16)
+
+
+def _power_level(power, N, D, A, valid):
+    power = np.asarray(power, dtype=np.float64)
+    N = np.asarray(N, dtype=np.float64)
+    with np.errstate(divide='ignore', invalid='ignore'):
+        level = 10 * np.log10(power / N**2) + (6 * np.asarray(D)) - A
+    invalid = N == 0
+    if valid is not None:
+        invalid = invalid | ~np.asarray(valid, dtype=bool)
+    return np.where(invalid, np.nan, level)
+
+
+def rx_power_level(C, N, D, A=A_PRF64, valid=None):
+    '''Receive power level in dBm (arrays or scalars).'''
+    C = np.asarray(C, dtype=np.float64)
+    return _power_level(C * RX_POWER_SCALE, N, D, A, valid)
+
+
+def fp_power_level(F1, F2, F3, N, D, A=A_PRF64, valid=None):
+    '''First path power level in dBm (arrays or scalars).'''
+    F1, F2, F3 = (np.asarray(F, dtype=np.float64) for F in (F1, F2, F3))
+    return _power_level(F1**2 + F2**2 + F3**2, N, D, A, valid)
+
+
+def frame_power_levels(table, A=A_PRF64):
+    '''Receive and first path power level of all frames of a FrameTable (NaN
+    without Ipatov CIR analysis or toa blob).'''
+    valid = table.present('cir_analysis_ip') & table.present('toa_data')
+    N = table.column('cir_analysis_ip', 'accum_count')
+    D = table.column('toa_data', 'dgc_decision')
+    rx = rx_power_level(table.column('cir_analysis_ip', 'power'), N, D, A,
+                        valid)
+    fp = fp_power_level(*(table.column('cir_analysis_ip', F)
+                          for F in ('F1', 'F2', 'F3')), N, D, A, valid)
+    return rx, fp
+
+
+def log2_q16(value):
+    '''log2 of integers > 0 in Q16 (like log2_q16() of signal_power.c).'''
+    value = np.asarray(value, dtype=np.uint64)
+    exponent = np.zeros(value.shape, dtype=np.int64)
+    rest = value.copy()
+    for bits in (32, 16, 8, 4, 2, 1):
+        high = rest >= np.uint64(1 << bits)
+        exponent[high] += bits
+        rest[high] >>= np.uint64(bits)
+    mantissa = value << (63 - exponent).astype(np.uint64)
+    index = (mantissa >> np.uint64(63 - LOG2_TABLE_BITS)).astype(np.int64) \
+        & (2**LOG2_TABLE_BITS - 1)
+    fraction = (mantissa >> np.uint64(63 - LOG2_TABLE_BITS - 16)).astype(
+        np.int64) & 0xFFFF
+    return ((exponent << LOG2_FRACTION_BITS) + LOG2_TABLE[index]
+            + (((LOG2_TABLE[index + 1] - LOG2_TABLE[index]) * fraction) >> 16))
+
+
+def _power_level_cdbm(power, scale_bits, N, D, rx_code):
+    power = np.asarray(power, dtype=np.uint64)
+    N = np.asarray(N, dtype=np.uint64)
+    invalid = (N == 0) | (power == 0)
+    # log2(1) for the invalid values, replaced below
+    log2_ratio = (log2_q16(np.where(invalid, 1, power))
+                  + (scale_bits << LOG2_FRACTION_BITS)
+                  - 2 * log2_q16(np.where(invalid, 1, N)))
+    level = (log2_ratio * CDB_PER_LOG2_Q32 + (1 << 31)) >> 32
+    a = np.where(np.asarray(rx_code) >= 9, A_PRF64_CDB, A_PRF16_CDB)
+    level = level + DGC_STEP_CDB * np.asarray(D, dtype=np.int64) - a
+    return np.where(invalid, SIGNAL_POWER_INVALID, level).astype(np.int16)
+
+
+def rx_power_cdbm(C, N, D, rx_code=9):
+    '''Receive power level in 0.01 dBm, integer approximation of the
+    firmware.'''
+    return _power_level_cdbm(C, RX_POWER_SCALE_BITS, N, D, rx_code)
+
+
+def fp_power_cdbm(F1, F2, F3, N, D, rx_code=9):
+    '''First path power level in 0.01 dBm, integer approximation of the
+    firmware.'''
+    F1, F2, F3 = (np.asarray(F, dtype=np.uint64) for F in (F1, F2, F3))
+    return _power_level_cdbm(F1 * F1 + F2 * F2 + F3 * F3, 0, N, D, rx_code)
+
+
+def main():
+    from serial_parser import parse_log_file
+
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('log_file', help='Log file written by serial_reader.py')
+
+    args = parser.parse_args()
+
+    table, _ = parse_log_file(args.log_file)
+    rx, fp = frame_power_levels(table)
+    valid = table.present('cir_analysis_ip') & table.present('toa_data')
+    N = table.column('cir_analysis_ip', 'accum_count')[valid]
+    D = table.column('toa_data', 'dgc_decision')[valid]
+    rx_int = rx_power_cdbm(table.column('cir_analysis_ip', 'power')[valid],
+                           N, D)
+    fp_int = fp_power_cdbm(*(table.column('cir_analysis_ip', F)[valid]
+                             for F in ('F1', 'F2', 'F3')), N, D)
+
+    print(f'{valid.sum()} of {len(table)} frames with power levels')
+    for name, level, level_int in (('rx', rx[valid], rx_int),
+                                   ('fp', fp[valid], fp_int)):
+        finite = np.isfinite(level) & (level_int != SIGNAL_POWER_INVALID)
+        if not finite.any():
+            print(f'{name} power: no valid values')
+            continue
+        error = level_int[finite] / 100 - level[finite]
+        print(f'{name} power: {np.mean(level[finite]):.2f} dBm mean, '
+              f'{np.min(level[finite]):.2f} .. {np.max(level[finite]):.2f} '
+              f'dBm, firmware error {np.abs(error).max():.4f} dB max')
+
+
+if __name__ == '__main__':
+    main()
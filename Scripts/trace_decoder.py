@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+
+
+"""Reconstruct the debug text output from binary trace blobs.
+
+The firmware stores only a format ID and raw arguments for each debug message
+(see `trace_log.h`). The format table is extracted from the `TRACE_FORMATS`
+macro in that header, the ID of each format is its position in the table.
+A copy of the table is shipped as `trace_formats.py` for use without the
+firmware tree, regenerate it with `--generate` after changing the header.
+
+Used as a library by `serial_reader.py` and `serial_parser.py`, or directly to
+print a log file with the trace blobs replaced by the decoded text.
+"""
+
+import os
+import re
+import sys
+import gzip
+import argparse
+
+import binary_parser
+
+
+DEFAULT_FORMAT_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                   '..', 'Firmware', 'Core', 'Src', 'apps',
+                                   'trace_log.h')
+DEFAULT_TABLE_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                  'trace_formats.py')
+
+format_entry_regex = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+conversion_regex = re.compile(r'%([-+ #0]*\d*)(?:l|ll|h|hh)?([diuxXc%])')
+
+c_escapes = {'n': '\n', 't': '\t', '\\': '\\', '"': '"'}
+
+
+def load_formats(format_file=DEFAULT_FORMAT_FILE):
+    '''Read the format table from the TRACE_FORMATS macro.
+
+    Returns a list of (name, format) tuples, the index is the format ID.
+    '''
+    with open(format_file) as f:
+        text = f.read()
+
+    start = text.find('#define TRACE_FORMATS(X)')
+    if start < 0:
+        raise ValueError(f'No TRACE_FORMATS table found in {format_file}')
+    # the macro ends at the first line without continuation
+    end = start
+    while True:
+        end = text.find('\n', end)
+        if end < 0 or not text[:end].rstrip().endswith('\\'):
+            break
+        end += 1
+
+    formats = []
+    for name, fmt in format_entry_regex.findall(text[start:end]):
+        fmt = re.sub(r'\\(.)', lambda m: c_escapes.get(m.group(1), m.group(1)),
+                     fmt)
+        formats.append((name, fmt))
+    return formats
+
+
+def generate_table(formats, table_file=DEFAULT_TABLE_FILE):
+    '''Write the format table as Python module (`trace_formats.py`).'''
+    with open(table_file, 'w') as f:
+        f.write('# Generated by `trace_decoder.py --generate` from trace_log.h, '
+                'do not edit.\n')
+        f.write('# Format table of the trace records, the index is the format '
+                'ID.\n\n')
+        f.write('FORMATS = [\n')
+        for name, fmt in formats:
+            f.write(f'    ({name!r}, {fmt!r}),\n')
+        f.write(']\n')
+
+
+def to_signed(value):
+    return value - (1 << 32) if value & (1 << 31) else value
+
+
+def format_record(fmt, args):
+    '''Apply a C format string to the raw 32-bit arguments.'''
+    args = iter(args)
+
+    def convert(match):
+        flags, conversion = match.groups()
+        if conversion == '%':
+            return '%'
+        value = next(args, 0)
+        if conversion in 'di':
+            value = to_signed(value)
+        elif conversion == 'u':
+            conversion = 'd'
+        elif conversion == 'c':
+            value = chr(value & 0xFF)
+        return ('%' + flags + conversion) % value
+
+    return conversion_regex.sub(convert, fmt)
+
+
+class TraceDecoder:
+    '''Convert trace records to text lines.
+
+    Formats without a trailing newline continue on the next record, possibly
+    in the next blob, so one decoder instance has to be used for a whole log.
+    The format table is read with the first record from the header, without
+    the firmware tree from the shipped `trace_formats.py`. A shipped table
+    that differs from the header is reported (it has to be regenerated).
+    '''
+
+    def __init__(self, format_file=DEFAULT_FORMAT_FILE):
+        self.format_file = format_file
+        self.formats = None
+        self.partial = ''
+
+    def _load_formats(self):
+        try:
+            import trace_formats
+            shipped = [tuple(entry) for entry in trace_formats.FORMATS]
+        except ImportError:
+            shipped = None
+        try:
+            self.formats = load_formats(self.format_file)
+        except OSError as e:
+            if shipped is None:
+                raise RuntimeError(f'Trace formats not available ({e}) and '
+                                   'no trace_formats.py') from e
+            self.formats = shipped
+            return
+        if shipped != self.formats:
+            print(f'Warning: trace_formats.py differs from {self.format_file}, '
+                  'regenerate it with trace_decoder.py --generate',
+                  file=sys.stderr)
+
+    def decode(self, records):
+        '''Returns the list of completed lines (without newline).'''
+        if self.formats is None:
+            self._load_formats()
+        text = self.partial
+        for record in records:
+            try:
+                fmt = self.formats[record.id][1]
+            except IndexError:
+                fmt = f'Unknown trace id {record.id}: %lu %lu %lu\n'
+            text += format_record(fmt, record.args)
+
+        lines = text.split('\n')
+        self.partial = lines.pop()
+        return lines
+
+    def decode_blob(self, b64_buffer, version):
+        decode_blob = binary_parser.decoders['trace']
+        return self.decode(decode_blob(b64_buffer, version))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument('log_file', nargs='?',
+                        help='Log file written by serial_reader.py')
+    parser.add_argument('--formats', default=DEFAULT_FORMAT_FILE,
+                        help='Header file containing the trace format table.')
+    parser.add_argument('--generate', action='store_true',
+                        help='Write the format table of the header to '
+                             'trace_formats.py (shipped with the scripts).')
+
+    args = parser.parse_args()
+
+    if args.generate:
+        formats = load_formats(args.formats)
+        generate_table(formats)
+        print(f'{len(formats)} formats written to {DEFAULT_TABLE_FILE}')
+        return
+    if args.log_file is None:
+        parser.error('log_file is required')
+
+    decoder = TraceDecoder(args.formats)
+
+    log_open = gzip.open if args.log_file.endswith('.gz') else open
+    with log_open(args.log_file, 'rt') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if 'BLOB / trace' not in line:
+                print(line)
+                continue
+
+            timestamp = line.split(':')[0]
+            blob_data = f.readline()
+            try:
+                version = int(line.split('/')[2].strip()[1:])
+                lines = decoder.decode_blob(blob_data.split(':')[2].strip(),
+                                            version)
+            except (IndexError, ValueError) as e:
+                print(f'Error decoding trace blob ({e}). Line: {line}')
+                continue
+            for text in lines:
+                print(f'{timestamp}: {text}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,52 @@
+# Generated by `trace_decoder.py --generate` from trace_log.h, do not edit.
+# Format table of the trace records, the index is the format ID.
+
+FORMATS = [
+    ('TRACE_DROPPED', 'Trace: %lu records dropped\n'),
+    ('TRACE_TIMEOUT', 'Timeout -> reset\n'),
+    ('TRACE_RANGING_ERROR', 'Ranging error -> reset\n'),
+    ('TRACE_TX_SYNC', 'TX: Sync frame\n'),
+    ('TRACE_TX_RESPONSE', 'TX: Response frame\n'),
+    ('TRACE_RX_POLL', 'RX: Poll frame\n'),
+    ('TRACE_RX_FINAL', 'RX: Final frame\n'),
+    ('TRACE_TX_ERR_SYNC', 'TX ERR: could not send sync frame\n'),
+    ('TRACE_TX_ERR_POLL', 'TX ERR: could not send poll frame\n'),
+    ('TRACE_TX_ERR_DELAYED', 'TX ERR: delayed send time missed\n'),
+    ('TRACE_RX_ERR_LENGTH', 'RX ERR: wrong frame length\n'),
+    ('TRACE_RX_ERR_STS', 'RX ERR: bad STS quality\n'),
+    ('TRACE_RX_ERR_EXPECTED_POLL', 'RX ERR: wrong frame (expected poll)\n'),
+    ('TRACE_RX_ERR_EXPECTED_FINAL', 'RX ERR: wrong frame (expected final)\n'),
+    ('TRACE_RX_ERR_SEQUENCE', 'RX ERR: wrong sequence number\n'),
+    ('TRACE_TWR_RESULT', 'twr_count: %lu, dist_mm: %lu\n'),
+    ('TRACE_ROTATION', 'rotation: %lu, 360_count: %lu\n'),
+    ('TRACE_MULTI_RESULT', 'slot: %lu, dist_mm: %lu\n'),
+    ('TRACE_MULTI_RESPONSES', 'twr_count: %lu, responses: %lu/%lu\n'),
+    ('TRACE_FRAME_RECEIVED', 'Frame Received (v5)\n'),
+    ('TRACE_FRAME_COUNT', 'count: %lu\n'),
+    ('TRACE_IP_TOA', 'ip_toa: 0x%02lX%08lX\n'),
+    ('TRACE_IP_TOAST', 'ip_toast: 0x%lX\n'),
+    ('TRACE_IP_POA', 'ip_poa: %lu\n'),
+    ('TRACE_IP_FP', 'ip_fp: %lu\n'),
+    ('TRACE_STS1_TOA', 'sts1_toa: 0x%02lX%08lX\n'),
+    ('TRACE_STS1_TOAST', 'sts1_toast: 0x%lX\n'),
+    ('TRACE_STS1_POA', 'sts1_poa: %lu\n'),
+    ('TRACE_STS1_FP', 'sts1_fp: %lu\n'),
+    ('TRACE_STS2_TOA', 'sts2_toa: 0x%02lX%08lX\n'),
+    ('TRACE_STS2_TOAST', 'sts2_toast: 0x%lX\n'),
+    ('TRACE_STS2_POA', 'sts2_poa: %lu\n'),
+    ('TRACE_STS2_FP', 'sts2_fp: %lu\n'),
+    ('TRACE_XTAL_OFFSET', 'xtaloffset: %ld\n'),
+    ('TRACE_TDOA', 'tdoa: 0x%02lX%02lX%08lX\n'),
+    ('TRACE_PDOA', 'pdoa: %ld\n'),
+    ('TRACE_FPTH', 'fpth: %lu\n'),
+    ('TRACE_STS_QUAL_GOOD', 'sts qual: good (%ld)\n'),
+    ('TRACE_STS_QUAL_BAD', 'sts qual: bad (%ld)\n'),
+    ('TRACE_CIR_IP_START', 'CIR IP: '),
+    ('TRACE_CIR_IP_END', 'END CIR IP\n'),
+    ('TRACE_CIR_STS1_START', 'CIR STS1: '),
+    ('TRACE_CIR_STS1_END', 'END CIR STS1\n'),
+    ('TRACE_CIR_STS2_START', 'CIR STS2: '),
+    ('TRACE_CIR_STS2_END', 'END CIR STS2\n'),
+    ('TRACE_CIR_SAMPLE', '%lu r %ld i %ld | '),
+    ('TRACE_MOTOR_STOPPED', 'motor: stopped at step %ld\n'),
+]
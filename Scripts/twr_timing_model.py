@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+
+
+"""Check the slot timing of the broadcast poll ranging against the radio configuration.
+
+The firmware configuration is read directly from `application_config.h`
+(`dwt_config_t config` initializer and the `MULTI_TWR_*` defines). For each
+frame of the exchange the on-air duration is estimated and the following
+constraints are checked (all delays are relative to the RMARKER, i.e. the
+timestamped end of the SFD):
+- the anchor in slot 0 receives the poll, processes it and starts the preamble
+  of its response in time (MULTI_TWR_FIRST_SLOT_US)
+- two responses do not overlap and the tag has time to read the diagnostics
+  and re-enable the receiver in between (MULTI_TWR_SLOT_US)
+- the last response ends before the tag stops waiting for responses, and the
+  final frame can still be written and scheduled (MULTI_TWR_FINAL_GUARD_US)
+
+Frame duration model (DW3000 user manual / IEEE 802.15.4z HRP UWB PHY):
+- preamble and SFD symbols: 993.59 ns (16 MHz PRF, codes 3, 4) or 1017.63 ns
+  (64 MHz PRF, codes 9-12)
+- STS: blocks of 512 chips (1.0256 us), the gap between SFD and STS is ignored
+- PHR: 19 bits at 850 kb/s (or at the data rate if DWT_PHRRATE_DTA is used)
+- payload including FCS: 8 bits per byte plus 48 Reed-Solomon parity bits for
+  each block of up to 330 data bits
+
+The model is conservative enough to catch configurations that cannot work
+(e.g. a longer preamble without adapting the slot spacing), it does not replace
+a measurement. The script exits with a nonzero status if a constraint is
+violated. The firmware applies the same model and checks to the runtime
+`config` command (`radio_config_check_multi_twr()` in `radio_config.c`).
+"""
+
+import os
+import re
+import sys
+import math
+import argparse
+
+
+DEFAULT_CONFIG_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                   '..', 'Firmware', 'Core', 'Src', 'apps',
+                                   'application_config.h')
+
+# order of the fields in the dwt_config_t initializer
+config_fields = ('chan', 'preamble_length', 'pac', 'tx_code', 'rx_code',
+                 'sfd_type', 'data_rate', 'phr_mode', 'phr_rate',
+                 'sfd_timeout', 'sts_mode', 'sts_length', 'pdoa_mode')
+
+preamble_lengths = {
+    'DWT_PLEN_32': 32, 'DWT_PLEN_64': 64, 'DWT_PLEN_72': 72,
+    'DWT_PLEN_128': 128, 'DWT_PLEN_256': 256, 'DWT_PLEN_512': 512,
+    'DWT_PLEN_1024': 1024, 'DWT_PLEN_1536': 1536, 'DWT_PLEN_2048': 2048,
+    'DWT_PLEN_4096': 4096,
+}
+
+# SFD length in symbols for sfd_type 0..3
+sfd_lengths = (8, 8, 16, 8)
+
+# bit duration in ns
+bit_durations = {
+    'DWT_BR_850K': 1025.64,
+    'DWT_BR_6M8': 128.21,
+}
+
+PHR_BITS = 19
+PHR_BIT_DURATION_STD = 1025.64
+RS_BLOCK_BITS = 330
+RS_PARITY_BITS = 48
+STS_BLOCK_DURATION = 1025.64
+
+# Frame lengths including the 2 byte FCS (see frame structs in application_config.h)
+BASE_FRAME_LENGTH = 10 + 2
+
+
+def frame_lengths(anchor_count):
+    return {
+        'poll': BASE_FRAME_LENGTH,
+        'response': BASE_FRAME_LENGTH + 1 + 4,
+        'final': BASE_FRAME_LENGTH + 1 + 10 * anchor_count,
+        # frames of the original four message exchange (sync, poll, response, final)
+        'twr sync': BASE_FRAME_LENGTH,
+        'twr poll': BASE_FRAME_LENGTH,
+        'twr response': BASE_FRAME_LENGTH,
+        'twr final': BASE_FRAME_LENGTH + 10,
+    }
+
+
+def strip_comments(text):
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.DOTALL)
+    return re.sub(r'//[^\n]*', '', text)
+
+
+def read_config(config_file):
+    '''Extract the radio configuration and the slot timing from the header.'''
+    with open(config_file) as f:
+        text = strip_comments(f.read())
+
+    match = re.search(r'dwt_config_t\s+config\s*=\s*\{(.*?)\};', text,
+                      re.DOTALL)
+    if not match:
+        raise ValueError(f'No dwt_config_t initializer found in {config_file}')
+    values = [v.strip() for v in match.group(1).split(',') if v.strip()]
+    if len(values) != len(config_fields):
+        raise ValueError(f'Unexpected number of config values: {values}')
+    config = dict(zip(config_fields, values))
+
+    defines = dict(re.findall(r'#define\s+(MULTI_TWR_\w+)\s+\(?\s*(\w+)\s*\)?',
+                              text))
+    try:
+        timing = {
+            'anchor_count': int(defines['MULTI_TWR_ANCHOR_COUNT'], 0),
+            'first_slot_us': int(defines['MULTI_TWR_FIRST_SLOT_US'], 0),
+            'slot_us': int(defines['MULTI_TWR_SLOT_US'], 0),
+            'final_guard_us': int(defines['MULTI_TWR_FINAL_GUARD_US'], 0),
+            'margin_us': int(defines['MULTI_TWR_MARGIN_US'], 0),
+        }
+    except KeyError as e:
+        raise ValueError(f'Missing define in {config_file}: {e}')
+
+    return config, timing
+
+
+class FrameModel:
+    '''On-air duration of a frame split at the RMARKER (in us).'''
+
+    def __init__(self, config):
+        tx_code = int(config['tx_code'], 0)
+        self.symbol = 1017.63 if tx_code >= 9 else 993.59
+        self.preamble = preamble_lengths[config['preamble_length']]
+        self.sfd = sfd_lengths[int(config['sfd_type'], 0)]
+        self.bit = bit_durations[config['data_rate']]
+        self.phr_bit = (self.bit if config['phr_rate'] == 'DWT_PHRRATE_DTA'
+                        else PHR_BIT_DURATION_STD)
+
+        sts_mode = config['sts_mode']
+        if 'DWT_STS_MODE_OFF' in sts_mode:
+            self.sts_blocks = 0
+        else:
+            self.sts_blocks = int(config['sts_length'].split('_')[-1])
+        # no PHR and payload in STS mode 3 (STS packet configuration 3)
+        self.no_data = 'DWT_STS_MODE_ND' in sts_mode
+
+    def before_rmarker(self):
+        return (self.preamble + self.sfd) * self.symbol / 1000
+
+    def after_rmarker(self, length):
+        duration = self.sts_blocks * STS_BLOCK_DURATION
+        if not self.no_data:
+            bits = 8 * length
+            parity = math.ceil(bits / RS_BLOCK_BITS) * RS_PARITY_BITS
+            duration += PHR_BITS * self.phr_bit + (bits + parity) * self.bit
+        return duration / 1000
+
+    def total(self, length):
+        return self.before_rmarker() + self.after_rmarker(length)
+
+
+def check_timing(model, timing, margin_us):
+    '''Returns a list of (description, required, configured) tuples.'''
+    lengths = frame_lengths(timing['anchor_count'])
+    poll_after = model.after_rmarker(lengths['poll'])
+    resp_before = model.before_rmarker()
+    resp_after = model.after_rmarker(lengths['response'])
+    final_before = model.before_rmarker()
+
+    checks = [
+        ('first slot (poll RX -> response TX)',
+         poll_after + margin_us + resp_before, timing['first_slot_us']),
+        ('slot spacing (response -> response)',
+         resp_after + margin_us + resp_before, timing['slot_us']),
+        # the tag stops waiting half of the guard time before the final frame
+        ('final guard (last slot -> final TX)',
+         2 * max(resp_after + margin_us, final_before + margin_us),
+         timing['final_guard_us']),
+    ]
+    return checks
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument('config_file', nargs='?', default=DEFAULT_CONFIG_FILE,
+                        help='Firmware configuration header to check.')
+    parser.add_argument('--margin-us', type=float, default=None,
+                        help='Processing margin required by the firmware '
+                        'between the end of a frame and the start of the next '
+                        '(interrupt, diagnostics readout, delayed TX setup), '
+                        'default MULTI_TWR_MARGIN_US.')
+    parser.add_argument('--anchors', type=int, default=None,
+                        help='Override the number of anchors/slots.')
+
+    args = parser.parse_args()
+
+    config, timing = read_config(args.config_file)
+    if args.anchors is not None:
+        timing['anchor_count'] = args.anchors
+    if args.margin_us is not None:
+        timing['margin_us'] = args.margin_us
+    model = FrameModel(config)
+    lengths = frame_lengths(timing['anchor_count'])
+    n = timing['anchor_count']
+
+    print('Configuration')
+    for k, v in config.items():
+        print(f'  {k}: {v}')
+    for k, v in timing.items():
+        print(f'  {k}: {v}')
+
+    print('\nFrame durations [us] (before RMARKER + after RMARKER)')
+    for name, length in lengths.items():
+        print(f'  {name:14s} {length:3d} bytes: {model.before_rmarker():8.1f} '
+              f'+ {model.after_rmarker(length):8.1f} = {model.total(length):8.1f}')
+
+    airtime_multi = (model.total(lengths['poll'])
+                     + n * model.total(lengths['response'])
+                     + model.total(lengths['final']))
+    airtime_single = n * (model.total(lengths['twr sync'])
+                          + model.total(lengths['twr poll'])
+                          + model.total(lengths['twr response'])
+                          + model.total(lengths['twr final']))
+    exchange_multi = timing['first_slot_us'] + n * timing['slot_us'] \
+        + timing['final_guard_us'] + model.after_rmarker(lengths['final'])
+
+    print(f'\nAirtime for {n} anchors')
+    print(f'  broadcast poll ({n + 2} frames): {airtime_multi:8.1f} us')
+    print(f'  separate TWR ({4 * n} frames):   {airtime_single:8.1f} us')
+    print(f'  broadcast poll exchange duration: {exchange_multi:8.1f} us')
+
+    print(f'\nSlot timing (processing margin {timing["margin_us"]} us)')
+    violations = 0
+    for description, required, configured in check_timing(
+            model, timing, timing['margin_us']):
+        ok = configured >= required
+        violations += not ok
+        print(f'  {description:38s} required {required:8.1f} us, '
+              f'configured {configured:6d} us: {"ok" if ok else "VIOLATED"}')
+
+    if violations:
+        print(f'\n{violations} timing constraint(s) violated!')
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()